@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "buffer_pool.h"
+
+// The smallest class is the size of the buffers we always used
+// (DATA_BUFFER_SIZE), which fits most requests and responses
+const std::array<size_t, 4> BufferPool::ClassSizes = {
+        {2048, 16 * 1024, 128 * 1024, 1024 * 1024}};
+
+const std::array<size_t, 4> BufferPool::ClassLimits = {{64, 16, 4, 1}};
+
+bool BufferPool::borrow(size_t size, std::unique_ptr<cb::Pipe>& buffer) {
+    bool pooled = false;
+
+    size_t index = 0;
+    while (index < ClassSizes.size() && ClassSizes[index] < size) {
+        ++index;
+    }
+
+    if (index < ClassSizes.size() && !classes[index].empty()) {
+        buffer = std::move(classes[index].back());
+        classes[index].pop_back();
+        pooled = true;
+    } else {
+        if (index < ClassSizes.size()) {
+            size = ClassSizes[index];
+        }
+        buffer = std::make_unique<cb::Pipe>(size);
+        stats.allocated_buffers++;
+    }
+
+    const auto capacity = getCapacity(*buffer);
+    if (pooled) {
+        stats.pooled_buffers--;
+        stats.pooled_bytes -= capacity;
+    }
+    stats.borrowed_buffers++;
+    stats.borrowed_bytes += capacity;
+
+    return pooled;
+}
+
+void BufferPool::giveBack(std::unique_ptr<cb::Pipe>& buffer, size_t loan) {
+    stats.borrowed_buffers--;
+    stats.borrowed_bytes -= loan;
+
+    // The buffer may have grown while it was borrowed; put it in the
+    // largest class it fits, unless it grew well past the largest class (to
+    // receive a huge packet)
+    const auto capacity = getCapacity(*buffer);
+    if (capacity <= ClassSizes.back() * 2) {
+        size_t index = ClassSizes.size();
+        while (index > 0 && ClassSizes[index - 1] > capacity) {
+            --index;
+        }
+
+        if (index > 0 && classes[index - 1].size() < ClassLimits[index - 1]) {
+            classes[index - 1].push_back(std::move(buffer));
+            stats.pooled_buffers++;
+            stats.pooled_bytes += capacity;
+            return;
+        }
+    }
+
+    buffer.reset();
+    stats.freed_buffers++;
+}
+
+size_t BufferPool::getCapacity(cb::Pipe& buffer) {
+    buffer.clear();
+    return buffer.wsize();
+}
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/pipe.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * The pool of network buffers owned by a worker thread.
+ *
+ * A connection borrows its read and write buffers from the pool of its
+ * thread while it has data in flight, and gives them back as soon as they
+ * are empty (see conn_loan_buffers() and conn_return_buffers()), so an idle
+ * connection doesn't hold any buffers.
+ *
+ * The buffers are kept in size classes. A buffer is borrowed from the
+ * smallest class which fits the requested size, so that the (few) large
+ * buffers grown for big packets aren't tied up by connections sending small
+ * requests. Each class keeps a limited number of buffers; buffers given back
+ * to a full class (or much larger than the largest class) are freed.
+ *
+ * All the methods must be called by the worker thread (apart from
+ * getStats()).
+ */
+class BufferPool {
+public:
+    struct Stats {
+        /** Number of buffers kept in the pool */
+        std::atomic<uint64_t> pooled_buffers{0};
+        /** Number of bytes kept in the pool */
+        std::atomic<uint64_t> pooled_bytes{0};
+        /** Number of buffers lent to connections */
+        std::atomic<uint64_t> borrowed_buffers{0};
+        /** Number of bytes lent to connections (their size when borrowed) */
+        std::atomic<uint64_t> borrowed_bytes{0};
+        /** Number of buffers allocated (as the pool had none to lend) */
+        std::atomic<uint64_t> allocated_buffers{0};
+        /** Number of buffers freed (as the pool was full) */
+        std::atomic<uint64_t> freed_buffers{0};
+    };
+
+    BufferPool() = default;
+
+    BufferPool(const BufferPool&) = delete;
+
+    /**
+     * Borrow a buffer with room for (at least) the given number of bytes
+     *
+     * @param size the number of bytes the buffer should hold
+     * @param buffer where to store the buffer
+     * @return true if the buffer was taken from the pool, false if a new
+     *         one was allocated
+     * @throws std::bad_alloc if allocating the buffer fails
+     */
+    bool borrow(size_t size, std::unique_ptr<cb::Pipe>& buffer);
+
+    /**
+     * Give back an (empty) buffer borrowed from the pool
+     *
+     * @param buffer the buffer (reset)
+     * @param loan the size of the buffer when it was borrowed (see
+     *             getCapacity())
+     */
+    void giveBack(std::unique_ptr<cb::Pipe>& buffer, size_t loan);
+
+    /**
+     * Get the number of bytes an empty buffer may hold
+     */
+    static size_t getCapacity(cb::Pipe& buffer);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+    /** The sizes of the buffers in each class */
+    static const std::array<size_t, 4> ClassSizes;
+
+    /** The maximum number of buffers kept in each class */
+    static const std::array<size_t, 4> ClassLimits;
+
+private:
+    std::array<std::vector<std::unique_ptr<cb::Pipe>>, 4> classes;
+
+    Stats stats;
+};
@@ -245,6 +245,13 @@ public:
         return false;
     }
 
+    /**
+     * @todo this should be pushed down to MCBP, doesn't apply to everyone else
+     */
+    virtual bool isSharedMemoryConnection() {
+        return false;
+    }
+
     /**
      * @todo this should be pushed down to MCBP, doesn't apply to everyone else
      */
@@ -29,7 +29,8 @@ ListenConnection::ListenConnection(SOCKET sfd,
                                    event_base* b,
                                    in_port_t port,
                                    sa_family_t fam,
-                                   const interface& interf)
+                                   const interface& interf,
+                                   LIBEVENT_THREAD* owner_)
     : Connection(sfd, b),
       registered_in_libevent(false),
       family(fam),
@@ -37,6 +38,7 @@ ListenConnection::ListenConnection(SOCKET sfd,
       ssl(!interf.ssl.cert.empty()),
       management(interf.management),
       protocol(interf.protocol),
+      owner(owner_),
       ev(event_new(b, sfd, EV_READ | EV_PERSIST, listen_event_handler,
                    reinterpret_cast<void*>(this))) {
 
@@ -56,13 +58,19 @@ ListenConnection::~ListenConnection() {
 
 }
 
+void ListenConnection::releaseEvent() {
+    disable();
+    ev.reset();
+    registered_in_libevent = false;
+}
+
 const Protocol ListenConnection::getProtocol() const {
     // @todo we need a new version of this
     return Protocol::Memcached;
 }
 
 void ListenConnection::enable() {
-    if (!registered_in_libevent) {
+    if (!registered_in_libevent && ev) {
         if (management || is_server_initialized()) {
             LOG_NOTICE(this, "%u Listen on %s", getId(), getSockname().c_str());
             if (listen(getSocketDescriptor(), backlog) == SOCKET_ERROR) {
@@ -32,11 +32,16 @@ class ListenConnection : public Connection {
 public:
     ListenConnection() = delete;
 
+    /**
+     * @param owner the worker thread accepting clients on the socket (and
+     *              running event base b), or nullptr for the dispatcher
+     */
     ListenConnection(SOCKET sfd,
                      event_base* b,
                      in_port_t port,
                      sa_family_t fam,
-                     const struct interface &interf);
+                     const struct interface &interf,
+                     LIBEVENT_THREAD* owner = nullptr);
 
     virtual ~ListenConnection();
 
@@ -48,12 +53,27 @@ public:
 
     void disable();
 
+    /**
+     * Disable the socket and delete its event, as the event base is about
+     * to be freed. The socket can't be enabled again.
+     */
+    void releaseEvent();
+
     virtual void runEventLoop(short) override;
 
     bool isManagement() const {
         return management;
     }
 
+    /**
+     * Get the worker thread which owns this socket (see
+     * Settings::isPerThreadListeners()), or nullptr if it is owned by the
+     * dispatcher. Only the owner may enable or disable the socket.
+     */
+    LIBEVENT_THREAD* getOwner() const {
+        return owner;
+    }
+
     /**
      * Get the details for this connection to put in the portnumber
      * file so that the test framework may pick up the port numbers
@@ -67,6 +87,7 @@ protected:
     const bool ssl;
     const bool management;
     const Protocol protocol;
+    LIBEVENT_THREAD* const owner;
 
     struct EventDeleter {
         void operator()(struct event* ev) {
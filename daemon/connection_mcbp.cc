@@ -20,8 +20,12 @@
 #include "runtime.h"
 #include "statemachine_mcbp.h"
 #include "mc_time.h"
+#include "protocol/mcbp/engine_wrapper.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstring>
 #include <exception>
 #include <utilities/protocol2text.h>
 #include <platform/cb_malloc.h>
@@ -29,6 +33,34 @@
 #include <platform/strerror.h>
 #include <platform/timeutils.h>
 
+/**
+ * The number of bytes of the values being streamed into items by all
+ * connections (limited by stream_value_limit)
+ */
+static std::atomic<size_t> streamingValueBytes{0};
+
+/**
+ * Account for a value about to be streamed, unless it would exceed
+ * stream_value_limit
+ *
+ * @return true if the value may be streamed
+ */
+static bool reserveStreamedValue(size_t size) {
+    const size_t limit = settings.getStreamValueLimit();
+    size_t current = streamingValueBytes.load();
+    do {
+        if (size > limit || current > limit - size) {
+            return false;
+        }
+    } while (!streamingValueBytes.compare_exchange_weak(current,
+                                                        current + size));
+    return true;
+}
+
+static void releaseStreamedValue(size_t size) {
+    streamingValueBytes.fetch_sub(size);
+}
+
 bool McbpConnection::unregisterEvent() {
     if (!registered_in_libevent) {
         LOG_WARNING(NULL,
@@ -86,6 +118,43 @@ bool McbpConnection::registerEvent() {
 bool McbpConnection::updateEvent(const short new_flags) {
     struct event_base* base = event.ev_base;
 
+    if (ioUring) {
+        // The socket isn't polled, so the event is only used for the idle
+        // timeout, and activated when the io_uring has completed what we
+        // wait for. That doesn't involve the kernel, so always re-register
+        // it (which also restarts the timeout).
+        if (registered_in_libevent && !unregisterEvent()) {
+            LOG_WARNING(this,
+                        "Failed to remove connection from event notification "
+                        "library. Shutting down connection %s",
+                        getDescription().c_str());
+            return false;
+        }
+        if (event_assign(&event, base, socketDescriptor,
+                         new_flags & EV_PERSIST, event_handler,
+                         reinterpret_cast<void*>(this)) == -1) {
+            LOG_WARNING(this,
+                        "Failed to set up event notification. "
+                        "Shutting down connection %s",
+                        getDescription().c_str());
+            return false;
+        }
+        ev_flags = new_flags;
+        if (!registerEvent()) {
+            LOG_WARNING(this,
+                        "Failed to add connection to the event notification "
+                        "library. Shutting down connection %s",
+                        getDescription().c_str());
+            return false;
+        }
+
+        const short ready = ioUring->getReadyEvents(new_flags);
+        if (ready != 0) {
+            event_active(&event, ready, 0);
+        }
+        return true;
+    }
+
     if (ssl.isEnabled() && ssl.isConnected() && (new_flags & EV_READ)) {
         /*
          * If we want more data and we have SSL, that data might be inside
@@ -162,6 +231,46 @@ bool McbpConnection::reapplyEventmask() {
     return updateEvent(ev_flags);
 }
 
+bool McbpConnection::enableIoUring(IoUringLoop& loop) {
+    ioUring = std::make_unique<IoUringSocket>(loop, *this, socketDescriptor);
+    if (!updateEvent(ev_flags)) {
+        // Let the state machine close the connection
+        setState(conn_closing);
+        event_active(&event, EV_READ, 0);
+        return false;
+    }
+    return true;
+}
+
+void McbpConnection::signalIoUring(short which) {
+    if (isSocketClosed()) {
+        // The last operation completed; let conn_pending_close continue
+        event_active(&event, EV_READ, 0);
+    } else if (registered_in_libevent && (ev_flags & which)) {
+        event_active(&event, ev_flags & which, 0);
+    }
+}
+
+void McbpConnection::cancelIoUring() {
+    if (!ioUring) {
+        return;
+    }
+    ioUring->close();
+    // The event is now only activated once the operations have completed,
+    // and the socket is closed by then.
+    event_del(&event);
+    registered_in_libevent = false;
+    event_assign(&event, event.ev_base, INVALID_SOCKET, 0, event_handler,
+                 reinterpret_cast<void*>(this));
+}
+
+void McbpConnection::releaseIoUring() {
+    if (ioUring) {
+        event_del(&event);
+        ioUring.reset();
+    }
+}
+
 bool McbpConnection::initializeEvent() {
     short event_flags = (EV_READ | EV_PERSIST);
 
@@ -178,6 +287,12 @@ void McbpConnection::shrinkBuffers() {
     // We share the buffers with the thread, so we don't need to worry
     // about the read and write buffer.
 
+    if (hasCorkedResponses()) {
+        // The IO vector holds the responses we're holding back
+        dynamicBuffer.clear();
+        return;
+    }
+
     if (msglist.size() > MSG_LIST_HIGHWAT) {
         try {
             msglist.resize(MSG_LIST_INITIAL);
@@ -322,7 +437,11 @@ int McbpConnection::recv(char* dest, size_t nbytes) {
             res = sslRead(dest, nbytes);
         }
     } else {
-        res = (int)::recv(socketDescriptor, dest, nbytes, 0);
+        if (ioUring) {
+            res = ioUring->recv(dest, nbytes);
+        } else {
+            res = (int)::recv(socketDescriptor, dest, nbytes, 0);
+        }
         if (res > 0) {
             totalRecv += res;
         }
@@ -350,7 +469,11 @@ int McbpConnection::sendmsg(struct msghdr* m) {
         ssl.drainBioSendPipe(socketDescriptor);
         return res;
     } else {
-        res = int(::sendmsg(socketDescriptor, m, 0));
+        if (ioUring) {
+            res = ioUring->sendmsg(m);
+        } else {
+            res = int(::sendmsg(socketDescriptor, m, 0));
+        }
         if (res > 0) {
             totalSend += res;
         }
@@ -360,6 +483,8 @@ int McbpConnection::sendmsg(struct msghdr* m) {
 }
 
 McbpConnection::TransmitResult McbpConnection::transmit() {
+    transmitting = true;
+
     if (ssl.isEnabled()) {
         // We use OpenSSL to write data into a buffer before we send it
         // over the wire... Lets go ahead and drain that BIO pipe before
@@ -389,16 +514,18 @@ McbpConnection::TransmitResult McbpConnection::transmit() {
 
         res = sendmsg(m);
         auto error = GetLastNetworkError();
+        get_thread_stats(this)->send_calls++;
         if (res > 0) {
             get_thread_stats(this)->bytes_written += res;
 
             // We've written some of the data. Remove the completed iovec
             // entries from the list of pending writes (and if the data was
-            // from our write buffer we should mark the section as unused)
+            // from our write buffer we should mark the section as unused.
+            // Only that section; the write buffer may hold several responses)
             while (m->msg_iovlen > 0 && res >= ssize_t(m->msg_iov->iov_len)) {
                 write->consume([&m](const void* ptr, size_t size) -> ssize_t {
                     if (m->msg_iov->iov_base == ptr) {
-                        return size;
+                        return m->msg_iov->iov_len;
                     }
                     return 0;
                 });
@@ -437,6 +564,9 @@ McbpConnection::TransmitResult McbpConnection::transmit() {
                        }
                        return TransmitResult::SoftError;
                    }
+                   transmitting = false;
+                   corkedResponses = 0;
+                   corkedBytes = 0;
                    return TransmitResult::Complete;
                }
             }
@@ -480,6 +610,9 @@ McbpConnection::TransmitResult McbpConnection::transmit() {
         setState(conn_closing);
         return TransmitResult::HardError;
     } else {
+        transmitting = false;
+        corkedResponses = 0;
+        corkedBytes = 0;
         return TransmitResult::Complete;
     }
 }
@@ -647,10 +780,17 @@ int McbpConnection::sslWrite(const char* src, size_t nbytes) {
 }
 
 void McbpConnection::addMsgHdr(bool reset) {
+    if (reset && hasCorkedResponses()) {
+        // Append the response to the ones we're holding back
+        responseIov = iovused;
+        return;
+    }
+
     if (reset) {
         msgcurr = 0;
         msglist.clear();
         iovused = 0;
+        responseIov = 0;
     }
 
     msglist.emplace_back();
@@ -700,15 +840,250 @@ void McbpConnection::ensureIovSpace() {
     }
 
     // Try to double the size of the array
+    const auto old = reinterpret_cast<uintptr_t>(iov.data());
     iov.resize(iov.size() * 2);
 
-    /* Point all the msghdr structures at the new list. */
-    size_t ii;
-    int iovnum;
-    for (ii = 0, iovnum = 0; ii < msglist.size(); ii++) {
-        msglist[ii].msg_iov = &iov[iovnum];
-        iovnum += msglist[ii].msg_iovlen;
+    // Point all the msghdr structures at the new list. A message may be
+    // partially sent (when we append to responses we failed to send
+    // without blocking), so keep the offset of each of them.
+    for (auto& msg : msglist) {
+        const auto offset =
+                (reinterpret_cast<uintptr_t>(msg.msg_iov) - old) / sizeof(iovec);
+        msg.msg_iov = &iov[offset];
+    }
+}
+
+bool McbpConnection::mayCorkResponses() const {
+    const size_t limit = settings.getResponseCorkSize();
+    if (limit == 0 || isDCP() || ioUring || transmitting || numEvents <= 0 ||
+        !parkedCommands.empty() || !isPacketAvailable()) {
+        return false;
+    }
+
+    if (corkedResponses == 0) {
+        return true;
+    }
+
+    const hrtime_t usec = (gethrtime() - corkStart) / 1000;
+    return corkedBytes < limit && usec < settings.getResponseCorkUsec();
+}
+
+bool McbpConnection::corkResponse() {
+    if (write_and_go != conn_new_cmd || msglist.size() != 1 ||
+        !mayCorkResponses()) {
+        return false;
+    }
+
+    // The data already in the write buffer stays there until it's sent
+    cb::const_byte_buffer pending;
+    write->consume([&pending](cb::const_byte_buffer buffer) -> ssize_t {
+        pending = buffer;
+        return 0;
+    });
+    auto inWriteBuffer = [&pending](const iovec& vec) -> bool {
+        const auto* ptr = static_cast<const uint8_t*>(vec.iov_base);
+        return ptr >= pending.data() &&
+               ptr + vec.iov_len <= pending.data() + pending.size();
+    };
+
+    size_t bytes = 0;
+    size_t copy = 0;
+    for (auto ii = responseIov; ii < iovused; ++ii) {
+        bytes += iov[ii].iov_len;
+        if (!inWriteBuffer(iov[ii])) {
+            copy += iov[ii].iov_len;
+        }
+    }
+
+    // Leave room for the header of the next response
+    if (corkedBytes + bytes > settings.getResponseCorkSize() ||
+        copy + sizeof(protocol_binary_response_header) > write->wsize()) {
+        return false;
+    }
+
+    if (copy > 0) {
+        write->produce([this, &inWriteBuffer](void* ptr,
+                                              size_t) -> size_t {
+            auto* dest = static_cast<uint8_t*>(ptr);
+            for (auto ii = responseIov; ii < iovused; ++ii) {
+                if (!inWriteBuffer(iov[ii])) {
+                    std::memcpy(dest, iov[ii].iov_base, iov[ii].iov_len);
+                    iov[ii].iov_base = dest;
+                    dest += iov[ii].iov_len;
+                }
+            }
+            return size_t(dest - static_cast<uint8_t*>(ptr));
+        });
+    }
+
+    // Merge the entries which are contiguous in the write buffer (which
+    // typically leaves a single entry for all of the responses)
+    if (iovused > 0) {
+        size_t last = responseIov > 0 ? responseIov - 1 : 0;
+        for (auto ii = last + 1; ii < iovused; ++ii) {
+            auto* end = static_cast<uint8_t*>(iov[last].iov_base) +
+                        iov[last].iov_len;
+            if (end == iov[ii].iov_base) {
+                iov[last].iov_len += iov[ii].iov_len;
+            } else {
+                iov[++last] = iov[ii];
+            }
+        }
+        msglist.front().msg_iovlen -= iovused - (last + 1);
+        iovused = last + 1;
+    }
+
+    // Everything we send is in the write buffer
+    releaseTempAlloc();
+    releaseReservedItems();
+
+    if (corkedResponses == 0) {
+        corkStart = gethrtime();
+    }
+    ++corkedResponses;
+    corkedBytes += bytes;
+    return true;
+}
+
+void McbpConnection::sendCorkedResponses() {
+    transmitting = true;
+    setState(conn_send_data);
+    setWriteAndGo(conn_new_cmd);
+}
+
+void McbpConnection::flushCorkedResponses() {
+    while (transmit() == TransmitResult::Incomplete) {
+        // keep on sending
+    }
+}
+
+size_t McbpConnection::getWriteBufferSize() const {
+    const size_t size = settings.getResponseCorkSize();
+    if (size > DATA_BUFFER_SIZE && !isDCP() && !ioUring) {
+        return size;
+    }
+    return DATA_BUFFER_SIZE;
+}
+
+bool McbpConnection::startValueStream() {
+    const size_t threshold = settings.getStreamValueThreshold();
+    if (threshold == 0 || isDCP() || valueStream.active ||
+        binary_header.request.magic != PROTOCOL_BINARY_REQ) {
+        return false;
+    }
+
+    switch (binary_header.request.opcode) {
+    case PROTOCOL_BINARY_CMD_SET:
+    case PROTOCOL_BINARY_CMD_SETQ:
+    case PROTOCOL_BINARY_CMD_ADD:
+    case PROTOCOL_BINARY_CMD_ADDQ:
+    case PROTOCOL_BINARY_CMD_REPLACE:
+    case PROTOCOL_BINARY_CMD_REPLACEQ:
+        break;
+    default:
+        return false;
+    }
+
+    const size_t extlen = binary_header.request.extlen;
+    const size_t keylen = binary_header.request.keylen;
+    const size_t bodylen = binary_header.request.bodylen;
+    if (extlen != 8 || keylen == 0 || bodylen < extlen + keylen ||
+        bodylen - extlen - keylen < threshold) {
+        return false;
+    }
+    const size_t valuelen = bodylen - extlen - keylen;
+    const size_t offset = sizeof(binary_header.bytes) + extlen + keylen;
+
+    // Invalid and unauthorized commands are read (and rejected) as usual
+    const auto datatype = binary_header.request.datatype;
+    if (!mcbp::datatype::is_valid(datatype) ||
+        mcbp::datatype::is_xattr(datatype) || !isDatatypeEnabled(datatype) ||
+        checkPrivilege(cb::rbac::Privilege::Upsert, getCookieObject()) !=
+                cb::rbac::PrivilegeAccess::Ok) {
+        return false;
+    }
+
+    cb::const_byte_buffer packet;
+    read->consume([&packet](cb::const_byte_buffer buffer) -> ssize_t {
+        packet = buffer;
+        return 0;
+    });
+    if (packet.size() < offset) {
+        return false;
+    }
+
+    if (!reserveStreamedValue(valuelen)) {
+        return false;
+    }
+
+    const auto* req =
+            reinterpret_cast<const protocol_binary_request_set*>(packet.data());
+    const DocKey key(packet.data() + sizeof(binary_header.bytes) + extlen,
+                     keylen,
+                     getDocNamespace());
+    auto ret = bucket_allocate(this,
+                               key,
+                               valuelen,
+                               req->message.body.flags,
+                               ntohl(req->message.body.expiration),
+                               datatype,
+                               binary_header.request.vbucket);
+    if (ret.first != cb::engine_errc::success) {
+        // The command fails (or blocks) when it's executed. If the engine
+        // blocked it will still notify the cookie, which the command must
+        // wait for before it's executed
+        releaseStreamedValue(valuelen);
+        if (ret.first == cb::engine_errc::would_block) {
+            streamAllocationBlocked = true;
+        }
+        return false;
+    }
+
+    item_info info;
+    if (!bucket_get_item_info(this, ret.second.get(), &info) ||
+        info.nvalue != 1 || info.value[0].iov_len != valuelen) {
+        releaseStreamedValue(valuelen);
+        return false;
+    }
+
+    valueStream.item = std::move(ret.second);
+    valueStream.value = {static_cast<uint8_t*>(info.value[0].iov_base),
+                         valuelen};
+    valueStream.buffered = packet.size();
+    valueStream.received = packet.size() - offset;
+    std::copy(packet.data() + offset,
+              packet.data() + packet.size(),
+              valueStream.value.data());
+    valueStream.active = true;
+    get_thread_stats(this)->streamed_values++;
+    return true;
+}
+
+int McbpConnection::recvStreamedValue() {
+    auto* dest = valueStream.value.data() + valueStream.received;
+    const auto res = recv(reinterpret_cast<char*>(dest),
+                          valueStream.value.size() - valueStream.received);
+    if (res > 0) {
+        valueStream.received += res;
+    }
+    return res;
+}
+
+size_t McbpConnection::finishValueStream() {
+    const auto buffered = valueStream.buffered;
+    resetValueStream();
+    return buffered;
+}
+
+void McbpConnection::resetValueStream() {
+    if (valueStream.active) {
+        releaseStreamedValue(valueStream.value.size());
     }
+    valueStream.active = false;
+    valueStream.item.reset();
+    valueStream.value = {};
+    valueStream.received = 0;
+    valueStream.buffered = 0;
 }
 
 McbpConnection::McbpConnection(SOCKET sfd, event_base *b)
@@ -906,6 +1281,7 @@ cJSON* McbpConnection::toJSON() const {
             cJSON* o = cJSON_CreateObject();
             cJSON_AddBoolToObject(o, "registered",
                                     isRegisteredInLibevent());
+            cJSON_AddBoolToObject(o, "io_uring", isIoUringEnabled());
             cJSON_AddItemToObject(o, "ev_flags", event_mask_to_json(ev_flags));
             cJSON_AddItemToObject(o, "which", event_mask_to_json(currentEvent));
 
@@ -986,6 +1362,11 @@ cJSON* McbpConnection::toJSON() const {
         cJSON_AddUintPtrToObject(obj, "cas", cas);
         cJSON_AddNumberToObject(obj, "aiostat", aiostat);
         cJSON_AddBoolToObject(obj, "ewouldblock", ewouldblock);
+        cJSON_AddBoolToObject(obj, "unordered_execution", unorderedExecution);
+        cJSON_AddNumberToObject(obj, "parked_commands",
+                                double(parkedCommands.size()));
+        cJSON_AddNumberToObject(obj, "corked_responses",
+                                double(corkedResponses));
         cJSON_AddItemToObject(obj, "ssl", ssl.toJSON());
         cJSON_AddNumberToObject(obj, "total_recv", totalRecv);
         cJSON_AddNumberToObject(obj, "total_send", totalSend);
@@ -1222,7 +1603,194 @@ void McbpConnection::setPriority(const Connection::Priority& priority) {
 }
 
 protocol_binary_response_status McbpConnection::validateCommand(protocol_binary_command command) {
-    return Bucket::validateMcbpCommand(this, command, cookie);
+    return Bucket::validateMcbpCommand(this, command, *currentCookie);
+}
+
+/**
+ * May the command be parked while it waits for the engine? It's executed
+ * again from scratch once notified, so it must not have any side effects
+ * when it returns EWOULDBLOCK.
+ */
+static bool is_parkable(uint8_t opcode) {
+    switch (opcode) {
+    case PROTOCOL_BINARY_CMD_GET:
+    case PROTOCOL_BINARY_CMD_GETQ:
+    case PROTOCOL_BINARY_CMD_GETK:
+    case PROTOCOL_BINARY_CMD_GETKQ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * May the command be executed while there are parked commands (on other
+ * keys)? These are the data commands operating on a single document, all
+ * of which are driven by a SteppableCommandContext.
+ */
+static bool is_reorderable(uint8_t opcode) {
+    switch (opcode) {
+    case PROTOCOL_BINARY_CMD_GET:
+    case PROTOCOL_BINARY_CMD_GETQ:
+    case PROTOCOL_BINARY_CMD_GETK:
+    case PROTOCOL_BINARY_CMD_GETKQ:
+    case PROTOCOL_BINARY_CMD_SET:
+    case PROTOCOL_BINARY_CMD_SETQ:
+    case PROTOCOL_BINARY_CMD_ADD:
+    case PROTOCOL_BINARY_CMD_ADDQ:
+    case PROTOCOL_BINARY_CMD_REPLACE:
+    case PROTOCOL_BINARY_CMD_REPLACEQ:
+    case PROTOCOL_BINARY_CMD_APPEND:
+    case PROTOCOL_BINARY_CMD_APPENDQ:
+    case PROTOCOL_BINARY_CMD_PREPEND:
+    case PROTOCOL_BINARY_CMD_PREPENDQ:
+    case PROTOCOL_BINARY_CMD_DELETE:
+    case PROTOCOL_BINARY_CMD_DELETEQ:
+    case PROTOCOL_BINARY_CMD_INCREMENT:
+    case PROTOCOL_BINARY_CMD_INCREMENTQ:
+    case PROTOCOL_BINARY_CMD_DECREMENT:
+    case PROTOCOL_BINARY_CMD_DECREMENTQ:
+    case PROTOCOL_BINARY_CMD_TOUCH:
+    case PROTOCOL_BINARY_CMD_GAT:
+    case PROTOCOL_BINARY_CMD_GATQ:
+    case PROTOCOL_BINARY_CMD_GET_LOCKED:
+    case PROTOCOL_BINARY_CMD_UNLOCK_KEY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void McbpConnection::assignCommandCookie() {
+    // A streamed value isn't in the read pipe, so the command can't be
+    // copied to be parked
+    if (!unorderedExecution || isDCP() || commandCookie ||
+        isStreamingValue() || !is_parkable(binary_header.request.opcode) ||
+        parkedCommands.size() >= MaxParkedCommands) {
+        return;
+    }
+
+    if (spareCookies.empty()) {
+        commandCookie.reset(new Cookie(this));
+    } else {
+        commandCookie = std::move(spareCookies.back());
+        spareCookies.pop_back();
+    }
+    currentCookie = commandCookie.get();
+}
+
+void McbpConnection::releaseCommandCookie() {
+    currentCookie = &cookie;
+    if (commandCookie) {
+        commandCookie->reset();
+        commandCookie->getPacket().clear();
+        spareCookies.push_back(std::move(commandCookie));
+    }
+}
+
+bool McbpConnection::parkCommand() {
+    if (!commandCookie) {
+        return false;
+    }
+
+    auto& packet = commandCookie->getPacket();
+    if (packet.empty()) {
+        const auto* data = static_cast<const uint8_t*>(getPacket(cookie));
+        packet.assign(data,
+                      data + sizeof(binary_header.bytes) +
+                              binary_header.request.bodylen);
+    }
+
+    // The command is executed from scratch when resumed
+    resetCommandContext();
+    setEwouldblock(false);
+    setAiostat(ENGINE_SUCCESS);
+
+    currentCookie = &cookie;
+    parkedCommands.push_back(std::move(commandCookie));
+    return true;
+}
+
+bool McbpConnection::mustWaitForParkedCommands() const {
+    if (parkedCommands.empty()) {
+        return false;
+    }
+
+    if (!is_reorderable(binary_header.request.opcode)) {
+        return true;
+    }
+
+    const auto key = getKey();
+    for (const auto& parked : parkedCommands) {
+        const auto& packet = parked->getPacket();
+        const auto* req =
+                reinterpret_cast<const protocol_binary_request_header*>(
+                        packet.data());
+        const size_t keylen = ntohs(req->request.keylen);
+        const auto* parkedKey = reinterpret_cast<const char*>(
+                packet.data() + sizeof(req->bytes) + req->request.extlen);
+        if (keylen == key.size() &&
+            std::equal(parkedKey, parkedKey + keylen, key.data())) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool McbpConnection::resumeParkedCommand() {
+    auto iter = std::find_if(parkedCommands.begin(), parkedCommands.end(),
+                             [](const std::unique_ptr<Cookie>& parked) {
+                                 return parked->isNotified();
+                             });
+    if (iter == parkedCommands.end()) {
+        return false;
+    }
+
+    commandCookie = std::move(*iter);
+    parkedCommands.erase(iter);
+    currentCookie = commandCookie.get();
+    setAiostat(commandCookie->clearNotified());
+
+    // Restore the (host byte order) header of the command
+    const auto* req = reinterpret_cast<const protocol_binary_request_header*>(
+            commandCookie->getPacket().data());
+    binary_header = *req;
+    binary_header.request.keylen = ntohs(req->request.keylen);
+    binary_header.request.bodylen = ntohl(req->request.bodylen);
+    binary_header.request.vbucket = ntohs(req->request.vbucket);
+    binary_header.request.cas = ntohll(req->request.cas);
+
+    addMsgHdr(true);
+    setCmd(binary_header.request.opcode);
+    setCAS(0);
+    setNoReply(false);
+    setStart(gethrtime());
+    return true;
+}
+
+bool McbpConnection::hasNotifiedParkedCommands() const {
+    return std::any_of(parkedCommands.begin(), parkedCommands.end(),
+                       [](const std::unique_ptr<Cookie>& parked) {
+                           return parked->isNotified();
+                       });
+}
+
+bool McbpConnection::hasParkedCommandsInFlight() const {
+    return std::any_of(parkedCommands.begin(), parkedCommands.end(),
+                       [](const std::unique_ptr<Cookie>& parked) {
+                           return !parked->isNotified();
+                       });
+}
+
+void McbpConnection::notifyIoComplete(const Cookie& cookie,
+                                      ENGINE_ERROR_CODE status) {
+    if (&cookie == &this->cookie) {
+        setAiostat(status);
+        this->cookie.setNotified(status);
+    } else {
+        const_cast<Cookie&>(cookie).setNotified(status);
+    }
 }
 
 void McbpConnection::logCommand() const {
@@ -1307,3 +1875,165 @@ int PipeConnection::sendmsg(struct msghdr* m) {
 int PipeConnection::recv(char* dest, size_t nbytes) {
     return (int)::read(socketDescriptor, dest, nbytes);
 }
+
+SharedMemoryConnection::SharedMemoryConnection(
+        SOCKET eventFd, event_base* b, std::unique_ptr<ShmChannel> chan)
+    : McbpConnection(eventFd, b), channel(std::move(chan)) {
+    peername = "shm";
+    sockname = settings.getShmListen();
+    updateDescription();
+    setState(conn_waiting);
+
+    if (event_assign(&hangupEvent, b, channel->getSocket(),
+                     EV_READ | EV_PERSIST, hangup_handler,
+                     reinterpret_cast<void*>(this)) == -1 ||
+        event_add(&hangupEvent, nullptr) == -1) {
+        unregisterEvent();
+        throw std::runtime_error("Failed to initialize hangup event");
+    }
+    hangupRegistered = true;
+}
+
+void SharedMemoryConnection::hangup_handler(evutil_socket_t fd,
+                                            short,
+                                            void* arg) {
+    auto* c = reinterpret_cast<SharedMemoryConnection*>(arg);
+    char buffer[64];
+    const auto nr = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (nr > 0 || (nr == -1 && is_blocking(GetLastNetworkError()))) {
+        // The client isn't supposed to send anything on the socket
+        return;
+    }
+
+    c->peerClosed = true;
+    event_del(&c->hangupEvent);
+    c->hangupRegistered = false;
+    // Let the state machine find out (recv() returns 0)
+    event_active(&c->event, EV_READ, 0);
+}
+
+int SharedMemoryConnection::sendmsg(struct msghdr* m) {
+    if (!channel || peerClosed) {
+        set_econnreset();
+        return -1;
+    }
+
+    auto responses = channel->getResponses();
+    bool wake = false;
+    size_t res = 0;
+    for (size_t ii = 0; ii < size_t(m->msg_iovlen); ii++) {
+        const auto& vec = m->msg_iov[ii];
+        auto nw = responses.produce(vec.iov_base, vec.iov_len, wake);
+        if (nw == 0 && res == 0) {
+            // The ring is full. Reset our eventfd before telling the
+            // client that we wait for room, so that we're woken up
+            ShmChannel::drain(socketDescriptor);
+            if (responses.waitForRoom() > 0) {
+                nw = responses.produce(vec.iov_base, vec.iov_len, wake);
+            }
+        }
+        if (nw == cb::shm::Ring::Corrupt) {
+            LOG_WARNING(this,
+                        "%u Closing connection %s: corrupt response ring",
+                        getId(), getDescription().c_str());
+            set_econnreset();
+            return -1;
+        }
+        res += nw;
+        if (nw < vec.iov_len) {
+            break;
+        }
+    }
+
+    // A single wakeup for all of the responses written
+    maybeSignalClient(wake);
+
+    if (res == 0) {
+        set_ewouldblock();
+        return -1;
+    }
+    totalSend += res;
+    return int(res);
+}
+
+int SharedMemoryConnection::recv(char* dest, size_t nbytes) {
+    if (!channel) {
+        return 0;
+    }
+
+    auto requests = channel->getRequests();
+    bool wake = false;
+    auto nr = requests.consume(dest, nbytes, wake);
+    if (nr == 0 && !peerClosed) {
+        // Reset our eventfd before looking at the ring once more, so that
+        // we're woken up by the client adding more requests
+        ShmChannel::drain(socketDescriptor);
+        nr = requests.consume(dest, nbytes, wake);
+    }
+    if (nr == cb::shm::Ring::Corrupt) {
+        LOG_WARNING(this, "%u Closing connection %s: corrupt request ring",
+                    getId(), getDescription().c_str());
+        set_econnreset();
+        return -1;
+    }
+    maybeSignalClient(wake);
+
+    if (nr > 0) {
+        totalRecv += nr;
+        return int(nr);
+    }
+    if (peerClosed) {
+        return 0;
+    }
+    set_ewouldblock();
+    return -1;
+}
+
+bool SharedMemoryConnection::updateEvent(const short new_flags) {
+    if (!channel) {
+        return McbpConnection::updateEvent(new_flags);
+    }
+
+    short ready = 0;
+    if (new_flags & EV_WRITE) {
+        auto responses = channel->getResponses();
+        if (responses.getFree() == 0) {
+            ShmChannel::drain(socketDescriptor);
+            if (responses.waitForRoom() > 0) {
+                ready |= EV_WRITE;
+            }
+        } else {
+            ready |= EV_WRITE;
+        }
+    }
+    if ((new_flags & EV_READ) &&
+        (peerClosed || !channel->getRequests().empty())) {
+        ready |= EV_READ;
+    }
+
+    short flags = new_flags;
+    if (flags & EV_WRITE) {
+        flags = (flags & ~EV_WRITE) | EV_READ;
+    }
+    if (!McbpConnection::updateEvent(flags)) {
+        return false;
+    }
+
+    if (ready != 0) {
+        event_active(&event, ready, 0);
+    }
+    return true;
+}
+
+bool SharedMemoryConnection::havePendingInputData() {
+    return McbpConnection::havePendingInputData() ||
+           (channel && !channel->getRequests().empty());
+}
+
+void SharedMemoryConnection::releaseTransport() {
+    if (hangupRegistered) {
+        event_del(&hangupEvent);
+        hangupRegistered = false;
+    }
+    channel.reset();
+}
@@ -22,8 +22,10 @@
 
 #include "datatype.h"
 #include "dynamic_buffer.h"
+#include "io_uring_loop.h"
 #include "log_macros.h"
 #include "settings.h"
+#include "shm_transport.h"
 #include "sslcert.h"
 #include "statemachine_mcbp.h"
 
@@ -158,7 +160,7 @@ public:
      * @return the buffer to the key.
      */
     cb::const_char_buffer getKey() const {
-        auto *pkt = reinterpret_cast<const char *>(getPacket(cookie));
+        auto *pkt = reinterpret_cast<const char *>(getPacket(*currentCookie));
         cb::const_char_buffer ret;
         ret.len = binary_header.request.keylen;
         ret.buf = pkt + sizeof binary_header.bytes + binary_header.request.extlen;
@@ -213,7 +215,7 @@ public:
      *
      * @param mask the new event mask to get notified about
      */
-    bool updateEvent(const short new_flags);
+    virtual bool updateEvent(const short new_flags);
 
     /**
      * Reapply the event mask (in case of a timeout we might want to do
@@ -237,6 +239,50 @@ public:
         return registered_in_libevent;
     }
 
+    /**
+     * Perform the network IO of this connection with the io_uring of its
+     * worker thread rather than waiting for the socket to be ready. Must
+     * not be used for SSL connections.
+     *
+     * @return true if success, false otherwise (and the connection is
+     *         scheduled to be closed)
+     */
+    bool enableIoUring(IoUringLoop& loop);
+
+    bool isIoUringEnabled() const {
+        return ioUring.get() != nullptr;
+    }
+
+    /**
+     * Called by the IoUringLoop when an operation completed; activate the
+     * event if the connection waits for one of the events in which (or,
+     * once closed, for the operations to complete).
+     */
+    void signalIoUring(short which);
+
+    /**
+     * Cancel the io_uring operations in flight as the connection is closing
+     */
+    void cancelIoUring();
+
+    /** Does the connection wait for io_uring operations to complete? */
+    bool hasIoUringOperations() const {
+        return ioUring && ioUring->hasOperationsInFlight();
+    }
+
+    /**
+     * Release the resources (other than the socket) used to talk to the
+     * client as the connection is closing
+     */
+    virtual void releaseTransport() {
+    }
+
+    /**
+     * Release the io_uring state of the connection (and any activation of
+     * the event it queued) before the connection is destroyed
+     */
+    void releaseIoUring();
+
     short getEventFlags() const {
         return ev_flags;
     }
@@ -310,6 +356,135 @@ public:
      */
     TransmitResult transmit();
 
+    /**
+     * Try to hold back the response to the current command, so that it may
+     * be sent with the responses to the pipelined commands following it
+     * (see Settings::getResponseCorkSize()). The parts of the response
+     * which aren't in the write buffer are copied into it (so that the
+     * resources of the command may be released), and the response is
+     * merged into the IO vector of the responses held back before it.
+     *
+     * @return true if the response is held back, false if it (and the
+     *         responses held back before it) should be sent now
+     */
+    bool corkResponse();
+
+    /**
+     * May the responses held back wait for the next command? That is the
+     * case if the next command is completely received, the connection may
+     * execute it before yielding and the size and time limits aren't
+     * exceeded.
+     */
+    bool mayCorkResponses() const;
+
+    /** Is the connection holding back responses? */
+    bool hasCorkedResponses() const {
+        return corkedResponses > 0;
+    }
+
+    /** Has transmit() started to send the current IO vector? */
+    bool isTransmitting() const {
+        return transmitting;
+    }
+
+    /**
+     * Send the responses held back (through conn_send_data), and continue
+     * with the next command.
+     */
+    void sendCorkedResponses();
+
+    /**
+     * Send as much of the responses held back as the socket accepts without
+     * blocking (the current command is about to wait for the engine). The
+     * remainder is sent together with the response to the command.
+     */
+    void flushCorkedResponses();
+
+    /**
+     * Get the size of the write buffer to borrow from the thread's pool;
+     * i.e. large enough to hold the responses held back
+     */
+    size_t getWriteBufferSize() const;
+
+    /**
+     * Start to receive the value of the (partially received) command
+     * straight into an item allocated from the engine, rather than
+     * buffering the entire command in the read pipe. Only the value of a
+     * SET, ADD or REPLACE of at least stream_value_threshold bytes is
+     * streamed, and only once its header, extras and key are received.
+     * The item is accounted for in the bucket quota before the value is
+     * received, so the values streamed by all connections at a time are
+     * limited to stream_value_limit bytes (and each connection only streams
+     * one value at a time). The bytes of the value already read are copied
+     * into the item.
+     *
+     * @return true if the value is streamed, false if the command should
+     *         be read into the read pipe
+     */
+    bool startValueStream();
+
+    /**
+     * Is the engine yet to notify the item allocation which blocked
+     * (EWOULDBLOCK) when the value of the current command was about to be
+     * streamed? The command is buffered instead, but must not be executed
+     * before the notification arrives (which would otherwise be taken for
+     * the completion of the command).
+     */
+    bool isStreamAllocationInFlight() const {
+        return streamAllocationBlocked && !isCommandNotified();
+    }
+
+    /**
+     * Forget the notification of an item allocation which blocked when the
+     * value of the current command was about to be streamed
+     */
+    void clearStreamAllocation() {
+        if (streamAllocationBlocked) {
+            streamAllocationBlocked = false;
+            clearCommandNotified();
+            setAiostat(ENGINE_SUCCESS);
+        }
+    }
+
+    /** Is the value of the current command received into an item? */
+    bool isStreamingValue() const {
+        return valueStream.active;
+    }
+
+    /**
+     * Receive more of the value being streamed (but nothing past it)
+     *
+     * @return the number of bytes received, 0 if the socket is closed or
+     *         -1 on error (as recv())
+     */
+    int recvStreamedValue();
+
+    /**
+     * Take the item the value was received into (the item is only
+     * present until the command takes it)
+     */
+    cb::unique_item_ptr takeStreamedItem() {
+        return std::move(valueStream.item);
+    }
+
+    /** Get the value received into the item */
+    cb::const_char_buffer getStreamedValue() const {
+        return {reinterpret_cast<const char*>(valueStream.value.data()),
+                valueStream.value.size()};
+    }
+
+    /**
+     * Complete the value stream of the command just executed
+     *
+     * @return the number of bytes of the command in the read pipe (i.e.
+     *         its header, extras and key, and the part of the value read
+     *         before the stream started)
+     */
+    size_t finishValueStream();
+
+    /** Release the item of a value stream which was never completed */
+    void resetValueStream();
+
     enum class TryReadResult {
         /** Data received on the socket and ready to parse */
             DataReceived,
@@ -666,7 +841,7 @@ public:
     /**
      * Do we have any pending input data on this connection?
      */
-    bool havePendingInputData() {
+    virtual bool havePendingInputData() {
         return (!read->empty() || ssl.havePendingInputData());
     }
 
@@ -693,18 +868,39 @@ public:
     /** Write buffer */
     std::unique_ptr<cb::Pipe> write;
 
+    /**
+     * The size of the read and write buffers when they were borrowed from
+     * the thread's pool (0 if they weren't)
+     */
+    size_t readLoan = 0;
+    size_t writeLoan = 0;
+
+    /**
+     * Get the cookie for the command being executed (the connection's own
+     * cookie, unless the command may be executed out of order)
+     */
     const void* getCookie() const {
-        return &cookie;
+        return currentCookie;
     }
 
     Cookie& getCookieObject() {
-        return cookie;
+        return *currentCookie;
     }
 
     /**
-     * Obtain a pointer to the packet for the Cookie's connection
+     * Obtain a pointer to the packet for the Cookie's connection (or the
+     * copy kept by the cookie if it's a parked command)
+     *
+     * While the value of the command is streamed (see startValueStream())
+     * the packet only holds its header, extras and key, and whatever part
+     * of the value was read before the stream started. Nothing may read the
+     * value from it: use getStreamedValue() instead.
      */
     static void* getPacket(const Cookie& cookie) {
+        if (!cookie.getPacket().empty()) {
+            return const_cast<uint8_t*>(cookie.getPacket().data());
+        }
+
         auto c = static_cast<McbpConnection*>(cookie.connection);
         cb::const_byte_buffer avail;
 
@@ -723,6 +919,10 @@ public:
      * @return true if we've got the entire packet, false otherwise
      */
     bool isPacketAvailable() const {
+        if (valueStream.active) {
+            return valueStream.received == valueStream.value.size();
+        }
+
         bool available;
         read->consume([&available](cb::const_byte_buffer buffer) -> ssize_t {
             const auto* req = reinterpret_cast<const cb::mcbp::Request*>(buffer.data());
@@ -757,6 +957,102 @@ public:
 
     bool selectedBucketIsXattrEnabled() const;
 
+    /**
+     * Has the client enabled the UnorderedExecution HELLO feature? If so
+     * a GET which has to wait for the engine (e.g. a background fetch) is
+     * parked, and the commands following it are executed in the mean time.
+     * The response is sent once the engine notified the parked command.
+     */
+    bool isUnorderedExecution() const {
+        return unorderedExecution;
+    }
+
+    void setUnorderedExecution(bool enable) {
+        unorderedExecution = enable;
+    }
+
+    /**
+     * Use a cookie of its own for the command about to be executed if it
+     * may be parked (i.e. unordered execution is enabled, the command is
+     * a GET and there is room for another parked command)
+     */
+    void assignCommandCookie();
+
+    /**
+     * Release the cookie of the command just executed, and go back to
+     * using the connection's own cookie.
+     */
+    void releaseCommandCookie();
+
+    /**
+     * Park the command which just returned EWOULDBLOCK, if it was executed
+     * with a cookie of its own (see assignCommandCookie()). The command
+     * is copied (unless it already was parked) so that it may be executed
+     * again once the engine notifies its cookie.
+     *
+     * @return true if the command was parked, false if the connection must
+     *         wait for it
+     */
+    bool parkCommand();
+
+    /**
+     * Must the current command wait for the parked commands to complete
+     * before it's executed? That is the case for a command on the same
+     * key as a parked command, and for all commands other than the data
+     * commands (which act as barriers; i.e. a client may send NOOP to
+     * wait for all of its previous commands).
+     */
+    bool mustWaitForParkedCommands() const;
+
+    /**
+     * Make a parked command the engine has notified the current command
+     * (to be executed again with the notified status)
+     *
+     * @return true if a parked command was resumed
+     */
+    bool resumeParkedCommand();
+
+    /** Is the current command a parked command being executed again? */
+    bool isExecutingParkedCommand() const {
+        return !currentCookie->getPacket().empty();
+    }
+
+    /** Has the engine notified any of the parked commands? */
+    bool hasNotifiedParkedCommands() const;
+
+    /**
+     * Are there any parked commands the engine has yet to notify? (The
+     * connection can't be released until they are)
+     */
+    bool hasParkedCommandsInFlight() const;
+
+    /**
+     * Record the status the engine notified for the cookie (called through
+     * notify_io_complete with the thread lock held)
+     */
+    void notifyIoComplete(const Cookie& cookie, ENGINE_ERROR_CODE status);
+
+    /**
+     * Has the engine notified the connection's own cookie since the current
+     * command was last executed? A connection with parked commands is also
+     * woken up when one of them is notified, so a blocked command must only
+     * be executed again once its own cookie is notified.
+     */
+    bool isCommandNotified() const {
+        return cookie.isNotified();
+    }
+
+    /**
+     * Forget the notification of the connection's own cookie (before the
+     * current command is handed to the engine)
+     */
+    void clearCommandNotified() {
+        cookie.clearNotified();
+    }
+
+    /** The maximum number of parked commands per connection */
+    static const size_t MaxParkedCommands = 64;
+
 protected:
     void runStateMachinery();
 
@@ -814,6 +1110,9 @@ protected:
     /** If ev_timeout_enabled is true, the current timeout in libevent */
     rel_time_t ev_timeout;
 
+    /** The network IO state when using the io_uring of the thread */
+    std::unique_ptr<IoUringSocket> ioUring;
+
     /** which state to go into after finishing current write */
     TaskFunction write_and_go;
 
@@ -829,6 +1128,41 @@ protected:
     /** number of bytes in current msg */
     int msgbytes;
 
+    /** The first entry in iov[] used by the current response */
+    size_t responseIov = 0;
+
+    /** Number of responses held back in the IO vector */
+    size_t corkedResponses = 0;
+
+    /** Number of bytes of the responses held back */
+    size_t corkedBytes = 0;
+
+    /** When the first of the responses held back was ready */
+    hrtime_t corkStart = 0;
+
+    /** Set once transmit() starts to send the IO vector, until it's done */
+    bool transmitting = false;
+
+    /** The state of the value received straight into an item */
+    struct ValueStream {
+        /** Is the value of the current command streamed? */
+        bool active = false;
+        /** The item (until it's taken by the command) */
+        cb::unique_item_ptr item;
+        /** The value of the item */
+        cb::byte_buffer value;
+        /** The number of bytes of the value received */
+        size_t received = 0;
+        /** The number of bytes of the command kept in the read pipe */
+        size_t buffered = 0;
+    } valueStream;
+
+    /**
+     * Set when the item allocation for a value stream returned EWOULDBLOCK
+     * (see isStreamAllocationInFlight())
+     */
+    bool streamAllocationBlocked = false;
+
     /**
      * List of items we've reserved during the command (should call
      * item_release when transmit is complete)
@@ -938,6 +1272,24 @@ protected:
 
     Cookie cookie;
 
+    /** The cookie of the current command (see getCookie()) */
+    Cookie* currentCookie = &cookie;
+
+    /** Has the client enabled out of order execution? */
+    bool unorderedExecution = false;
+
+    /** The commands waiting for the engine to notify their cookie */
+    std::vector<std::unique_ptr<Cookie>> parkedCommands;
+
+    /**
+     * The cookie of the current command if it may be parked (currentCookie
+     * points to it)
+     */
+    std::unique_ptr<Cookie> commandCookie;
+
+    /** Cookies released by the commands (kept for reuse) */
+    std::vector<std::unique_ptr<Cookie>> spareCookies;
+
     Datatype datatype;
 
     /**
@@ -972,3 +1324,66 @@ public:
         return true;
     }
 };
+
+/*
+ * A connection to a local client using shared memory (see
+ * include/memcached/shm_ring.h)
+ *
+ * The requests are read from (and the responses written to) rings in the
+ * shared memory rather than a socket. The socket descriptor of the
+ * connection is the eventfd the client signals when it adds requests to
+ * the (empty) request ring or makes room in the (full) response ring, so
+ * the connection is always waiting for it to become readable. The client
+ * closing the unix domain socket it connected to closes the connection.
+ */
+class SharedMemoryConnection : public McbpConnection {
+public:
+    SharedMemoryConnection() = delete;
+
+    /*
+     * Construct connection and set peername to be "shm" and sockname to be
+     * the path of the unix domain socket.
+     */
+    SharedMemoryConnection(SOCKET eventFd,
+                           event_base* b,
+                           std::unique_ptr<ShmChannel> channel);
+
+    virtual int sendmsg(struct msghdr* m) override;
+
+    virtual int recv(char* dest, size_t nbytes) override;
+
+    /**
+     * Always wait for the eventfd to become readable (it is always
+     * writable), and signal the events we already know about ourselves
+     */
+    virtual bool updateEvent(const short new_flags) override;
+
+    virtual bool havePendingInputData() override;
+
+    virtual bool isSharedMemoryConnection() override {
+        return true;
+    }
+
+    virtual void releaseTransport() override;
+
+protected:
+    /** Called when the unix domain socket becomes readable */
+    static void hangup_handler(evutil_socket_t fd, short which, void* arg);
+
+    /** Wake up the client if told to by the ring */
+    void maybeSignalClient(bool wake) {
+        if (wake) {
+            channel->signalClient();
+        }
+    }
+
+    std::unique_ptr<ShmChannel> channel;
+
+    /** The event notifying about the client closing the socket */
+    struct event hangupEvent;
+
+    bool hangupRegistered = false;
+
+    /** Has the client closed the socket? */
+    bool peerClosed = false;
+};
@@ -24,6 +24,7 @@
 #include <cJSON.h>
 #include <list>
 #include <algorithm>
+#include <memcached/thread_placement.h>
 #include <platform/cb_malloc.h>
 
 /*
@@ -47,12 +48,14 @@ enum class BufferLoan {
 /** Function prototypes ******************************************************/
 
 static BufferLoan conn_loan_single_buffer(McbpConnection& c,
-                                          std::unique_ptr<cb::Pipe>& thread_buf,
-                                          std::unique_ptr<cb::Pipe>& conn_buf);
-
-static void conn_return_single_buffer(McbpConnection& c,
-                                      std::unique_ptr<cb::Pipe>& thread_buf,
-                                      std::unique_ptr<cb::Pipe>& conn_buf);
+                                          BufferPool* pool,
+                                          size_t size,
+                                          std::unique_ptr<cb::Pipe>& conn_buf,
+                                          size_t& loan);
+
+static void conn_return_single_buffer(BufferPool* pool,
+                                      std::unique_ptr<cb::Pipe>& conn_buf,
+                                      size_t& loan);
 static void conn_destructor(Connection *c);
 static Connection *allocate_connection(SOCKET sfd,
                                        event_base *base,
@@ -62,9 +65,13 @@ static ListenConnection* allocate_listen_connection(SOCKET sfd,
                                                     event_base* base,
                                                     in_port_t port,
                                                     sa_family_t family,
-                                                    const struct interface& interf);
+                                                    const struct interface& interf,
+                                                    LIBEVENT_THREAD* owner);
 
 static Connection *allocate_pipe_connection(int fd, event_base *base);
+static Connection* allocate_shm_connection(SOCKET eventFd,
+                                           std::unique_ptr<ShmChannel> channel,
+                                           event_base* base);
 static void release_connection(Connection *c);
 
 /** External functions *******************************************************/
@@ -156,6 +163,7 @@ void run_event_loop(Connection* c, short which) {
     auto* thread = c->getThread();
     if (thread != nullptr) {
         scheduler_info[thread->index].add(ns);
+        thread->last_cpu.store(cb::getCurrentCpu(), std::memory_order_relaxed);
     }
 
     if (c->shouldDelete()) {
@@ -167,8 +175,10 @@ ListenConnection* conn_new_server(const SOCKET sfd,
                                   in_port_t parent_port,
                                   sa_family_t family,
                                   const struct interface& interf,
-                                  struct event_base* base) {
-    auto* c = allocate_listen_connection(sfd, base, parent_port, family, interf);
+                                  struct event_base* base,
+                                  LIBEVENT_THREAD* owner) {
+    auto* c = allocate_listen_connection(sfd, base, parent_port, family, interf,
+                                         owner);
     if (c == nullptr) {
         return nullptr;
     }
@@ -216,8 +226,17 @@ Connection* conn_new(const SOCKET sfd, in_port_t parent_port,
     associate_initial_bucket(c);
 
     c->setThread(thread);
+    thread->total_conns++;
+    thread->curr_conns++;
     MEMCACHED_CONN_ALLOCATE(c->getId());
 
+    auto* mcbp = dynamic_cast<McbpConnection*>(c);
+    if (thread->io_uring && mcbp != nullptr && !mcbp->isSslEnabled() &&
+        !mcbp->isPipeConnection() && !mcbp->enableIoUring(*thread->io_uring)) {
+        LOG_WARNING(c, "%u: Failed to use io_uring, closing connection",
+                    c->getId());
+    }
+
     if (settings.getVerbose() > 1) {
         LOG_DEBUG(c, "<%d new client connection", sfd);
     }
@@ -236,6 +255,8 @@ Connection* conn_pipe_new(const int fd,
     stats.total_conns++;
     c->incrementRefcount();
     c->setThread(thread);
+    thread->total_conns++;
+    thread->curr_conns++;
     associate_initial_bucket(c);
     MEMCACHED_CONN_ALLOCATE(c->getId());
 
@@ -243,6 +264,28 @@ Connection* conn_pipe_new(const int fd,
 
 }
 
+Connection* conn_shm_new(SOCKET eventFd,
+                         std::unique_ptr<ShmChannel> channel,
+                         struct event_base* base,
+                         LIBEVENT_THREAD* thread) {
+    Connection* c = allocate_shm_connection(eventFd, std::move(channel), base);
+    if (c == nullptr) {
+        return nullptr;
+    }
+
+    LOG_INFO(nullptr, "%u: Accepted new shared memory client", c->getId());
+
+    stats.total_conns++;
+    c->incrementRefcount();
+    c->setThread(thread);
+    thread->total_conns++;
+    thread->curr_conns++;
+    associate_initial_bucket(c);
+    MEMCACHED_CONN_ALLOCATE(c->getId());
+
+    return c;
+}
+
 void conn_cleanup_engine_allocations(McbpConnection * c) {
     c->releaseReservedItems();
 }
@@ -272,6 +315,9 @@ static void conn_cleanup(Connection *c) {
     }
     c->setEngineStorage(nullptr);
 
+    if (c->getThread() != nullptr) {
+        c->getThread()->curr_conns--;
+    }
     c->setThread(nullptr);
     cb_assert(c->getNext() == nullptr);
     c->setSocketDescriptor(INVALID_SOCKET);
@@ -304,6 +350,7 @@ void conn_close(McbpConnection *c) {
                     "Current connection was in the pending-io list.. Nuking it");
     }
     thread->pending_io = list_remove(thread->pending_io, c);
+    c->releaseIoUring();
 
     conn_cleanup(c);
 
@@ -370,7 +417,9 @@ void conn_loan_buffers(Connection *connection) {
     }
 
     auto *ts = get_thread_stats(c);
-    switch (conn_loan_single_buffer(*c, c->getThread()->read, c->read)) {
+    auto* pool = c->getThread()->buffer_pool.get();
+    switch (conn_loan_single_buffer(
+            *c, pool, DATA_BUFFER_SIZE, c->read, c->readLoan)) {
     case BufferLoan::Existing:
         ts->rbufs_existing++;
         break;
@@ -382,7 +431,8 @@ void conn_loan_buffers(Connection *connection) {
         break;
     }
 
-    switch (conn_loan_single_buffer(*c, c->getThread()->write, c->write)) {
+    switch (conn_loan_single_buffer(
+            *c, pool, c->getWriteBufferSize(), c->write, c->writeLoan)) {
     case BufferLoan::Existing:
         ts->wbufs_existing++;
         break;
@@ -415,8 +465,9 @@ void conn_return_buffers(Connection *connection) {
         return;
     }
 
-    conn_return_single_buffer(*c, thread->read, c->read);
-    conn_return_single_buffer(*c, thread->write, c->write);
+    auto* pool = thread->buffer_pool.get();
+    conn_return_single_buffer(pool, c->read, c->readLoan);
+    conn_return_single_buffer(pool, c->write, c->writeLoan);
 }
 
 /** Internal functions *******************************************************/
@@ -460,11 +511,12 @@ static ListenConnection* allocate_listen_connection(SOCKET sfd,
                                                     event_base* base,
                                                     in_port_t port,
                                                     sa_family_t family,
-                                                    const struct interface& interf) {
+                                                    const struct interface& interf,
+                                                    LIBEVENT_THREAD* owner) {
     ListenConnection *ret = nullptr;
 
     try {
-        ret = new ListenConnection(sfd, base, port, family, interf);
+        ret = new ListenConnection(sfd, base, port, family, interf, owner);
         std::lock_guard<std::mutex> lock(connections.mutex);
         connections.conns.push_back(ret);
         stats.conn_structs++;
@@ -509,6 +561,36 @@ static Connection *allocate_pipe_connection(int fd, event_base *base) {
     return nullptr;
 }
 
+/**
+ * Allocate a SharedMemoryConnection and add it to the conections list.
+ *
+ * Returns a pointer to the newly-allocated Connection else NULL if failed.
+ */
+static Connection* allocate_shm_connection(SOCKET eventFd,
+                                           std::unique_ptr<ShmChannel> channel,
+                                           event_base* base) {
+    Connection* ret = nullptr;
+
+    try {
+        ret = new SharedMemoryConnection(eventFd, base, std::move(channel));
+
+        std::lock_guard<std::mutex> lock(connections.mutex);
+        connections.conns.push_back(ret);
+        stats.conn_structs++;
+        return ret;
+    } catch (std::bad_alloc) {
+        LOG_WARNING(nullptr,
+                    "Failed to allocate memory for SharedMemoryConnection");
+    } catch (std::exception& error) {
+        LOG_WARNING(nullptr, "Failed to create connection: %s", error.what());
+    } catch (...) {
+        LOG_WARNING(nullptr, "Failed to create connection");
+    }
+
+    delete ret;
+    return nullptr;
+}
+
 /** Release a connection; removing it from the connection list management
  *  and freeing the Connection object.
  */
@@ -527,26 +609,27 @@ static void release_connection(Connection *c) {
 
 /**
  * If the connection doesn't already have a populated conn_buff, ensure that
- * it does by either loaning out the threads, or allocating a new one if
- * necessary.
+ * it does by either borrowing one (with room for at least size bytes) from
+ * the thread's pool, or allocating a new one if necessary.
  */
 static BufferLoan conn_loan_single_buffer(McbpConnection& c,
-                                          std::unique_ptr<cb::Pipe>& thread_buf,
-                                          std::unique_ptr<cb::Pipe>& conn_buf) {
+                                          BufferPool* pool,
+                                          size_t size,
+                                          std::unique_ptr<cb::Pipe>& conn_buf,
+                                          size_t& loan) {
     /* Already have a (partial) buffer - nothing to do. */
     if (conn_buf) {
         return BufferLoan::Existing;
     }
 
-    // If the thread has a buffer, let's loan that to the connection
-    if (thread_buf) {
-        thread_buf.swap(conn_buf);
-        return BufferLoan::Loaned;
-    }
-
-    // Need to allocate a new buffer
     try {
-        conn_buf = std::make_unique<cb::Pipe>(DATA_BUFFER_SIZE);
+        if (pool != nullptr) {
+            const bool pooled = pool->borrow(size, conn_buf);
+            loan = BufferPool::getCapacity(*conn_buf);
+            return pooled ? BufferLoan::Loaned : BufferLoan::Allocated;
+        }
+
+        conn_buf = std::make_unique<cb::Pipe>(size);
     } catch (const std::bad_alloc&) {
         // Unable to alloc a buffer for the thread. Not much we can do here
         // other than terminate the current connection.
@@ -565,24 +648,25 @@ static BufferLoan conn_loan_single_buffer(McbpConnection& c,
 
 
 /**
- * Return an empty read buffer back to the owning worker thread.
+ * Return an empty buffer back to the pool of the owning worker thread.
  */
-static void conn_return_single_buffer(McbpConnection& c,
-                                      std::unique_ptr<cb::Pipe>& thread_buf,
-                                      std::unique_ptr<cb::Pipe>& conn_buf) {
+static void conn_return_single_buffer(BufferPool* pool,
+                                      std::unique_ptr<cb::Pipe>& conn_buf,
+                                      size_t& loan) {
     if (!conn_buf) {
         // No buffer - nothing to do
+        return;
     }
 
     if (conn_buf->empty()) {
-        // Buffer clean, dispose of it
-        if (thread_buf) {
-            // Already got a thread buffer.. release this one
-            conn_buf.reset();
+        // Buffer clean, give it back (or dispose of it if it wasn't
+        // borrowed from the pool)
+        if (pool != nullptr && loan != 0) {
+            pool->giveBack(conn_buf, loan);
         } else {
-            conn_buf.swap(thread_buf);
+            conn_buf.reset();
         }
-
+        loan = 0;
         return;
     }
 
@@ -85,12 +85,14 @@ Connection* conn_new(const SOCKET sfd,
  * @param family the address family used for the port
  * @param interf the interface description
  * @param base the event base to use for the socket
+ * @param owner the worker thread running base, or nullptr for the dispatcher
  */
 ListenConnection* conn_new_server(const SOCKET sfd,
                                   in_port_t parent_port,
                                   sa_family_t family,
                                   const struct interface& interf,
-                                  struct event_base* base);
+                                  struct event_base* base,
+                                  LIBEVENT_THREAD* owner = nullptr);
 
 /*
  * Creates a new connection to a pipe, e.g. stdin.
@@ -99,6 +101,14 @@ Connection *conn_pipe_new(const int fd,
                           struct event_base *base,
                           LIBEVENT_THREAD* thread);
 
+/*
+ * Creates a new connection to a local client using shared memory.
+ */
+Connection* conn_shm_new(SOCKET eventFd,
+                         std::unique_ptr<ShmChannel> channel,
+                         struct event_base* base,
+                         LIBEVENT_THREAD* thread);
+
 /*
  * Closes a connection. Afterwards the connection is invalid (can no longer
  * be used), but it's memory is still allocated. See conn_destructor() to
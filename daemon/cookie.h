@@ -16,8 +16,13 @@
  */
 #pragma once
 
+#include <memcached/engine_error.h>
 #include <platform/uuid.h>
+
+#include <atomic>
+#include <cstdint>
 #include <stdexcept>
+#include <vector>
 
 class Connection;
 
@@ -101,6 +106,46 @@ public:
      */
     const std::string& getErrorJson();
 
+    /**
+     * Get the copy of the command this cookie was parked with (see
+     * McbpConnection::parkCommand()). Empty unless the cookie is used for
+     * out of order execution, and the command had to wait for the engine.
+     */
+    const std::vector<uint8_t>& getPacket() const {
+        return packet;
+    }
+
+    std::vector<uint8_t>& getPacket() {
+        return packet;
+    }
+
+    /**
+     * Record the status the engine notified (notify_io_complete) for the
+     * parked command using this cookie. May be called from any thread.
+     */
+    void setNotified(ENGINE_ERROR_CODE status) {
+        aiostat = status;
+        notified.store(true, std::memory_order_release);
+    }
+
+    /**
+     * Has the engine notified the parked command using this cookie (so it
+     * may be executed again)?
+     */
+    bool isNotified() const {
+        return notified.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Clear the notification (before handing the cookie back to the engine)
+     *
+     * @return the status the engine notified
+     */
+    ENGINE_ERROR_CODE clearNotified() {
+        notified.store(false, std::memory_order_relaxed);
+        return aiostat;
+    }
+
     /**
      * The magic byte is used for development only and will be removed when
      * we've successfully verified that we don't have any calls through the
@@ -121,4 +166,10 @@ protected:
      * transferred to the client.
      */
     std::string json_message;
+
+    /** The parked command (header in network byte order) */
+    std::vector<uint8_t> packet;
+    /** The status the engine notified for the parked command */
+    ENGINE_ERROR_CODE aiostat = ENGINE_SUCCESS;
+    std::atomic<bool> notified{false};
 };
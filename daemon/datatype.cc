@@ -33,6 +33,7 @@ bool Datatype::isSupported(mcbp::Feature feature) {
     case mcbp::Feature::XERROR:
     case mcbp::Feature::SELECT_BUCKET:
     case mcbp::Feature::COLLECTIONS:
+    case mcbp::Feature::UNORDERED_EXECUTION:
     case mcbp::Feature::Invalid:
         throw std::invalid_argument("Datatype::isSupported invalid feature:" +
                                     std::to_string(int(feature)));
@@ -58,6 +59,7 @@ void Datatype::enable(mcbp::Feature feature) {
     case mcbp::Feature::XERROR:
     case mcbp::Feature::SELECT_BUCKET:
     case mcbp::Feature::COLLECTIONS:
+    case mcbp::Feature::UNORDERED_EXECUTION:
     case mcbp::Feature::Invalid:
         throw std::invalid_argument("Datatype::enable invalid feature:" +
                                     std::to_string(int(feature)));
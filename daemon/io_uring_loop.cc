@@ -0,0 +1,657 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include "io_uring_loop.h"
+#include "memcached.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** Stop receiving on a connection with this much data not yet read */
+static const size_t maxBufferedInput = 256 * 1024;
+
+/** Free a connection's input buffer once drained if it has grown beyond
+ * this, so a burst of input doesn't pin up to maxBufferedInput for the life
+ * of the connection */
+static const size_t maxIdleInputCapacity = 32 * 1024;
+
+/** The operations, in the low bits of the user_data (the rest being the
+ * IoUringSocket). A user_data of 0 is used for cancellations. */
+enum : uint64_t { OpRecv = 1, OpSend = 2, OpMask = 3 };
+
+IoUringSocket::IoUringSocket(IoUringLoop& loop,
+                             McbpConnection& connection,
+                             SOCKET sfd)
+    : loop(loop), connection(connection), sfd(sfd) {
+    maybeArmRecv();
+}
+
+int IoUringSocket::recv(char* dest, size_t nbytes) {
+    const size_t available = getBufferedInput();
+    if (available > 0) {
+        const size_t n = std::min(available, nbytes);
+        std::memcpy(dest, input.data() + inputOffset, n);
+        inputOffset += n;
+        if (inputOffset == input.size()) {
+            if (input.capacity() > maxIdleInputCapacity) {
+                std::vector<uint8_t>().swap(input);
+            } else {
+                input.clear();
+            }
+            inputOffset = 0;
+        }
+        maybeArmRecv();
+        return int(n);
+    }
+
+    if (recvError != 0) {
+        errno = recvError;
+        return -1;
+    }
+    if (recvEof) {
+        return 0;
+    }
+    errno = EWOULDBLOCK;
+    return -1;
+}
+
+int IoUringSocket::sendmsg(struct msghdr* m) {
+    if (sendComplete) {
+        if (m != sendMsg) {
+            throw std::logic_error(
+                    "IoUringSocket::sendmsg: called with a different message "
+                    "than the completed send");
+        }
+        sendComplete = false;
+        sendMsg = nullptr;
+        if (sendResult < 0) {
+            errno = -sendResult;
+            return -1;
+        }
+        return sendResult;
+    }
+
+    if (!sendPending) {
+        sendMsg = m;
+        loop.submitSendmsg(*this, m);
+    }
+    errno = EWOULDBLOCK;
+    return -1;
+}
+
+short IoUringSocket::getReadyEvents(short flags) const {
+    short ready = 0;
+    if ((flags & EV_READ) &&
+        (getBufferedInput() > 0 || recvError != 0 || recvEof)) {
+        ready |= EV_READ;
+    }
+    if ((flags & EV_WRITE) && sendComplete) {
+        ready |= EV_WRITE;
+    }
+    return ready;
+}
+
+void IoUringSocket::close() {
+    if (closed) {
+        return;
+    }
+    closed = true;
+    if (recvArmed && !recvCancelled) {
+        recvCancelled = true;
+        loop.cancel(*this, uint64_t(uintptr_t(this)) | OpRecv);
+    }
+    if (sendPending) {
+        loop.cancel(*this, uint64_t(uintptr_t(this)) | OpSend);
+    }
+}
+
+void IoUringSocket::maybeArmRecv() {
+    if (!recvArmed && !closed && !recvEof && recvError == 0 &&
+        getBufferedInput() < maxBufferedInput) {
+        loop.armRecv(*this);
+    }
+}
+
+#ifdef HAVE_IO_URING
+
+/** Number of submission queue entries */
+static const unsigned sqEntries = 256;
+/** Number of completion queue entries (each receive may post many) */
+static const unsigned cqEntries = 4096;
+/** Number (power of 2) and size of the receive buffers */
+static const unsigned bufferCount = 256;
+static const size_t bufferSize = 16 * 1024;
+static const uint16_t bufferGroup = 0;
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return int(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int io_uring_enter(int fd,
+                          unsigned to_submit,
+                          unsigned min_complete,
+                          unsigned flags) {
+    return int(syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                       flags, nullptr, 0));
+}
+
+static int io_uring_register(int fd,
+                             unsigned opcode,
+                             void* arg,
+                             unsigned nr_args) {
+    return int(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+static T* ring_ptr(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+}
+
+/**
+ * The memory shared with the kernel; the submission and completion queues
+ * and the receive buffers (used with the kernel ABI directly, rather than
+ * through liburing).
+ */
+struct IoUringLoop::Ring {
+    ~Ring();
+
+    /** Set up the ring (what's set up is released by the destructor) */
+    void init();
+
+    /** Get an entry to prepare (submitting the prepared ones if full) */
+    struct io_uring_sqe* getSqe();
+
+    /** Give the buffer back to the kernel */
+    void recycleBuffer(uint16_t bid);
+
+    int fd = -1;
+    int eventFd = -1;
+
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    struct io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqFlags = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqSize = 0;
+    /** The tail including the entries prepared but not yet published */
+    unsigned sqLocalTail = 0;
+
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    struct io_uring_cqe* cqes = nullptr;
+
+    /** The buffer ring. (Not used through struct io_uring_buf_ring, as
+     * its flexible array member is misplaced when compiled as C++; the
+     * tail overlays the resv field of the first entry.) */
+    struct io_uring_buf* bufRing = nullptr;
+    size_t bufRingSize = 0;
+    uint8_t* buffers = nullptr;
+    size_t buffersSize = 0;
+    /** The buffer ring tail including the buffers not yet published */
+    uint16_t bufLocalTail = 0;
+
+    IoUringLoop* owner = nullptr;
+};
+
+static void* map_shared(int fd, size_t size, off_t offset) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, offset);
+    if (ptr == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: failed to map the ring");
+    }
+    return ptr;
+}
+
+void IoUringLoop::Ring::init() {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = cqEntries;
+
+    fd = io_uring_setup(sqEntries, &params);
+    if (fd == -1) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: io_uring_setup failed");
+    }
+    if ((params.features & IORING_FEAT_NODROP) == 0) {
+        throw std::system_error(ENOTSUP, std::system_category(),
+                                "IoUringLoop: the kernel may drop completions");
+    }
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes +
+                params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+    }
+    sqMap = map_shared(fd, sqMapSize, IORING_OFF_SQ_RING);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqMap = sqMap;
+    } else {
+        cqMap = map_shared(fd, cqMapSize, IORING_OFF_CQ_RING);
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(
+            map_shared(fd, sqesSize, IORING_OFF_SQES));
+
+    sqHead = ring_ptr<unsigned>(sqMap, params.sq_off.head);
+    sqTail = ring_ptr<unsigned>(sqMap, params.sq_off.tail);
+    sqFlags = ring_ptr<unsigned>(sqMap, params.sq_off.flags);
+    sqMask = *ring_ptr<unsigned>(sqMap, params.sq_off.ring_mask);
+    sqSize = params.sq_entries;
+    sqLocalTail = *sqTail;
+    // Entry i of the submission queue always uses SQE i
+    auto* array = ring_ptr<unsigned>(sqMap, params.sq_off.array);
+    for (unsigned ii = 0; ii < params.sq_entries; ++ii) {
+        array[ii] = ii;
+    }
+
+    cqHead = ring_ptr<unsigned>(cqMap, params.cq_off.head);
+    cqTail = ring_ptr<unsigned>(cqMap, params.cq_off.tail);
+    cqMask = *ring_ptr<unsigned>(cqMap, params.cq_off.ring_mask);
+    cqes = ring_ptr<struct io_uring_cqe>(cqMap, params.cq_off.cqes);
+
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd == -1) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: eventfd failed");
+    }
+    if (io_uring_register(fd, IORING_REGISTER_EVENTFD, &eventFd, 1) == -1) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: failed to register eventfd");
+    }
+
+    // The receive buffers
+    bufRingSize = bufferCount * sizeof(struct io_uring_buf);
+    void* ptr = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: failed to allocate buffer ring");
+    }
+    bufRing = static_cast<struct io_uring_buf*>(ptr);
+
+    buffersSize = bufferCount * bufferSize;
+    ptr = mmap(nullptr, buffersSize, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: failed to allocate buffers");
+    }
+    buffers = static_cast<uint8_t*>(ptr);
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = uintptr_t(bufRing);
+    reg.ring_entries = bufferCount;
+    reg.bgid = bufferGroup;
+    if (io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        throw std::system_error(
+                errno, std::system_category(),
+                "IoUringLoop: failed to register the buffer ring");
+    }
+    for (unsigned ii = 0; ii < bufferCount; ++ii) {
+        recycleBuffer(uint16_t(ii));
+    }
+}
+
+IoUringLoop::Ring::~Ring() {
+    if (fd != -1) {
+        ::close(fd);
+    }
+    if (eventFd != -1) {
+        ::close(eventFd);
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqMap != MAP_FAILED && cqMap != sqMap) {
+        munmap(cqMap, cqMapSize);
+    }
+    if (sqMap != MAP_FAILED) {
+        munmap(sqMap, sqMapSize);
+    }
+    if (bufRing != nullptr) {
+        munmap(bufRing, bufRingSize);
+    }
+    if (buffers != nullptr) {
+        munmap(buffers, buffersSize);
+    }
+}
+
+struct io_uring_sqe* IoUringLoop::Ring::getSqe() {
+    if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqSize) {
+        owner->submit();
+        if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >=
+            sqSize) {
+            throw std::system_error(EBUSY, std::system_category(),
+                                    "IoUringLoop: submission queue is full");
+        }
+    }
+    auto* sqe = &sqes[sqLocalTail & sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sqLocalTail;
+    return sqe;
+}
+
+void IoUringLoop::Ring::recycleBuffer(uint16_t bid) {
+    auto& buf = bufRing[bufLocalTail & (bufferCount - 1)];
+    buf.addr = uintptr_t(buffers + bid * bufferSize);
+    buf.len = uint32_t(bufferSize);
+    buf.bid = bid;
+    ++bufLocalTail;
+    __atomic_store_n(&bufRing[0].resv, bufLocalTail, __ATOMIC_RELEASE);
+}
+
+IoUringLoop::IoUringLoop(struct event_base* base) : ring(new Ring) {
+    ring->owner = this;
+    ring->init();
+    if (event_assign(&completionEvent, base, ring->eventFd,
+                     EV_READ | EV_PERSIST, completionHandler, this) == -1 ||
+        event_add(&completionEvent, nullptr) == -1) {
+        throw std::system_error(EINVAL, std::system_category(),
+                                "IoUringLoop: failed to add the completion "
+                                "event");
+    }
+    if (event_assign(&submitEvent, base, -1, 0, submitHandler, this) == -1) {
+        event_del(&completionEvent);
+        throw std::system_error(EINVAL, std::system_category(),
+                                "IoUringLoop: failed to set up the submit "
+                                "event");
+    }
+}
+
+IoUringLoop::~IoUringLoop() {
+    event_del(&completionEvent);
+    event_del(&submitEvent);
+
+    // The kernel may still write to the receive buffers (and read the
+    // messages being sent), so wait for everything in flight to complete.
+    if (inflight > 0) {
+        auto* sqe = ring->getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        ++inflight;
+        __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+        while (inflight > 0) {
+            const int ret = io_uring_enter(
+                    ring->fd, ring->sqLocalTail - *ring->sqHead, 1,
+                    IORING_ENTER_GETEVENTS);
+            if (ret == -1 && errno != EINTR && errno != EAGAIN &&
+                errno != EBUSY) {
+                break;
+            }
+            unsigned head = *ring->cqHead;
+            const unsigned tail = __atomic_load_n(ring->cqTail,
+                                                  __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const auto& cqe = ring->cqes[head & ring->cqMask];
+                if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+                    --inflight;
+                }
+            }
+            __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+void IoUringLoop::armRecv(IoUringSocket& socket) {
+    auto* sqe = ring->getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket.sfd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bufferGroup;
+    sqe->ioprio = multishot ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = uint64_t(uintptr_t(&socket)) | OpRecv;
+    socket.recvArmed = true;
+    socket.recvCancelled = false;
+    ++inflight;
+    scheduleSubmit();
+}
+
+void IoUringLoop::submitSendmsg(IoUringSocket& socket, struct msghdr* m) {
+    auto* sqe = ring->getSqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = socket.sfd;
+    sqe->addr = uintptr_t(m);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = uint64_t(uintptr_t(&socket)) | OpSend;
+    socket.sendPending = true;
+    ++inflight;
+    scheduleSubmit();
+}
+
+void IoUringLoop::cancel(IoUringSocket&, uint64_t userData) {
+    auto* sqe = ring->getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = 0;
+    ++inflight;
+    scheduleSubmit();
+}
+
+void IoUringLoop::scheduleSubmit() {
+    if (!submitScheduled) {
+        submitScheduled = true;
+        event_active(&submitEvent, EV_TIMEOUT, 0);
+    }
+}
+
+void IoUringLoop::submit() {
+    submitScheduled = false;
+    const unsigned pending =
+            ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    if (pending == 0) {
+        return;
+    }
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    if (__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) &
+        IORING_SQ_CQ_OVERFLOW) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+    int ret;
+    do {
+        ret = io_uring_enter(ring->fd, pending, 0, flags);
+    } while (ret == -1 && errno == EINTR);
+
+    if (ret == -1) {
+        // EAGAIN / EBUSY: the kernel is short of resources, or has
+        // completions it can't post. Try again once they're reaped.
+        scheduleSubmit();
+        return;
+    }
+    stats.submits.fetch_add(1, std::memory_order_relaxed);
+    stats.sqes.fetch_add(uint64_t(ret), std::memory_order_relaxed);
+}
+
+void IoUringLoop::reap() {
+    for (;;) {
+        unsigned head = *ring->cqHead;
+        const unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            break;
+        }
+        for (; head != tail; ++head) {
+            const auto& cqe = ring->cqes[head & ring->cqMask];
+            const uint64_t userData = cqe.user_data;
+            const int res = cqe.res;
+            const uint32_t flags = cqe.flags;
+            // Release the entry before handling it, as that may submit
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            stats.cqes.fetch_add(1, std::memory_order_relaxed);
+            handleCompletion(userData, res, flags);
+        }
+    }
+
+    if (__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) &
+        IORING_SQ_CQ_OVERFLOW) {
+        // Have the kernel post the completions it held back
+        io_uring_enter(ring->fd, 0, 0, IORING_ENTER_GETEVENTS);
+        reap();
+    }
+}
+
+void IoUringLoop::handleCompletion(uint64_t userData, int res, uint32_t flags) {
+    const bool more = (flags & IORING_CQE_F_MORE) != 0;
+    if (!more) {
+        --inflight;
+    }
+
+    auto* socket = reinterpret_cast<IoUringSocket*>(uintptr_t(userData & ~OpMask));
+    if (socket == nullptr) {
+        // A cancellation
+        return;
+    }
+
+    short events = 0;
+    if ((userData & OpMask) == OpRecv) {
+        if (flags & IORING_CQE_F_BUFFER) {
+            const auto bid = uint16_t(flags >> IORING_CQE_BUFFER_SHIFT);
+            if (res > 0) {
+                if (socket->inputOffset > 0 &&
+                    socket->inputOffset >= socket->input.size() / 2) {
+                    socket->input.erase(
+                            socket->input.begin(),
+                            socket->input.begin() + socket->inputOffset);
+                    socket->inputOffset = 0;
+                }
+                const auto* data = ring->buffers + bid * bufferSize;
+                socket->input.insert(socket->input.end(), data, data + res);
+            }
+            ring->recycleBuffer(bid);
+        }
+
+        if (!more) {
+            socket->recvArmed = false;
+        }
+        if (res > 0) {
+            events = EV_READ;
+            if (more && !socket->recvCancelled &&
+                socket->getBufferedInput() >= maxBufferedInput) {
+                // Stop receiving until the connection catches up
+                socket->recvCancelled = true;
+                cancel(*socket, userData);
+            }
+        } else if (res == 0) {
+            socket->recvEof = true;
+            events = EV_READ;
+        } else {
+            switch (-res) {
+            case ENOBUFS:
+                stats.recv_nobufs.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case EINVAL:
+                if (multishot) {
+                    // Multishot receive isn't supported by the kernel
+                    multishot = false;
+                    break;
+                }
+                socket->recvError = -res;
+                events = EV_READ;
+                break;
+            case ECANCELED:
+            case EAGAIN:
+            case EINTR:
+                break;
+            default:
+                socket->recvError = -res;
+                events = EV_READ;
+            }
+        }
+        if (!socket->recvArmed) {
+            socket->maybeArmRecv();
+        }
+    } else {
+        socket->sendPending = false;
+        socket->sendComplete = true;
+        socket->sendResult = res;
+        events = EV_WRITE;
+    }
+
+    if (socket->closed) {
+        if (!socket->hasOperationsInFlight()) {
+            socket->connection.signalIoUring(EV_READ);
+        }
+    } else if (events != 0) {
+        socket->connection.signalIoUring(events);
+    }
+}
+
+void IoUringLoop::completionHandler(evutil_socket_t fd, short, void* arg) {
+    auto& loop = *reinterpret_cast<IoUringLoop*>(arg);
+    uint64_t count;
+    if (::read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        throw std::system_error(errno, std::system_category(),
+                                "IoUringLoop: failed to read eventfd");
+    }
+    loop.reap();
+}
+
+void IoUringLoop::submitHandler(evutil_socket_t, short, void* arg) {
+    auto& loop = *reinterpret_cast<IoUringLoop*>(arg);
+    loop.submit();
+    // Operations which complete right away have their completions posted
+    // during the submit
+    loop.reap();
+}
+
+#else
+
+struct IoUringLoop::Ring {};
+
+IoUringLoop::IoUringLoop(struct event_base*) {
+    throw std::system_error(ENOTSUP, std::system_category(),
+                            "IoUringLoop: io_uring is not supported");
+}
+
+IoUringLoop::~IoUringLoop() = default;
+
+void IoUringLoop::armRecv(IoUringSocket&) {
+}
+
+void IoUringLoop::submitSendmsg(IoUringSocket&, struct msghdr*) {
+}
+
+void IoUringLoop::cancel(IoUringSocket&, uint64_t) {
+}
+
+#endif
@@ -0,0 +1,206 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <event.h>
+#include <platform/platform.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct msghdr;
+class IoUringLoop;
+class McbpConnection;
+
+/**
+ * The network IO of a connection served by an IoUringLoop (the
+ * "io_uring" event_loop setting).
+ *
+ * Rather than waiting for the socket to become readable, a (multishot)
+ * receive is kept posted on it. The data it completes with is buffered
+ * here until the state machine reads it with recv(). A send is submitted
+ * by the first call to sendmsg(), which reports EWOULDBLOCK until it
+ * completes; the call made after the connection is signalled (with
+ * EV_WRITE) returns its result.
+ *
+ * The connection is signalled through McbpConnection::signalIoUring() when
+ * there is something for the state machine to do.
+ */
+class IoUringSocket {
+public:
+    IoUringSocket(IoUringLoop& loop, McbpConnection& connection, SOCKET sfd);
+
+    IoUringSocket(const IoUringSocket&) = delete;
+
+    /**
+     * Read the data received on the socket (same semantics as ::recv on a
+     * non-blocking socket)
+     *
+     * @return the number of bytes read, 0 if the peer closed the connection
+     *         or -1 (with errno set) for an error or if there is no data
+     */
+    int recv(char* dest, size_t nbytes);
+
+    /**
+     * Send the message (same semantics as ::sendmsg on a non-blocking
+     * socket). The message (and the data it refers to) must not be
+     * modified until the call returning its result.
+     */
+    int sendmsg(struct msghdr* m);
+
+    /**
+     * Get the subset of EV_READ / EV_WRITE in flags which may be handled
+     * right away; i.e. there is received data (or an error) to read, or
+     * the result of a send to return.
+     */
+    short getReadyEvents(short flags) const;
+
+    /**
+     * Cancel the operations in flight as the connection is closing. The
+     * connection is signalled once they have all completed.
+     */
+    void close();
+
+    /** Are there any operations the kernel may still complete? */
+    bool hasOperationsInFlight() const {
+        return recvArmed || sendPending;
+    }
+
+private:
+    friend class IoUringLoop;
+
+    /** Post a receive unless closed, or stopped by an error, EOF or having
+     * too much data buffered */
+    void maybeArmRecv();
+
+    size_t getBufferedInput() const {
+        return input.size() - inputOffset;
+    }
+
+    IoUringLoop& loop;
+    McbpConnection& connection;
+    const SOCKET sfd;
+
+    /** Data received but not yet read (from inputOffset) */
+    std::vector<uint8_t> input;
+    size_t inputOffset = 0;
+    /** The error the receive failed with (0 if none) */
+    int recvError = 0;
+    /** Has the peer closed the connection? */
+    bool recvEof = false;
+    /** Is a receive posted (until its final completion)? */
+    bool recvArmed = false;
+    /** Has the posted receive been cancelled? */
+    bool recvCancelled = false;
+
+    /** The message of the send in flight (or completed) */
+    struct msghdr* sendMsg = nullptr;
+    /** Is a send submitted and not yet completed? */
+    bool sendPending = false;
+    /** Is the result of a send waiting to be returned? */
+    bool sendComplete = false;
+    /** The (kernel) result of the completed send */
+    int sendResult = 0;
+
+    /** Is the connection closing? */
+    bool closed = false;
+};
+
+/**
+ * An io_uring owned by a worker thread, and used by the connections it
+ * serves for their network IO.
+ *
+ * The operations prepared while handling the events of an event loop
+ * iteration are submitted together (with a single system call) at the end
+ * of it. The completions are signalled to the event base with an eventfd,
+ * and dispatched to the IoUringSockets. The receives use buffers from a
+ * pool shared by all the connections (a "provided buffer ring"), which are
+ * returned to the kernel as soon as the data is copied out.
+ *
+ * All the methods must be called by the worker thread (apart from
+ * getStats()).
+ */
+class IoUringLoop {
+public:
+    struct Stats {
+        /** Number of io_uring_enter calls submitting operations */
+        std::atomic<uint64_t> submits{0};
+        /** Number of operations submitted */
+        std::atomic<uint64_t> sqes{0};
+        /** Number of completions handled */
+        std::atomic<uint64_t> cqes{0};
+        /** Number of receives stopped as the buffer pool was empty */
+        std::atomic<uint64_t> recv_nobufs{0};
+    };
+
+    /**
+     * Create the io_uring and add its events to the event base
+     *
+     * @throws std::system_error if the kernel doesn't support the
+     *         operations used
+     */
+    explicit IoUringLoop(struct event_base* base);
+
+    IoUringLoop(const IoUringLoop&) = delete;
+
+    /**
+     * Cancel (and wait for) all the operations in flight, and release
+     * the io_uring
+     */
+    ~IoUringLoop();
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+private:
+    friend class IoUringSocket;
+
+    struct Ring;
+
+    void armRecv(IoUringSocket& socket);
+    void submitSendmsg(IoUringSocket& socket, struct msghdr* m);
+    void cancel(IoUringSocket& socket, uint64_t userData);
+
+    /** Submit the prepared operations (and handle any completions) at the
+     * end of this event loop iteration */
+    void scheduleSubmit();
+    void submit();
+    void reap();
+    void handleCompletion(uint64_t userData, int res, uint32_t flags);
+
+    static void completionHandler(evutil_socket_t fd, short which, void* arg);
+    static void submitHandler(evutil_socket_t fd, short which, void* arg);
+
+    std::unique_ptr<Ring> ring;
+
+    /** Signalled by the kernel when completions are posted */
+    struct event completionEvent;
+    /** Activated to submit the prepared operations */
+    struct event submitEvent;
+    bool submitScheduled = false;
+
+    /** Number of operations which haven't had their final completion */
+    size_t inflight = 0;
+
+    /** Use multishot receives (cleared if the kernel rejects them) */
+    bool multishot = true;
+
+    Stats stats;
+};
@@ -510,6 +510,13 @@ static ENGINE_ERROR_CODE dcp_message_control(const void* void_cookie,
     return ret;
 }
 
+/**
+ * The maximum number of DCP messages we ask the engine for in one step. The
+ * engine stops before this when the write buffer or flow control window is
+ * full; this just bounds how long a single connection may hold the thread.
+ */
+static const size_t DcpStepBatchSize = 64;
+
 void ship_mcbp_dcp_log(McbpConnection* c) {
     static struct dcp_message_producers producers = {
         dcp_message_get_failover_log,
@@ -537,8 +544,18 @@ void ship_mcbp_dcp_log(McbpConnection* c) {
 
     c->addMsgHdr(true);
     c->setEwouldblock(false);
-    ret = c->getBucketEngine()->dcp.step(c->getBucketEngineAsV0(), c->getCookie(),
-                                         &producers);
+    auto* engine = c->getBucketEngine();
+    if (engine->dcp.step_batch != nullptr) {
+        // Let the engine fill the write buffer with as many messages as it
+        // can; they're all sent with a single conn_send_data.
+        ret = engine->dcp.step_batch(c->getBucketEngineAsV0(),
+                                     c->getCookie(),
+                                     &producers,
+                                     DcpStepBatchSize);
+    } else {
+        ret = engine->dcp.step(c->getBucketEngineAsV0(), c->getCookie(),
+                               &producers);
+    }
     if (ret == ENGINE_SUCCESS) {
         /* the engine don't have more data to send at this moment */
         c->setEwouldblock(true);
@@ -1332,6 +1349,9 @@ static void dispatch_bin_command(McbpConnection* c) {
     if (c->isPacketAvailable()) {
         // we've got the entire packet spooled up, just go execute
         c->setState(conn_execute);
+    } else if (c->startValueStream()) {
+        // The rest of the value is received straight into the item
+        c->setState(conn_read_packet_body);
     } else {
         // we need to allocate more memory!!
         try {
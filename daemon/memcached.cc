@@ -41,6 +41,7 @@
 #include "runtime.h"
 #include "session_cas.h"
 #include "settings.h"
+#include "shm_transport.h"
 #include "stats.h"
 #include "subdocument.h"
 #include "timings.h"
@@ -155,6 +156,17 @@ struct stats stats;
 
 /** file scope variables **/
 Connection *listen_conn = NULL;
+/*
+ * Protects listen_conn (and enabling / disabling the connections in it), as
+ * the worker threads walk it to find their own listening sockets when
+ * per_thread_listeners is enabled.
+ */
+static std::mutex listen_conn_mutex;
+/*
+ * Bumped whenever listening is disabled or enabled again, so that the worker
+ * threads only look at their sockets when they need to.
+ */
+static std::atomic<uint64_t> listen_generation;
 static struct event_base *main_base;
 
 static engine_event_handler_array_t engine_event_handlers;
@@ -561,6 +573,18 @@ static void settings_init(void) {
      */
     settings.setMaxPacketSize(30 * 1024 * 1024);
 
+    // Hold back the responses to (up to 16k of) pipelined requests, so that
+    // they may be sent with a single system call
+    settings.setResponseCorkSize(16 * 1024);
+    settings.setResponseCorkUsec(250);
+
+    // Receive values of 1MB and bigger straight into the engine's item
+    // rather than the connection's read buffer
+    settings.setStreamValueThreshold(1024 * 1024);
+    // .. but only up to 100MB of them at a time, as the engine accounts the
+    // item for the full value before it is received
+    settings.setStreamValueLimit(100 * 1024 * 1024);
+
     settings.setRequireInit(false);
     settings.setDedupeNmvbMaps(false);
 
@@ -672,14 +696,54 @@ static void disable_listen(void) {
         ++listen_state.num_disable;
     }
 
-    for (next = listen_conn; next; next = next->getNext()) {
+    {
+        std::lock_guard<std::mutex> guard(listen_conn_mutex);
+        for (next = listen_conn; next; next = next->getNext()) {
+            auto* connection = dynamic_cast<ListenConnection*>(next);
+            if (connection == nullptr) {
+                LOG_WARNING(next, "Internal error. Tried to disable listen on"
+                    " an illegal connection object");
+                continue;
+            }
+            // The worker threads disable their own sockets when notified
+            if (connection->getOwner() == nullptr) {
+                connection->disable();
+            }
+        }
+    }
+    listen_generation++;
+    threads_notify_listeners();
+}
+
+void update_thread_listeners(LIBEVENT_THREAD* me) {
+    const uint64_t generation = listen_generation.load();
+    if (generation == me->listen_generation) {
+        return;
+    }
+    me->listen_generation = generation;
+    const bool disabled = is_listen_disabled();
+
+    std::lock_guard<std::mutex> guard(listen_conn_mutex);
+    for (auto* next = listen_conn; next; next = next->getNext()) {
         auto* connection = dynamic_cast<ListenConnection*>(next);
-        if (connection == nullptr) {
-            LOG_WARNING(next, "Internal error. Tried to disable listen on"
-                " an illegal connection object");
+        if (connection == nullptr || connection->getOwner() != me) {
             continue;
         }
-        connection->disable();
+        if (disabled) {
+            connection->disable();
+        } else {
+            connection->enable();
+        }
+    }
+}
+
+void release_thread_listeners(LIBEVENT_THREAD* me) {
+    std::lock_guard<std::mutex> guard(listen_conn_mutex);
+    for (auto* next = listen_conn; next; next = next->getNext()) {
+        auto* connection = dynamic_cast<ListenConnection*>(next);
+        if (connection != nullptr && connection->getOwner() == me) {
+            connection->releaseEvent();
+        }
     }
 }
 
@@ -975,7 +1039,20 @@ bool conn_listening(ListenConnection *c)
         return false;
     }
 
-    dispatch_conn_new(sfd, c->getParentPort());
+    auto* owner = c->getOwner();
+    if (owner == nullptr) {
+        dispatch_conn_new(sfd, c->getParentPort());
+        return false;
+    }
+
+    // Accepted on the thread's own socket; serve the client from this
+    // thread without going through the dispatcher.
+    owner->accepted_conns++;
+    if (conn_new(sfd, c->getParentPort(), owner->base, owner) == nullptr) {
+        LOG_WARNING(c, "Failed to create connection for socket %ld",
+                    long(sfd));
+        safe_close(sfd);
+    }
 
     return false;
 }
@@ -1084,7 +1161,8 @@ void event_handler(evutil_socket_t fd, short which, void *arg) {
 /**
  * The listen_event_handler is the callback from libevent when someone is
  * connecting to one of the server sockets. It runs in the context of the
- * listen thread
+ * listen thread, or of the worker thread owning the socket (with
+ * per_thread_listeners)
  */
 void listen_event_handler(evutil_socket_t, short which, void *arg) {
     auto *c = reinterpret_cast<ListenConnection *>(arg);
@@ -1095,6 +1173,12 @@ void listen_event_handler(evutil_socket_t, short which, void *arg) {
     }
 
     if (memcached_shutdown) {
+        if (c->getOwner() != nullptr) {
+            // The worker thread stops once its clients are disconnected;
+            // just stop accepting new ones.
+            c->disable();
+            return;
+        }
         // Someone requested memcached to shut down. The listen thread should
         // be stopped immediately.
         LOG_NOTICE(NULL, "Stopping listen thread");
@@ -1126,17 +1210,25 @@ static void dispatch_event_handler(evutil_socket_t fd, short, void *) {
             }
         }
         if (enable) {
-            Connection *next;
-            for (next = listen_conn; next; next = next->getNext()) {
-                auto* connection = dynamic_cast<ListenConnection*>(next);
-                if (connection == nullptr) {
-                    LOG_WARNING(next, "Internal error: tried to enable listen "
-                        "on an incorrect connection object type");
-                    continue;
-                }
+            {
+                std::lock_guard<std::mutex> guard(listen_conn_mutex);
+                Connection* next;
+                for (next = listen_conn; next; next = next->getNext()) {
+                    auto* connection = dynamic_cast<ListenConnection*>(next);
+                    if (connection == nullptr) {
+                        LOG_WARNING(next,
+                                    "Internal error: tried to enable listen "
+                                    "on an incorrect connection object type");
+                        continue;
+                    }
 
-                connection->enable();
+                    if (connection->getOwner() == nullptr) {
+                        connection->enable();
+                    }
+                }
             }
+            listen_generation++;
+            threads_notify_listeners();
         }
     }
 }
@@ -1185,7 +1277,19 @@ static void maximize_sndbuf(const SOCKET sfd) {
     }
 }
 
-static SOCKET new_server_socket(struct addrinfo *ai, bool tcp_nodelay) {
+/**
+ * Should each worker thread accept clients on its own listening sockets? This
+ * requires SO_REUSEPORT, so is never the case on platforms without it.
+ */
+static bool use_per_thread_listeners() {
+#ifdef SO_REUSEPORT
+    return settings.isPerThreadListeners();
+#else
+    return false;
+#endif
+}
+
+static SOCKET new_server_socket(const struct addrinfo *ai, bool tcp_nodelay) {
     SOCKET sfd;
 
     sfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
@@ -1226,6 +1330,18 @@ static SOCKET new_server_socket(struct addrinfo *ai, bool tcp_nodelay) {
 #endif
 
     setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, flags_ptr, sizeof(flags));
+#ifdef SO_REUSEPORT
+    if (use_per_thread_listeners()) {
+        error = setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, flags_ptr,
+                           sizeof(flags));
+        if (error != 0) {
+            LOG_WARNING(NULL, "setsockopt(SO_REUSEPORT): %s",
+                        strerror(errno));
+            safe_close(sfd);
+            return INVALID_SOCKET;
+        }
+    }
+#endif
     error = setsockopt(sfd, SOL_SOCKET, SO_KEEPALIVE, flags_ptr,
                        sizeof(flags));
     if (error != 0) {
@@ -1302,6 +1418,68 @@ static void add_listening_port(const struct interface *interf, in_port_t port, s
     }
 }
 
+/**
+ * Add a listening connection to the list of them (listen_conn)
+ */
+static void add_listen_conn(ListenConnection* lconn) {
+    std::lock_guard<std::mutex> guard(listen_conn_mutex);
+    lconn->setNext(listen_conn);
+    listen_conn = lconn;
+
+    stats.daemon_conns++;
+    stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Create the listening connections of each worker thread for an address
+ * (with per_thread_listeners enabled). The sockets are all bound to the same
+ * address with SO_REUSEPORT, so the kernel spreads the clients across them.
+ *
+ * @param sfd the socket already bound to the address, which is given to
+ *            the first thread
+ * @param ai the address
+ * @param port the port the socket is bound to (ai may specify port 0)
+ * @param interf the interface description used to create the port
+ */
+static void add_thread_listeners(SOCKET sfd,
+                                 const struct addrinfo* ai,
+                                 in_port_t port,
+                                 const struct interface& interf) {
+    struct sockaddr_storage addr;
+    memcpy(&addr, ai->ai_addr, ai->ai_addrlen);
+    if (ai->ai_family == AF_INET) {
+        reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port = htons(port);
+    } else if (ai->ai_family == AF_INET6) {
+        reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port = htons(port);
+    }
+
+    for (int ii = 0; ii < settings.getNumWorkerThreads(); ++ii) {
+        if (ii > 0) {
+            sfd = new_server_socket(ai, interf.tcp_nodelay);
+            if (sfd == INVALID_SOCKET) {
+                FATAL_ERROR(EX_OSERR,
+                            "Failed to create listening socket for worker "
+                            "thread %d", ii);
+            }
+            if (bind(sfd, reinterpret_cast<struct sockaddr*>(&addr),
+                     socklen_t(ai->ai_addrlen)) == SOCKET_ERROR) {
+                FATAL_ERROR(EX_OSERR,
+                            "Failed to bind listening socket for worker "
+                            "thread %d to port %u: %s",
+                            ii, port, cb_strerror().c_str());
+            }
+        }
+
+        auto* thread = get_worker_thread(ii);
+        auto* lconn = conn_new_server(sfd, port, ai->ai_family, interf,
+                                      thread->base, thread);
+        if (lconn == nullptr) {
+            FATAL_ERROR(EXIT_FAILURE, "Failed to create listening connection");
+        }
+        add_listen_conn(lconn);
+    }
+}
+
 /**
  * Create a socket and bind it to a specific port number
  * @param interface the interface to bind to
@@ -1387,17 +1565,18 @@ static int server_socket(const struct interface *interf) {
             }
         }
 
-        auto* lconn = conn_new_server(sfd, listenport, next->ai_addr->sa_family,
-                                      *interf, main_base);
-        if (lconn == nullptr) {
-            FATAL_ERROR(EXIT_FAILURE, "Failed to create listening connection");
+        if (use_per_thread_listeners()) {
+            add_thread_listeners(sfd, next, listenport, *interf);
+        } else {
+            auto* lconn = conn_new_server(sfd, listenport,
+                                          next->ai_addr->sa_family,
+                                          *interf, main_base);
+            if (lconn == nullptr) {
+                FATAL_ERROR(EXIT_FAILURE,
+                            "Failed to create listening connection");
+            }
+            add_listen_conn(lconn);
         }
-
-        lconn->setNext(listen_conn);
-        listen_conn = lconn;
-
-        stats.daemon_conns++;
-        stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
         add_listening_port(interf, listenport, next->ai_addr->sa_family);
     }
 
@@ -1428,6 +1607,11 @@ static int server_sockets(bool management) {
         dispatch_conn_new(fileno(stdin), 0);
     }
 
+    // Local clients using shared memory are user clients
+    if (!management && !shm_listen_start(main_base)) {
+        ret |= 1;
+    }
+
     return ret;
 }
 
@@ -1459,6 +1643,7 @@ static void create_listen_sockets(bool management) {
 
         unique_cJSON_ptr array(cJSON_CreateArray());
 
+        std::lock_guard<std::mutex> guard(listen_conn_mutex);
         for (auto* c = listen_conn; c!= nullptr; c = c->getNext()) {
             auto* lc = dynamic_cast<ListenConnection*>(c);
             if (lc == nullptr) {
@@ -1466,6 +1651,11 @@ static void create_listen_sockets(bool management) {
                                            " illegal objects: " +
                                        to_string(c->toJSON(), false));
             }
+            // With per_thread_listeners every thread has a socket for the
+            // same address; only list it once.
+            if (lc->getOwner() != nullptr && lc->getOwner()->index != 0) {
+                continue;
+            }
             cJSON_AddItemToArray(array.get(), lc->getDetails().release());
         }
 
@@ -2004,6 +2194,7 @@ static SERVER_HANDLE_V1 *get_server_api(void)
         server_cookie_api.engine_error2mcbp = engine_error2mcbp;
         server_cookie_api.get_log_info = cookie_get_log_info;
         server_cookie_api.set_error_context = cookie_set_error_context;
+        server_cookie_api.notify_io_complete_batch = notify_io_complete_batch;
 
         server_stat_api.evicting = count_eviction;
 
@@ -2882,6 +3073,7 @@ extern "C" int memcached_main(int argc, char **argv) {
     }
 
     LOG_NOTICE(NULL, "Initiating graceful shutdown.");
+    shm_listen_stop();
     delete_all_buckets();
 
     if (parent_monitor.get() != nullptr) {
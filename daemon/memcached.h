@@ -2,6 +2,8 @@
 #ifndef MEMCACHED_H
 #define MEMCACHED_H
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -23,8 +25,10 @@
 #include <memcached/extension.h>
 #include <JSON_checker.h>
 
+#include "buffer_pool.h"
 #include "dynamic_buffer.h"
 #include "executorpool.h"
+#include "io_uring_loop.h"
 #include "log_macros.h"
 #include "settings.h"
 #include "timing_histogram.h"
@@ -70,6 +74,7 @@ enum class ThreadType {
 
 class Connection;
 class ConnectionQueue;
+class ShmChannel;
 
 struct LIBEVENT_THREAD {
     cb_thread_t thread_id;      /* unique ID of this thread */
@@ -83,11 +88,11 @@ struct LIBEVENT_THREAD {
     int index;                  /* index of this thread in the threads array */
     ThreadType type;      /* Type of IO this thread processes */
 
-    /** Shared read buffer for all connections serviced by this thread. */
-    std::unique_ptr<cb::Pipe> read;
-
-    /** Shared write buffer for all connections serviced by this thread. */
-    std::unique_ptr<cb::Pipe> write;
+    /**
+     * The pool of read and write buffers lent to the connections serviced
+     * by this thread while they have data in flight.
+     */
+    std::unique_ptr<BufferPool> buffer_pool;
 
     subdoc_OPERATION* subdoc_op; /** Shared sub-document operation for all
                                      connections serviced by this thread. */
@@ -104,6 +109,48 @@ struct LIBEVENT_THREAD {
     int deleting_buckets;
 
     JSON_checker::Validator *validator;
+
+    /** Is this thread bound to the CPUs selected by its thread_placement */
+    bool bound;
+
+    /** The CPU this thread was last seen running on. */
+    std::atomic<int> last_cpu;
+
+    /** The listen state last applied to this thread's listening sockets */
+    uint64_t listen_generation;
+
+    /** Number of clients accepted on this thread's own listening sockets */
+    std::atomic<uint64_t> accepted_conns;
+
+    /** Number of connections served by this thread since startup */
+    std::atomic<uint64_t> total_conns;
+
+    /** Number of connections currently served by this thread */
+    std::atomic<uint64_t> curr_conns;
+
+    /**
+     * The io_uring used for the network IO of the connections (when the
+     * event_loop setting is "io_uring", and it could be created)
+     */
+    std::unique_ptr<IoUringLoop> io_uring;
+
+    /**
+     * Is the notification channel an eventfd (notify[0] and notify[1] are
+     * the same descriptor) rather than a pipe
+     */
+    bool notify_eventfd;
+
+    /** Number of times this thread was notified */
+    std::atomic<uint64_t> notify_signals;
+
+    /** Number of times this thread woke up to drain its notifications */
+    std::atomic<uint64_t> notify_wakeups;
+
+    /** Number of io completions handed over to this thread by the engines */
+    std::atomic<uint64_t> io_completions;
+
+    /** Number of times this thread was notified about io completions */
+    std::atomic<uint64_t> io_completion_signals;
 };
 
 #define LOCK_THREAD(t) \
@@ -155,7 +202,69 @@ void thread_init(int nthreads, struct event_base *main_base,
 void threads_shutdown(void);
 void threads_cleanup(void);
 
+/**
+ * Add the CPU placement of each worker thread to a stats response; i.e. the
+ * CPUs it is bound to ("none" if not bound), and the CPU and NUMA node it was
+ * last seen running on.
+ */
+void threads_placement_stats(ADD_STAT add_stat, const void* cookie);
+
+/**
+ * Add the connection counts of each worker thread to a stats response; i.e.
+ * the number of clients it accepted on its own listening sockets, and the
+ * total and current number of connections it serves.
+ */
+void threads_connection_stats(ADD_STAT add_stat, const void* cookie);
+
+/**
+ * Add the network IO statistics of each worker thread to a stats response;
+ * i.e. the event loop it uses and, for an io_uring, the number of submit
+ * calls, operations submitted and completions handled.
+ */
+void threads_io_stats(ADD_STAT add_stat, const void* cookie);
+
+/**
+ * Add the buffer pool statistics of each worker thread to a stats response;
+ * i.e. the number of buffers (and bytes) kept in its pool and lent to its
+ * connections, and how many buffers it allocated and freed.
+ */
+void threads_buffer_stats(ADD_STAT add_stat, const void* cookie);
+
+/**
+ * Add the notification statistics of each worker thread to a stats
+ * response; i.e. the kind of notification channel it uses, how many times
+ * it was notified and woke up, and how many io completions it was handed
+ * over (and notified about).
+ */
+void threads_notification_stats(ADD_STAT add_stat, const void* cookie);
+
+/**
+ * Get the worker thread with the given index (0 <= index < number of worker
+ * threads).
+ */
+LIBEVENT_THREAD* get_worker_thread(int index);
+
+/**
+ * Notify all the worker threads that their listening sockets (see
+ * Settings::isPerThreadListeners()) should be enabled or disabled.
+ */
+void threads_notify_listeners(void);
+
+/**
+ * Enable or disable the listening sockets owned by the calling worker thread
+ * to match the current listen state (called by the thread when notified).
+ */
+void update_thread_listeners(LIBEVENT_THREAD* me);
+
+/**
+ * Delete the events of the listening sockets owned by a worker thread (called
+ * by the thread when its event loop exited, as its event base is freed
+ * before the listening connections are destroyed).
+ */
+void release_thread_listeners(LIBEVENT_THREAD* me);
+
 void dispatch_conn_new(SOCKET sfd, int parent_port);
+void dispatch_shm_conn_new(SOCKET eventFd, std::unique_ptr<ShmChannel> channel);
 
 /* Lock wrappers for cache functions that are called from main loop. */
 int is_listen_thread(void);
@@ -165,6 +274,8 @@ void STATS_UNLOCK(void);
 void threadlocal_stats_reset(struct thread_stats *thread_stats);
 
 void notify_io_complete(const void *cookie, ENGINE_ERROR_CODE status);
+void notify_io_complete_batch(const cb::IoCompletion* completions,
+                              size_t count);
 void safe_close(SOCKET sfd);
 
 
@@ -43,6 +43,7 @@ void process_hello_packet_executor(McbpConnection* c, void* packet) {
     c->setSupportsMutationExtras(false);
     c->setXerrorSupport(false);
     c->setCollectionsSupported(false);
+    c->setUnorderedExecution(false);
 
     if (!key.empty()) {
         log_buffer.append("[");
@@ -117,6 +118,12 @@ void process_hello_packet_executor(McbpConnection* c, void* packet) {
                 added = true;
             }
             break;
+        case mcbp::Feature::UNORDERED_EXECUTION:
+            if (!c->isDCP() && !c->isUnorderedExecution()) {
+                c->setUnorderedExecution(true);
+                added = true;
+            }
+            break;
         }
 
         if (added) {
@@ -31,9 +31,14 @@ MutationCommandContext::MutationCommandContext(McbpConnection& c,
       key(req->bytes + sizeof(req->bytes),
           ntohs(req->message.header.request.keylen),
           c.getDocNamespace()),
-      value(reinterpret_cast<const char*>(key.data() + key.size()),
-            ntohl(req->message.header.request.bodylen) - key.size() -
-                    req->message.header.request.extlen),
+      value(c.isStreamingValue()
+                    ? c.getStreamedValue()
+                    : cb::const_char_buffer(
+                              reinterpret_cast<const char*>(key.data() +
+                                                            key.size()),
+                              ntohl(req->message.header.request.bodylen) -
+                                      key.size() -
+                                      req->message.header.request.extlen)),
       vbucket(ntohs(req->message.header.request.vbucket)),
       input_cas(ntohll(req->message.header.request.cas)),
       expiration(ntohl(req->message.body.expiration)),
@@ -42,6 +47,8 @@ MutationCommandContext::MutationCommandContext(McbpConnection& c,
       state(State::ValidateInput),
       newitem(nullptr, cb::ItemDeleter{c.getBucketEngineAsV0()}),
       existing(nullptr, cb::ItemDeleter{c.getBucketEngineAsV0()}),
+      streamed(c.takeStreamedItem()),
+      newitemIsStreamed(false),
       xattr_size(0),
       store_if_predicate(c.selectedBucketIsXattrEnabled() ? storeIfPredicate
                                                           : nullptr) {
@@ -169,18 +176,28 @@ ENGINE_ERROR_CODE MutationCommandContext::getExistingItemToPreserveXattr() {
 }
 
 ENGINE_ERROR_CODE MutationCommandContext::allocateNewItem() {
+    reclaimStreamedItem();
+
     auto dtype = datatype;
     if (xattr_size > 0) {
         dtype |= PROTOCOL_BINARY_DATATYPE_XATTR;
     }
-    auto ret = bucket_allocate(&connection, key, value.len + xattr_size,
-                               flags, expiration, dtype, vbucket);
 
-    if (ret.first != cb::engine_errc::success) {
-        return ENGINE_ERROR_CODE(ret.first);
-    }
+    // The value may already be in an item of its own (unless the xattrs
+    // of the existing document must be preserved)
+    if (streamed && xattr_size == 0 && setStreamedDatatype(dtype)) {
+        newitem = std::move(streamed);
+        newitemIsStreamed = true;
+    } else {
+        auto ret = bucket_allocate(&connection, key, value.len + xattr_size,
+                                   flags, expiration, dtype, vbucket);
 
-    newitem = std::move(ret.second);
+        if (ret.first != cb::engine_errc::success) {
+            return ENGINE_ERROR_CODE(ret.first);
+        }
+
+        newitem = std::move(ret.second);
+    }
 
     if (operation == OPERATION_ADD || input_cas != 0) {
         bucket_item_set_cas(&connection, newitem.get(), input_cas);
@@ -192,6 +209,11 @@ ENGINE_ERROR_CODE MutationCommandContext::allocateNewItem() {
         }
     }
 
+    if (newitemIsStreamed) {
+        state = State::StoreItem;
+        return ENGINE_SUCCESS;
+    }
+
     item_info newitem_info;
     if (!bucket_get_item_info(&connection, newitem.get(), &newitem_info)) {
         return ENGINE_FAILED;
@@ -289,6 +311,7 @@ ENGINE_ERROR_CODE MutationCommandContext::sendResponse() {
 }
 
 ENGINE_ERROR_CODE MutationCommandContext::reset() {
+    reclaimStreamedItem();
     newitem.reset();
     existing.reset();
     xattr_size = 0;
@@ -296,6 +319,28 @@ ENGINE_ERROR_CODE MutationCommandContext::reset() {
     return ENGINE_SUCCESS;
 }
 
+bool MutationCommandContext::setStreamedDatatype(
+        protocol_binary_datatype_t dtype) {
+    item_info info;
+    if (!bucket_get_item_info(&connection, streamed.get(), &info)) {
+        return false;
+    }
+
+    if (info.datatype == dtype) {
+        return true;
+    }
+
+    info.datatype = dtype;
+    return bucket_set_item_info(&connection, streamed.get(), &info);
+}
+
+void MutationCommandContext::reclaimStreamedItem() {
+    if (newitemIsStreamed) {
+        streamed = std::move(newitem);
+        newitemIsStreamed = false;
+    }
+}
+
 // predicate so that we fail if any existing item has
 // an xattr datatype. In the case an item may not be in cache (existing
 // is not initialised) we force a fetch (return GetInfo) if the VB may
@@ -105,6 +105,19 @@ protected:
      */
     ENGINE_ERROR_CODE reset();
 
+    /**
+     * Set the datatype of the item the value was received into (see
+     * McbpConnection::startValueStream())
+     *
+     * @return true if the item may be stored with the datatype
+     */
+    bool setStreamedDatatype(protocol_binary_datatype_t dtype);
+
+    /**
+     * Take back the item the value was received into if it's the new
+     * document (it's the source of the value if a new item is allocated)
+     */
+    void reclaimStreamedItem();
 
 private:
     const ENGINE_STORE_OPERATION operation;
@@ -128,6 +141,12 @@ private:
     // Pointer to the current value stored in the engine
     cb::unique_item_ptr existing;
 
+    // The item the value was received into (value points into it)
+    cb::unique_item_ptr streamed;
+
+    // Is newitem the item the value was received into?
+    bool newitemIsStreamed;
+
     // The metadata for the existing item
     item_info existing_info;
 
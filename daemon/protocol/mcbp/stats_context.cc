@@ -203,6 +203,12 @@ static ENGINE_ERROR_CODE server_stats(ADD_STAT add_stat_callback,
         add_stat(cookie, add_stat_callback, "rejected_conns", stats.rejected_conns);
         add_stat(cookie, add_stat_callback, "threads", settings.getNumWorkerThreads());
         add_stat(cookie, add_stat_callback, "conn_yields", thread_stats.conn_yields);
+        add_stat(cookie, add_stat_callback, "responses_sent",
+                 thread_stats.responses_sent);
+        add_stat(cookie, add_stat_callback, "send_calls",
+                 thread_stats.send_calls);
+        add_stat(cookie, add_stat_callback, "streamed_values",
+                 thread_stats.streamed_values);
         add_stat(cookie, add_stat_callback, "rbufs_allocated",
                  thread_stats.rbufs_allocated);
         add_stat(cookie, add_stat_callback, "rbufs_loaned",
@@ -320,6 +326,14 @@ static void process_stat_settings(ADD_STAT add_stat_callback,
 
     add_stat(cookie, add_stat_callback, "verbosity", settings.getVerbose());
     add_stat(cookie, add_stat_callback, "num_threads", settings.getNumWorkerThreads());
+    add_stat(cookie, add_stat_callback, "thread_placement",
+             cb::to_string(settings.getThreadPlacement()));
+    add_stat(cookie, add_stat_callback, "per_thread_listeners",
+             settings.isPerThreadListeners());
+    add_stat(cookie, add_stat_callback, "event_loop",
+             to_string(settings.getEventLoop()));
+    add_stat(cookie, add_stat_callback, "shm_listen",
+             settings.getShmListen());
     add_stat(cookie, add_stat_callback, "reqs_per_event_high_priority",
              settings.getRequestsPerEventNotification(EventPriority::High));
     add_stat(cookie, add_stat_callback, "reqs_per_event_med_priority",
@@ -372,6 +386,14 @@ static void process_stat_settings(ADD_STAT add_stat_callback,
              settings.isDedupeNmvbMaps() ? "true" : "false");
     add_stat(cookie, add_stat_callback, "max_packet_size",
              std::to_string(settings.getMaxPacketSize()).c_str());
+    add_stat(cookie, add_stat_callback, "response_cork_size",
+             uint64_t(settings.getResponseCorkSize()));
+    add_stat(cookie, add_stat_callback, "response_cork_usec",
+             uint64_t(settings.getResponseCorkUsec()));
+    add_stat(cookie, add_stat_callback, "stream_value_threshold",
+             uint64_t(settings.getStreamValueThreshold()));
+    add_stat(cookie, add_stat_callback, "stream_value_limit",
+             uint64_t(settings.getStreamValueLimit()));
     add_stat(cookie, add_stat_callback, "xattr_enabled",
             settings.isXattrEnabled());
     add_stat(cookie, add_stat_callback, "privilege_debug",
@@ -504,7 +526,13 @@ static ENGINE_ERROR_CODE stat_reset_executor(const std::string& arg,
  * Handler for the <code>stats sched</code> used to get the
  * histogram for the scheduler histogram.
  *
- * @param arg - should be empty
+ * @param arg - empty, "aggregate" for the histogram of all the threads,
+ *              "placement" for the CPU placement of each thread,
+ *              "connections" for the connection counts of each thread,
+ *              "io" for the network IO statistics of each thread,
+ *              "buffers" for the buffer pool statistics of each thread, or
+ *              "notifications" for the notification statistics of each
+ *              thread
  * @param connection the connection that requested the operation
  */
 static ENGINE_ERROR_CODE stat_sched_executor(const std::string& arg,
@@ -529,6 +557,21 @@ static ENGINE_ERROR_CODE stat_sched_executor(const std::string& arg,
         append_stats(key.data(), key.size(), hist.data(), hist.size(),
                      connection.getCookie());
         return ENGINE_SUCCESS;
+    } else if (arg == "placement") {
+        threads_placement_stats(&append_stats, connection.getCookie());
+        return ENGINE_SUCCESS;
+    } else if (arg == "connections") {
+        threads_connection_stats(&append_stats, connection.getCookie());
+        return ENGINE_SUCCESS;
+    } else if (arg == "io") {
+        threads_io_stats(&append_stats, connection.getCookie());
+        return ENGINE_SUCCESS;
+    } else if (arg == "buffers") {
+        threads_buffer_stats(&append_stats, connection.getCookie());
+        return ENGINE_SUCCESS;
+    } else if (arg == "notifications") {
+        threads_notification_stats(&append_stats, connection.getCookie());
+        return ENGINE_SUCCESS;
     } else {
         return ENGINE_EINVAL;
     }
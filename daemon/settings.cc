@@ -32,6 +32,16 @@
 // the global entry of the settings object
 Settings settings;
 
+std::string to_string(EventLoop loop) {
+    switch (loop) {
+    case EventLoop::Libevent:
+        return "libevent";
+    case EventLoop::IoUring:
+        return "io_uring";
+    }
+
+    return "unknown event loop: " + std::to_string(int(loop));
+}
 
 /**
  * Initialize all members to "null" to preserve backwards
@@ -39,6 +49,7 @@ Settings settings;
  */
 Settings::Settings()
     : num_threads(0),
+      thread_placement(cb::ThreadPlacement::None),
       require_sasl(false),
       bio_drain_buffer_sz(0),
       datatype_json(false),
@@ -51,11 +62,17 @@ Settings::Settings()
       require_init(false),
       topkeys_size(0),
       stdin_listen(false),
+      per_thread_listeners(false),
+      event_loop(EventLoop::Libevent),
       exit_on_connection_close(false),
       maxconns(0) {
 
     verbose.store(0);
     connection_idle_time.reset();
+    response_cork_size.reset();
+    response_cork_usec.reset();
+    stream_value_threshold.reset();
+    stream_value_limit.reset();
     dedupe_nmvb_maps.store(false);
     xattr_enabled.store(false);
     privilege_debug.store(false);
@@ -199,6 +216,28 @@ static void handle_threads(Settings& s, cJSON* obj) {
     s.setNumWorkerThreads(obj->valueint);
 }
 
+/**
+ * Handle the "thread_placement" tag in the settings
+ *
+ *  The value must be one of "none", "core" or "numa"
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_thread_placement(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_String) {
+        throw std::invalid_argument("\"thread_placement\" must be a string");
+    }
+
+    try {
+        s.setThreadPlacement(cb::to_thread_placement(obj->valuestring));
+    } catch (const std::invalid_argument&) {
+        throw std::invalid_argument(
+                "\"thread_placement\" must be one of \"none\", \"core\" "
+                "or \"numa\"");
+    }
+}
+
 /**
  * Handle the "require_init" tag in the settings
  *
@@ -430,6 +469,70 @@ static void handle_max_packet_size(Settings& s, cJSON* obj) {
     s.setMaxPacketSize(obj->valueint * 1024 * 1024);
 }
 
+/**
+ * Handle the "response_cork_size" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_response_cork_size(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_Number) {
+        throw std::invalid_argument(
+            "\"response_cork_size\" must be an integer");
+    }
+    s.setResponseCorkSize(obj->valueint);
+}
+
+/**
+ * Handle the "response_cork_usec" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_response_cork_usec(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_Number) {
+        throw std::invalid_argument(
+            "\"response_cork_usec\" must be an integer");
+    }
+    s.setResponseCorkUsec(obj->valueint);
+}
+
+/**
+ * Handle the "stream_value_threshold" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_stream_value_threshold(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_Number) {
+        throw std::invalid_argument(
+            "\"stream_value_threshold\" must be an integer");
+    }
+    s.setStreamValueThreshold(obj->valueint);
+}
+
+/**
+ * Handle the "stream_value_limit" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_stream_value_limit(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_Number) {
+        throw std::invalid_argument(
+            "\"stream_value_limit\" must be an integer");
+    }
+    s.setStreamValueLimit(obj->valueint);
+}
+
 /**
  * Handle the "stdin_listen" tag in the settings
  *
@@ -449,6 +552,64 @@ static void handle_stdin_listen(Settings& s, cJSON* obj) {
     }
 }
 
+/**
+ * Handle the "per_thread_listeners" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_per_thread_listeners(Settings& s, cJSON* obj) {
+    if (obj->type == cJSON_True) {
+        s.setPerThreadListeners(true);
+    } else if (obj->type == cJSON_False) {
+        s.setPerThreadListeners(false);
+    } else {
+        throw std::invalid_argument(
+            "\"per_thread_listeners\" must be a boolean value");
+    }
+}
+
+/**
+ * Handle the "event_loop" tag in the settings
+ *
+ *  The value must be one of "libevent" or "io_uring"
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_event_loop(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_String) {
+        throw std::invalid_argument("\"event_loop\" must be a string");
+    }
+
+    const std::string loop(obj->valuestring);
+    if (loop == "libevent") {
+        s.setEventLoop(EventLoop::Libevent);
+    } else if (loop == "io_uring") {
+        s.setEventLoop(EventLoop::IoUring);
+    } else {
+        throw std::invalid_argument(
+                "\"event_loop\" must be one of \"libevent\" or \"io_uring\"");
+    }
+}
+
+/**
+ * Handle the "shm_listen" tag in the settings
+ *
+ *  The value must be a string
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_shm_listen(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_String) {
+        throw std::invalid_argument("\"shm_listen\" must be a string");
+    }
+    s.setShmListen(obj->valuestring);
+}
+
 /**
  * Handle the "exit_on_connection_close" tag in the settings
  *
@@ -679,6 +840,7 @@ void Settings::reconfigure(const unique_cJSON_ptr& json) {
             {"audit_file", handle_audit_file},
             {"error_maps_dir", handle_error_maps_dir},
             {"threads", handle_threads},
+            {"thread_placement", handle_thread_placement},
             {"interfaces", handle_interfaces},
             {"extensions", handle_extensions},
             {"require_init", handle_require_init},
@@ -697,7 +859,14 @@ void Settings::reconfigure(const unique_cJSON_ptr& json) {
             {"ssl_minimum_protocol", handle_ssl_minimum_protocol},
             {"breakpad", handle_breakpad},
             {"max_packet_size", handle_max_packet_size},
+            {"response_cork_size", handle_response_cork_size},
+            {"response_cork_usec", handle_response_cork_usec},
+            {"stream_value_threshold", handle_stream_value_threshold},
+            {"stream_value_limit", handle_stream_value_limit},
             {"stdin_listen", handle_stdin_listen},
+            {"per_thread_listeners", handle_per_thread_listeners},
+            {"event_loop", handle_event_loop},
+            {"shm_listen", handle_shm_listen},
             {"exit_on_connection_close", handle_exit_on_connection_close},
             {"saslauthd_socketpath", handle_saslauthd_socketpath},
             {"sasl_mechanisms", handle_sasl_mechanisms},
@@ -914,6 +1083,12 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             throw std::invalid_argument("threads can't be changed dynamically");
         }
     }
+    if (other.has.thread_placement) {
+        if (other.thread_placement != thread_placement) {
+            throw std::invalid_argument(
+                    "thread_placement can't be changed dynamically");
+        }
+    }
 
     if (other.has.audit) {
         if (other.audit_file != audit_file) {
@@ -967,6 +1142,24 @@ void Settings::updateSettings(const Settings& other, bool apply) {
                 "stdin_listen can't be changed dynamically");
         }
     }
+    if (other.has.per_thread_listeners) {
+        if (other.per_thread_listeners != per_thread_listeners) {
+            throw std::invalid_argument(
+                "per_thread_listeners can't be changed dynamically");
+        }
+    }
+    if (other.has.event_loop) {
+        if (other.event_loop != event_loop) {
+            throw std::invalid_argument(
+                "event_loop can't be changed dynamically");
+        }
+    }
+    if (other.has.shm_listen) {
+        if (other.shm_listen != shm_listen) {
+            throw std::invalid_argument(
+                "shm_listen can't be changed dynamically");
+        }
+    }
     if (other.has.exit_on_connection_close) {
         if (other.exit_on_connection_close != exit_on_connection_close) {
             throw std::invalid_argument(
@@ -1117,6 +1310,43 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             setMaxPacketSize(other.max_packet_size);
         }
     }
+    if (other.has.response_cork_size) {
+        if (other.response_cork_size != response_cork_size) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "Change response cork size from %" PRIu64 " to %" PRIu64,
+                  uint64_t(response_cork_size.load()),
+                  uint64_t(other.response_cork_size.load()));
+            setResponseCorkSize(other.response_cork_size);
+        }
+    }
+    if (other.has.response_cork_usec) {
+        if (other.response_cork_usec != response_cork_usec) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "Change response cork time from %" PRIu64 " to %" PRIu64
+                  " usec",
+                  uint64_t(response_cork_usec.load()),
+                  uint64_t(other.response_cork_usec.load()));
+            setResponseCorkUsec(other.response_cork_usec);
+        }
+    }
+    if (other.has.stream_value_threshold) {
+        if (other.stream_value_threshold != stream_value_threshold) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "Change stream value threshold from %" PRIu64 " to %" PRIu64,
+                  uint64_t(stream_value_threshold.load()),
+                  uint64_t(other.stream_value_threshold.load()));
+            setStreamValueThreshold(other.stream_value_threshold);
+        }
+    }
+    if (other.has.stream_value_limit) {
+        if (other.stream_value_limit != stream_value_limit) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "Change stream value limit from %" PRIu64 " to %" PRIu64,
+                  uint64_t(stream_value_limit.load()),
+                  uint64_t(other.stream_value_limit.load()));
+            setStreamValueLimit(other.stream_value_limit);
+        }
+    }
     if (other.has.ssl_cipher_list) {
         if (other.ssl_cipher_list != ssl_cipher_list) {
             // this isn't safe!! an other thread could call stats settings
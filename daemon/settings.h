@@ -22,6 +22,7 @@
 #include "sslcert.h"
 #include <cJSON_utils.h>
 #include <memcached/engine.h>
+#include <memcached/thread_placement.h>
 #include <platform/dynamic.h>
 #include <relaxed_atomic.h>
 #include <atomic>
@@ -173,6 +174,19 @@ enum class EventPriority {
     Default
 };
 
+/**
+ * The mechanism the worker threads use to perform network IO for their
+ * connections.
+ */
+enum class EventLoop {
+    /** Readiness notification from libevent, followed by recv / sendmsg */
+    Libevent,
+    /** Receive and send are submitted to (and completed by) an io_uring */
+    IoUring
+};
+
+std::string to_string(EventLoop loop);
+
 /**
  * Settings for enabling/disabling the ssl client authentication
  */
@@ -341,6 +355,24 @@ public:
         notify_changed("threads");
     }
 
+    /**
+     * Get how the frontend worker threads are placed on the CPUs
+     */
+    cb::ThreadPlacement getThreadPlacement() const {
+        return thread_placement;
+    }
+
+    /**
+     * Set how the frontend worker threads are placed on the CPUs
+     *
+     * @param placement the new placement policy
+     */
+    void setThreadPlacement(cb::ThreadPlacement placement) {
+        has.thread_placement = true;
+        thread_placement = placement;
+        notify_changed("thread_placement");
+    }
+
     /**
      * Add a new interface definition to the list of interfaces provided
      * by the server.
@@ -678,6 +710,89 @@ public:
         notify_changed("max_packet_size");
     }
 
+    /**
+     * Get the maximum number of bytes of responses to pipelined requests
+     * which may be held back, in order to send them with a single system
+     * call (0 if responses are sent as soon as they're ready)
+     */
+    size_t getResponseCorkSize() const {
+        return response_cork_size;
+    }
+
+    /**
+     * Set the maximum number of bytes of responses to pipelined requests
+     * which may be held back (0 disables response corking)
+     *
+     * @param size the new size in bytes
+     */
+    void setResponseCorkSize(size_t size) {
+        Settings::response_cork_size = size;
+        has.response_cork_size = true;
+        notify_changed("response_cork_size");
+    }
+
+    /**
+     * Get the maximum number of microseconds the first of the responses
+     * held back may wait for the following ones
+     */
+    size_t getResponseCorkUsec() const {
+        return response_cork_usec;
+    }
+
+    /**
+     * Set the maximum number of microseconds the first of the responses
+     * held back may wait for the following ones
+     *
+     * @param usec the new time in microseconds
+     */
+    void setResponseCorkUsec(size_t usec) {
+        Settings::response_cork_usec = usec;
+        has.response_cork_usec = true;
+        notify_changed("response_cork_usec");
+    }
+
+    /**
+     * Get the minimum size of a value (of a SET, ADD or REPLACE) to be
+     * received straight into the item allocated from the engine, rather
+     * than buffered in the connection (0 if values are never streamed)
+     */
+    size_t getStreamValueThreshold() const {
+        return stream_value_threshold;
+    }
+
+    /**
+     * Set the minimum size of a value to be received straight into the
+     * item allocated from the engine (0 disables value streaming)
+     *
+     * @param size the new size in bytes
+     */
+    void setStreamValueThreshold(size_t size) {
+        Settings::stream_value_threshold = size;
+        has.stream_value_threshold = true;
+        notify_changed("stream_value_threshold");
+    }
+
+    /**
+     * Get the maximum number of bytes of values being streamed into items
+     * allocated from the engine at any one time (for all connections). A
+     * value which would exceed it is buffered in the connection instead.
+     */
+    size_t getStreamValueLimit() const {
+        return stream_value_limit;
+    }
+
+    /**
+     * Set the maximum number of bytes of values being streamed into items
+     * allocated from the engine at any one time
+     *
+     * @param size the new size in bytes
+     */
+    void setStreamValueLimit(size_t size) {
+        Settings::stream_value_limit = size;
+        has.stream_value_limit = true;
+        notify_changed("stream_value_limit");
+    }
+
     /**
      * Should the server wait for an init message before opening up all
      * non-management tagged interfaces (and disconnect all "non-admin"
@@ -839,6 +954,63 @@ public:
         notify_changed("stdin_listen");
     }
 
+    /**
+     * Should each worker thread accept its own clients on a SO_REUSEPORT
+     * listening socket, rather than the dispatcher accepting them all?
+     */
+    bool isPerThreadListeners() const {
+        return per_thread_listeners;
+    }
+
+    /**
+     * Set if each worker thread should listen on its own socket
+     *
+     * @param enabled true if the workers should accept their own clients
+     */
+    void setPerThreadListeners(bool enabled) {
+        per_thread_listeners = enabled;
+        has.per_thread_listeners = true;
+        notify_changed("per_thread_listeners");
+    }
+
+    /**
+     * Get the mechanism the worker threads use for network IO
+     */
+    EventLoop getEventLoop() const {
+        return event_loop;
+    }
+
+    /**
+     * Set the mechanism the worker threads use for network IO
+     *
+     * @param loop the new event loop
+     */
+    void setEventLoop(EventLoop loop) {
+        event_loop = loop;
+        has.event_loop = true;
+        notify_changed("event_loop");
+    }
+
+    /**
+     * Get the path of the unix domain socket local clients connect to in
+     * order to use the shared memory transport (empty if disabled)
+     */
+    const std::string& getShmListen() const {
+        return shm_listen;
+    }
+
+    /**
+     * Set the path of the unix domain socket used to set up shared memory
+     * connections
+     *
+     * @param path the path of the socket (empty to disable the transport)
+     */
+    void setShmListen(const std::string& path) {
+        shm_listen = path;
+        has.shm_listen = true;
+        notify_changed("shm_listen");
+    }
+
     /**
      * Should the process exit when the connection close
      * (This is used for testing)
@@ -1029,6 +1201,11 @@ protected:
      * */
     int num_threads;
 
+    /**
+     * How the worker threads are placed on the CPUs
+     */
+    cb::ThreadPlacement thread_placement;
+
     /**
      * Array of interface settings we are listening on
      */
@@ -1102,6 +1279,29 @@ protected:
      */
     uint32_t max_packet_size;
 
+    /**
+     * The maximum number of bytes of responses to pipelined requests
+     * held back by a connection (see getResponseCorkSize())
+     */
+    Couchbase::RelaxedAtomic<size_t> response_cork_size;
+
+    /**
+     * The maximum time (in microseconds) a response may be held back
+     */
+    Couchbase::RelaxedAtomic<size_t> response_cork_usec;
+
+    /**
+     * The minimum size of a value to be streamed into the engine's item
+     * (see getStreamValueThreshold())
+     */
+    Couchbase::RelaxedAtomic<size_t> stream_value_threshold;
+
+    /**
+     * The maximum number of bytes of values being streamed at any one
+     * time (see getStreamValueLimit())
+     */
+    Couchbase::RelaxedAtomic<size_t> stream_value_limit;
+
     /**
      * Require init message from ns_server
      */
@@ -1132,6 +1332,21 @@ protected:
      */
     bool stdin_listen;
 
+    /**
+     * Each worker thread accepts clients on its own listening sockets
+     */
+    bool per_thread_listeners;
+
+    /**
+     * The mechanism the worker threads use for network IO
+     */
+    EventLoop event_loop;
+
+    /**
+     * The unix domain socket used to set up shared memory connections
+     */
+    std::string shm_listen;
+
     /**
      * When *any* connection closes, terminate the process.
      * Intended for afl-fuzz runs.
@@ -1187,6 +1402,7 @@ public:
         bool rbac_file;
         bool privilege_debug;
         bool threads;
+        bool thread_placement;
         bool interfaces;
         bool extensions;
         bool audit;
@@ -1204,12 +1420,19 @@ public:
         bool root;
         bool breakpad;
         bool max_packet_size;
+        bool response_cork_size;
+        bool response_cork_usec;
+        bool stream_value_threshold;
+        bool stream_value_limit;
         bool require_init;
         bool ssl_cipher_list;
         bool ssl_minimum_protocol;
         bool client_cert_auth;
         bool topkeys_size;
         bool stdin_listen;
+        bool per_thread_listeners;
+        bool event_loop;
+        bool shm_listen;
         bool exit_on_connection_close;
         bool sasl_mechanisms;
         bool ssl_sasl_mechanisms;
@@ -0,0 +1,311 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include "shm_transport.h"
+#include "memcached.h"
+#include "stats.h"
+
+#include <event.h>
+#include <platform/make_unique.h>
+#include <platform/strerror.h>
+
+#ifdef __linux__
+#include <linux/memfd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <new>
+#include <string>
+
+ShmChannel::ShmChannel(SOCKET sock,
+                       int clientEventFd,
+                       cb::shm::Segment* segment)
+    : sock(sock),
+      clientEventFd(clientEventFd),
+      segment(segment),
+      ringSize(ShmRingSize) {
+}
+
+ShmChannel::~ShmChannel() {
+#ifdef __linux__
+    // The socket isn't counted as a connection (see safe_close()), the
+    // eventfd of the connection is
+    ::close(sock);
+    ::close(clientEventFd);
+    munmap(segment, cb::shm::Segment::getSize(ringSize));
+#endif
+}
+
+void ShmChannel::signalClient() {
+#ifdef __linux__
+    const uint64_t value = 1;
+    if (::write(clientEventFd, &value, sizeof(value)) == -1 &&
+        errno != EAGAIN) {
+        LOG_WARNING(nullptr, "Failed to signal shared memory client: %s",
+                    cb_strerror().c_str());
+    }
+#endif
+}
+
+void ShmChannel::drain(SOCKET eventFd) {
+#ifdef __linux__
+    uint64_t value;
+    while (::read(eventFd, &value, sizeof(value)) == -1 && errno == EINTR) {
+        // retry
+    }
+#endif
+}
+
+#ifdef __linux__
+
+/**
+ * The unix domain socket clients connect to, and the event notifying the
+ * dispatcher about new clients
+ */
+static struct {
+    SOCKET sfd = INVALID_SOCKET;
+    struct event* ev = nullptr;
+    std::string path;
+} shm_listener;
+
+/**
+ * Create the shared memory segment and the eventfds for a new client, and
+ * send them to the client
+ *
+ * @param sock the unix domain socket of the client
+ * @param serverEventFd where to store the eventfd memcached waits on
+ * @return the channel to the client, or nullptr if the setup failed
+ */
+static std::unique_ptr<ShmChannel> shm_handshake(SOCKET sock,
+                                                 int& serverEventFd) {
+    const size_t size = cb::shm::Segment::getSize(ShmRingSize);
+    const int memfd = int(syscall(SYS_memfd_create, "memcached-shm",
+                                  MFD_CLOEXEC));
+    if (memfd == -1) {
+        LOG_WARNING(nullptr, "Failed to create shared memory segment: %s",
+                    cb_strerror().c_str());
+        return nullptr;
+    }
+
+    void* addr = MAP_FAILED;
+    if (ftruncate(memfd, off_t(size)) == 0) {
+        addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    memfd, 0);
+    }
+    if (addr == MAP_FAILED) {
+        LOG_WARNING(nullptr, "Failed to map shared memory segment: %s",
+                    cb_strerror().c_str());
+        ::close(memfd);
+        return nullptr;
+    }
+
+    auto* segment = new (addr) cb::shm::Segment();
+    segment->magic = cb::shm::Magic;
+    segment->version = cb::shm::Version;
+    segment->ringSize = ShmRingSize;
+
+    serverEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const int clientEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (serverEventFd == -1 || clientEventFd == -1) {
+        LOG_WARNING(nullptr, "Failed to create eventfd: %s",
+                    cb_strerror().c_str());
+        if (serverEventFd != -1) {
+            ::close(serverEventFd);
+            serverEventFd = -1;
+        }
+        if (clientEventFd != -1) {
+            ::close(clientEventFd);
+        }
+        munmap(addr, size);
+        ::close(memfd);
+        return nullptr;
+    }
+
+    cb::shm::Hello hello = {cb::shm::Magic, cb::shm::Version, ShmRingSize};
+    struct iovec iov = {&hello, sizeof(hello)};
+    const int fds[3] = {memfd, serverEventFd, clientEventFd};
+    union {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    auto* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    const auto nw = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    // The client has its own reference to the segment now
+    ::close(memfd);
+    if (nw != ssize_t(sizeof(hello))) {
+        LOG_WARNING(nullptr, "Failed to send shared memory to client: %s",
+                    nw == -1 ? cb_strerror().c_str() : "short write");
+        ::close(serverEventFd);
+        serverEventFd = -1;
+        ::close(clientEventFd);
+        munmap(addr, size);
+        return nullptr;
+    }
+
+    try {
+        return std::make_unique<ShmChannel>(sock, clientEventFd, segment);
+    } catch (const std::bad_alloc&) {
+        LOG_WARNING(nullptr, "Failed to allocate shared memory channel");
+        ::close(serverEventFd);
+        serverEventFd = -1;
+        ::close(clientEventFd);
+        munmap(addr, size);
+        return nullptr;
+    }
+}
+
+static void shm_accept_handler(evutil_socket_t fd, short, void*) {
+    SOCKET sock = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (sock == INVALID_SOCKET) {
+        if (!is_blocking(errno)) {
+            LOG_WARNING(nullptr, "Failed to accept shared memory client: %s",
+                        cb_strerror().c_str());
+        }
+        return;
+    }
+
+    // The unix domain socket is counted as the connection until the
+    // connection is set up (safe_close() decrements the count)
+    const int curr_conns = stats.curr_conns.fetch_add(
+            1, std::memory_order_relaxed);
+    if (curr_conns >= settings.getMaxconns()) {
+        stats.rejected_conns++;
+        LOG_WARNING(nullptr,
+                    "Too many open connections. Rejecting shared memory "
+                    "client; total: %d/%d", curr_conns,
+                    settings.getMaxconns());
+        safe_close(sock);
+        return;
+    }
+
+    int serverEventFd = -1;
+    auto channel = shm_handshake(sock, serverEventFd);
+    if (!channel) {
+        safe_close(sock);
+        return;
+    }
+
+    if (evutil_make_socket_nonblocking(sock) == -1) {
+        LOG_WARNING(nullptr, "Failed to make socket non-blocking. closing it");
+        channel.reset();
+        safe_close(serverEventFd);
+        return;
+    }
+
+    // From now on the connection is counted by the eventfd (closed by the
+    // connection), and the socket is closed by the channel
+    dispatch_shm_conn_new(serverEventFd, std::move(channel));
+}
+
+bool shm_listen_start(event_base* base) {
+    const auto& path = settings.getShmListen();
+    if (path.empty() || shm_listener.sfd != INVALID_SOCKET) {
+        return true;
+    }
+
+    struct sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        LOG_WARNING(nullptr, "shm_listen: \"%s\" is too long", path.c_str());
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), addr.sun_path);
+
+    SOCKET sfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sfd == INVALID_SOCKET) {
+        LOG_WARNING(nullptr, "shm_listen: Failed to create socket: %s",
+                    cb_strerror().c_str());
+        return false;
+    }
+
+    // Remove the socket left behind by a previous instance
+    unlink(path.c_str());
+    if (bind(sfd, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) == -1 ||
+        listen(sfd, 1024) == -1 ||
+        evutil_make_socket_nonblocking(sfd) == -1) {
+        LOG_WARNING(nullptr, "shm_listen: Failed to listen to \"%s\": %s",
+                    path.c_str(), cb_strerror().c_str());
+        ::close(sfd);
+        return false;
+    }
+
+    shm_listener.ev = event_new(base, sfd, EV_READ | EV_PERSIST,
+                                shm_accept_handler, nullptr);
+    if (shm_listener.ev == nullptr || event_add(shm_listener.ev, nullptr)) {
+        LOG_WARNING(nullptr, "shm_listen: Failed to add event for \"%s\"",
+                    path.c_str());
+        if (shm_listener.ev != nullptr) {
+            event_free(shm_listener.ev);
+            shm_listener.ev = nullptr;
+        }
+        ::close(sfd);
+        unlink(path.c_str());
+        return false;
+    }
+
+    shm_listener.sfd = sfd;
+    shm_listener.path = path;
+    LOG_NOTICE(nullptr, "Accepting shared memory clients on %s",
+               path.c_str());
+    return true;
+}
+
+void shm_listen_stop() {
+    if (shm_listener.sfd == INVALID_SOCKET) {
+        return;
+    }
+
+    event_free(shm_listener.ev);
+    shm_listener.ev = nullptr;
+    ::close(shm_listener.sfd);
+    shm_listener.sfd = INVALID_SOCKET;
+    unlink(shm_listener.path.c_str());
+}
+
+#else
+
+bool shm_listen_start(event_base*) {
+    if (!settings.getShmListen().empty()) {
+        LOG_WARNING(nullptr,
+                    "shm_listen: The shared memory transport is only "
+                    "supported on Linux, ignoring \"%s\"",
+                    settings.getShmListen().c_str());
+    }
+    return true;
+}
+
+void shm_listen_stop() {
+}
+
+#endif
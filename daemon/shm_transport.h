@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/shm_ring.h>
+#include <platform/platform.h>
+
+#include <cstddef>
+
+struct event_base;
+
+/**
+ * The size of each of the rings of a shared memory connection
+ */
+const size_t ShmRingSize = 1024 * 1024;
+
+/**
+ * The server side of the shared memory transport of a connection (see
+ * include/memcached/shm_ring.h): the unix domain socket the client stays
+ * connected to, the eventfd used to wake up the client, and the mapping of
+ * the segment. The eventfd memcached waits on is the socket descriptor of
+ * the connection, and is owned by the connection.
+ */
+class ShmChannel {
+public:
+    /**
+     * @param sock the unix domain socket of the client
+     * @param clientEventFd the eventfd the client waits on
+     * @param segment the (mapped) shared memory segment
+     */
+    ShmChannel(SOCKET sock, int clientEventFd, cb::shm::Segment* segment);
+
+    ShmChannel(const ShmChannel&) = delete;
+
+    ~ShmChannel();
+
+    SOCKET getSocket() const {
+        return sock;
+    }
+
+    /** Get the ring memcached reads the requests from */
+    cb::shm::Ring getRequests() {
+        return {segment->requests, segment->getRequestData(), ringSize};
+    }
+
+    /** Get the ring memcached writes the responses to */
+    cb::shm::Ring getResponses() {
+        return {segment->responses, segment->getResponseData(ringSize),
+                ringSize};
+    }
+
+    /** Wake up the client */
+    void signalClient();
+
+    /**
+     * Reset the eventfd memcached waits on (before checking the rings one
+     * last time)
+     */
+    static void drain(SOCKET eventFd);
+
+private:
+    const SOCKET sock;
+    const int clientEventFd;
+    cb::shm::Segment* const segment;
+    /**
+     * The size of the rings. The client may write anything to the segment,
+     * so the size is never read back from it.
+     */
+    const size_t ringSize;
+};
+
+/**
+ * Start accepting local clients on the unix domain socket specified by
+ * the "shm_listen" setting (if any). The clients are accepted (and the
+ * shared memory set up) by the thread running the event base, and then
+ * dispatched to the worker threads like other clients.
+ *
+ * @param base the event base of the dispatcher
+ * @return true if success (or the transport isn't enabled)
+ */
+bool shm_listen_start(event_base* base);
+
+/**
+ * Stop accepting local clients, and remove the unix domain socket
+ */
+void shm_listen_stop();
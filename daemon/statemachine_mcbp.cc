@@ -105,12 +105,16 @@ const char* McbpStateMachine::getTaskName(TaskFunction task) const {
 static void reset_cmd_handler(McbpConnection *c) {
     c->setCmd(-1);
 
+    c->releaseCommandCookie();
     c->getCookieObject().reset();
     c->resetCommandContext();
 
     c->shrinkBuffers();
 
-    if (c->read->rsize() >= sizeof(c->binary_header)) {
+    if (c->resumeParkedCommand()) {
+        // The engine is done with a parked command; it goes first
+        c->setState(conn_execute);
+    } else if (c->read->rsize() >= sizeof(c->binary_header)) {
         c->setState(conn_parse_cmd);
     } else {
         c->setState(conn_waiting);
@@ -203,6 +207,12 @@ bool conn_read_packet_header(McbpConnection* c) {
         return true;
     }
 
+    if (c->hasNotifiedParkedCommands()) {
+        // Send the response of the parked command(s)
+        c->setState(conn_new_cmd);
+        return true;
+    }
+
     switch (c->tryReadNetwork()) {
     case McbpConnection::TryReadResult::NoDataReceived:
         if (settings.isExitOnConnectionClose()) {
@@ -243,7 +253,14 @@ bool conn_new_cmd(McbpConnection *c) {
 
     c->setStart(0);
 
-    if (!c->write->empty()) {
+    if (c->hasCorkedResponses() && !c->mayCorkResponses()) {
+        // Send the responses we've held back before we wait for more
+        // data (or yield)
+        c->sendCorkedResponses();
+        return true;
+    }
+
+    if (!c->write->empty() && !c->hasCorkedResponses()) {
         LOG_WARNING(c,
                     "%u: Expected write buffer to be empty.. It's not! (%"
                     PRIu64 ")", c->getId(), c->write->rsize());
@@ -297,17 +314,66 @@ bool conn_execute(McbpConnection *c) {
         return true;
     }
 
-    if (!c->isPacketAvailable()) {
-        throw std::logic_error(
-            "conn_execute: Internal error.. the input packet is not completely in memory");
+    // A parked command is executed from the copy kept by its cookie
+    const bool parked = c->isExecutingParkedCommand();
+
+    if (!parked) {
+        if (!c->isPacketAvailable()) {
+            throw std::logic_error(
+                "conn_execute: Internal error.. the input packet is not completely in memory");
+        }
+
+        if (c->isStreamAllocationInFlight()) {
+            // Wait for the engine to notify the item allocation which
+            // blocked when the value was about to be streamed
+            c->unregisterEvent();
+            return false;
+        }
+        c->clearStreamAllocation();
+
+        if (c->isEwouldblock()) {
+            if (c->isUnorderedExecution() && !c->isCommandNotified()) {
+                // Woken up for a parked command while this command still
+                // waits for the engine. The parked commands are run once
+                // this command completes (see reset_cmd_handler())
+                c->unregisterEvent();
+                return false;
+            }
+        } else {
+            if (c->mustWaitForParkedCommands()) {
+                if (c->hasNotifiedParkedCommands()) {
+                    // Run the parked command(s), and then parse this
+                    // command again
+                    c->setState(conn_new_cmd);
+                    return true;
+                }
+                // We'll be notified (through notify_io_complete) when
+                // one of them may continue
+                c->unregisterEvent();
+                return false;
+            }
+            c->assignCommandCookie();
+        }
     }
 
     c->setEwouldblock(false);
+    c->clearCommandNotified();
     mcbp_complete_packet(c);
 
     if (c->isEwouldblock()) {
-        c->unregisterEvent();
-        return false;
+        if (!c->parkCommand()) {
+            if (c->hasCorkedResponses()) {
+                // Don't hold back the responses while we wait
+                c->flushCorkedResponses();
+                if (c->getState() == conn_closing) {
+                    return true;
+                }
+            }
+            c->unregisterEvent();
+            return false;
+        }
+        // Move on to the next command while the engine works on this one
+        c->setState(conn_new_cmd);
     }
 
     // We've executed the packet, and given that we're not blocking we
@@ -317,9 +383,17 @@ bool conn_execute(McbpConnection *c) {
         throw std::logic_error("conn_execute: Should leave conn_execute for !EWOULDBLOCK");
     }
 
-    // Consume the packet we just executed from the input buffer
-    c->read->consume([c](cb::const_byte_buffer buffer) -> ssize_t {
-        size_t size = sizeof(c->binary_header) + c->binary_header.request.bodylen;
+    if (parked) {
+        return true;
+    }
+
+    // Consume the packet we just executed from the input buffer (only the
+    // part of it which was read before its value was streamed)
+    size_t size = sizeof(c->binary_header) + c->binary_header.request.bodylen;
+    if (c->isStreamingValue()) {
+        size = c->finishValueStream();
+    }
+    c->read->consume([size](cb::const_byte_buffer buffer) -> ssize_t {
         if (size > buffer.size()) {
             throw std::logic_error("conn_execute: Not enough data in input buffer");
         }
@@ -340,10 +414,15 @@ bool conn_read_packet_body(McbpConnection* c) {
     }
 
     // We need to get more data!!!
-    auto res = c->read->produce([c](cb::byte_buffer buffer) -> ssize_t {
-        return c->recv(reinterpret_cast<char*>(buffer.data()),
-                       buffer.size());
-    });
+    ssize_t res;
+    if (c->isStreamingValue()) {
+        res = c->recvStreamedValue();
+    } else {
+        res = c->read->produce([c](cb::byte_buffer buffer) -> ssize_t {
+            return c->recv(reinterpret_cast<char*>(buffer.data()),
+                           buffer.size());
+        });
+    }
 
     if (res > 0) {
         get_thread_stats(c)->bytes_read += res;
@@ -385,6 +464,16 @@ bool conn_read_packet_body(McbpConnection* c) {
 bool conn_send_data(McbpConnection* c) {
     bool ret = true;
 
+    if (!c->isTransmitting()) {
+        get_thread_stats(c)->responses_sent++;
+        if (c->corkResponse()) {
+            // Send it together with the responses to the pipelined
+            // commands following it
+            c->setState(c->getWriteAndGo());
+            return true;
+        }
+    }
+
     switch (c->transmit()) {
     case McbpConnection::TransmitResult::Complete:
         // Release all allocated resources
@@ -429,7 +518,8 @@ bool conn_pending_close(McbpConnection *c) {
      */
     perform_callbacks(ON_DISCONNECT, NULL, c->getCookie());
 
-    if (c->getRefcount() > 1) {
+    if (c->getRefcount() > 1 || c->hasIoUringOperations() ||
+        c->hasParkedCommandsInFlight() || c->isStreamAllocationInFlight()) {
         return false;
     }
 
@@ -449,7 +539,8 @@ bool conn_immediate_close(McbpConnection *c) {
         port_instance = get_listening_port_instance(c->getParentPort());
         if (port_instance) {
             --port_instance->curr_conns;
-        } else if(!c->isPipeConnection()) {
+        } else if (!c->isPipeConnection() &&
+                   !c->isSharedMemoryConnection()) {
             throw std::logic_error("null port_instance and connection "
                                        "is not a pipe");
         }
@@ -465,16 +556,22 @@ bool conn_immediate_close(McbpConnection *c) {
 bool conn_closing(McbpConnection *c) {
     // Delete any attached command context
     c->resetCommandContext();
+    c->releaseCommandCookie();
+    c->resetValueStream();
 
     /* We don't want any network notifications anymore.. */
     c->unregisterEvent();
+    c->cancelIoUring();
+    c->releaseTransport();
     safe_close(c->getSocketDescriptor());
     c->setSocketDescriptor(INVALID_SOCKET);
 
     /* engine::release any allocated state */
     conn_cleanup_engine_allocations(c);
 
-    if (c->getRefcount() > 1 || c->isEwouldblock()) {
+    if (c->getRefcount() > 1 || c->isEwouldblock() ||
+        c->hasIoUringOperations() || c->hasParkedCommandsInFlight() ||
+        c->isStreamAllocationInFlight()) {
         c->setState(conn_pending_close);
     } else {
         c->setState(conn_immediate_close);
@@ -48,6 +48,9 @@ struct thread_stats {
         bytes_read = 0;
         cmd_flush = 0;
         conn_yields = 0;
+        responses_sent = 0;
+        send_calls = 0;
+        streamed_values = 0;
         auth_cmds = 0;
         auth_errors = 0;
         cmd_subdoc_lookup = 0;
@@ -89,6 +92,9 @@ struct thread_stats {
         bytes_written += other.bytes_written;
         cmd_flush += other.cmd_flush;
         conn_yields += other.conn_yields;
+        responses_sent += other.responses_sent;
+        send_calls += other.send_calls;
+        streamed_values += other.streamed_values;
         auth_cmds += other.auth_cmds;
         auth_errors += other.auth_errors;
         cmd_subdoc_lookup += other.cmd_subdoc_lookup;
@@ -138,6 +144,13 @@ struct thread_stats {
     Couchbase::RelaxedAtomic<uint64_t> bytes_written;
     Couchbase::RelaxedAtomic<uint64_t> cmd_flush;
     Couchbase::RelaxedAtomic<uint64_t> conn_yields; /* # of yields for connections (-R option)*/
+    /* # of responses queued for sending (held back responses included) */
+    Couchbase::RelaxedAtomic<uint64_t> responses_sent;
+    /* # of system calls used to send data (compare with responses_sent
+       and bytes_written) */
+    Couchbase::RelaxedAtomic<uint64_t> send_calls;
+    /* # of values received straight into the engine's item */
+    Couchbase::RelaxedAtomic<uint64_t> streamed_values;
     Couchbase::RelaxedAtomic<uint64_t> auth_cmds;
     Couchbase::RelaxedAtomic<uint64_t> auth_errors;
     /* # of subdoc lookup commands (GET/EXISTS/MULTI_LOOKUP) */
@@ -5,6 +5,7 @@
 #include "config.h"
 #include "memcached.h"
 #include "connections.h"
+#include "shm_transport.h"
 
 #include <atomic>
 #include <stdio.h>
@@ -15,11 +16,20 @@
 #include <stdint.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <memcached/thread_placement.h>
 #include <platform/cb_malloc.h>
 #include <platform/platform.h>
 #include <platform/strerror.h>
 #include <queue>
+#include <stdexcept>
 #include <memory>
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 #define ITEMS_PER_ALLOC 64
 
@@ -34,8 +44,17 @@ struct ConnectionQueueItem {
         // empty
     }
 
+    ConnectionQueueItem(SOCKET eventFd, std::unique_ptr<ShmChannel> channel)
+        : sfd(eventFd),
+          parent_port(0),
+          shm(std::move(channel)) {
+        // empty
+    }
+
     SOCKET sfd;
     in_port_t parent_port;
+    /** The shared memory of a local client (sfd is its eventfd) */
+    std::unique_ptr<ShmChannel> shm;
 };
 
 class ConnectionQueue {
@@ -145,6 +164,28 @@ bool create_notification_pipe(LIBEVENT_THREAD *me)
     return true;
 }
 
+/*
+ * Create the notification channel of a worker thread. On Linux this is an
+ * eventfd (used as both ends of the channel): notifying the thread is a
+ * single write, and any number of notifications is drained with a single
+ * read. Other platforms use the notification pipe.
+ */
+static bool create_notification_channel(LIBEVENT_THREAD *me)
+{
+#ifdef __linux__
+    const int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd != -1) {
+        me->notify[0] = me->notify[1] = efd;
+        me->notify_eventfd = true;
+        return true;
+    }
+    LOG_WARNING(nullptr, "Can't create notify eventfd (using a pipe): %s",
+                cb_strerror().c_str());
+#endif
+    me->notify_eventfd = false;
+    return create_notification_pipe(me);
+}
+
 static void setup_dispatcher(struct event_base *main_base,
                              void (*dispatcher_callback)(evutil_socket_t, short, void *))
 {
@@ -213,6 +254,59 @@ static void setup_thread(LIBEVENT_THREAD *me) {
     } catch (const std::bad_alloc&) {
         FATAL_ERROR(EXIT_FAILURE, "Failed to allocate memory for JSON validator");
     }
+
+    try {
+        me->buffer_pool = std::make_unique<BufferPool>();
+    } catch (const std::bad_alloc&) {
+        FATAL_ERROR(EXIT_FAILURE, "Failed to allocate memory for buffer pool");
+    }
+
+    if (settings.getEventLoop() == EventLoop::IoUring) {
+        try {
+            me->io_uring = std::make_unique<IoUringLoop>(me->base);
+        } catch (const std::exception& error) {
+            LOG_WARNING(nullptr,
+                        "Failed to create io_uring for worker thread %d, "
+                        "using libevent: %s",
+                        me->index, error.what());
+        }
+    }
+}
+
+/*
+ * Bind the calling worker thread to the CPUs selected by the thread_placement
+ * setting for the given process-wide thread ordinal (so that the executor
+ * threads started later are placed after the workers), and make it allocate
+ * its memory from its own NUMA node.
+ */
+static void place_thread(LIBEVENT_THREAD *me, size_t ordinal) {
+    me->bound = false;
+    me->last_cpu.store(cb::getCurrentCpu());
+
+    const auto placement = settings.getThreadPlacement();
+    const auto& topology = cb::CpuTopology::get();
+    const auto cpus = topology.getPlacement(placement, ordinal);
+    if (cpus.empty()) {
+        return;
+    }
+
+    const auto cpuList = cb::CpuTopology::formatCpuList(cpus);
+    if (!cb::bindCurrentThread(cpus)) {
+        LOG_WARNING(nullptr, "Failed to bind worker thread %d to CPUs %s: %s",
+                    me->index, cpuList.c_str(), cb_strerror().c_str());
+        return;
+    }
+    me->bound = true;
+    me->last_cpu.store(cb::getCurrentCpu());
+
+    if (!cb::setLocalMemoryPolicy()) {
+        LOG_WARNING(nullptr,
+                    "Failed to set local memory policy for worker thread %d: "
+                    "%s",
+                    me->index, cb_strerror().c_str());
+    }
+    LOG_INFO(nullptr, "Worker thread %d bound to CPUs %s (NUMA node %d)",
+             me->index, cpuList.c_str(), topology.getNode(cpus.front()));
 }
 
 /*
@@ -223,7 +317,13 @@ static void worker_libevent(void *arg) {
 
     /* Any per-thread setup can happen here; thread_init() will block until
      * all threads have finished initializing.
+     *
+     * The thread's event base and other state are allocated here (rather
+     * than by thread_init()), so that once placed they are local to it.
      */
+    const auto ordinal = cb::acquireThreadOrdinal();
+    place_thread(me, ordinal);
+    setup_thread(me);
 
     cb_mutex_enter(&init_lock);
     init_count++;
@@ -233,6 +333,8 @@ static void worker_libevent(void *arg) {
     event_base_loop(me->base, 0);
 
     // Event loop exited; cleanup before thread exits.
+    release_thread_listeners(me);
+    cb::releaseThreadOrdinal(ordinal);
     ERR_remove_state(0);
 }
 
@@ -246,8 +348,20 @@ static int number_of_pending(Connection *c, Connection *list) {
     return rv;
 }
 
-static void drain_notification_channel(evutil_socket_t fd)
+static void drain_notification_channel(LIBEVENT_THREAD* me, evutil_socket_t fd)
 {
+    me->notify_wakeups++;
+#ifdef __linux__
+    if (me->notify_eventfd) {
+        uint64_t value;
+        if (::read(fd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+            LOG_WARNING(nullptr, "Can't read from notify eventfd: %s",
+                        cb_strerror().c_str());
+        }
+        return;
+    }
+#endif
+
     int nread;
     while ((nread = recv(fd, devnull, sizeof(devnull), 0)) == (int)sizeof(devnull)) {
         /* empty */
@@ -263,7 +377,9 @@ void dispatch_new_connections(LIBEVENT_THREAD* me) {
     std::unique_ptr<ConnectionQueueItem> item;
     while ((item = me->new_conn_queue->pop()) != nullptr) {
         Connection* c = nullptr;
-        if (item->sfd == fileno(stdin)) {
+        if (item->shm) {
+            c = conn_shm_new(item->sfd, std::move(item->shm), me->base, me);
+        } else if (item->sfd == fileno(stdin)) {
             c = conn_pipe_new(item->sfd, me->base, me);
         } else {
             c = conn_new(item->sfd, item->parent_port, me->base, me);
@@ -289,7 +405,7 @@ static void thread_libevent_process(evutil_socket_t fd, short which, void *arg)
     // tries to notify us while we're doing the work below (so we don't have
     // to care about race conditions for stuff people try to notify us
     // about.
-    drain_notification_channel(fd);
+    drain_notification_channel(me, fd);
 
     if (memcached_shutdown) {
         // Someone requested memcached to shut down. The listen thread should
@@ -308,6 +424,7 @@ static void thread_libevent_process(evutil_socket_t fd, short which, void *arg)
     }
 
     dispatch_new_connections(me);
+    update_thread_listeners(me);
 
     LOCK_THREAD(me);
     Connection* pending = me->pending_io;
@@ -417,7 +534,11 @@ static void enlist_conn(Connection *c, Connection **list) {
     cb_assert(!has_cycle(*list));
 }
 
-void notify_io_complete(const void *void_cookie, ENGINE_ERROR_CODE status)
+/*
+ * Validate a cookie the engine notifies the completion of an io operation
+ * for, and get the cookie (its connection is bound to a thread).
+ */
+static const Cookie& get_notified_cookie(const void *void_cookie)
 {
     if (void_cookie == nullptr) {
         throw std::logic_error(
@@ -434,28 +555,93 @@ void notify_io_complete(const void *void_cookie, ENGINE_ERROR_CODE status)
                 "connection set to null");
     }
 
-    LIBEVENT_THREAD* thr = connection->getThread();
-    if (thr == nullptr) {
+    if (connection->getThread() == nullptr) {
         throw std::runtime_error(
             "notify_io_complete: connection should be bound to a thread");
     }
 
-    int notify;
+    return *cookie;
+}
+
+/*
+ * Hand the completion of an io operation over to the connection, and add
+ * the connection to the pending io list of its thread. Must be called with
+ * the thread locked.
+ *
+ * @return true if the thread must be notified
+ */
+static bool complete_io(const Cookie& cookie, ENGINE_ERROR_CODE status)
+{
+    Connection* connection = cookie.connection;
 
     LOG_DEBUG(NULL, "Got notify from %u, status 0x%x",
               connection->getId(), status);
 
+    reinterpret_cast<McbpConnection*>(connection)->notifyIoComplete(cookie,
+                                                                   status);
+    connection->getThread()->io_completions++;
+    return add_conn_to_pending_io_list(connection) != 0;
+}
+
+void notify_io_complete(const void *void_cookie, ENGINE_ERROR_CODE status)
+{
+    const auto& cookie = get_notified_cookie(void_cookie);
+    LIBEVENT_THREAD* thr = cookie.connection->getThread();
+
     LOCK_THREAD(thr);
-    reinterpret_cast<McbpConnection*>(connection)->setAiostat(status);
-    notify = add_conn_to_pending_io_list(connection);
+    const bool notify = complete_io(cookie, status);
     UNLOCK_THREAD(thr);
 
     /* kick the thread in the butt */
     if (notify) {
+        thr->io_completion_signals++;
         notify_thread(thr);
     }
 }
 
+void notify_io_complete_batch(const cb::IoCompletion* completions,
+                              size_t count)
+{
+    struct Completion {
+        LIBEVENT_THREAD* thread;
+        const Cookie* cookie;
+        ENGINE_ERROR_CODE status;
+    };
+
+    // Validate all of the cookies before handing any of them over, and
+    // group the completions by thread (keeping the order of the
+    // completions for a thread)
+    std::vector<Completion> batch;
+    batch.reserve(count);
+    for (size_t ii = 0; ii < count; ++ii) {
+        const auto& cookie = get_notified_cookie(completions[ii].cookie);
+        batch.push_back({cookie.connection->getThread(), &cookie,
+                         completions[ii].status});
+    }
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const Completion& a, const Completion& b) {
+                         return a.thread->index < b.thread->index;
+                     });
+
+    // Lock each thread once, and only wake it up once
+    auto it = batch.begin();
+    while (it != batch.end()) {
+        LIBEVENT_THREAD* thr = it->thread;
+        bool notify = false;
+
+        LOCK_THREAD(thr);
+        for (; it != batch.end() && it->thread == thr; ++it) {
+            notify |= complete_io(*it->cookie, it->status);
+        }
+        UNLOCK_THREAD(thr);
+
+        if (notify) {
+            thr->io_completion_signals++;
+            notify_thread(thr);
+        }
+    }
+}
+
 /* Which thread we assigned a connection to most recently. */
 static int last_thread = -1;
 
@@ -484,6 +670,32 @@ void dispatch_conn_new(SOCKET sfd, int parent_port) {
     notify_thread(thread);
 }
 
+/*
+ * Dispatches a new shared memory connection to another thread (like
+ * dispatch_conn_new()).
+ */
+void dispatch_shm_conn_new(SOCKET eventFd,
+                           std::unique_ptr<ShmChannel> channel) {
+    int tid = (last_thread + 1) % settings.getNumWorkerThreads();
+    LIBEVENT_THREAD* thread = threads + tid;
+    last_thread = tid;
+
+    try {
+        std::unique_ptr<ConnectionQueueItem> item(
+            new ConnectionQueueItem(eventFd, std::move(channel)));
+        thread->new_conn_queue->push(item);
+    } catch (std::bad_alloc& e) {
+        LOG_WARNING(nullptr,
+                    "dispatch_shm_conn_new: Failed to dispatch new "
+                    "connection: %s", e.what());
+        safe_close(eventFd);
+        return;
+    }
+
+    MEMCACHED_CONN_DISPATCH(eventFd, (uintptr_t)thread->thread_id);
+    notify_thread(thread);
+}
+
 /*
  * Returns true if this is the thread that listens for new TCP connections.
  */
@@ -532,12 +744,10 @@ void thread_init(int nthr, struct event_base *main_base,
     setup_dispatcher(main_base, dispatcher_callback);
 
     for (i = 0; i < nthreads; i++) {
-        if (!create_notification_pipe(&threads[i])) {
+        if (!create_notification_channel(&threads[i])) {
             FATAL_ERROR(EXIT_FAILURE, "Cannot create notification pipe");
         }
         threads[i].index = i;
-
-        setup_thread(&threads[i]);
     }
 
     /* Create threads after we've done all the libevent setup. */
@@ -570,11 +780,13 @@ void threads_cleanup(void)
     int ii;
     for (ii = 0; ii < nthreads; ++ii) {
         safe_close(threads[ii].notify[0]);
-        safe_close(threads[ii].notify[1]);
+        if (!threads[ii].notify_eventfd) {
+            safe_close(threads[ii].notify[1]);
+        }
+        threads[ii].io_uring.reset();
         event_base_free(threads[ii].base);
 
-        threads[ii].read.reset();
-        threads[ii].write.reset();
+        threads[ii].buffer_pool.reset();
         subdoc_op_free(threads[ii].subdoc_op);
         delete threads[ii].validator;
         delete threads[ii].new_conn_queue;
@@ -584,6 +796,121 @@ void threads_cleanup(void)
     cb_free(threads);
 }
 
+void threads_placement_stats(ADD_STAT add_stat, const void* cookie) {
+    const auto& topology = cb::CpuTopology::get();
+    const auto placement = settings.getThreadPlacement();
+    for (int ii = 0; ii < nthreads; ++ii) {
+        const auto& thr = threads[ii];
+        const int cpu = thr.last_cpu.load(std::memory_order_relaxed);
+        const std::pair<const char*, std::string> values[] = {
+                {"bound_cpus",
+                 thr.bound ? cb::CpuTopology::formatCpuList(
+                                     topology.getPlacement(placement, ii))
+                           : "none"},
+                {"cpu", std::to_string(cpu)},
+                {"node", std::to_string(topology.getNode(cpu))}};
+        for (const auto& value : values) {
+            const auto key = std::to_string(ii) + ":" + value.first;
+            add_stat(key.data(), uint16_t(key.size()),
+                     value.second.data(), uint32_t(value.second.size()),
+                     cookie);
+        }
+    }
+}
+
+void threads_connection_stats(ADD_STAT add_stat, const void* cookie) {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        const auto& thr = threads[ii];
+        const std::pair<const char*, uint64_t> values[] = {
+                {"accepted_conns", thr.accepted_conns.load()},
+                {"total_conns", thr.total_conns.load()},
+                {"curr_conns", thr.curr_conns.load()}};
+        for (const auto& value : values) {
+            const auto key = std::to_string(ii) + ":" + value.first;
+            const auto val = std::to_string(value.second);
+            add_stat(key.data(), uint16_t(key.size()),
+                     val.data(), uint32_t(val.size()),
+                     cookie);
+        }
+    }
+}
+
+void threads_io_stats(ADD_STAT add_stat, const void* cookie) {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        const auto& thr = threads[ii];
+        std::vector<std::pair<const char*, std::string>> values;
+        if (thr.io_uring) {
+            const auto& stats = thr.io_uring->getStats();
+            values = {{"event_loop", to_string(EventLoop::IoUring)},
+                      {"submits", std::to_string(stats.submits.load())},
+                      {"sqes", std::to_string(stats.sqes.load())},
+                      {"cqes", std::to_string(stats.cqes.load())},
+                      {"recv_nobufs", std::to_string(stats.recv_nobufs.load())}};
+        } else {
+            values = {{"event_loop", to_string(EventLoop::Libevent)}};
+        }
+        for (const auto& value : values) {
+            const auto key = std::to_string(ii) + ":" + value.first;
+            add_stat(key.data(), uint16_t(key.size()),
+                     value.second.data(), uint32_t(value.second.size()),
+                     cookie);
+        }
+    }
+}
+
+void threads_buffer_stats(ADD_STAT add_stat, const void* cookie) {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        const auto& stats = threads[ii].buffer_pool->getStats();
+        const std::vector<std::pair<const char*, uint64_t>> values = {
+                {"pooled_buffers", stats.pooled_buffers.load()},
+                {"pooled_bytes", stats.pooled_bytes.load()},
+                {"borrowed_buffers", stats.borrowed_buffers.load()},
+                {"borrowed_bytes", stats.borrowed_bytes.load()},
+                {"allocated_buffers", stats.allocated_buffers.load()},
+                {"freed_buffers", stats.freed_buffers.load()}};
+        for (const auto& value : values) {
+            const auto key = std::to_string(ii) + ":" + value.first;
+            const auto val = std::to_string(value.second);
+            add_stat(key.data(), uint16_t(key.size()),
+                     val.data(), uint32_t(val.size()),
+                     cookie);
+        }
+    }
+}
+
+void threads_notification_stats(ADD_STAT add_stat, const void* cookie) {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        const auto& thr = threads[ii];
+        const std::pair<const char*, std::string> values[] = {
+                {"notify_channel", thr.notify_eventfd ? "eventfd" : "pipe"},
+                {"notify_signals", std::to_string(thr.notify_signals.load())},
+                {"notify_wakeups", std::to_string(thr.notify_wakeups.load())},
+                {"io_completions", std::to_string(thr.io_completions.load())},
+                {"io_completion_signals",
+                 std::to_string(thr.io_completion_signals.load())}};
+        for (const auto& value : values) {
+            const auto key = std::to_string(ii) + ":" + value.first;
+            add_stat(key.data(), uint16_t(key.size()),
+                     value.second.data(), uint32_t(value.second.size()),
+                     cookie);
+        }
+    }
+}
+
+LIBEVENT_THREAD* get_worker_thread(int index) {
+    if (index < 0 || index >= nthreads) {
+        throw std::out_of_range("get_worker_thread: index " +
+                                std::to_string(index) + " is out of range");
+    }
+    return threads + index;
+}
+
+void threads_notify_listeners(void) {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        notify_thread(threads + ii);
+    }
+}
+
 void threads_notify_bucket_deletion(void)
 {
     for (int ii = 0; ii < nthreads; ++ii) {
@@ -613,6 +940,21 @@ void threads_initiate_bucket_deletion(void)
 }
 
 void notify_thread(LIBEVENT_THREAD *thread) {
+    thread->notify_signals++;
+#ifdef __linux__
+    if (thread->notify_eventfd) {
+        // Only fails if the counter would overflow, and then the thread
+        // has plenty of wakeups pending already
+        const uint64_t value = 1;
+        if (::write(thread->notify[1], &value, sizeof(value)) == -1 &&
+            errno != EAGAIN) {
+            LOG_WARNING(nullptr, "Failed to notify thread: %s",
+                        cb_strerror().c_str());
+        }
+        return;
+    }
+#endif
+
     if (send(thread->notify[1], "", 1, 0) != 1 &&
             !is_blocking(GetLastNetworkError())) {
         log_socket_error(EXTENSION_LOG_WARNING, NULL,
@@ -0,0 +1,60 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "taskable.h"
+#include "workload.h"
+
+/**
+ * Taskable which owns the tasks created by the benchmarks; it doesn't record
+ * anything.
+ */
+class BenchTaskable : public Taskable {
+public:
+    BenchTaskable() : name("EPEngineBench"), policy(HIGH_BUCKET_PRIORITY, 1) {
+    }
+
+    const std::string& getName() const override {
+        return name;
+    }
+
+    task_gid_t getGID() const override {
+        return reinterpret_cast<task_gid_t>(this);
+    }
+
+    bucket_priority_t getWorkloadPriority() const override {
+        return HIGH_BUCKET_PRIORITY;
+    }
+
+    void setWorkloadPriority(bucket_priority_t prio) override {
+    }
+
+    WorkLoadPolicy& getWorkLoadPolicy() override {
+        return policy;
+    }
+
+    void logQTime(TaskId id, const ProcessClock::duration enqTime) override {
+    }
+
+    void logRunTime(TaskId id, const ProcessClock::duration runTime) override {
+    }
+
+private:
+    const std::string name;
+    WorkLoadPolicy policy;
+};
@@ -0,0 +1,193 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for the ExecutorPool: how quickly its threads can pick up short
+ * tasks, and how long it takes a woken task to start running.
+ */
+
+#include "bench_taskable.h"
+#include "executorpool.h"
+#include "tests/module_tests/executorpool_test.h"
+#include "tests/module_tests/lambda_task.h"
+
+#include <benchmark/benchmark.h>
+
+#include <climits>
+#include <condition_variable>
+#include <limits>
+
+/**
+ * Task which sleeps until woken, recording how long it took from the wake
+ * request to it running.
+ */
+class WakeTask : public GlobalTask {
+public:
+    WakeTask(Taskable& t)
+        : GlobalTask(t, TaskId::MultiBGFetcherTask, INT_MAX, false) {
+    }
+
+    bool run() override {
+        const auto now = ProcessClock::now();
+        // Snooze before signalling; so the next wake (which may come before
+        // we are rescheduled) isn't overwritten.
+        snooze(INT_MAX);
+        {
+            std::lock_guard<std::mutex> lh(mutex);
+            latency = now - wakeRequested;
+            woken = true;
+        }
+        cond.notify_one();
+        return true;
+    }
+
+    cb::const_char_buffer getDescription() override {
+        return "Wake benchmark task";
+    }
+
+    /// Wake the task via the pool and wait for it to run.
+    ProcessClock::duration wakeAndWait(ExecutorPool& pool) {
+        std::unique_lock<std::mutex> lh(mutex);
+        woken = false;
+        wakeRequested = ProcessClock::now();
+        pool.wake(getId());
+        cond.wait(lh, [this] { return woken; });
+        return latency;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool woken = false;
+    ProcessClock::time_point wakeRequested;
+    ProcessClock::duration latency;
+};
+
+class ExecutorPoolBench : public benchmark::Fixture {
+public:
+    void SetUp(benchmark::State& state) override {
+        // range(0) is the number of reader threads.
+        pool.reset(new TestExecutorPool(/*maxThreads*/ 0,
+                                        NUM_TASK_GROUPS,
+                                        state.range(0),
+                                        /*maxWriters*/ 1,
+                                        /*maxAuxIO*/ 1,
+                                        /*maxNonIO*/ 1));
+        pool->registerTaskable(taskable);
+    }
+
+    void TearDown(benchmark::State& state) override {
+        pool->unregisterTaskable(taskable, false);
+        pool.reset();
+    }
+
+protected:
+    /**
+     * Schedule numTasks front-end tasks which each run again (immediately)
+     * until remaining runs have happened between them, or stop is set.
+     */
+    void scheduleBusyTasks(size_t numTasks,
+                           std::atomic<size_t>& remaining,
+                           std::atomic<bool>& stop) {
+        for (size_t i = 0; i < numTasks; ++i) {
+            ExTask task = std::make_shared<LambdaTask>(
+                    taskable,
+                    TaskId::MultiBGFetcherTask,
+                    0,
+                    true,
+                    [&remaining, &stop, numTasks] {
+                        // Each task stops once fewer runs than there are
+                        // tasks remain; so exactly the requested number of
+                        // runs happen.
+                        return !stop && remaining.fetch_sub(1) > numTasks;
+                    });
+            pool->schedule(task);
+        }
+    }
+
+    BenchTaskable taskable;
+    std::unique_ptr<TestExecutorPool> pool;
+};
+
+/*
+ * Scheduling throughput: range(0) reader threads work through range(1)
+ * concurrently ready front-end tasks, each of which does no work and asks to
+ * run again, so the cost is all in fetching and rescheduling tasks.
+ */
+BENCHMARK_DEFINE_F(ExecutorPoolBench, ScheduleThroughput)
+(benchmark::State& state) {
+    const size_t numTasks = state.range(1);
+    const size_t runsPerIteration = numTasks * 100;
+    std::atomic<bool> stop{false};
+
+    while (state.KeepRunning()) {
+        std::atomic<size_t> remaining{runsPerIteration};
+        scheduleBusyTasks(numTasks, remaining, stop);
+        pool->waitForEmptyTaskLocator();
+    }
+    state.SetItemsProcessed(state.iterations() * runsPerIteration);
+}
+
+/*
+ * Wake latency: time from ExecutorPool::wake() of a sleeping front-end task
+ * to it running, with range(0) reader threads which are otherwise kept busy
+ * by range(1) front-end tasks.
+ */
+BENCHMARK_DEFINE_F(ExecutorPoolBench, WakeLatency)(benchmark::State& state) {
+    auto task = std::make_shared<WakeTask>(taskable);
+    pool->schedule(task);
+
+    std::atomic<size_t> remaining{std::numeric_limits<size_t>::max()};
+    std::atomic<bool> stop{false};
+    scheduleBusyTasks(state.range(1), remaining, stop);
+
+    while (state.KeepRunning()) {
+        const auto latency = task->wakeAndWait(*pool);
+        state.SetIterationTime(
+                std::chrono::duration<double>(latency).count());
+    }
+
+    // The busy tasks reference our locals; wait for them all to finish.
+    stop = true;
+    task->cancel();
+    pool->wake(task->getId());
+    pool->waitForEmptyTaskLocator();
+}
+
+static void ThroughputArguments(benchmark::internal::Benchmark* b) {
+    for (int threads : {1, 4, 16, 64}) {
+        for (int tasks : {1, 16, 256}) {
+            b->Args({threads, tasks});
+        }
+    }
+}
+
+static void WakeLatencyArguments(benchmark::internal::Benchmark* b) {
+    for (int threads : {4, 16, 64}) {
+        for (int busyTasks : {0, 16, 256}) {
+            b->Args({threads, busyTasks});
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(ExecutorPoolBench, ScheduleThroughput)
+        ->Apply(ThroughputArguments)
+        ->UseRealTime();
+
+BENCHMARK_REGISTER_F(ExecutorPoolBench, WakeLatency)
+        ->Apply(WakeLatencyArguments)
+        ->UseManualTime();
@@ -0,0 +1,124 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for the FutureQueue: the cost of snoozing and waking tasks when
+ * many others are pending.
+ */
+
+#include "bench_taskable.h"
+#include "futurequeue.h"
+#include "tests/module_tests/lambda_task.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+class FutureQueueBench : public benchmark::Fixture {
+public:
+    void SetUp(benchmark::State& state) override {
+        // range(0) is the number of pending tasks; spread over the next
+        // minute, as tasks which snooze for a few seconds would be.
+        now = ProcessClock::now();
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            ExTask task = std::make_shared<LambdaTask>(
+                    taskable, TaskId::ItemPager, 0, false, [] {
+                        return false;
+                    });
+            task->updateWaketime(randomWaketime());
+            queue.push(task);
+            tasks.push_back(task);
+        }
+    }
+
+    void TearDown(benchmark::State& state) override {
+        std::vector<ExTask> drained;
+        queue.popExpired(ProcessClock::time_point::max(), drained);
+        tasks.clear();
+    }
+
+protected:
+    ProcessClock::time_point randomWaketime() {
+        return now + std::chrono::milliseconds(delay(rng));
+    }
+
+    ExTask& randomTask() {
+        return tasks[pick(rng) % tasks.size()];
+    }
+
+    BenchTaskable taskable;
+    FutureQueue<> queue;
+    std::vector<ExTask> tasks;
+    ProcessClock::time_point now;
+    std::mt19937_64 rng{0};
+    std::uniform_int_distribution<int> delay{1, 60000};
+    std::uniform_int_distribution<size_t> pick;
+};
+
+/*
+ * Snooze: move a random pending task to a new wakeTime, as happens when a
+ * task is snoozed by the ExecutorPool.
+ */
+BENCHMARK_DEFINE_F(FutureQueueBench, Snooze)(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        queue.updateWaketime(randomTask(), randomWaketime());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/*
+ * Wake: wake a random pending task, expire it (as the TaskQueue does when
+ * moving tasks to its readyQueue) and, once it has "run", queue it again for
+ * later.
+ */
+BENCHMARK_DEFINE_F(FutureQueueBench, WakeAndExpire)(benchmark::State& state) {
+    std::vector<ExTask> ready;
+    while (state.KeepRunning()) {
+        queue.updateWaketime(randomTask(), now);
+        ready.clear();
+        queue.popExpired(now, ready);
+        for (auto& task : ready) {
+            task->updateWaketime(randomWaketime());
+            queue.push(task);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/*
+ * Expire: move the wheel forward through time, expiring (and re-queueing for
+ * a minute later) the tasks as they become due.
+ */
+BENCHMARK_DEFINE_F(FutureQueueBench, Expire)(benchmark::State& state) {
+    std::vector<ExTask> ready;
+    size_t expired = 0;
+    while (state.KeepRunning()) {
+        now += std::chrono::milliseconds(1);
+        ready.clear();
+        expired += queue.popExpired(now, ready);
+        for (auto& task : ready) {
+            task->updateWaketime(now + std::chrono::seconds(60));
+            queue.push(task);
+        }
+    }
+    state.SetItemsProcessed(expired);
+}
+
+BENCHMARK_REGISTER_F(FutureQueueBench, Snooze)->Range(1000, 100000);
+BENCHMARK_REGISTER_F(FutureQueueBench, WakeAndExpire)->Range(1000, 100000);
+BENCHMARK_REGISTER_F(FutureQueueBench, Expire)->Range(1000, 100000);
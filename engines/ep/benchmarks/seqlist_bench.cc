@@ -0,0 +1,173 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the SequenceList implementations of ephemeral vBuckets
+ * (see the ephemeral_seqlist_type setting): the time to start a backfill,
+ * i.e. to create a range iterator positioned at the start seqno.
+ */
+
+#include "hash_table.h"
+#include "item.h"
+#include "linked_list.h"
+#include "skip_list.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+#include <gtest/gtest.h>
+#include <valgrind/valgrind.h>
+
+#include <random>
+#include <stdexcept>
+
+/*
+ * A list of numItems elements (and the hash table owning them). Building
+ * one takes a while and several GB of memory at the size we want to
+ * measure, so it is kept (one list type at a time) across the runs of the
+ * benchmarks.
+ */
+struct SeqListData {
+    SeqListData(int type, seqno_t numItems)
+        : ht(stats,
+             std::make_unique<OrderedStoredValueFactory>(stats),
+             2,
+             1),
+          type(type) {
+        if (type == 0) {
+            list = std::make_unique<BasicLinkedList>(0, stats);
+        } else {
+            list = std::make_unique<SkipList>(0, stats);
+        }
+        ht.resize(numItems);
+
+        const std::string val("data");
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+        for (seqno_t seqno = 1; seqno <= numItems; ++seqno) {
+            StoredDocKey key = makeStoredDocKey("key" + std::to_string(seqno));
+            Item item(key,
+                      0,
+                      0,
+                      val.data(),
+                      val.length(),
+                      /*ext_meta*/ nullptr,
+                      /*ext_len*/ 0,
+                      /*theCas*/ 0,
+                      /*bySeqno*/ seqno);
+            if (ht.set(item) != MutationStatus::WasClean) {
+                throw std::logic_error("SeqListData: Failed to store " +
+                                       std::string(key.c_str()));
+            }
+            auto* osv = ht.find(key, TrackReference::No, WantsDeleted::No)
+                                ->toOrderedStoredValue();
+
+            std::lock_guard<std::mutex> listWriteLg(list->getListWriteLock());
+            list->appendToList(lg, listWriteLg, *osv);
+            list->updateHighSeqno(listWriteLg, *osv);
+        }
+    }
+
+    ~SeqListData() {
+        /* Like in a vbucket the list must be erased before the HashTable */
+        list.reset();
+    }
+
+    EPStats stats;
+    HashTable ht;
+    std::unique_ptr<SequenceList> list;
+    const int type;
+};
+
+class SeqListBench : public benchmark::Fixture {
+public:
+    void SetUp(benchmark::State& state) override {
+        // The first parameter specifies the SequenceList implementation
+        switch (state.range(0)) {
+        case 0:
+            state.SetLabel("linked_list");
+            break;
+        case 1:
+            state.SetLabel("skip_list");
+            break;
+        default:
+            FAIL() << "Invalid input param(0) value:" << state.range(0);
+        }
+
+        // The vBucket size the skip_list is meant for; but only enough for
+        // functional testing when running under Valgrind.
+        numItems = RUNNING_ON_VALGRIND ? 1000 : 10000000;
+        if (!data || data->type != state.range(0)) {
+            // Only one list at a time (they're big)
+            data.reset();
+            data = std::make_unique<SeqListData>(int(state.range(0)),
+                                                 numItems);
+        }
+    }
+
+protected:
+    /**
+     * Start a backfill from the given seqno, verifying its position
+     */
+    void startBackfill(benchmark::State& state, seqno_t start) {
+        auto itr = data->list->makeRangeIterator(true /*isBackfill*/, start);
+        if (!itr || itr->curr() != start ||
+            itr->count() != uint64_t(numItems - start + 1)) {
+            state.SkipWithError("Backfill not positioned at the start seqno");
+        }
+    }
+
+    static std::unique_ptr<SeqListData> data;
+    seqno_t numItems;
+};
+
+std::unique_ptr<SeqListData> SeqListBench::data;
+
+/*
+ * A backfill near the end of the vBucket, as for a replica which
+ * reconnects after falling a little behind.
+ */
+BENCHMARK_DEFINE_F(SeqListBench, BackfillStartNearEnd)
+(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        startBackfill(state, numItems - 10);
+    }
+}
+
+/* A backfill from a random seqno */
+BENCHMARK_DEFINE_F(SeqListBench, BackfillStartRandom)
+(benchmark::State& state) {
+    std::mt19937_64 rng{0};
+    std::uniform_int_distribution<seqno_t> seqno{1, numItems};
+    while (state.KeepRunning()) {
+        startBackfill(state, seqno(rng));
+    }
+}
+
+BENCHMARK_REGISTER_F(SeqListBench, BackfillStartNearEnd)
+        ->Arg(0)
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(SeqListBench, BackfillStartRandom)
+        ->Arg(0)
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(SeqListBench, BackfillStartNearEnd)
+        ->Arg(1)
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(SeqListBench, BackfillStartRandom)
+        ->Arg(1)
+        ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for the cost of cross-node traffic which thread placement
+ * (thread_placement / executor_thread_placement) avoids. Each is run with
+ * the threads on the same NUMA node (arg 0) and on different nodes (arg 1),
+ * and is skipped on a machine with a single node.
+ */
+
+#include <memcached/thread_placement.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Larger than the last level cache, so that the scan goes to memory.
+static const size_t bufferSize = 256 * 1024 * 1024;
+
+/**
+ * Bind the calling thread to the given node for the lifetime of the object,
+ * then let it run on any CPU again.
+ */
+class NodeBinding {
+public:
+    explicit NodeBinding(size_t node) {
+        cb::bindCurrentThread(cb::CpuTopology::get().getCpus(node));
+    }
+
+    ~NodeBinding() {
+        std::vector<int> all;
+        const auto& topology = cb::CpuTopology::get();
+        for (size_t node = 0; node < topology.getNumNodes(); ++node) {
+            const auto& cpus = topology.getCpus(node);
+            all.insert(all.end(), cpus.begin(), cpus.end());
+        }
+        cb::bindCurrentThread(all);
+    }
+};
+
+static bool checkNodes(benchmark::State& state) {
+    if (cb::CpuTopology::get().getNumNodes() < 2) {
+        state.SkipWithError("Requires at least 2 NUMA nodes");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * A thread on node 0 (e.g. a reader which bg fetched an item) allocates and
+ * fills a buffer, which is then read by a thread on the same or another node
+ * (e.g. the front-end thread sending it to the client).
+ */
+static void BM_ScanBuffer(benchmark::State& state) {
+    if (!checkNodes(state)) {
+        return;
+    }
+
+    std::vector<uint64_t> buffer;
+    std::thread writer([&buffer] {
+        NodeBinding binding(0);
+        cb::setLocalMemoryPolicy();
+        // First touch decides which node the pages are allocated on.
+        buffer.resize(bufferSize / sizeof(uint64_t), 1);
+    });
+    writer.join();
+
+    NodeBinding binding(state.range(0));
+    while (state.KeepRunning()) {
+        uint64_t sum = 0;
+        for (auto value : buffer) {
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * bufferSize);
+}
+
+/*
+ * Two threads hand a cache line back and forth, as a front-end thread and an
+ * executor thread do when a request is passed to a task and its result is
+ * notified back.
+ */
+static void BM_HandOff(benchmark::State& state) {
+    if (!checkNodes(state)) {
+        return;
+    }
+
+    // 0: owned by the benchmark thread, 1: owned by the peer, 2: stop.
+    std::atomic<int> turn{0};
+    std::thread peer([&turn] {
+        NodeBinding binding(0);
+        int expected;
+        do {
+            expected = 1;
+            if (turn.compare_exchange_weak(expected, 0)) {
+                continue;
+            }
+        } while (expected != 2);
+    });
+
+    NodeBinding binding(state.range(0));
+    while (state.KeepRunning()) {
+        turn.store(1);
+        while (turn.load() != 0) {
+        }
+    }
+    turn.store(2);
+    peer.join();
+}
+
+BENCHMARK(BM_ScanBuffer)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_HandOff)->Arg(0)->Arg(1);
@@ -179,6 +179,11 @@ ENGINE_ERROR_CODE ConnHandler::step(struct dcp_message_producers* producers) {
     return ENGINE_DISCONNECT;
 }
 
+ENGINE_ERROR_CODE ConnHandler::stepBatch(
+        struct dcp_message_producers* producers, size_t maxMessages) {
+    return step(producers);
+}
+
 bool ConnHandler::handleResponse(protocol_binary_response_header* resp) {
     logger.log(EXTENSION_LOG_WARNING, "Disconnecting - This connection doesn't "
         "support the dcp response handler API");
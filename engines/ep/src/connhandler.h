@@ -162,6 +162,13 @@ public:
 
     virtual ENGINE_ERROR_CODE step(struct dcp_message_producers* producers);
 
+    /**
+     * Add up to maxMessages messages to the connection in a single call.
+     * The default implementation sends a single message via step().
+     */
+    virtual ENGINE_ERROR_CODE stepBatch(struct dcp_message_producers* producers,
+                                        size_t maxMessages);
+
     /**
      * Sub-classes must implement a method that processes a response
      * to a request initiated by itself.
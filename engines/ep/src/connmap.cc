@@ -87,6 +87,7 @@ void ConnNotifier::notifyMutationEvent(void) {
 bool ConnNotifier::notifyConnections() {
     bool inverse = true;
     pendingNotification.compare_exchange_strong(inverse, false);
+    connMap.processDeferredNotifications();
     connMap.notifyAllPausedConnections();
 
     if (!pendingNotification.load()) {
@@ -152,6 +153,7 @@ ConnMap::ConnMap(EventuallyPersistentEngine &theEngine)
     for (size_t i = 0; i < max_vbs; ++i) {
         vbConns.push_back(std::list<connection_t>());
     }
+    vbConnCounts.reset(new std::atomic<size_t>[max_vbs]());
 }
 
 void ConnMap::initialize() {
@@ -195,10 +197,12 @@ void ConnMap::notifyAllPausedConnections() {
     std::queue<connection_t> queue;
     pendingNotifications.getAll(queue);
 
+    std::set<const void*> notified;
     LockHolder rlh(releaseLock);
     while (!queue.empty()) {
         connection_t &conn = queue.front();
-        if (conn.get() && conn->isPaused() && conn->isReserved()) {
+        if (conn.get() && conn->isPaused() && conn->isReserved() &&
+            notified.insert(conn->getCookie()).second) {
             engine.notifyIOComplete(conn->getCookie(), ENGINE_SUCCESS);
         }
         queue.pop();
@@ -214,6 +218,7 @@ void ConnMap::addVBConnByVBId(connection_t &conn, int16_t vbid) {
     std::lock_guard<SpinLock> lh(vbConnLocks[lock_num]);
     std::list<connection_t> &vb_conns = vbConns[vbid];
     vb_conns.push_back(conn);
+    ++vbConnCounts[vbid];
 }
 
 void ConnMap::removeVBConnByVBId_UNLOCKED(connection_t &conn, int16_t vbid) {
@@ -226,6 +231,7 @@ void ConnMap::removeVBConnByVBId_UNLOCKED(connection_t &conn, int16_t vbid) {
     for (; itr != vb_conns.end(); ++itr) {
         if (conn->getCookie() == (*itr)->getCookie()) {
             vb_conns.erase(itr);
+            --vbConnCounts[vbid];
             break;
         }
     }
@@ -27,6 +27,7 @@
 #include <iterator>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -79,8 +80,21 @@ public:
      */
     void notifyPausedConnection(connection_t conn, bool schedule = false);
 
+    /**
+     * Notify all connections queued by notifyPausedConnection(schedule=true).
+     * A connection queued more than once since the last call is only
+     * notified once.
+     */
     void notifyAllPausedConnections();
 
+    /**
+     * Hook run by the ConnNotifier before it notifies the paused
+     * connections; allows subclasses to deliver notifications they have
+     * deferred from the front-end.
+     */
+    virtual void processDeferredNotifications() {
+    }
+
     EventuallyPersistentEngine& getEngine() {
         return engine;
     }
@@ -103,6 +117,9 @@ protected:
 
     SpinLock *vbConnLocks;
     std::vector<std::list<connection_t> > vbConns;
+    // Number of connections in each of vbConns, readable without taking
+    // the vbConnLock.
+    std::unique_ptr<std::atomic<size_t>[]> vbConnCounts;
 
     /* Handle to the engine who owns us */
     EventuallyPersistentEngine &engine;
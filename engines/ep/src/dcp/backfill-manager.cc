@@ -29,6 +29,14 @@
 
 static const size_t sleepTime = 1;
 
+// Weights of connections of each priority when sharing the bucket's
+// backfill scan slots
+static const size_t lowPriorityWeight = 1;
+static const size_t mediumPriorityWeight = 2;
+static const size_t highPriorityWeight = 4;
+
+const size_t BackfillManager::maxTimesPassedOver = 8;
+
 class BackfillManagerTask : public GlobalTask {
 public:
     BackfillManagerTask(EventuallyPersistentEngine& e,
@@ -87,7 +95,10 @@ cb::const_char_buffer BackfillManagerTask::getDescription() {
 }
 
 BackfillManager::BackfillManager(EventuallyPersistentEngine& e)
-    : engine(e), managerTask(NULL) {
+    : scanVTime(e.getDcpConnMap().getBackfillScanVTime()),
+      engine(e),
+      managerTask(NULL),
+      weight(mediumPriorityWeight) {
     Configuration& config = e.getConfiguration();
 
     scanBuffer.bytesRead = 0;
@@ -99,6 +110,10 @@ BackfillManager::BackfillManager(EventuallyPersistentEngine& e)
     buffer.maxBytes = config.getDcpBackfillByteLimit();
     buffer.nextReadSize = 0;
     buffer.full = false;
+
+    queueTime.numStarted = 0;
+    queueTime.totalWait = std::chrono::microseconds(0);
+    queueTime.maxWait = std::chrono::microseconds(0);
 }
 
 void BackfillManager::addStats(connection_t conn, ADD_STAT add_stat,
@@ -110,6 +125,12 @@ void BackfillManager::addStats(connection_t conn, ADD_STAT add_stat,
     conn->addStat("backfill_num_active", activeBackfills.size(), add_stat, c);
     conn->addStat("backfill_num_snoozing", snoozingBackfills.size(), add_stat, c);
     conn->addStat("backfill_num_pending", pendingBackfills.size(), add_stat, c);
+    conn->addStat("backfill_num_started", queueTime.numStarted, add_stat, c);
+    conn->addStat("backfill_queue_time_total_us",
+                  queueTime.totalWait.count(), add_stat, c);
+    conn->addStat("backfill_queue_time_max_us",
+                  queueTime.maxWait.count(), add_stat, c);
+    conn->addStat("backfill_scan_vtime", scanVTime.load(), add_stat, c);
 }
 
 BackfillManager::~BackfillManager() {
@@ -138,6 +159,10 @@ BackfillManager::~BackfillManager() {
         pendingBackfills.pop_front();
         backfill->cancel();
     }
+
+    // Return our share of the bucket's backfill resources
+    engine.getDcpConnMap().removeBackfillWaiter(*this);
+    engine.getDcpConnMap().releaseBackfillBytes(buffer.bytesRead);
 }
 
 void BackfillManager::schedule(VBucket& vb,
@@ -145,6 +170,16 @@ void BackfillManager::schedule(VBucket& vb,
                                uint64_t start,
                                uint64_t end) {
     LockHolder lh(lock);
+    if (activeBackfills.empty() && snoozingBackfills.empty() &&
+        pendingBackfills.empty()) {
+        // Don't let a connection which has been idle bank its share of the
+        // scan slots; start from the current virtual time.
+        uint64_t now = engine.getDcpConnMap().getBackfillScanVTime();
+        if (scanVTime < now) {
+            scanVTime = now;
+        }
+    }
+
     UniqueDCPBackfillPtr backfill =
             vb.createDCPBackfill(engine, stream, start, end);
     if (engine.getDcpConnMap().canAddBackfillToActiveQ()) {
@@ -181,6 +216,13 @@ bool BackfillManager::bytesCheckAndRead(size_t bytes) {
     }
 
     if (buffer.bytesRead == 0 || buffer.bytesRead + bytes <= buffer.maxBytes) {
+        // Also check the bucket-wide budget. A connection with an empty
+        // buffer may always read so that every connection makes progress.
+        if (!engine.getDcpConnMap().reserveBackfillBytes(
+                    bytes, buffer.bytesRead == 0)) {
+            scanBuffer.bytesRead -= bytes;
+            return false;
+        }
         buffer.bytesRead += bytes;
     } else {
         scanBuffer.bytesRead -= bytes;
@@ -202,6 +244,7 @@ void BackfillManager::bytesForceRead(size_t bytes) {
     ++scanBuffer.itemsRead;
     scanBuffer.bytesRead += bytes;
     buffer.bytesRead += bytes;
+    engine.getDcpConnMap().reserveBackfillBytes(bytes, true);
 
     if (buffer.bytesRead > buffer.maxBytes) {
         /* Setting this flag prevents running other backfills and hence prevents
@@ -213,7 +256,7 @@ void BackfillManager::bytesForceRead(size_t bytes) {
 }
 
 void BackfillManager::bytesSent(size_t bytes) {
-    LockHolder lh(lock);
+    std::unique_lock<std::mutex> lh(lock);
     if (bytes > buffer.bytesRead) {
         throw std::invalid_argument("BackfillManager::bytesSent: bytes "
                 "(which is" + std::to_string(bytes) + ") is greater than "
@@ -243,6 +286,11 @@ void BackfillManager::bytesSent(size_t bytes) {
             }
         }
     }
+
+    // May wake other connections' backfills, so must be done without our
+    // lock held
+    lh.unlock();
+    engine.getDcpConnMap().releaseBackfillBytes(bytes);
 }
 
 backfill_status_t BackfillManager::backfill() {
@@ -251,6 +299,7 @@ backfill_status_t BackfillManager::backfill() {
     if (activeBackfills.empty() && snoozingBackfills.empty()
         && pendingBackfills.empty()) {
         managerTask.reset();
+        engine.getDcpConnMap().removeBackfillWaiter(*this);
         return backfill_finished;
     }
 
@@ -266,10 +315,13 @@ backfill_status_t BackfillManager::backfill() {
         return backfill_snooze;
     }
 
-    if (buffer.full) {
-        // If the buffer is full check to make sure we don't have any backfills
-        // that no longer have active streams and remove them. This prevents an
-        // issue where we have dead backfills taking up buffer space.
+    DcpConnMap& connMap = engine.getDcpConnMap();
+    if (buffer.full ||
+        (buffer.bytesRead > 0 && !connMap.canBackfillReadBytes(*this))) {
+        // If the buffer (or the bucket's backfill budget) is full check to
+        // make sure we don't have any backfills that no longer have active
+        // streams and remove them. This prevents an issue where we have dead
+        // backfills taking up buffer space.
         std::list<UniqueDCPBackfillPtr> toDelete;
         for (auto a_itr = activeBackfills.begin();
              a_itr != activeBackfills.end();) {
@@ -292,13 +344,28 @@ backfill_status_t BackfillManager::backfill() {
         return reschedule ? backfill_success : backfill_snooze;
     }
 
-    UniqueDCPBackfillPtr backfill = std::move(activeBackfills.front());
-    activeBackfills.pop_front();
+    if (!connMap.acquireBackfillScan(*this)) {
+        // We'll be woken when it's our turn
+        return backfill_snooze;
+    }
+
+    UniqueDCPBackfillPtr backfill = popNextActiveBackfill();
+    if (!backfill->isStarted()) {
+        auto waited = backfill->markStarted();
+        ++queueTime.numStarted;
+        queueTime.totalWait += waited;
+        queueTime.maxWait = std::max(queueTime.maxWait, waited);
+    }
 
     lh.unlock();
     backfill_status_t status = backfill->run();
+    connMap.releaseBackfillScan();
     lh.lock();
 
+    // Charge the scan to this connection, scaled by its weight
+    scanVTime += std::max(scanBuffer.bytesRead, size_t(1)) *
+                 highPriorityWeight / weight;
+
     scanBuffer.bytesRead = 0;
     scanBuffer.itemsRead = 0;
 
@@ -330,6 +397,32 @@ backfill_status_t BackfillManager::backfill() {
     return backfill_success;
 }
 
+UniqueDCPBackfillPtr BackfillManager::popNextActiveBackfill() {
+    auto next = activeBackfills.begin();
+    for (auto it = activeBackfills.begin(); it != activeBackfills.end();
+         ++it) {
+        if ((*it)->getTimesPassedOver() >= maxTimesPassedOver) {
+            next = it;
+            break;
+        }
+        if ((*it)->getSeqnosRemaining() < (*next)->getSeqnosRemaining()) {
+            next = it;
+        }
+    }
+
+    for (auto it = activeBackfills.begin(); it != activeBackfills.end();
+         ++it) {
+        if (it != next) {
+            (*it)->setTimesPassedOver((*it)->getTimesPassedOver() + 1);
+        }
+    }
+
+    UniqueDCPBackfillPtr backfill = std::move(*next);
+    activeBackfills.erase(next);
+    backfill->setTimesPassedOver(0);
+    return backfill;
+}
+
 void BackfillManager::moveToActiveQueue() {
     // Order in below AND is important
     while (!pendingBackfills.empty() &&
@@ -355,6 +448,22 @@ void BackfillManager::moveToActiveQueue() {
     }
 }
 
+void BackfillManager::setPriority(CONN_PRIORITY priority) {
+    switch (priority) {
+    case CONN_PRIORITY_HIGH:
+        weight = highPriorityWeight;
+        return;
+    case CONN_PRIORITY_MED:
+        weight = mediumPriorityWeight;
+        return;
+    case CONN_PRIORITY_LOW:
+        weight = lowPriorityWeight;
+        return;
+    }
+    throw std::invalid_argument("BackfillManager::setPriority: invalid "
+            "priority " + std::to_string(int(priority)));
+}
+
 void BackfillManager::wakeUpTask() {
     LockHolder lh(lock);
     if (managerTask) {
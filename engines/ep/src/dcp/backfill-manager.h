@@ -36,10 +36,21 @@
  * sufficiently drained (by sending to the client), backfilling can be
  * resumed.
  *
+ * The BackfillManagers of a bucket also share bucket-wide limits, held by
+ * the DcpConnMap: a byte budget for the buffers of all connections, and a
+ * maximum number of backfills scanning at once. Scan slots are shared
+ * between connections in proportion to their priority, by granting them
+ * to the manager which has scanned the fewest bytes per unit of weight
+ * (its "virtual time"). Within a connection, the backfill closest to
+ * completion is run first, so streams leave the backfilling state (and
+ * release their resources) sooner.
+ *
  * Significant configuration parameters affecting backfill:
  * - dcp_scan_byte_limit
  * - dcp_scan_item_limit
  * - dcp_backfill_byte_limit
+ * - dcp_backfill_bucket_byte_limit
+ * - dcp_backfill_max_concurrent_scans
  */
 
 #ifndef SRC_DCP_BACKFILL_MANAGER_H_
@@ -48,6 +59,8 @@
 #include "config.h"
 #include "dcp/backfill.h"
 
+#include <atomic>
+#include <chrono>
 #include <list>
 
 class EventuallyPersistentEngine;
@@ -92,6 +105,20 @@ public:
 
     void wakeUpTask();
 
+    /**
+     * Set the weight of this connection's backfills when sharing the
+     * bucket's backfill scan slots, from the connection's priority.
+     */
+    void setPriority(CONN_PRIORITY priority);
+
+    /**
+     * @return the bytes scanned by this manager's backfills, divided by the
+     *         manager's weight.
+     */
+    uint64_t getScanVTime() const {
+        return scanVTime.load();
+    }
+
 protected:
     //! The buffer is the total bytes used by all backfills for this connection
     struct {
@@ -101,10 +128,31 @@ protected:
         bool full;
     } buffer;
 
+    //! Time the backfills of this connection waited before their first run
+    struct {
+        size_t numStarted;
+        std::chrono::microseconds totalWait;
+        std::chrono::microseconds maxWait;
+    } queueTime;
+
+    //! See getScanVTime()
+    std::atomic<uint64_t> scanVTime;
+
 private:
 
     void moveToActiveQueue();
 
+    /**
+     * Remove and return the next backfill to run from activeBackfills: the
+     * one with the fewest seqnos remaining, unless a backfill has been
+     * passed over maxTimesPassedOver times, in which case the oldest such.
+     */
+    UniqueDCPBackfillPtr popNextActiveBackfill();
+
+    //! Times a backfill may be passed over in favour of one closer to
+    //! completion before it is run regardless
+    static const size_t maxTimesPassedOver;
+
     std::mutex lock;
     std::list<UniqueDCPBackfillPtr> activeBackfills;
     std::list<std::pair<rel_time_t, UniqueDCPBackfillPtr> > snoozingBackfills;
@@ -121,6 +169,9 @@ private:
         size_t maxBytes;
         size_t maxItems;
     } scanBuffer;
+
+    //! Weight of this connection when sharing the bucket's scan slots
+    std::atomic<size_t> weight;
 };
 
 #endif  // SRC_DCP_BACKFILL_MANAGER_H_
@@ -21,6 +21,10 @@
 
 #include "dcp/stream.h"
 
+#include <platform/processclock.h>
+
+#include <algorithm>
+
 class ScanContext;
 
 /**
@@ -37,7 +41,12 @@ public:
     DCPBackfill(const active_stream_t& s,
                 uint64_t startSeqno,
                 uint64_t endSeqno)
-        : stream(s), startSeqno(startSeqno), endSeqno(endSeqno) {
+        : stream(s),
+          startSeqno(startSeqno),
+          endSeqno(endSeqno),
+          created(ProcessClock::now()),
+          started(false),
+          timesPassedOver(0) {
     }
 
     virtual ~DCPBackfill() {
@@ -73,6 +82,46 @@ public:
      */
     virtual void cancel() = 0;
 
+    /**
+     * Estimate of how much of the backfill is left to do, as the number of
+     * seqnos between the last seqno read into the stream and the end seqno.
+     */
+    uint64_t getSeqnosRemaining() const {
+        const uint64_t lastRead =
+                std::max(startSeqno, stream->getLastReadSeqno());
+        return endSeqno > lastRead ? endSeqno - lastRead : 0;
+    }
+
+    /**
+     * Indicates if the backfill has been run at least once
+     */
+    bool isStarted() const {
+        return started;
+    }
+
+    /**
+     * Marks the backfill as started
+     *
+     * @return the time the backfill waited between being created and now
+     */
+    std::chrono::microseconds markStarted() {
+        started = true;
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                ProcessClock::now() - created);
+    }
+
+    /**
+     * Number of times another backfill was chosen to run ahead of this one
+     * since this one last ran.
+     */
+    size_t getTimesPassedOver() const {
+        return timesPassedOver;
+    }
+
+    void setTimesPassedOver(size_t times) {
+        timesPassedOver = times;
+    }
+
 protected:
     /**
      * Ptr to the associated Active DCP stream. Backfill can be run for only
@@ -89,6 +138,16 @@ protected:
      * End seqno of the backfill
      */
     uint64_t endSeqno;
+
+private:
+    //! When the backfill was created (i.e. queued in the BackfillManager)
+    const ProcessClock::time_point created;
+
+    //! Has the backfill been run at least once
+    bool started;
+
+    //! See getTimesPassedOver()
+    size_t timesPassedOver;
 };
 
 using UniqueDCPBackfillPtr = std::unique_ptr<DCPBackfill>;
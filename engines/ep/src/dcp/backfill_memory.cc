@@ -149,15 +149,16 @@ void DCPBackfillMemoryBuffered::cancel() {
 backfill_status_t DCPBackfillMemoryBuffered::create() {
     /* Create range read cursor */
     try {
-        auto rangeItrOptional = evb->makeRangeIterator(true /*isBackfill*/);
+        auto rangeItrOptional =
+                evb->makeRangeIterator(true /*isBackfill*/, startSeqno);
         if (rangeItrOptional) {
             rangeItr = std::move(*rangeItrOptional);
         } else {
             stream->getLogger().log(
                     EXTENSION_LOG_WARNING,
                     "vb:%" PRIu16
-                    " Deferring backfill creation as another "
-                    "range iterator is already on the sequence list",
+                    " Deferring backfill creation as a range "
+                    "iterator cannot be created on the sequence list now",
                     getVBucketId());
             return backfill_snooze;
         }
@@ -0,0 +1,89 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "dcp/compression-cache.h"
+
+#include "statwriter.h"
+
+DcpCompressedValueCache::DcpCompressedValueCache(size_t maxBytes)
+    : maxBytesPerShard(maxBytes / numShards), hits(0), misses(0) {
+}
+
+queued_item DcpCompressedValueCache::getCompressed(const queued_item& item,
+                                                   float minCompressionRatio) {
+    const Key key{item->getVBucketId(), item->getBySeqno(), item->getCas()};
+    Shard& shard = shards[item->getVBucketId() % numShards];
+
+    {
+        std::lock_guard<std::mutex> lh(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+            ++hits;
+            return found->second->item;
+        }
+    }
+    ++misses;
+
+    // Compress without the lock held; if another stream compresses the same
+    // item meanwhile, we just use whichever copy got cached first.
+    queued_item compressed(new Item(*item));
+    if (!compressed->compressValue(minCompressionRatio) ||
+        !mcbp::datatype::is_snappy(compressed->getDataType())) {
+        // Remember it's not worth compressing so others don't try again
+        compressed = item;
+    }
+    const size_t size = compressed->size();
+    if (size > maxBytesPerShard) {
+        return compressed;
+    }
+
+    std::lock_guard<std::mutex> lh(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+        return found->second->item;
+    }
+
+    while (!shard.lru.empty() && shard.bytes + size > maxBytesPerShard) {
+        const Entry& oldest = shard.lru.back();
+        shard.bytes -= oldest.item->size();
+        shard.index.erase(oldest.key);
+        shard.lru.pop_back();
+    }
+    shard.lru.push_front({key, compressed});
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += size;
+    return compressed;
+}
+
+void DcpCompressedValueCache::addStats(ADD_STAT add_stat, const void* c) {
+    size_t items = 0;
+    size_t bytes = 0;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lh(shard.mutex);
+        items += shard.lru.size();
+        bytes += shard.bytes;
+    }
+    add_casted_stat("ep_dcp_compression_cache_items", items, add_stat, c);
+    add_casted_stat("ep_dcp_compression_cache_bytes", bytes, add_stat, c);
+    add_casted_stat("ep_dcp_compression_cache_hits", hits.load(), add_stat, c);
+    add_casted_stat("ep_dcp_compression_cache_misses", misses.load(),
+                    add_stat, c);
+}
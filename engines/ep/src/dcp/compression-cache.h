@@ -0,0 +1,91 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "item.h"
+
+#include <memcached/engine_common.h>
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+/**
+ * DcpCompressedValueCache keeps the snappy-compressed copies of recently
+ * streamed items, so that an item streamed by several DCP producers (e.g.
+ * replication, XDCR and indexing of the same vBucket) is compressed once.
+ *
+ * Items are identified by vBucket, seqno and CAS. The cache is bounded by
+ * the memory of the items it holds, evicting the least recently used first,
+ * and is sharded by vBucket to limit contention between streams.
+ */
+class DcpCompressedValueCache {
+public:
+    DcpCompressedValueCache(size_t maxBytes);
+
+    /**
+     * Get a copy of the given item with its value snappy-compressed; the
+     * compression is only done if the copy isn't already cached.
+     *
+     * @param item the item, whose value must not be compressed
+     * @param minCompressionRatio see Item::compressValue
+     * @return the compressed copy, or the item itself if compressing it
+     *         failed or did not achieve the ratio
+     */
+    queued_item getCompressed(const queued_item& item,
+                              float minCompressionRatio);
+
+    void addStats(ADD_STAT add_stat, const void* c);
+
+    size_t getNumHits() const {
+        return hits;
+    }
+
+    size_t getNumMisses() const {
+        return misses;
+    }
+
+private:
+    // vbucket, seqno, CAS
+    using Key = std::tuple<uint16_t, int64_t, uint64_t>;
+
+    struct Entry {
+        Key key;
+        queued_item item;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        // Most recently used at the front
+        std::list<Entry> lru;
+        std::map<Key, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    static const size_t numShards = 16;
+
+    std::array<Shard, numShards> shards;
+    const size_t maxBytesPerShard;
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+};
@@ -39,16 +39,19 @@ class Processor : public GlobalTask {
 public:
     Processor(EventuallyPersistentEngine* e,
               connection_t c,
+              size_t partition,
               double sleeptime = 1,
               bool completeBeforeShutdown = true)
         : GlobalTask(e, TaskId::Processor, sleeptime, completeBeforeShutdown),
           conn(c),
-          description("Processing buffered items for " + conn->getName()) {
+          partition(partition),
+          description("Processing buffered items for " + conn->getName() +
+                      " (partition " + std::to_string(partition) + ")") {
     }
 
     ~Processor() {
         DcpConsumer* consumer = static_cast<DcpConsumer*>(conn.get());
-        consumer->taskCancelled();
+        consumer->taskCancelled(partition);
     }
 
     bool run() {
@@ -59,7 +62,8 @@ public:
         }
 
         double sleepFor = 0.0;
-        enum process_items_error_t state = consumer->processBufferedItems();
+        enum process_items_error_t state =
+                consumer->processBufferedItems(partition);
         switch (state) {
             case all_processed:
                 sleepFor = INT_MAX;
@@ -87,20 +91,20 @@ public:
         // between the second `if(consumer->notifiedProcessor)` and us calling
         // `wakeUp()`; but that's essentially a benign race as it will just
         // result in wakeUp() being called twice which is benign.
-        if (consumer->notifiedProcessor(false)) {
+        if (consumer->notifiedProcessor(false, partition)) {
             wakeUp();
             state = more_to_process;
         } else {
             snooze(sleepFor);
             // Check if the processor was notified again,
             // in which case the task should wake immediately.
-            if (consumer->notifiedProcessor(false)) {
+            if (consumer->notifiedProcessor(false, partition)) {
                 wakeUp();
                 state = more_to_process;
             }
         }
 
-        consumer->setProcessorTaskState(state);
+        consumer->setProcessorTaskState(state, partition);
 
         return true;
     }
@@ -111,6 +115,7 @@ public:
 
 private:
     const connection_t conn;
+    const size_t partition;
     const std::string description;
 };
 
@@ -119,13 +124,9 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine &engine, const void *cookie,
     : ConnHandler(engine, cookie, name),
       lastMessageTime(ep_current_time()),
       opaqueCounter(0),
-      processorTaskId(0),
-      processorTaskState(all_processed),
-      processorNotification(false),
       backoffs(0),
       dcpIdleTimeout(engine.getConfiguration().getDcpIdleTimeout()),
       dcpNoopTxInterval(engine.getConfiguration().getDcpNoopTxInterval()),
-      taskAlreadyCancelled(false),
       flowControl(engine, this),
       processBufferedMessagesYieldThreshold(engine.getConfiguration().
                                                 getDcpConsumerProcessBufferedMessagesYieldLimit()),
@@ -144,8 +145,14 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine &engine, const void *cookie,
     pendingEnableValueCompression = config.isDcpValueCompressionEnabled();
     pendingSupportCursorDropping = true;
 
-    ExTask task = std::make_shared<Processor>(&engine, this, 1);
-    processorTaskId = ExecutorPool::get()->schedule(task);
+    const size_t numProcessors = config.getDcpConsumerProcessorTasks();
+    for (size_t ii = 0; ii < numProcessors; ++ii) {
+        processors.emplace_back(std::make_unique<ProcessorPartition>());
+    }
+    for (size_t ii = 0; ii < numProcessors; ++ii) {
+        ExTask task = std::make_shared<Processor>(&engine, this, ii, 1);
+        processors[ii]->taskId = ExecutorPool::get()->schedule(task);
+    }
 }
 
 DcpConsumer::~DcpConsumer() {
@@ -154,15 +161,19 @@ DcpConsumer::~DcpConsumer() {
 
 
 void DcpConsumer::cancelTask() {
-    bool inverse = false;
-    if (taskAlreadyCancelled.compare_exchange_strong(inverse, true)) {
-        ExecutorPool::get()->cancel(processorTaskId);
+    for (auto& processor : processors) {
+        bool inverse = false;
+        if (processor->taskAlreadyCancelled.compare_exchange_strong(inverse,
+                                                                    true)) {
+            ExecutorPool::get()->cancel(processor->taskId);
+        }
     }
 }
 
-void DcpConsumer::taskCancelled() {
+void DcpConsumer::taskCancelled(size_t partition) {
     bool inverse = false;
-    taskAlreadyCancelled.compare_exchange_strong(inverse, true);
+    processors[partition]->taskAlreadyCancelled.compare_exchange_strong(
+            inverse, true);
 }
 
 SingleThreadedRCPtr<PassiveStream> DcpConsumer::makePassiveStream(
@@ -727,8 +738,10 @@ bool DcpConsumer::handleResponse(protocol_binary_response_header* resp) {
 
         streamAccepted(opaque, status, body, bodylen);
         return true;
-    } else if (opcode == PROTOCOL_BINARY_CMD_DCP_BUFFER_ACKNOWLEDGEMENT ||
-               opcode == PROTOCOL_BINARY_CMD_DCP_CONTROL) {
+    } else if (opcode == PROTOCOL_BINARY_CMD_DCP_BUFFER_ACKNOWLEDGEMENT) {
+        return true;
+    } else if (opcode == PROTOCOL_BINARY_CMD_DCP_CONTROL) {
+        flowControl.handleControlResponse(opaque);
         return true;
     }
 
@@ -847,12 +860,14 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(SingleThreadedRCPtr
         switch (engine_.getReplicationThrottle().getStatus()) {
         case ReplicationThrottle::Status::Pause:
             backoffs++;
-            vbReady.pushUnique(stream->getVBucket());
+            getProcessor(stream->getVBucket()).vbReady.pushUnique(
+                    stream->getVBucket());
             return cannot_process;
 
         case ReplicationThrottle::Status::Disconnect:
             backoffs++;
-            vbReady.pushUnique(stream->getVBucket());
+            getProcessor(stream->getVBucket()).vbReady.pushUnique(
+                    stream->getVBucket());
             return stop_processing;
 
         case ReplicationThrottle::Status::Process:
@@ -876,7 +891,8 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(SingleThreadedRCPtr
 
     // The stream may not be done yet so must go back in the ready queue
     if (bytesProcessed > 0) {
-        vbReady.pushUnique(stream->getVBucket());
+        getProcessor(stream->getVBucket()).vbReady.pushUnique(
+                stream->getVBucket());
         if (rval == stop_processing) {
             return stop_processing;
         }
@@ -886,9 +902,10 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(SingleThreadedRCPtr
     return rval;
 }
 
-process_items_error_t DcpConsumer::processBufferedItems() {
+process_items_error_t DcpConsumer::processBufferedItems(size_t partition) {
     process_items_error_t process_ret = all_processed;
     uint16_t vbucket = 0;
+    DcpReadyQueue& vbReady = processors[partition]->vbReady;
     while (vbReady.popFront(vbucket)) {
         auto stream = findStream(vbucket);
 
@@ -922,23 +939,49 @@ process_items_error_t DcpConsumer::processBufferedItems() {
 }
 
 void DcpConsumer::notifyVbucketReady(uint16_t vbucket) {
-    if (vbReady.pushUnique(vbucket) &&
-        notifiedProcessor(true)) {
-        ExecutorPool::get()->wake(processorTaskId);
+    auto& processor = getProcessor(vbucket);
+    if (processor.vbReady.pushUnique(vbucket) &&
+        notifiedProcessor(true, processorIndex(vbucket))) {
+        ExecutorPool::get()->wake(processor.taskId);
     }
 }
 
-bool DcpConsumer::notifiedProcessor(bool to) {
+bool DcpConsumer::notifiedProcessor(bool to, size_t partition) {
     bool inverse = !to;
-    return processorNotification.compare_exchange_strong(inverse, to);
+    return processors[partition]->notification.compare_exchange_strong(inverse,
+                                                                       to);
 }
 
-void DcpConsumer::setProcessorTaskState(enum process_items_error_t to) {
-    processorTaskState = to;
+void DcpConsumer::setProcessorTaskState(enum process_items_error_t to,
+                                        size_t partition) {
+    processors[partition]->taskState = to;
 }
 
 std::string DcpConsumer::getProcessorTaskStatusStr() {
-    switch (processorTaskState.load()) {
+    // Report the state of the busiest processor; in order of precedence
+    // stop_processing, cannot_process, more_to_process, all_processed.
+    auto rank = [](process_items_error_t state) {
+        switch (state) {
+        case all_processed:
+            return 0;
+        case more_to_process:
+            return 1;
+        case cannot_process:
+            return 2;
+        case stop_processing:
+            return 3;
+        }
+        return 0;
+    };
+    process_items_error_t state = all_processed;
+    for (const auto& processor : processors) {
+        const auto partitionState = processor->taskState.load();
+        if (rank(partitionState) > rank(state)) {
+            state = partitionState;
+        }
+    }
+
+    switch (state) {
         case all_processed:
             return "ALL_PROCESSED";
         case more_to_process:
@@ -1221,6 +1264,14 @@ void DcpConsumer::notifyConsumerIfNecessary(bool schedule) {
     }
 }
 
+size_t DcpConsumer::processorIndex(uint16_t vbucket) const {
+    return vbucket % processors.size();
+}
+
+DcpConsumer::ProcessorPartition& DcpConsumer::getProcessor(uint16_t vbucket) {
+    return *processors[processorIndex(vbucket)];
+}
+
 SingleThreadedRCPtr<PassiveStream> DcpConsumer::findStream(uint16_t vbid) {
     auto it = streams.find(vbid);
     if (it.second) {
@@ -27,6 +27,9 @@
 
 #include <relaxed_atomic.h>
 
+#include <memory>
+#include <vector>
+
 class DcpResponse;
 class StreamEndResponse;
 
@@ -172,7 +175,11 @@ public:
 
     void closeStreamDueToVbStateChange(uint16_t vbucket, vbucket_state_t state);
 
-    process_items_error_t processBufferedItems();
+    /**
+     * Apply the buffered messages of the vbuckets belonging to the given
+     * processor partition (see ProcessorPartition).
+     */
+    process_items_error_t processBufferedItems(size_t partition = 0);
 
     uint64_t incrOpaqueCounter();
 
@@ -186,11 +193,12 @@ public:
 
     void cancelTask();
 
-    void taskCancelled();
+    void taskCancelled(size_t partition);
 
-    bool notifiedProcessor(bool to);
+    bool notifiedProcessor(bool to, size_t partition);
 
-    void setProcessorTaskState(enum process_items_error_t to);
+    void setProcessorTaskState(enum process_items_error_t to,
+                               size_t partition);
 
     std::string getProcessorTaskStatusStr();
 
@@ -264,6 +272,24 @@ protected:
 
     void notifyVbucketReady(uint16_t vbucket);
 
+    /*
+     * Buffered messages are applied by one Processor task per partition.
+     * A vbucket always belongs to the same partition (vbucket % partitions),
+     * so its messages are applied in order by a single task, while
+     * different vbuckets of the connection can be applied concurrently.
+     */
+    struct ProcessorPartition {
+        size_t taskId{0};
+        std::atomic<enum process_items_error_t> taskState{all_processed};
+        DcpReadyQueue vbReady;
+        std::atomic<bool> notification{false};
+        std::atomic<bool> taskAlreadyCancelled{false};
+    };
+
+    size_t processorIndex(uint16_t vbucket) const;
+
+    ProcessorPartition& getProcessor(uint16_t vbucket);
+
     /**
      * Drain the stream of bufferedItems
      * The function will stop draining
@@ -295,11 +321,9 @@ protected:
                                 uint64_t rollbackSeqno);
 
     uint64_t opaqueCounter;
-    size_t processorTaskId;
-    std::atomic<enum process_items_error_t> processorTaskState;
 
-    DcpReadyQueue vbReady;
-    std::atomic<bool> processorNotification;
+    // Sized from dcp_consumer_processor_tasks on construction.
+    std::vector<std::unique_ptr<ProcessorPartition>> processors;
 
     std::mutex readyMutex;
     std::list<uint16_t> ready;
@@ -327,7 +351,6 @@ protected:
     bool pendingEnableExtMetaData;
     bool pendingEnableValueCompression;
     bool pendingSupportCursorDropping;
-    std::atomic<bool> taskAlreadyCancelled;
 
     FlowControl flowControl;
 
@@ -18,14 +18,20 @@
 #include "config.h"
 
 #include "configuration.h"
+#include "dcp/backfill-manager.h"
 #include "dcp/consumer.h"
 #include "dcp/producer.h"
 #include "dcpconnmap.h"
 #include "ep_engine.h"
+#include "ep_time.h"
+
+#include <limits>
 
 const uint32_t DcpConnMap::dbFileMem = 10 * 1024;
 const uint16_t DcpConnMap::numBackfillsThreshold = 4096;
 const uint8_t DcpConnMap::numBackfillsMemThreshold = 1;
+const uint8_t DcpConnMap::backfillBytesMemThreshold = 10;
+const rel_time_t DcpConnMap::backfillScanWaiterTimeout = 2;
 
 class DcpConnMap::DcpConfigChangeListener : public ValueChangedListener {
 public:
@@ -40,8 +46,18 @@ private:
 
 DcpConnMap::DcpConnMap(EventuallyPersistentEngine &e)
     : ConnMap(e),
+      compressedValueCache(e.getConfiguration().getDcpCompressionCacheSize()),
+      vbNotifyPending(new std::atomic<bool>[
+              e.getConfiguration().getMaxVbuckets()]()),
       aggrDcpConsumerBufferSize(0) {
     backfills.numActiveSnoozing = 0;
+    backfills.bytesBuffered = 0;
+    backfills.bytesFull = false;
+    backfills.numRunningScans = 0;
+    backfills.maxRunningScans = static_cast<uint16_t>(
+            std::min(e.getConfiguration().getDcpBackfillMaxConcurrentScans(),
+                     size_t(std::numeric_limits<uint16_t>::max())));
+    backfills.scanVTime = 0;
     updateMaxActiveSnoozingBackfills(engine.getEpStats().getMaxDataSize());
     minCompressionRatioForProducer.store(
                     engine.getConfiguration().getDcpMinCompressionRatio());
@@ -360,26 +376,53 @@ void DcpConnMap::removeVBConnections(connection_t &conn) {
     for (const auto vbid : prod->getVBVector()) {
         size_t lock_num = vbid % vbConnLockNum;
         std::lock_guard<SpinLock> lh(vbConnLocks[lock_num]);
-        std::list<connection_t> &vb_conns = vbConns[vbid];
-        std::list<connection_t>::iterator itr = vb_conns.begin();
-        for (; itr != vb_conns.end(); ++itr) {
-            if (conn->getCookie() == (*itr)->getCookie()) {
-                vb_conns.erase(itr);
-                break;
-            }
-        }
+        removeVBConnByVBId_UNLOCKED(conn, vbid);
     }
 }
 
 void DcpConnMap::notifyVBConnections(uint16_t vbid, uint64_t bySeqno) {
-    size_t lock_num = vbid % vbConnLockNum;
-    std::lock_guard<SpinLock> lh(vbConnLocks[lock_num]);
+    if (vbConnCounts[vbid] == 0) {
+        return;
+    }
 
-    std::list<connection_t> &conns = vbConns[vbid];
-    std::list<connection_t>::iterator it = conns.begin();
-    for (; it != conns.end(); ++it) {
-        DcpProducer *conn = static_cast<DcpProducer*>((*it).get());
-        conn->notifySeqnoAvailable(vbid, bySeqno);
+    // Only the first notification since the vbucket was last processed
+    // needs to do anything; later ones are covered by the same pass of
+    // the ConnNotifier.
+    if (vbNotifyPending[vbid].load(std::memory_order_relaxed) ||
+        vbNotifyPending[vbid].exchange(true)) {
+        return;
+    }
+
+    pendingVBNotifications.push(vbid);
+    if (connNotifier_) {
+        connNotifier_->notifyMutationEvent();
+    }
+}
+
+void DcpConnMap::processDeferredNotifications() {
+    std::queue<uint16_t> vbuckets;
+    pendingVBNotifications.getAll(vbuckets);
+
+    while (!vbuckets.empty()) {
+        const uint16_t vbid = vbuckets.front();
+        vbuckets.pop();
+
+        // Clear the flag before reading the seqno so a mutation racing
+        // with us is either seen here or re-queues the vbucket.
+        vbNotifyPending[vbid].store(false);
+
+        VBucketPtr vb = engine.getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        const uint64_t seqno = vb->getHighSeqno();
+
+        size_t lock_num = vbid % vbConnLockNum;
+        std::lock_guard<SpinLock> lh(vbConnLocks[lock_num]);
+        for (auto& conn : vbConns[vbid]) {
+            static_cast<DcpProducer*>(conn.get())
+                    ->notifySeqnoAvailable(vbid, seqno);
+        }
     }
 }
 
@@ -422,6 +465,17 @@ void DcpConnMap::updateMaxActiveSnoozingBackfills(size_t maxDataSize)
                          static_cast<double>(numBackfillsMemThreshold)/100;
     size_t max = maxDataSize * numBackfillsMemThresholdPercent / dbFileMem;
 
+    /* Unless configured explicitly the backfill buffers of all connections
+       may use a percentage of the quota, but never less than a single
+       connection may use */
+    Configuration& config = engine.getConfiguration();
+    size_t maxBytes = config.getDcpBackfillBucketByteLimit();
+    if (maxBytes == 0) {
+        maxBytes = std::max(
+                maxDataSize * backfillBytesMemThreshold / 100,
+                config.getDcpBackfillByteLimit());
+    }
+
     uint16_t newMaxActive;
     {
         std::lock_guard<std::mutex> lh(backfills.mutex);
@@ -430,15 +484,171 @@ void DcpConnMap::updateMaxActiveSnoozingBackfills(size_t maxDataSize)
                 std::max(static_cast<size_t>(1),
                          std::min(max, static_cast<size_t>(numBackfillsThreshold)));
         newMaxActive = backfills.maxActiveSnoozing;
+        backfills.maxBytesBuffered = maxBytes;
     }
-    LOG(EXTENSION_LOG_DEBUG, "Max active snoozing backfills set to %" PRIu16,
-        newMaxActive);
+    LOG(EXTENSION_LOG_DEBUG, "Max active snoozing backfills set to %" PRIu16
+        ", max backfill bytes set to %" PRIu64,
+        newMaxActive, uint64_t(maxBytes));
+}
+
+bool DcpConnMap::reserveBackfillBytes(size_t bytes, bool force) {
+    std::lock_guard<std::mutex> lh(backfills.mutex);
+    if (force ||
+        backfills.bytesBuffered + bytes <= backfills.maxBytesBuffered) {
+        backfills.bytesBuffered += bytes;
+        return true;
+    }
+    backfills.bytesFull = true;
+    return false;
+}
+
+void DcpConnMap::releaseBackfillBytes(size_t bytes) {
+    std::list<BackfillWaiter> toWake;
+    {
+        std::lock_guard<std::mutex> lh(backfills.mutex);
+        if (bytes > backfills.bytesBuffered) {
+            LOG(EXTENSION_LOG_WARNING,
+                "DcpConnMap::releaseBackfillBytes: releasing %" PRIu64
+                " bytes but only %" PRIu64 " are buffered",
+                uint64_t(bytes), uint64_t(backfills.bytesBuffered));
+            bytes = backfills.bytesBuffered;
+        }
+        backfills.bytesBuffered -= bytes;
+
+        /* Like the per connection buffer, resume once a quarter of the
+           budget is free to avoid waking everyone for every item sent */
+        if (backfills.bytesFull &&
+            backfills.bytesBuffered <= (backfills.maxBytesBuffered * 3 / 4)) {
+            backfills.bytesFull = false;
+            toWake.swap(backfills.byteWaiters);
+        }
+    }
+
+    for (auto& waiter : toWake) {
+        auto manager = waiter.weakManager.lock();
+        if (manager) {
+            manager->wakeUpTask();
+        }
+    }
+}
+
+bool DcpConnMap::canBackfillReadBytes(BackfillManager& mgr) {
+    std::lock_guard<std::mutex> lh(backfills.mutex);
+    if (!backfills.bytesFull) {
+        return true;
+    }
+    for (const auto& waiter : backfills.byteWaiters) {
+        if (waiter.manager == &mgr) {
+            return false;
+        }
+    }
+    backfills.byteWaiters.push_back({&mgr, mgr.shared_from_this(), 0, 0});
+    return false;
+}
+
+bool DcpConnMap::acquireBackfillScan(BackfillManager& mgr) {
+    const uint64_t vtime = mgr.getScanVTime();
+    const rel_time_t now = ep_current_time();
+
+    std::lock_guard<std::mutex> lh(backfills.mutex);
+    auto self = backfills.scanWaiters.end();
+    size_t waitersAhead = 0;
+    for (auto it = backfills.scanWaiters.begin();
+         it != backfills.scanWaiters.end();) {
+        if (it->manager == &mgr) {
+            self = it++;
+        } else if (it->lastAsked + backfillScanWaiterTimeout < now ||
+                   it->weakManager.expired()) {
+            // The waiter no longer wants a slot (e.g. its backfills
+            // completed or its buffer is full); don't let it hold up others
+            it = backfills.scanWaiters.erase(it);
+        } else {
+            if (it->vtime < vtime) {
+                ++waitersAhead;
+            }
+            ++it;
+        }
+    }
+
+    if (backfills.numRunningScans + waitersAhead <
+        backfills.maxRunningScans) {
+        ++backfills.numRunningScans;
+        backfills.scanVTime = std::max(backfills.scanVTime, vtime);
+        if (self != backfills.scanWaiters.end()) {
+            backfills.scanWaiters.erase(self);
+        }
+        return true;
+    }
+
+    if (self != backfills.scanWaiters.end()) {
+        self->vtime = vtime;
+        self->lastAsked = now;
+    } else {
+        backfills.scanWaiters.push_back(
+                {&mgr, mgr.shared_from_this(), vtime, now});
+    }
+    return false;
+}
+
+void DcpConnMap::releaseBackfillScan() {
+    std::weak_ptr<BackfillManager> next;
+    {
+        std::lock_guard<std::mutex> lh(backfills.mutex);
+        if (backfills.numRunningScans == 0) {
+            throw std::logic_error(
+                    "DcpConnMap::releaseBackfillScan: no scan is running");
+        }
+        --backfills.numRunningScans;
+
+        auto lowest = backfills.scanWaiters.end();
+        for (auto it = backfills.scanWaiters.begin();
+             it != backfills.scanWaiters.end();
+             ++it) {
+            if (lowest == backfills.scanWaiters.end() ||
+                it->vtime < lowest->vtime) {
+                lowest = it;
+            }
+        }
+        if (lowest != backfills.scanWaiters.end()) {
+            next = lowest->weakManager;
+        }
+    }
+
+    auto manager = next.lock();
+    if (manager) {
+        manager->wakeUpTask();
+    }
+}
+
+void DcpConnMap::removeBackfillWaiter(const BackfillManager& mgr) {
+    std::lock_guard<std::mutex> lh(backfills.mutex);
+    auto isMgr = [&mgr](const BackfillWaiter& waiter) {
+        return waiter.manager == &mgr;
+    };
+    backfills.scanWaiters.remove_if(isMgr);
+    backfills.byteWaiters.remove_if(isMgr);
 }
 
 void DcpConnMap::addStats(ADD_STAT add_stat, const void *c) {
-    LockHolder lh(connsLock);
-    add_casted_stat("ep_dcp_dead_conn_count", deadConnections.size(), add_stat,
-                    c);
+    {
+        LockHolder lh(connsLock);
+        add_casted_stat("ep_dcp_dead_conn_count", deadConnections.size(),
+                        add_stat, c);
+    }
+
+    compressedValueCache.addStats(add_stat, c);
+
+    std::lock_guard<std::mutex> lh(backfills.mutex);
+    add_casted_stat("ep_dcp_backfill_buffer_bytes", backfills.bytesBuffered,
+                    add_stat, c);
+    add_casted_stat("ep_dcp_backfill_buffer_max_bytes",
+                    backfills.maxBytesBuffered, add_stat, c);
+    add_casted_stat("ep_dcp_num_running_backfill_scans",
+                    backfills.numRunningScans, add_stat, c);
+    add_casted_stat("ep_dcp_max_running_backfill_scans",
+                    backfills.maxRunningScans, add_stat, c);
+    add_casted_stat("ep_dcp_backfill_scan_waiters",
+                    backfills.scanWaiters.size(), add_stat, c);
 }
 
 void DcpConnMap::updateMinCompressionRatioForProducers(float value) {
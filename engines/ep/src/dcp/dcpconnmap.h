@@ -20,13 +20,16 @@
 #include "config.h"
 
 #include "connmap.h"
+#include "dcp/compression-cache.h"
 
 #include <platform/sized_buffer.h>
 
 #include <atomic>
 #include <list>
+#include <memory>
 #include <string>
 
+class BackfillManager;
 class DcpProducer;
 class DcpConsumer;
 
@@ -57,8 +60,21 @@ public:
      */
     DcpConsumer *newConsumer(const void* cookie, const std::string &name);
 
+    /**
+     * Notify the producers streaming the given vbucket that a new seqno is
+     * available. The notification is coalesced: the vbucket is only marked
+     * as pending and the producers are told by the ConnNotifier (see
+     * processDeferredNotifications), so the cost to the front-end thread
+     * does not depend on the number of producers.
+     */
     void notifyVBConnections(uint16_t vbid, uint64_t bySeqno);
 
+    /**
+     * Notify the producers of every vbucket marked by notifyVBConnections
+     * since the last call, at most once per vbucket.
+     */
+    void processDeferredNotifications() override;
+
     void notifyBackfillManagerTasks();
 
     void removeVBConnections(connection_t &conn);
@@ -116,6 +132,71 @@ public:
         return backfills.maxActiveSnoozing;
     }
 
+    /**
+     * Account for bytes read into the backfill buffer of a connection against
+     * the bucket-wide backfill byte budget.
+     *
+     * @param bytes read size
+     * @param force read even if the budget is exhausted
+     * @return true if the bytes were accounted, false if the budget is
+     *         exhausted (the caller must not read the item)
+     */
+    bool reserveBackfillBytes(size_t bytes, bool force);
+
+    /**
+     * Return bytes accounted by reserveBackfillBytes. Wakes the backfills
+     * waiting for the budget once enough of it has been freed.
+     */
+    void releaseBackfillBytes(size_t bytes);
+
+    /**
+     * Check whether the given BackfillManager may read more items given the
+     * bucket-wide backfill byte budget. If not, the manager is woken
+     * (see BackfillManager::wakeUpTask) once the budget has been freed.
+     */
+    bool canBackfillReadBytes(BackfillManager& mgr);
+
+    /**
+     * Try to acquire one of the bucket's backfill scan slots (see
+     * dcp_backfill_max_concurrent_scans) for the given BackfillManager.
+     *
+     * Slots are shared fairly between BackfillManagers: a manager which is
+     * refused is remembered as a waiter, and a free slot is only granted if
+     * enough slots are free for all the waiters which have scanned less
+     * than it (weighted by priority, see BackfillManager::getScanVTime).
+     *
+     * @return true if a slot was acquired; it must be returned with
+     *         releaseBackfillScan
+     */
+    bool acquireBackfillScan(BackfillManager& mgr);
+
+    /**
+     * Release a slot acquired by acquireBackfillScan and wake the waiter
+     * with the lowest virtual time. Must not be called with any
+     * BackfillManager lock held.
+     */
+    void releaseBackfillScan();
+
+    /**
+     * Forget the given BackfillManager as a scan or byte budget waiter.
+     */
+    void removeBackfillWaiter(const BackfillManager& mgr);
+
+    /**
+     * @return the virtual time of the last backfill scan granted; new
+     *         BackfillManagers start from here so they cannot monopolise
+     *         the scan slots.
+     */
+    uint64_t getBackfillScanVTime() {
+        std::lock_guard<std::mutex> lh(backfills.mutex);
+        return backfills.scanVTime;
+    }
+
+    uint16_t getNumRunningBackfillScans() {
+        std::lock_guard<std::mutex> lh(backfills.mutex);
+        return backfills.numRunningScans;
+    }
+
     ENGINE_ERROR_CODE addPassiveStream(ConnHandler& conn, uint32_t opaque,
                                        uint16_t vbucket, uint32_t flags);
 
@@ -130,6 +211,12 @@ public:
 
     float getMinCompressionRatio();
 
+    /* Compressed values shared by all producers with value compression
+     * enabled */
+    DcpCompressedValueCache& getCompressedValueCache() {
+        return compressedValueCache;
+    }
+
     connection_t findByName(const std::string &name);
 
     bool isConnections() {
@@ -180,20 +267,60 @@ protected:
     /* Db file memory */
     static const uint32_t dbFileMem;
 
-    // Current and maximum number of backfills which are snoozing.
+    // A BackfillManager waiting for a backfill scan slot or for backfill
+    // byte budget. The manager is only locked (to be woken) without
+    // backfills.mutex held, as releasing it may destroy it.
+    struct BackfillWaiter {
+        const BackfillManager* manager;
+        std::weak_ptr<BackfillManager> weakManager;
+        // The manager's virtual time when it last asked for a scan slot
+        uint64_t vtime;
+        // When the manager last asked for a scan slot
+        rel_time_t lastAsked;
+    };
+
     struct {
         std::mutex mutex;
+        // Current and maximum number of backfills which are snoozing.
         uint16_t numActiveSnoozing;
         uint16_t maxActiveSnoozing;
+        // Bytes backfilled but not yet sent by all the connections, and the
+        // bucket-wide budget for them.
+        size_t bytesBuffered;
+        size_t maxBytesBuffered;
+        // Set when a read was refused for lack of budget
+        bool bytesFull;
+        std::list<BackfillWaiter> byteWaiters;
+        // Current and maximum number of backfills scanning at once.
+        uint16_t numRunningScans;
+        uint16_t maxRunningScans;
+        // Virtual time of the last scan granted
+        uint64_t scanVTime;
+        std::list<BackfillWaiter> scanWaiters;
     } backfills;
 
     /* Max num of backfills we want to have irrespective of memory */
     static const uint16_t numBackfillsThreshold;
     /* Max percentage of memory we want backfills to occupy */
     static const uint8_t numBackfillsMemThreshold;
+    /* Default percentage of memory all backfill buffers may occupy */
+    static const uint8_t backfillBytesMemThreshold;
+    /* Seconds after which a scan waiter which hasn't asked again is
+       ignored */
+    static const rel_time_t backfillScanWaiterTimeout;
 
     std::atomic<float> minCompressionRatioForProducer;
 
+    DcpCompressedValueCache compressedValueCache;
+
+    /*
+     * Per-vbucket flag set by notifyVBConnections when a seqno became
+     * available and the vbucket's producers have not yet been notified,
+     * and the queue of such vbuckets.
+     */
+    std::unique_ptr<std::atomic<bool>[]> vbNotifyPending;
+    AtomicQueue<uint16_t> pendingVBNotifications;
+
     /* Total memory used by all DCP consumer buffers */
     std::atomic<size_t> aggrDcpConsumerBufferSize;
 
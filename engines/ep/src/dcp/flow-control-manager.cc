@@ -34,11 +34,22 @@ size_t DcpFlowControlManager::newConsumerConn(DcpConsumer *) {
 
 void DcpFlowControlManager::handleDisconnect(DcpConsumer *) {}
 
+size_t DcpFlowControlManager::resizeConsumerConn(DcpConsumer *consumerConn,
+                                                 size_t)
+{
+    return consumerConn->getFlowControlBufSize();
+}
+
 bool DcpFlowControlManager::isEnabled() const
 {
     return false;
 }
 
+bool DcpFlowControlManager::isAdaptive() const
+{
+    return false;
+}
+
 void DcpFlowControlManager::setBufSizeWithinBounds(DcpConsumer *consumerConn,
                                                    size_t &bufSize)
 {
@@ -215,3 +226,94 @@ void DcpFlowControlManagerAggressive::resizeBuffers_UNLOCKED(size_t bufferSize)
         iter.second->setFlowControlBufSize(bufferSize);
     }
 }
+
+DcpFlowControlManagerAdaptive::DcpFlowControlManagerAdaptive(
+                                        EventuallyPersistentEngine &engine) :
+    DcpFlowControlManager(engine), aggrBufferSize(0)
+{
+}
+
+DcpFlowControlManagerAdaptive::~DcpFlowControlManagerAdaptive() {}
+
+size_t DcpFlowControlManagerAdaptive::newConsumerConn(
+                                                    DcpConsumer *consumerConn)
+{
+    if (consumerConn == nullptr) {
+        throw std::invalid_argument(
+                "DcpFlowControlManagerAdaptive::newConsumerConn: resp is NULL");
+    }
+
+    /* Start with the min size until the connection has an estimate of what
+       it needs */
+    size_t bufferSize = engine_.getConfiguration().getDcpConnBufferSize();
+
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    bufferSizes[consumerConn->getCookie()] = bufferSize;
+    aggrBufferSize += bufferSize;
+    LOG(EXTENSION_LOG_INFO, "%s Conn flow control buffer is %zu",
+        consumerConn->logHeader(), bufferSize);
+    return bufferSize;
+}
+
+void DcpFlowControlManagerAdaptive::handleDisconnect(DcpConsumer *consumerConn)
+{
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    auto iter = bufferSizes.find(consumerConn->getCookie());
+    if (iter != bufferSizes.end()) {
+        aggrBufferSize -= iter->second;
+        bufferSizes.erase(iter);
+    }
+}
+
+size_t DcpFlowControlManagerAdaptive::resizeConsumerConn(
+                                                    DcpConsumer *consumerConn,
+                                                    size_t desiredSize)
+{
+    Configuration &config = engine_.getConfiguration();
+
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    auto iter = bufferSizes.find(consumerConn->getCookie());
+    if (iter == bufferSizes.end()) {
+        throw std::invalid_argument(
+                "DcpFlowControlManagerAdaptive::resizeConsumerConn: " +
+                std::string(consumerConn->logHeader()) +
+                " is not a known connection");
+    }
+
+    /* Make sure that the flow control buffer size is within a max and min
+     range */
+    setBufSizeWithinBounds(consumerConn, desiredSize);
+
+    /* Only grow into the memory the other connections leave under the
+       threshold; a connection is never made to shrink for others */
+    const size_t currentSize = iter->second;
+    const size_t othersSize = aggrBufferSize - currentSize;
+    const double dcpConnBufferSizeThreshold = static_cast<double>
+                            (config.getDcpConnBufferSizeAggrMemThreshold())/100;
+    const size_t threshold =
+            dcpConnBufferSizeThreshold * engine_.getEpStats().getMaxDataSize();
+    if (desiredSize > currentSize && othersSize + desiredSize > threshold) {
+        const size_t available =
+                threshold > othersSize ? threshold - othersSize : 0;
+        desiredSize = std::max(currentSize, available);
+        LOG(EXTENSION_LOG_INFO, "%s Conn flow control buffer limited to %zu "
+            "as aggr memory used for flow control buffers across all "
+            "consumers is above the threshold (%f) * (%zu)",
+            consumerConn->logHeader(), desiredSize, dcpConnBufferSizeThreshold,
+            engine_.getEpStats().getMaxDataSize());
+    }
+
+    aggrBufferSize = othersSize + desiredSize;
+    iter->second = desiredSize;
+    return desiredSize;
+}
+
+bool DcpFlowControlManagerAdaptive::isEnabled() const
+{
+    return true;
+}
+
+bool DcpFlowControlManagerAdaptive::isAdaptive() const
+{
+    return true;
+}
@@ -19,6 +19,7 @@
 #define SRC_DCP_FLOW_CONTROL_MANAGER_H_ 1
 
 #include <atomic>
+#include <map>
 #include <mutex>
 
 #include "memcached/types.h"
@@ -47,9 +48,19 @@ public:
     /* To be called when a consumer connection is deleted */
     virtual void handleDisconnect(DcpConsumer *);
 
+    /* To be called when a consumer connection has a new estimate of the
+       flow control buffer size it needs. Returns the size the buffer should
+       be set to */
+    virtual size_t resizeConsumerConn(DcpConsumer *consumerConn,
+                                      size_t desiredSize);
+
     /* Will indicate if flow control is enabled */
     virtual bool isEnabled(void) const;
 
+    /* Will indicate if flow control buffers are sized from the estimates of
+       the connections (see resizeConsumerConn) */
+    virtual bool isAdaptive(void) const;
+
 protected:
     void setBufSizeWithinBounds(DcpConsumer *consumerConn, size_t &bufSize);
 
@@ -129,4 +140,37 @@ private:
     /* Fraction of memQuota for all dcp consumer connection buffers */
     std::atomic<double> dcpConnBufferSizeAggrFrac;
 };
+
+/**
+ * In this policy flow control buffers start at the min value (10 MB) and are
+ * then resized from the bandwidth-delay product each connection estimates
+ * (see FlowControl), within the max (50MB) and min values. Buffers are only
+ * grown while the aggr memory used by all flow control buffers is below a
+ * threshold (10% of bucket memory), so a connection to a distant node can
+ * get a large buffer while local connections keep small ones
+ */
+class DcpFlowControlManagerAdaptive : public DcpFlowControlManager {
+public:
+    DcpFlowControlManagerAdaptive(EventuallyPersistentEngine &engine);
+
+    ~DcpFlowControlManagerAdaptive();
+
+    size_t newConsumerConn(DcpConsumer *consumerConn);
+
+    void handleDisconnect(DcpConsumer *consumerConn);
+
+    size_t resizeConsumerConn(DcpConsumer *consumerConn, size_t desiredSize);
+
+    bool isEnabled(void) const;
+
+    bool isAdaptive(void) const;
+
+private:
+    /* Mutex to ensure bufferSizes and aggrBufferSize are thread safe */
+    std::mutex bufferSizesMutex;
+    /* Flow control buffer size of all DCP Consumers */
+    std::map<const void*, size_t> bufferSizes;
+    /* Total memory used by all DCP consumer buffers */
+    size_t aggrBufferSize;
+};
 #endif  /* SRC_DCP_FLOW_CONTROL_MANAGER_H_ */
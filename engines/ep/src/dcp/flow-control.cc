@@ -25,6 +25,24 @@
 #include "ep_time.h"
 #include "objectregistry.h"
 
+#include <algorithm>
+
+/* The buffer is sized as a multiple of the bandwidth-delay product so that
+   it doesn't limit a connection whose throughput could still grow */
+static const size_t bdpHeadroom = 2;
+
+/* Changes to the size smaller than 1/resizeThreshold of the current size
+   are ignored, so the producer isn't told of every small variation */
+static const size_t resizeThreshold = 8;
+
+/* Min time between resizes from the estimates */
+static const std::chrono::seconds resizeInterval(1);
+
+/* How often a control message is sent to sample the round trip time, and
+   how long the min round trip time is kept for */
+static const std::chrono::seconds rttProbeInterval(5);
+static const std::chrono::seconds minRttLifetime(10);
+
 FlowControl::FlowControl(EventuallyPersistentEngine &engine,
                          DcpConsumer* consumer) :
     consumerConn(consumer),
@@ -32,8 +50,18 @@ FlowControl::FlowControl(EventuallyPersistentEngine &engine,
     pendingControl(true),
     lastBufferAck(ep_current_time()),
     ackedBytes(0),
-    freedBytes(0)
+    freedBytes(0),
+    adaptive(engine.getDcpFlowControlManager().isAdaptive()),
+    lastBufferAckTime(ProcessClock::now()),
+    ackedBytesPerSec(0),
+    minRttUs(0),
+    minRttTime(lastBufferAckTime),
+    lastResize(lastBufferAckTime)
 {
+    rttProbe.pending = false;
+    rttProbe.opaque = 0;
+    rttProbe.sent = lastBufferAckTime;
+
     enabled = engine.getDcpFlowControlManager().isEnabled();
     if (enabled) {
         bufferSize =
@@ -53,11 +81,19 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
         ENGINE_ERROR_CODE ret;
         uint32_t ackable_bytes = freedBytes.load();
         std::unique_lock<SpinLock> lh(bufferSizeLock);
-        if (pendingControl) {
+        const auto now = ProcessClock::now();
+        if (pendingControl || isRttProbeDue_UNLOCKED(now)) {
             pendingControl = false;
             std::string buf_size(std::to_string(bufferSize));
-            lh.unlock();
             uint64_t opaque = consumerConn->incrOpaqueCounter();
+            /* Sample the round trip time with this message unless another
+               sample is outstanding */
+            if (!rttProbe.pending) {
+                rttProbe.pending = true;
+                rttProbe.opaque = uint32_t(opaque);
+                rttProbe.sent = now;
+            }
+            lh.unlock();
             const std::string &controlMsgKey = consumerConn->getControlMsgKey();
             EventuallyPersistentEngine *epe =
                                     ObjectRegistry::onSwitchThread(NULL, true);
@@ -80,6 +116,7 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
             lastBufferAck = ep_current_time();
             ackedBytes.fetch_add(ackable_bytes);
             freedBytes.fetch_sub(ackable_bytes);
+            bufferAckSent(ackable_bytes);
             return (ret == ENGINE_SUCCESS) ? ENGINE_WANT_MORE : ret;
         } else if (ackable_bytes > 0 &&
                    (ep_current_time() - lastBufferAck) > 5) {
@@ -94,6 +131,7 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
             lastBufferAck = ep_current_time();
             ackedBytes.fetch_add(ackable_bytes);
             freedBytes.fetch_sub(ackable_bytes);
+            bufferAckSent(ackable_bytes);
             return (ret == ENGINE_SUCCESS) ? ENGINE_WANT_MORE : ret;
         } else {
             lh.unlock();
@@ -131,9 +169,85 @@ bool FlowControl::isBufferSufficientlyDrained_UNLOCKED(uint32_t ackable_bytes) {
     return ackable_bytes > (bufferSize * .2);
 }
 
+void FlowControl::handleControlResponse(uint32_t opaque)
+{
+    std::lock_guard<SpinLock> lh(bufferSizeLock);
+    if (!rttProbe.pending || rttProbe.opaque != opaque) {
+        return;
+    }
+    rttProbe.pending = false;
+
+    const auto now = ProcessClock::now();
+    const uint64_t rtt = std::max<uint64_t>(
+            1,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - rttProbe.sent).count());
+    if (minRttUs == 0 || rtt < minRttUs || now - minRttTime > minRttLifetime) {
+        minRttUs = rtt;
+        minRttTime = now;
+    }
+}
+
+bool FlowControl::isRttProbeDue_UNLOCKED(ProcessClock::time_point now)
+{
+    if (!adaptive) {
+        return false;
+    }
+    if (rttProbe.pending) {
+        /* Give up on a sample whose response got lost */
+        if (now - rttProbe.sent > minRttLifetime) {
+            rttProbe.pending = false;
+        }
+        return false;
+    }
+    return now - rttProbe.sent >= rttProbeInterval;
+}
+
+void FlowControl::bufferAckSent(uint32_t bytes)
+{
+    const auto now = ProcessClock::now();
+    size_t desiredSize;
+    {
+        std::lock_guard<SpinLock> lh(bufferSizeLock);
+        const auto interval =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        now - lastBufferAckTime);
+        lastBufferAckTime = now;
+        if (interval.count() > 0) {
+            const uint64_t sample =
+                    uint64_t(bytes) * 1000000 / interval.count();
+            const uint64_t previous = ackedBytesPerSec;
+            ackedBytesPerSec =
+                    (previous == 0) ? sample : (previous * 3 + sample) / 4;
+        }
+
+        if (!adaptive || minRttUs == 0 || now - lastResize < resizeInterval) {
+            return;
+        }
+
+        desiredSize = bdpHeadroom * ackedBytesPerSec * minRttUs / 1000000;
+        const size_t currentSize = bufferSize;
+        const size_t change = (desiredSize > currentSize)
+                                      ? desiredSize - currentSize
+                                      : currentSize - desiredSize;
+        if (change < currentSize / resizeThreshold) {
+            return;
+        }
+        lastResize = now;
+    }
+
+    /* The manager may read our buffer size, so bufferSizeLock must not be
+       held */
+    setFlowControlBufSize(
+            engine_.getDcpFlowControlManager().resizeConsumerConn(
+                    consumerConn, desiredSize));
+}
+
 void FlowControl::addStats(ADD_STAT add_stat, const void *c)
 {
     consumerConn->addStat("total_acked_bytes", ackedBytes, add_stat, c);
     consumerConn->addStat("max_buffer_bytes", bufferSize, add_stat, c);
     consumerConn->addStat("unacked_bytes", freedBytes, add_stat, c);
+    consumerConn->addStat("acked_bytes_per_sec", ackedBytesPerSec, add_stat, c);
+    consumerConn->addStat("control_min_rtt_us", minRttUs, add_stat, c);
 }
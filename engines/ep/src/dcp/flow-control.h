@@ -23,6 +23,7 @@
 #include "atomic.h"
 #include "memcached/engine.h"
 
+#include <platform/processclock.h>
 #include <relaxed_atomic.h>
 
 class DcpConsumer;
@@ -33,7 +34,14 @@ class EventuallyPersistentEngine;
  * It is always associated with a DCP consumer.
  * Flow control buffer size is set when the class obj is initialized.
  * The class obj subsequently handles sending control messages and
- * sending bytes processed acks to the DCP producer
+ * sending bytes processed acks to the DCP producer.
+ *
+ * It also estimates the bandwidth-delay product of the connection: the
+ * throughput from the bytes acked between buffer acks, and the round trip
+ * time from the responses to the connection_buffer_size control messages.
+ * With an adaptive flow control policy the buffer is resized from that
+ * estimate, and the control message is re-sent periodically to keep the
+ * round trip time up to date.
  */
 class FlowControl {
 public:
@@ -49,6 +57,10 @@ public:
 
     void setFlowControlBufSize(uint32_t newSize);
 
+    /* To be called with the response to a control message sent by the
+       associated consumer */
+    void handleControlResponse(uint32_t opaque);
+
     bool isBufferSufficientlyDrained();
 
     void addStats(ADD_STAT add_stat, const void *c);
@@ -58,6 +70,14 @@ private:
 
     bool isBufferSufficientlyDrained_UNLOCKED(uint32_t ackable_bytes);
 
+    /* Update the throughput estimate after a buffer ack of the given bytes
+       was sent, and resize the buffer if the policy is adaptive */
+    void bufferAckSent(uint32_t bytes);
+
+    /* Indicates if a control message should be sent to sample the round
+       trip time */
+    bool isRttProbeDue_UNLOCKED(ProcessClock::time_point now);
+
     /* Associated consumer connection handler */
     DcpConsumer* consumerConn;
 
@@ -85,6 +105,33 @@ private:
 
     /* Bytes processed from the flow control buffer */
     std::atomic<uint64_t> freedBytes;
+
+    /* Indicates if the buffer is sized from the estimates below */
+    bool adaptive;
+
+    /* The remaining members are protected by bufferSizeLock */
+
+    /* When the last buffer ack was sent, for the throughput estimate */
+    ProcessClock::time_point lastBufferAckTime;
+
+    /* Bytes per second acked, averaged over the recent buffer acks */
+    std::atomic<uint64_t> ackedBytesPerSec;
+
+    /* The outstanding control message used to sample the round trip time */
+    struct {
+        bool pending;
+        uint32_t opaque;
+        ProcessClock::time_point sent;
+    } rttProbe;
+
+    /* Min round trip time (in us) of the recent control messages and when
+       it was sampled. Larger samples include time the response spent
+       queued behind data, so are not used */
+    std::atomic<uint64_t> minRttUs;
+    ProcessClock::time_point minRttTime;
+
+    /* When the buffer was last resized from the estimates */
+    ProcessClock::time_point lastResize;
 };
 
 #endif  /* SRC_DCP_FLOW_CONTROL_H_ */
@@ -214,8 +214,8 @@ DcpProducer::~DcpProducer() {
     backfillMgr.reset();
     delete rejectResp;
 
-    if (checkpointCreatorTask) {
-        ExecutorPool::get()->cancel(checkpointCreatorTask->getId());
+    for (auto& task : checkpointCreatorTasks) {
+        ExecutorPool::get()->cancel(task->getId());
     }
 }
 
@@ -518,7 +518,15 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
             return ENGINE_ENOMEM;
         }
 
-        if (enableValueCompression) {
+        if (mutationResponse->isCompressedByStream()) {
+            // The stream compressed the value while value compression was
+            // enabled; if it since got disabled send the value as is.
+            if (!enableValueCompression && !itmCpy->decompressValue()) {
+                LOG(EXTENSION_LOG_WARNING,
+                    "%s Failed to snappy decompress a compressed value!",
+                    logHeader());
+            }
+        } else if (enableValueCompression) {
             /**
              * If value compression is enabled, the producer will need
              * to snappy-compress the document before transmitting.
@@ -648,6 +656,26 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
     return (ret == ENGINE_SUCCESS) ? ENGINE_WANT_MORE : ret;
 }
 
+ENGINE_ERROR_CODE DcpProducer::stepBatch(
+        struct dcp_message_producers* producers, size_t maxMessages) {
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+    size_t sent = 0;
+    while (sent < maxMessages) {
+        ret = step(producers);
+        if (ret != ENGINE_WANT_MORE) {
+            break;
+        }
+        ++sent;
+    }
+
+    if (sent > 0 && (ret == ENGINE_SUCCESS || ret == ENGINE_E2BIG)) {
+        // We've added messages to the connection; let the caller send them
+        // and call us again (any rejected message is kept in rejectResp).
+        return ENGINE_WANT_MORE;
+    }
+    return ret;
+}
+
 ENGINE_ERROR_CODE DcpProducer::bufferAcknowledgement(uint32_t opaque,
                                                      uint16_t vbucket,
                                                      uint32_t buffer_bytes) {
@@ -731,14 +759,17 @@ ENGINE_ERROR_CODE DcpProducer::control(uint32_t opaque, const void* key,
     } else if(strncmp(param, "set_priority", nkey) == 0) {
         if (valueStr == "high") {
             engine_.setDCPPriority(getCookie(), CONN_PRIORITY_HIGH);
+            backfillMgr->setPriority(CONN_PRIORITY_HIGH);
             priority.assign("high");
             return ENGINE_SUCCESS;
         } else if (valueStr == "medium") {
             engine_.setDCPPriority(getCookie(), CONN_PRIORITY_MED);
+            backfillMgr->setPriority(CONN_PRIORITY_MED);
             priority.assign("medium");
             return ENGINE_SUCCESS;
         } else if (valueStr == "low") {
             engine_.setDCPPriority(getCookie(), CONN_PRIORITY_LOW);
+            backfillMgr->setPriority(CONN_PRIORITY_LOW);
             priority.assign("low");
             return ENGINE_SUCCESS;
         }
@@ -1205,30 +1236,44 @@ bool DcpProducer::bufferLogInsert(size_t bytes) {
 }
 
 void DcpProducer::createCheckpointProcessorTask() {
-    checkpointCreatorTask =
-            std::make_shared<ActiveStreamCheckpointProcessorTask>(engine_);
+    const size_t numTasks = engine_.getConfiguration()
+                                    .getDcpProducerCheckpointProcessorTasks();
+    checkpointCreatorTasks.clear();
+    for (size_t i = 0; i < numTasks; ++i) {
+        checkpointCreatorTasks.push_back(
+                std::make_shared<ActiveStreamCheckpointProcessorTask>(engine_));
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask() {
-    ExecutorPool::get()->schedule(checkpointCreatorTask);
+    for (auto& task : checkpointCreatorTasks) {
+        ExecutorPool::get()->schedule(task);
+    }
+}
+
+ActiveStreamCheckpointProcessorTask& DcpProducer::getCheckpointProcessorTask(
+        uint16_t vbid) const {
+    return *static_cast<ActiveStreamCheckpointProcessorTask*>(
+            checkpointCreatorTasks[vbid % checkpointCreatorTasks.size()].get());
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask(const stream_t& s) {
-    if (!checkpointCreatorTask) {
+    if (checkpointCreatorTasks.empty()) {
         throw std::logic_error(
                 "DcpProducer::scheduleCheckpointProcessorTask task is null");
     }
-    static_cast<ActiveStreamCheckpointProcessorTask*>(checkpointCreatorTask.get())
-        ->schedule(s);
+    getCheckpointProcessorTask(s->getVBucket()).schedule(s);
 }
 
 void DcpProducer::clearCheckpointProcessorTaskQueues() {
-    if (!checkpointCreatorTask) {
+    if (checkpointCreatorTasks.empty()) {
         throw std::logic_error(
                 "DcpProducer::clearCheckpointProcessorTaskQueues task is null");
     }
-    static_cast<ActiveStreamCheckpointProcessorTask*>(checkpointCreatorTask.get())
-        ->clearQueues();
+    for (auto& task : checkpointCreatorTasks) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
+                ->clearQueues();
+    }
 }
 
 SingleThreadedRCPtr<Stream> DcpProducer::findStream(uint16_t vbid) {
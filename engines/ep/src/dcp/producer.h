@@ -29,6 +29,7 @@ namespace Collections {
 class Filter;
 }
 
+class ActiveStreamCheckpointProcessorTask;
 class BackfillManager;
 class DcpResponse;
 
@@ -68,6 +69,16 @@ public:
 
     ENGINE_ERROR_CODE step(struct dcp_message_producers* producers) override;
 
+    /**
+     * Send as many ready messages as possible (up to maxMessages) in one
+     * call. Stops early when no more messages are ready, when the flow
+     * control buffer is full, or when the caller's write buffer is full
+     * (a producer callback returned ENGINE_E2BIG); in the latter case the
+     * rejected message is sent first on the next call.
+     */
+    ENGINE_ERROR_CODE stepBatch(struct dcp_message_producers* producers,
+                                size_t maxMessages) override;
+
     ENGINE_ERROR_CODE bufferAcknowledgement(uint32_t opaque, uint16_t vbucket,
                                             uint32_t buffer_bytes) override;
 
@@ -227,13 +238,13 @@ private:
     bool bufferLogInsert(size_t bytes);
 
     /*
-        Schedules active stream checkpoint processor task
-        for given stream.
+        Schedules the active stream checkpoint processor task which
+        owns the given stream's vbucket.
     */
     void scheduleCheckpointProcessorTask(const stream_t& s);
 
     /*
-        Clears active stream checkpoint processor task's queue.
+        Clears the queues of all active stream checkpoint processor tasks.
     */
     void clearCheckpointProcessorTaskQueues();
 
@@ -263,16 +274,25 @@ protected:
     ENGINE_ERROR_CODE maybeSendNoop(struct dcp_message_producers* producers);
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreatorTask
+     * Create dcp_producer_checkpoint_processor_tasks
+     * ActiveStreamCheckpointProcessorTasks and assign them to
+     * checkpointCreatorTasks
      */
     void createCheckpointProcessorTask();
 
     /**
-     * Schedule the checkpointCreatorTask on the ExecutorPool
+     * Schedule the checkpointCreatorTasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask();
 
+    /**
+     * Returns the ActiveStreamCheckpointProcessorTask responsible for the
+     * given vbucket. A vbucket always maps to the same task, so a stream can
+     * only ever be queued (and processed) by one task at a time.
+     */
+    ActiveStreamCheckpointProcessorTask& getCheckpointProcessorTask(
+            uint16_t vbid) const;
+
     struct {
         rel_time_t sendTime;
         uint32_t opaque;
@@ -317,7 +337,10 @@ protected:
     std::atomic<size_t> itemsSent;
     std::atomic<size_t> totalBytesSent;
 
-    ExTask checkpointCreatorTask;
+    // Streams are sharded across these tasks by vbucket so that the
+    // checkpoint processing of a producer with many streams can make use of
+    // more than one thread.
+    std::vector<ExTask> checkpointCreatorTasks;
     static const std::chrono::seconds defaultDcpNoopTxInterval;
 
     // Indicates whether the active streams belonging to the DcpProducer should
@@ -439,21 +439,33 @@ public:
                              IncludeValue includeVal,
                              IncludeXattrs includeXattrs,
                              uint8_t _collectionLen,
-                             ExtendedMetaData* e = NULL)
+                             ExtendedMetaData* e = NULL,
+                             bool _compressedByStream = false)
         : MutationResponse(item,
                            opaque,
                            includeVal,
                            includeXattrs,
                            e),
-          collectionLen(_collectionLen) {
+          collectionLen(_collectionLen),
+          compressedByStream(_compressedByStream) {
     }
 
     uint8_t getCollectionLen() const {
         return collectionLen;
     }
 
+    /**
+     * @return true if the stream already attempted to compress the value
+     *         (so the item's datatype is final), in which case the
+     *         producer need not try again.
+     */
+    bool isCompressedByStream() const {
+        return compressedByStream;
+    }
+
 private:
     uint8_t collectionLen;
+    bool compressedByStream;
 };
 
 /**
@@ -23,6 +23,7 @@
 #include "dcp/backfill-manager.h"
 #include "dcp/backfill.h"
 #include "dcp/consumer.h"
+#include "dcp/dcpconnmap.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
 #include "dcp/stream.h"
@@ -471,12 +472,17 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
     }
 
     if (itm->shouldReplicate()) {
+        // Build the response (which may compress the value) before taking
+        // streamMutex, so the front-end threads stepping the stream don't
+        // have to wait for the compression
+        queued_item qi(std::move(itm));
+        std::unique_ptr<DcpResponse> resp(makeResponseFromItem(qi));
+
         std::unique_lock<std::mutex> lh(streamMutex);
         if (isBackfilling()) {
-            queued_item qi(std::move(itm));
-            std::unique_ptr<DcpResponse> resp(makeResponseFromItem(qi));
             if (!producer->recordBackfillManagerBytesRead(
                         resp->getApproximateSize(), force)) {
+                lh.unlock();
                 // Deleting resp may also delete itm (which is owned by resp)
                 resp.reset();
                 return false;
@@ -976,6 +982,33 @@ std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
         queued_item& item) {
     if (item->getOperation() != queue_op::system_event) {
         auto cKey = Collections::DocKey::make(item->getKey(), currentSeparator);
+        // Compress the value here, on the checkpoint processor or backfill
+        // task, rather than on the front-end thread in DcpProducer::step.
+        // The value must be sent whole (nothing for step to prune), and the
+        // compressed copy is shared with any other stream sending the item.
+        const bool compress =
+                isCompressionEnabled() && !item->isDeleted() &&
+                item->getNBytes() > 0 &&
+                !mcbp::datatype::is_snappy(item->getDataType()) &&
+                includeValue == IncludeValue::Yes &&
+                (includeXattributes == IncludeXattrs::Yes ||
+                 !mcbp::datatype::is_xattr(item->getDataType()));
+        if (compress) {
+            auto compressed =
+                    engine->getDcpConnMap()
+                            .getCompressedValueCache()
+                            .getCompressed(item,
+                                           engine->getDcpConnMap()
+                                                   .getMinCompressionRatio());
+            return std::make_unique<MutationProducerResponse>(
+                    compressed,
+                    opaque_,
+                    includeValue,
+                    includeXattributes,
+                    cKey.getCollectionLen(),
+                    nullptr,
+                    true);
+        }
         return std::make_unique<MutationProducerResponse>(
                 item,
                 opaque_,
@@ -545,6 +545,18 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             size_t value = std::stoull(valz);
             getConfiguration().setNumNonioThreads(value);
             ExecutorPool::get()->setNumNonIO(value);
+        } else if (strcmp(keyz, "io_frontend_reserved_pcnt") == 0) {
+            size_t value = std::stoull(valz);
+            getConfiguration().setIoFrontendReservedPcnt(value);
+            ExecutorPool::get()->setFrontEndReservedPcnt(value);
+        } else if (strcmp(keyz, "io_replication_weight") == 0) {
+            size_t value = std::stoull(valz);
+            getConfiguration().setIoReplicationWeight(value);
+            ExecutorPool::get()->setIOClassWeight(IOClass::Replication, value);
+        } else if (strcmp(keyz, "io_background_weight") == 0) {
+            size_t value = std::stoull(valz);
+            getConfiguration().setIoBackgroundWeight(value);
+            ExecutorPool::get()->setIOClassWeight(IOClass::Background, value);
         } else if (strcmp(keyz, "bfilter_enabled") == 0) {
             getConfiguration().setBfilterEnabled(cb_stob(valz));
         } else if (strcmp(keyz, "bfilter_residency_threshold") == 0) {
@@ -643,6 +655,17 @@ protocol_binary_response_status EventuallyPersistentEngine::setDcpParam(
             validate(v, size_t(1), std::numeric_limits<size_t>::max());
             getConfiguration().setDcpConsumerProcessBufferedMessagesBatchSize(
                     v);
+        } else if (strcmp(keyz, "dcp_consumer_processor_tasks") == 0) {
+            size_t v = atoi(valz);
+            checkNumeric(valz);
+            validate(v, size_t(1), size_t(64));
+            getConfiguration().setDcpConsumerProcessorTasks(v);
+        } else if (strcmp(keyz, "dcp_producer_checkpoint_processor_tasks") ==
+                   0) {
+            size_t v = atoi(valz);
+            checkNumeric(valz);
+            validate(v, size_t(1), size_t(64));
+            getConfiguration().setDcpProducerCheckpointProcessorTasks(v);
         } else {
             msg = "Unknown config param";
             rv = PROTOCOL_BINARY_RESPONSE_KEY_ENOENT;
@@ -1287,6 +1310,19 @@ static ENGINE_ERROR_CODE EvpDcpStep(ENGINE_HANDLE* handle,
     return ENGINE_DISCONNECT;
 }
 
+static ENGINE_ERROR_CODE EvpDcpStepBatch(
+        ENGINE_HANDLE* handle,
+        const void* cookie,
+        struct dcp_message_producers* producers,
+        size_t max_messages) {
+    auto engine = acquireEngine(handle);
+    ConnHandler* conn = engine->getConnHandler(cookie);
+    if (conn) {
+        return conn->stepBatch(producers, max_messages);
+    }
+    return ENGINE_DISCONNECT;
+}
+
 static ENGINE_ERROR_CODE EvpDcpOpen(ENGINE_HANDLE* handle,
                                     const void* cookie,
                                     uint32_t opaque,
@@ -1741,6 +1777,7 @@ EventuallyPersistentEngine::EventuallyPersistentEngine(
     ENGINE_HANDLE_V1::get_engine_vb_map = EvpGetClusterConfig;
 
     ENGINE_HANDLE_V1::dcp.step = EvpDcpStep;
+    ENGINE_HANDLE_V1::dcp.step_batch = EvpDcpStepBatch;
     ENGINE_HANDLE_V1::dcp.open = EvpDcpOpen;
     ENGINE_HANDLE_V1::dcp.add_stream = EvpDcpAddStream;
     ENGINE_HANDLE_V1::dcp.close_stream = EvpDcpCloseStream;
@@ -1932,6 +1969,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
         dcpFlowControlManager_ = new DcpFlowControlManagerDynamic(*this);
     } else if (!flowCtlPolicy.compare("aggressive")) {
         dcpFlowControlManager_ = new DcpFlowControlManagerAggressive(*this);
+    } else if (!flowCtlPolicy.compare("adaptive")) {
+        dcpFlowControlManager_ = new DcpFlowControlManagerAdaptive(*this);
     } else {
         /* Flow control is not enabled */
         dcpFlowControlManager_ = new DcpFlowControlManager(*this);
@@ -3276,6 +3315,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doSchedulerStats(const void
                         stats.schedulingHisto[static_cast<int>(id)],
                         add_stat, cookie);
     }
+    for (size_t c = 0; c < size_t(IOClass::COUNT); c++) {
+        add_casted_stat(("ioclass_" + to_string(IOClass(c))).c_str(),
+                        stats.ioClassSchedulingHisto[c],
+                        add_stat, cookie);
+    }
 
     return ENGINE_SUCCESS;
 }
@@ -3289,6 +3333,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doRunTimeStats(const void
                         stats.taskRuntimeHisto[static_cast<int>(id)],
                         add_stat, cookie);
     }
+    for (size_t c = 0; c < size_t(IOClass::COUNT); c++) {
+        add_casted_stat(("ioclass_" + to_string(IOClass(c))).c_str(),
+                        stats.ioClassRuntimeHisto[c],
+                        add_stat, cookie);
+    }
 
     return ENGINE_SUCCESS;
 }
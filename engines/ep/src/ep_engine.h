@@ -30,6 +30,7 @@
 #include <platform/processclock.h>
 
 #include <string>
+#include <vector>
 
 class StoredValue;
 class DcpConnMap;
@@ -303,6 +304,25 @@ public:
         }
     }
 
+    /**
+     * Notify the completion of a number of io operations in one go; the
+     * front end wakes up each of the threads serving the connections once
+     * (rather than once per cookie).
+     *
+     * @param completions the (non-NULL) cookies and the status of their io
+     *                    operation
+     */
+    void notifyIOComplete(const std::vector<cb::IoCompletion>& completions) {
+        if (completions.empty()) {
+            return;
+        }
+        BlockTimer bt(&stats.notifyIOHisto);
+        EventuallyPersistentEngine *epe = ObjectRegistry::onSwitchThread(NULL, true);
+        serverApi->cookie->notify_io_complete_batch(completions.data(),
+                                                    completions.size());
+        ObjectRegistry::onSwitchThread(epe);
+    }
+
     ENGINE_ERROR_CODE reserveCookie(const void *cookie);
     ENGINE_ERROR_CODE releaseCookie(const void *cookie);
 
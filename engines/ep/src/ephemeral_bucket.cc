@@ -27,6 +27,8 @@
 
 #include <platform/sized_buffer.h>
 
+#include <algorithm>
+
 /**
  * A configuration value changed listener that responds to Ephemeral bucket
  * parameter changes.
@@ -98,10 +100,21 @@ EphemeralBucket::EphemeralBucket(EventuallyPersistentEngine& theEngine)
              that we are going to use like NRU, FIFO etc. */
     eviction_policy = VALUE_ONLY;
 
-    // Create tombstone purger task; it will later be scheduled as necessary
-    // in initialize().
-    tombstonePurgerTask =
-            std::make_shared<EphTombstoneHTCleaner>(&engine, *this);
+    // Create tombstone purger tasks; they will later be scheduled as
+    // necessary in initialize().
+    auto& config = engine.getConfiguration();
+    // Every partition of the vBuckets needs at least one vBucket
+    const size_t numPurgerTasks =
+            std::min(config.getEphemeralMetadataPurgeTasks(),
+                     config.getMaxVbuckets());
+    tombstonePurgeProgress = std::make_unique<EphTombstonePurgeProgress>(
+            numPurgerTasks,
+            std::chrono::milliseconds(
+                    config.getEphemeralMetadataPurgeChunkDuration()));
+    for (size_t partition = 0; partition < numPurgerTasks; ++partition) {
+        tombstonePurgerTasks.push_back(std::make_shared<EphTombstoneHTCleaner>(
+                &engine, *this, *tombstonePurgeProgress, partition));
+    }
 
     replicationThrottle = std::make_unique<ReplicationThrottleEphe>(
             engine.getConfiguration(), stats);
@@ -153,10 +166,12 @@ void EphemeralBucket::attemptToFreeMemory() {
         wakeUpExpiryPager();
     }
 
-    // Additionally, wake up the tombstone purger to scan for and remove any
+    // Additionally, wake up the tombstone purgers to scan for and remove any
     // tombstones in the HashTable / sequence list.
-    if (tombstonePurgerTask->getState() == TASK_SNOOZED) {
-        ExecutorPool::get()->wake(tombstonePurgerTask->getId());
+    for (auto& task : tombstonePurgerTasks) {
+        if (task->getState() == TASK_SNOOZED) {
+            ExecutorPool::get()->wake(task->getId());
+        }
     }
 }
 
@@ -222,12 +237,16 @@ RollbackResult EphemeralBucket::doRollback(uint16_t vbid,
 }
 
 void EphemeralBucket::enableTombstonePurgerTask() {
-    ExecutorPool::get()->cancel(tombstonePurgerTask->getId());
-    ExecutorPool::get()->schedule(tombstonePurgerTask);
+    for (auto& task : tombstonePurgerTasks) {
+        ExecutorPool::get()->cancel(task->getId());
+        ExecutorPool::get()->schedule(task);
+    }
 }
 
 void EphemeralBucket::disableTombstonePurgerTask() {
-    ExecutorPool::get()->cancel(tombstonePurgerTask->getId());
+    for (auto& task : tombstonePurgerTasks) {
+        ExecutorPool::get()->cancel(task->getId());
+    }
 }
 
 void EphemeralBucket::reconfigureForEphemeral(Configuration& config) {
@@ -319,6 +338,8 @@ void EphemeralBucket::appendAggregatedVBucketStats(VBucketCountVisitor& active,
     ARP_STAT("seqlist_stale_metadata_bytes", seqlistStaleMetadataBytes);
 
 #undef ARP_STAT
+
+    tombstonePurgeProgress->addStats(add_stat, cookie);
 }
 
 EphemeralBucket::NotifyHighPriorityReqTask::NotifyHighPriorityReqTask(
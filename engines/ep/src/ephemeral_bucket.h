@@ -19,6 +19,7 @@
 #include "kv_bucket.h"
 
 /* Forward declarations */
+class EphTombstonePurgeProgress;
 class RollbackResult;
 
 /**
@@ -134,8 +135,12 @@ protected:
 
     // Protected member variables /////////////////////////////////////////////
 
-    /// Task responsible for purging in-memory tombstones.
-    ExTask tombstonePurgerTask;
+    /// Progress of the tombstone purger tasks, shared between them.
+    std::unique_ptr<EphTombstonePurgeProgress> tombstonePurgeProgress;
+
+    /// Tasks responsible for purging in-memory tombstones; one per partition
+    /// of the vBuckets.
+    std::vector<ExTask> tombstonePurgerTasks;
 
 private:
     /**
@@ -23,11 +23,126 @@
 #include "ephemeral_bucket.h"
 #include "ephemeral_vb.h"
 #include "seqlist.h"
+#include "statwriter.h"
 
+#include <algorithm>
 #include <climits>
+#include <stdexcept>
+#include <string>
+
+EphTombstonePurgeProgress::EphTombstonePurgeProgress(
+        size_t numPartitions, std::chrono::milliseconds chunkDuration)
+    : chunkDurationMs(chunkDuration.count()),
+      itemsMarkedStale(0),
+      itemsDeleted(0),
+      deleterRunTimeUs(0),
+      backlog(numPartitions) {
+    if (numPartitions == 0) {
+        throw std::invalid_argument(
+                "EphTombstonePurgeProgress: numPartitions must be non-zero");
+    }
+    for (auto& b : backlog) {
+        b.store(0);
+    }
+}
+
+std::chrono::milliseconds EphTombstonePurgeProgress::getChunkDuration(
+        std::chrono::milliseconds maxDuration) const {
+    // The configured duration may have been lowered since we last adapted.
+    return std::min(std::chrono::milliseconds(chunkDurationMs.load()),
+                    maxDuration);
+}
+
+void EphTombstonePurgeProgress::chunkCompleted(
+        ProcessClock::duration runTime,
+        ProcessClock::duration lockWaitTime,
+        size_t markedStale,
+        std::chrono::milliseconds maxDuration) {
+    itemsMarkedStale.fetch_add(markedStale);
+
+    const size_t maxMs = std::max(maxDuration.count(),
+                                  std::chrono::milliseconds::rep(1));
+    const bool contended =
+            runTime.count() > 0 &&
+            double(lockWaitTime.count()) / runTime.count() >
+                    maxLockWaitFraction;
+
+    // Other partitions may be adapting concurrently; each completed chunk
+    // gets to apply its adjustment to whatever the current value is.
+    size_t current = chunkDurationMs.load();
+    size_t desired;
+    do {
+        if (contended) {
+            desired = std::min(std::max(current / 2, size_t(1)), maxMs);
+        } else {
+            desired = std::min(current + 1, maxMs);
+        }
+    } while (!chunkDurationMs.compare_exchange_weak(current, desired));
+}
+
+void EphTombstonePurgeProgress::deleterCompleted(size_t partition,
+                                                 ProcessClock::duration runTime,
+                                                 size_t deleted,
+                                                 size_t remaining) {
+    itemsDeleted.fetch_add(deleted);
+    deleterRunTimeUs.fetch_add(
+            std::chrono::duration_cast<std::chrono::microseconds>(runTime)
+                    .count());
+    backlog.at(partition).store(remaining);
+}
+
+void EphTombstonePurgeProgress::addStats(ADD_STAT add_stat,
+                                         const void* cookie) const {
+    size_t totalBacklog = 0;
+    for (const auto& b : backlog) {
+        totalBacklog += b.load();
+    }
+
+    const size_t deleted = itemsDeleted.load();
+    const uint64_t runTimeUs = deleterRunTimeUs.load();
+    const uint64_t itemsPerSec =
+            runTimeUs ? uint64_t(deleted) * 1000000 / runTimeUs : 0;
+
+    add_casted_stat("ep_ephemeral_purge_backlog", totalBacklog, add_stat,
+                    cookie);
+    add_casted_stat("ep_ephemeral_purge_chunk_duration",
+                    chunkDurationMs.load(), add_stat, cookie);
+    add_casted_stat("ep_ephemeral_purge_items_deleted", deleted, add_stat,
+                    cookie);
+    add_casted_stat("ep_ephemeral_purge_items_marked_stale",
+                    itemsMarkedStale.load(), add_stat, cookie);
+    add_casted_stat("ep_ephemeral_purge_items_per_sec", itemsPerSec, add_stat,
+                    cookie);
+}
+
+VBucketFilter EphTombstoneHTCleaner::makePartitionFilter(size_t maxVBuckets,
+                                                         size_t numPartitions,
+                                                         size_t partition) {
+    // An empty filter accepts every vBucket, so a partition without any
+    // vBuckets would purge all of them
+    if (partition >= numPartitions || partition >= maxVBuckets) {
+        throw std::invalid_argument(
+                "EphTombstoneHTCleaner::makePartitionFilter: partition " +
+                std::to_string(partition) + " has no vBuckets (partitions:" +
+                std::to_string(numPartitions) + ", max vBuckets:" +
+                std::to_string(maxVBuckets) + ")");
+    }
+
+    std::set<uint16_t> vbids;
+    if (numPartitions > 1) {
+        for (size_t vbid = partition; vbid < maxVBuckets;
+             vbid += numPartitions) {
+            vbids.insert(uint16_t(vbid));
+        }
+    }
+    return VBucketFilter(std::move(vbids));
+}
 
 EphemeralVBucket::HTTombstonePurger::HTTombstonePurger(rel_time_t purgeAge)
-    : now(ep_current_time()), purgeAge(purgeAge), numPurgedItems(0) {
+    : now(ep_current_time()),
+      purgeAge(purgeAge),
+      numPurgedItems(0),
+      lockWaitTime(ProcessClock::duration::zero()) {
 }
 
 void EphemeralVBucket::HTTombstonePurger::setDeadline(
@@ -48,8 +163,16 @@ bool EphemeralVBucket::HTTombstonePurger::visit(
         // to being owned by the sequence list.
         auto ownedSV = vbucket->ht.unlocked_release(hbl, v.getKey());
         {
-            std::lock_guard<std::mutex> listWriteLg(
-                    vbucket->seqList->getListWriteLock());
+            // Record how long front-end operations (which also need the
+            // list lock) hold us up; it is used to adapt the chunk duration.
+            auto& listWriteLock = vbucket->seqList->getListWriteLock();
+            if (!listWriteLock.try_lock()) {
+                auto waitStart = ProcessClock::now();
+                listWriteLock.lock();
+                lockWaitTime += ProcessClock::now() - waitStart;
+            }
+            std::lock_guard<std::mutex> listWriteLg(listWriteLock,
+                                                    std::adopt_lock);
             // Mark the item stale, with no replacement item
             vbucket->seqList->markItemStale(
                     listWriteLg, std::move(ownedSV), nullptr);
@@ -67,17 +190,26 @@ bool EphemeralVBucket::HTTombstonePurger::visit(
 void EphemeralVBucket::HTTombstonePurger::clearStats() {
     numVisitedItems = 0;
     numPurgedItems = 0;
+    lockWaitTime = ProcessClock::duration::zero();
 }
 
-EphTombstoneHTCleaner::EphTombstoneHTCleaner(EventuallyPersistentEngine* e,
-                                             EphemeralBucket& bucket)
+EphTombstoneHTCleaner::EphTombstoneHTCleaner(
+        EventuallyPersistentEngine* e,
+        EphemeralBucket& bucket,
+        EphTombstonePurgeProgress& progress,
+        size_t partition)
     : GlobalTask(e,
                  TaskId::EphTombstoneHTCleaner,
                  e->getConfiguration().getEphemeralMetadataPurgeInterval(),
                  false),
       bucket(bucket),
+      progress(progress),
+      vbFilter(makePartitionFilter(e->getConfiguration().getMaxVbuckets(),
+                                   progress.getNumPartitions(),
+                                   partition)),
       bucketPosition(bucket.endPosition()),
-      staleItemDeleterTask(std::make_shared<EphTombstoneStaleItemDeleter>(e)) {
+      staleItemDeleterTask(std::make_shared<EphTombstoneStaleItemDeleter>(
+              e, progress, partition, vbFilter)) {
     ExecutorPool::get()->schedule(staleItemDeleterTask);
 }
 
@@ -88,7 +220,8 @@ bool EphTombstoneHTCleaner::run() {
     if (bucketPosition == bucket.endPosition()) {
         prAdapter = std::make_unique<PauseResumeVBAdapter>(
                 std::make_unique<EphemeralVBucket::HTTombstonePurger>(
-                        getDeletedPurgeAge()));
+                        getDeletedPurgeAge()),
+                vbFilter);
         bucketPosition = bucket.startPosition();
 
         LOG(EXTENSION_LOG_NOTICE /*INFO*/,
@@ -107,6 +240,11 @@ bool EphTombstoneHTCleaner::run() {
     bucketPosition = bucket.pauseResumeVisit(*prAdapter, bucketPosition);
     auto end = ProcessClock::now();
 
+    progress.chunkCompleted(end - start,
+                            visitor.getLockWaitTime(),
+                            visitor.getNumItemsMarkedStale(),
+                            getMaxChunkDuration());
+
     // Check if the visitor completed a full pass.
     bool completed = (bucketPosition == bucket.endPosition());
 
@@ -141,6 +279,10 @@ cb::const_char_buffer EphTombstoneHTCleaner::getDescription() {
 }
 
 std::chrono::milliseconds EphTombstoneHTCleaner::getChunkDuration() const {
+    return progress.getChunkDuration(getMaxChunkDuration());
+}
+
+std::chrono::milliseconds EphTombstoneHTCleaner::getMaxChunkDuration() const {
     return std::chrono::milliseconds(
             engine->getConfiguration().getEphemeralMetadataPurgeChunkDuration());
 }
@@ -167,10 +309,13 @@ EphTombstoneHTCleaner::getPurgerVisitor() {
  */
 class EphemeralVBucket::StaleItemDeleter : public VBucketVisitor {
 public:
-    StaleItemDeleter() {
+    StaleItemDeleter(const VBucketFilter& filter) : VBucketVisitor(filter) {
     }
 
     void visitBucket(VBucketPtr& vb) override {
+        if (!vBucketFilter(vb->getId())) {
+            return;
+        }
         auto* vbucket = dynamic_cast<EphemeralVBucket*>(vb.get());
         if (!vbucket) {
             throw std::invalid_argument(
@@ -178,20 +323,36 @@ public:
                     "non-Ephemeral bucket");
         }
         numItemsDeleted += vbucket->purgeStaleItems();
+        // Anything left could not be purged yet (e.g. it is within an
+        // in-flight range read).
+        numItemsRemaining += vbucket->seqList->getNumStaleItems();
     }
 
     size_t getNumItemsDeleted() const {
         return numItemsDeleted;
     }
 
+    size_t getNumItemsRemaining() const {
+        return numItemsRemaining;
+    }
+
 protected:
     /// Count of how many items have been deleted for all visited vBuckets.
     size_t numItemsDeleted = 0;
+
+    /// Count of stale items left in the visited vBuckets.
+    size_t numItemsRemaining = 0;
 };
 
 EphTombstoneStaleItemDeleter::EphTombstoneStaleItemDeleter(
-        EventuallyPersistentEngine* e)
-    : GlobalTask(e, TaskId::EphTombstoneStaleItemDeleter, INT_MAX, false) {
+        EventuallyPersistentEngine* e,
+        EphTombstonePurgeProgress& progress,
+        size_t partition,
+        VBucketFilter vbFilter)
+    : GlobalTask(e, TaskId::EphTombstoneStaleItemDeleter, INT_MAX, false),
+      progress(progress),
+      partition(partition),
+      vbFilter(std::move(vbFilter)) {
 }
 
 bool EphTombstoneStaleItemDeleter::run() {
@@ -199,10 +360,15 @@ bool EphTombstoneStaleItemDeleter::run() {
 
     // Create a StaleItemDeleter, and run across all VBuckets.
     auto start = ProcessClock::now();
-    EphemeralVBucket::StaleItemDeleter deleter;
+    EphemeralVBucket::StaleItemDeleter deleter(vbFilter);
     engine->getKVBucket()->visit(deleter);
     auto end = ProcessClock::now();
 
+    progress.deleterCompleted(partition,
+                              end - start,
+                              deleter.getNumItemsDeleted(),
+                              deleter.getNumItemsRemaining());
+
     auto duration_ms =
             std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
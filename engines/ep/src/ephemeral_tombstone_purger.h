@@ -60,6 +60,13 @@
  * existing item. As such, EphTombstoneStaleItemDeleter task deletes stale
  * items created in both situations, and isn't strictly limited to purging
  * tombstones.
+ *
+ * To keep up with heavy delete churn, the vBuckets can be split into
+ * ephemeral_metadata_purge_tasks partitions (by vbid modulo the number of
+ * partitions), each with its own pair of tasks. All the partitions share an
+ * EphTombstonePurgeProgress which tracks their progress for stats, and adapts
+ * how long each HT cleaner chunk runs for to the contention it sees with
+ * front-end operations.
  */
 #pragma once
 
@@ -70,9 +77,88 @@
 #include "progress_tracker.h"
 #include "vb_visitors.h"
 
+#include <atomic>
+#include <vector>
+
 class EphemeralBucket;
 class EphTombstoneStaleItemDeleter;
 
+/**
+ * Progress of the tombstone purger tasks of an Ephemeral bucket, shared by all
+ * of its partitions.
+ *
+ * Also owns the (adaptive) duration of the HT cleaner chunks: each chunk
+ * reports how long it spent waiting for the sequence list lock held by
+ * front-end operations. If that is a significant part of the chunk, the
+ * purge is slowing the front-end down and the chunk duration is halved;
+ * otherwise it grows back (by 1ms per chunk) up to
+ * ephemeral_metadata_purge_chunk_duration.
+ */
+class EphTombstonePurgeProgress {
+public:
+    EphTombstonePurgeProgress(size_t numPartitions,
+                              std::chrono::milliseconds chunkDuration);
+
+    size_t getNumPartitions() const {
+        return backlog.size();
+    }
+
+    /**
+     * Returns the duration the next HT cleaner chunk should run for.
+     * @param maxDuration the configured (maximum) chunk duration
+     */
+    std::chrono::milliseconds getChunkDuration(
+            std::chrono::milliseconds maxDuration) const;
+
+    /**
+     * Record a completed HT cleaner chunk, and adapt the chunk duration.
+     *
+     * @param runTime how long the chunk ran for
+     * @param lockWaitTime how much of that was spent waiting for front-end
+     *        operations
+     * @param markedStale number of items the chunk marked stale
+     * @param maxDuration the configured (maximum) chunk duration
+     */
+    void chunkCompleted(ProcessClock::duration runTime,
+                        ProcessClock::duration lockWaitTime,
+                        size_t markedStale,
+                        std::chrono::milliseconds maxDuration);
+
+    /**
+     * Record a completed run of the stale item deleter of a partition.
+     *
+     * @param partition the partition the deleter ran for
+     * @param runTime how long the deleter ran for
+     * @param deleted number of stale items deleted
+     * @param remaining number of stale items still in the partition's
+     *        sequence lists (which could not be deleted yet)
+     */
+    void deleterCompleted(size_t partition,
+                          ProcessClock::duration runTime,
+                          size_t deleted,
+                          size_t remaining);
+
+    void addStats(ADD_STAT add_stat, const void* cookie) const;
+
+private:
+    /// Fraction of a chunk which, if spent waiting for front-end operations,
+    /// makes us halve the chunk duration.
+    static constexpr double maxLockWaitFraction = 0.05;
+
+    /// Current chunk duration, in milliseconds.
+    std::atomic<size_t> chunkDurationMs;
+
+    std::atomic<size_t> itemsMarkedStale;
+    std::atomic<size_t> itemsDeleted;
+
+    /// Total time the stale item deleters ran for, in microseconds.
+    std::atomic<uint64_t> deleterRunTimeUs;
+
+    /// Stale items left (to be deleted) by the last deleter run of each
+    /// partition.
+    std::vector<std::atomic<size_t>> backlog;
+};
+
 /**
  * HashTable Tombstone Purger visitor
  *
@@ -104,6 +190,11 @@ public:
         return numPurgedItems;
     }
 
+    /// Return the time spent waiting for the sequence list lock.
+    ProcessClock::duration getLockWaitTime() const {
+        return lockWaitTime;
+    }
+
     void clearStats();
 
 protected:
@@ -126,6 +217,10 @@ protected:
 
     /// Count of how many items have been purged.
     size_t numPurgedItems;
+
+    /// Time spent waiting for the sequence list lock (held by front-end
+    /// operations).
+    ProcessClock::duration lockWaitTime;
 };
 
 /**
@@ -134,17 +229,40 @@ protected:
  */
 class EphTombstoneHTCleaner : public GlobalTask {
 public:
+    /**
+     * @param e the engine
+     * @param bucket the bucket to purge
+     * @param progress progress shared by all the partitions of the bucket
+     * @param partition the partition (of progress.getNumPartitions()) of
+     *        vBuckets this task purges
+     */
     EphTombstoneHTCleaner(EventuallyPersistentEngine* e,
-                          EphemeralBucket& bucket);
+                          EphemeralBucket& bucket,
+                          EphTombstonePurgeProgress& progress,
+                          size_t partition);
 
     bool run() override;
 
     cb::const_char_buffer getDescription() override;
 
+    /**
+     * Returns the filter selecting the vBuckets of the given partition
+     * (those whose vbid modulo numPartitions is the partition); or an empty
+     * (accept-all) filter if there is only one partition.
+     *
+     * @throws std::invalid_argument if the partition would have no vBuckets
+     */
+    static VBucketFilter makePartitionFilter(size_t maxVBuckets,
+                                             size_t numPartitions,
+                                             size_t partition);
+
 private:
     /// How long should each chunk of HT cleaning run for?
     std::chrono::milliseconds getChunkDuration() const;
 
+    /// The configured (maximum) duration of a chunk of HT cleaning.
+    std::chrono::milliseconds getMaxChunkDuration() const;
+
     /// Duration (in seconds) task should sleep for between runs.
     size_t getSleepTime() const;
 
@@ -157,6 +275,12 @@ private:
     /// The bucket we are associated with.
     EphemeralBucket& bucket;
 
+    /// Progress shared with the other partitions.
+    EphTombstonePurgeProgress& progress;
+
+    /// The vBuckets of our partition.
+    const VBucketFilter vbFilter;
+
     /// Opaque marker indicating how far through the KVBucket we have visited.
     KVBucketIface::Position bucketPosition;
 
@@ -179,9 +303,20 @@ private:
  */
 class EphTombstoneStaleItemDeleter : public GlobalTask {
 public:
-    EphTombstoneStaleItemDeleter(EventuallyPersistentEngine* e);
+    EphTombstoneStaleItemDeleter(EventuallyPersistentEngine* e,
+                                 EphTombstonePurgeProgress& progress,
+                                 size_t partition,
+                                 VBucketFilter vbFilter);
 
     bool run() override;
 
     cb::const_char_buffer getDescription() override;
+
+private:
+    EphTombstonePurgeProgress& progress;
+
+    const size_t partition;
+
+    /// The vBuckets of our partition.
+    const VBucketFilter vbFilter;
 };
@@ -21,10 +21,21 @@
 #include "ephemeral_tombstone_purger.h"
 #include "failover-table.h"
 #include "linked_list.h"
+#include "skip_list.h"
 #include "stored_value_factories.h"
 #include "vbucket_bgfetch_item.h"
 #include "vbucketdeletiontask.h"
 
+/* Creates the SequenceList implementation selected by the configuration */
+static std::unique_ptr<SequenceList> makeSequenceList(uint16_t vbid,
+                                                      EPStats& st,
+                                                      Configuration& config) {
+    if (config.getEphemeralSeqlistType() == "skip_list") {
+        return std::make_unique<SkipList>(vbid, st);
+    }
+    return std::make_unique<BasicLinkedList>(vbid, st);
+}
+
 EphemeralVBucket::EphemeralVBucket(id_type i,
                                    vbucket_state_t newState,
                                    EPStats& st,
@@ -61,7 +72,7 @@ EphemeralVBucket::EphemeralVBucket(id_type i,
               0, // Every item in ephemeral has a HLC cas
               mightContainXattrs,
               collectionsManifest),
-      seqList(std::make_unique<BasicLinkedList>(i, st)),
+      seqList(makeSequenceList(i, st, config)),
       backfillType(BackfillType::None) {
     /* Get the flow control policy */
     std::string dcpBackfillType = config.getDcpEphemeralBackfillType();
@@ -163,6 +174,16 @@ void EphemeralVBucket::addStats(bool details,
                 seqList->getStaleValueBytes(),
                 add_stat,
                 c);
+        const auto indexBytes = seqList->getIndexBytes();
+        const auto numSeqListItems = seqList->getNumItems();
+        addStat("seqlist_index_bytes", indexBytes, add_stat, c);
+        /* Bytes each item pays for being ordered: its link in the list and
+           its share of any index over the list */
+        addStat("seqlist_overhead_per_item",
+                (sizeof(OrderedStoredValue) - sizeof(StoredValue)) +
+                        (numSeqListItems ? indexBytes / numSeqListItems : 0),
+                add_stat,
+                c);
     }
 }
 
@@ -273,8 +294,8 @@ EphemeralVBucket::inMemoryBackfill(uint64_t start, uint64_t end) {
 }
 
 boost::optional<SequenceList::RangeIterator>
-EphemeralVBucket::makeRangeIterator(bool isBackfill) {
-    return seqList->makeRangeIterator(isBackfill);
+EphemeralVBucket::makeRangeIterator(bool isBackfill, seqno_t start) {
+    return seqList->makeRangeIterator(isBackfill, start);
 }
 
 /* Vb level backfill queue is for items in a huge snapshot (disk backfill
@@ -134,12 +134,13 @@ public:
      * the SequenceList, new range iterator will not be allowed
      *
      * @param isBackfill indicates if the iterator is for backfill (for debug)
+     * @param start seqno from which the iterator should start
      *
      * @return range iterator object when possible
      *         null when not possible
      */
     boost::optional<SequenceList::RangeIterator> makeRangeIterator(
-            bool isBackfill);
+            bool isBackfill, seqno_t start);
 
     void dump() const override;
 
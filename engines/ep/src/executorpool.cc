@@ -30,6 +30,7 @@
 #include <platform/sysinfo.h>
 #include <algorithm>
 #include <chrono>
+#include <limits>
 #include <queue>
 #include <sstream>
 
@@ -139,6 +140,13 @@ ExecutorPool *ExecutorPool::get(void) {
                                    config.getNumWriterThreads(),
                                    config.getNumAuxioThreads(),
                                    config.getNumNonioThreads());
+            tmp->setFrontEndReservedPcnt(config.getIoFrontendReservedPcnt());
+            tmp->setIOClassWeight(IOClass::Replication,
+                                  config.getIoReplicationWeight());
+            tmp->setIOClassWeight(IOClass::Background,
+                                  config.getIoBackgroundWeight());
+            tmp->setThreadPlacement(cb::to_thread_placement(
+                    config.getExecutorThreadPlacement()));
             ObjectRegistry::onSwitchThread(epe);
             instance.store(tmp);
         }
@@ -160,7 +168,8 @@ ExecutorPool::ExecutorPool(size_t maxThreads, size_t nTaskSets,
                            size_t maxAuxIO,   size_t maxNonIO) :
                   numTaskSets(nTaskSets), totReadyTasks(0),
                   isHiPrioQset(false), isLowPrioQset(false), numBuckets(0),
-                  numSleepers(0) {
+                  numSleepers(0), frontEndReservedPcnt(0),
+                  threadPlacement(cb::ThreadPlacement::None) {
     size_t numCPU = Couchbase::get_available_cpu_count();
     size_t numThreads = (size_t)((numCPU * 3)/4);
     numThreads = (numThreads < EP_MIN_NUM_THREADS) ?
@@ -177,6 +186,17 @@ ExecutorPool::ExecutorPool(size_t maxThreads, size_t nTaskSets,
     numWorkers[READER_TASK_IDX] = maxReaders;
     numWorkers[AUXIO_TASK_IDX] = maxAuxIO;
     numWorkers[NONIO_TASK_IDX] = maxNonIO;
+
+    for (size_t i = 0; i < NUM_TASK_GROUPS; i++) {
+        for (size_t c = 0; c < size_t(IOClass::COUNT); c++) {
+            numReadyTasksByClass[i][c] = 0;
+            curWorkersByClass[i][c] = 0;
+        }
+        curNonFrontEndWorkers[i] = 0;
+    }
+    for (auto& weight : ioClassWeight) {
+        weight = 1;
+    }
 }
 
 ExecutorPool::~ExecutorPool(void) {
@@ -247,22 +267,88 @@ TaskQueue *ExecutorPool::nextTask(ExecutorThread &t, uint8_t tick) {
     return tq;
 }
 
-void ExecutorPool::addWork(size_t newWork, task_type_t qType) {
+void ExecutorPool::addWork(size_t newWork,
+                           task_type_t qType,
+                           IOClass ioClass) {
     if (newWork) {
         totReadyTasks.fetch_add(newWork);
         numReadyTasks[qType].fetch_add(newWork);
+        numReadyTasksByClass[qType][size_t(ioClass)].fetch_add(newWork);
     }
 }
 
-void ExecutorPool::lessWork(task_type_t qType) {
+void ExecutorPool::lessWork(task_type_t qType, IOClass ioClass) {
     if (numReadyTasks[qType].load() == 0) {
         throw std::logic_error("ExecutorPool::lessWork: number of ready "
                 "tasks on qType " + std::to_string(qType) + " is zero");
     }
     numReadyTasks[qType]--;
+    numReadyTasksByClass[qType][size_t(ioClass)]--;
     totReadyTasks--;
 }
 
+bool ExecutorPool::trySleep(task_type_t task_type) {
+    // Sleep if there is nothing ready, or if everything which is ready is
+    // throttled by its IOClass (we are woken by doneWork once a non
+    // front-end slot becomes free).
+    if (!numReadyTasks[task_type] ||
+        (!numReadyTasksByClass[task_type][size_t(IOClass::FrontEnd)] &&
+         isNonFrontEndLimitReached(task_type))) {
+        numSleepers++;
+        return true;
+    }
+    return false;
+}
+
+size_t ExecutorPool::getMaxNonFrontEndWorkers(task_type_t qType) {
+    const size_t workers = numWorkers[qType];
+    if (workers == 0) {
+        // No threads created (yet) for this type - nothing to reserve.
+        return std::numeric_limits<size_t>::max();
+    }
+    const size_t reserved = (workers * frontEndReservedPcnt) / 100;
+    return std::max(size_t(1), workers - std::min(reserved, workers));
+}
+
+bool ExecutorPool::isNonFrontEndLimitReached(task_type_t qType) {
+    return curNonFrontEndWorkers[qType] >= getMaxNonFrontEndWorkers(qType);
+}
+
+bool ExecutorPool::tryStartIOClass(task_type_t qType,
+                                   IOClass ioClass,
+                                   bool force) {
+    if (ioClass != IOClass::FrontEnd) {
+        auto& active = curNonFrontEndWorkers[qType];
+        uint16_t current = active.load();
+        do {
+            if (!force && current >= getMaxNonFrontEndWorkers(qType)) {
+                return false;
+            }
+        } while (!active.compare_exchange_weak(current, current + 1));
+    }
+    ++curWorkersByClass[qType][size_t(ioClass)];
+    return true;
+}
+
+void ExecutorPool::setFrontEndReservedPcnt(size_t pcnt) {
+    if (pcnt > 100) {
+        throw std::invalid_argument(
+                "ExecutorPool::setFrontEndReservedPcnt: pcnt (which is " +
+                std::to_string(pcnt) + ") is greater than 100");
+    }
+    frontEndReservedPcnt = pcnt;
+}
+
+void ExecutorPool::setIOClassWeight(IOClass ioClass, size_t weight) {
+    if (ioClass == IOClass::FrontEnd || ioClass == IOClass::COUNT ||
+        weight == 0) {
+        throw std::invalid_argument(
+                "ExecutorPool::setIOClassWeight: invalid weight " +
+                std::to_string(weight) + " for class " + to_string(ioClass));
+    }
+    ioClassWeight[size_t(ioClass)] = weight;
+}
+
 void ExecutorPool::startWork(task_type_t taskType) {
     if (taskType == NO_TASK_TYPE || taskType == NUM_TASK_GROUPS) {
         throw std::logic_error(
@@ -281,13 +367,25 @@ void ExecutorPool::startWork(task_type_t taskType) {
     }
 }
 
-void ExecutorPool::doneWork(task_type_t taskType) {
+void ExecutorPool::doneWork(task_type_t taskType, IOClass ioClass) {
     if (taskType == NO_TASK_TYPE || taskType == NUM_TASK_GROUPS) {
         throw std::logic_error(
                 "ExecutorPool::doneWork: worker is finishing task with invalid "
                 "type {" + std::to_string(taskType) + "}");
     } else {
         --curWorkers[taskType];
+        --curWorkersByClass[taskType][size_t(ioClass)];
+        if (ioClass != IOClass::FrontEnd) {
+            --curNonFrontEndWorkers[taskType];
+            // A non front-end slot is free again; if other threads went to
+            // sleep because the only ready work was throttled, wake one.
+            const size_t frontEndReady =
+                    numReadyTasksByClass[taskType][size_t(IOClass::FrontEnd)];
+            if (numReadyTasks[taskType] > frontEndReady) {
+                size_t numToWake = 1;
+                getSleepQ(taskType)->doWake(numToWake);
+            }
+        }
         // Record that a thread is done working on a particular queue type
         LOG(EXTENSION_LOG_DEBUG,
             "Done with task type:{%" PRIu32 "} capacity:{%" PRIu16 "}",
@@ -541,7 +639,14 @@ ssize_t ExecutorPool::_adjustWorkers(task_type_t type, size_t desiredNumItems) {
                 threadQ.push_back(new ExecutorThread(
                         this,
                         type,
-                        typeName + "_worker_" + std::to_string(tidx)));
+                        typeName + "_worker_" + std::to_string(tidx),
+                        tidx));
+                // Placed by the process-wide ordinal rather than tidx, so
+                // that thread k of each type (and memcached's worker k)
+                // don't all share a CPU. Threads created together still
+                // alternate between the NUMA nodes.
+                threadQ.back()->setPlacement(cb::CpuTopology::get().getPlacement(
+                        threadPlacement, threadQ.back()->getOrdinal()));
                 threadQ.back()->start();
             }
         } else if (numItems > desiredNumItems) {
@@ -783,6 +888,38 @@ void ExecutorPool::doTaskQStat(EventuallyPersistentEngine *engine,
                 }
             }
         }
+
+        // Per IOClass breakdown of the ready queues and running tasks
+        for (size_t i = 0; i < numTaskSets; i++) {
+            const auto type = static_cast<task_type_t>(i);
+            for (size_t c = 0; c < size_t(IOClass::COUNT); c++) {
+                const auto ioClass = static_cast<IOClass>(c);
+                checked_snprintf(statname, sizeof(statname),
+                                 "ep_workload:%s:%s:OutQsize",
+                                 to_string(type).c_str(),
+                                 to_string(ioClass).c_str());
+                add_casted_stat(statname,
+                                numReadyTasksByClass[i][c].load(),
+                                add_stat,
+                                cookie);
+                checked_snprintf(statname, sizeof(statname),
+                                 "ep_workload:%s:%s:running",
+                                 to_string(type).c_str(),
+                                 to_string(ioClass).c_str());
+                add_casted_stat(statname,
+                                curWorkersByClass[i][c].load(),
+                                add_stat,
+                                cookie);
+            }
+            checked_snprintf(statname, sizeof(statname),
+                             "ep_workload:%s:max_non_frontend",
+                             to_string(type).c_str());
+            add_casted_stat(statname,
+                            std::min(getMaxNonFrontEndWorkers(type),
+                                     size_t(numWorkers[i])),
+                            add_stat,
+                            cookie);
+        }
     } catch (std::exception& error) {
         LOG(EXTENSION_LOG_WARNING,
             "ExecutorPool::doTaskQStat: Failed to build stats: %s",
@@ -854,6 +991,20 @@ static void addWorkerStats(const char *prefix, ExecutorThread *t,
         checked_snprintf(statname, sizeof(statname), "%s:cur_time", prefix);
         add_casted_stat(statname, to_ns_since_epoch(t->getCurTime()).count(),
                         add_stat, cookie);
+
+        const auto boundCpus = t->getBoundCpus();
+        const std::string cpuList =
+                boundCpus.empty() ? "none"
+                                  : cb::CpuTopology::formatCpuList(boundCpus);
+        checked_snprintf(statname, sizeof(statname), "%s:bound_cpus", prefix);
+        add_casted_stat(statname, cpuList.c_str(), add_stat, cookie);
+        const int cpu = t->getLastCpu();
+        checked_snprintf(statname, sizeof(statname), "%s:cpu", prefix);
+        add_casted_stat(statname, cpu, add_stat, cookie);
+        checked_snprintf(statname, sizeof(statname), "%s:node", prefix);
+        add_casted_stat(statname,
+                        cpu < 0 ? -1 : cb::CpuTopology::get().getNode(cpu),
+                        add_stat, cookie);
     } catch (std::exception& error) {
         LOG(EXTENSION_LOG_WARNING,
             "addWorkerStats: Failed to build stats: %s", error.what());
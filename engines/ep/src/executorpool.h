@@ -62,6 +62,25 @@
  * ExecutorPool::snooze(size_t taskId, double toSleep)
  *   The pool's snooze method will locate the task matching taskId and adjust
  *   its wakeTime to account for the toSleep value.
+ *
+ * === I/O QoS classes ===
+ *
+ * Every task has an IOClass (see tasks.def.h). Ready tasks are kept in one
+ * priority-ordered queue per class; front-end tasks are always run first,
+ * and at most (100 - frontEndReservedPcnt)% of the threads of a given type
+ * may run non front-end tasks at any one time, so a share of the threads (and
+ * hence of the outstanding disk operations) is always available to front-end
+ * work. The remaining classes share their threads in proportion to their
+ * weights (setIOClassWeight).
+ *
+ * === Local queues ===
+ *
+ * To reduce contention on the TaskQueue mutex, a thread which picks a
+ * front-end task also moves a few more ready front-end tasks of the same
+ * priority into a local queue (see TaskQueue::LocalQueue), which it works
+ * through before going back to the shared queues. A thread whose own local
+ * queue is empty steals from the other threads' local queues (whose owners
+ * are busy running a task) before going back to the shared queues.
  */
 #ifndef SRC_EXECUTORPOOL_H_
 #define SRC_EXECUTORPOOL_H_ 1
@@ -72,6 +91,9 @@
 #include "task_type.h"
 #include "taskable.h"
 
+#include <memcached/thread_placement.h>
+
+#include <array>
 #include <map>
 #include <set>
 
@@ -87,22 +109,72 @@ typedef std::vector<TaskQueue *> TaskQ;
 class ExecutorPool {
 public:
 
-    void addWork(size_t newWork, task_type_t qType);
+    void addWork(size_t newWork, task_type_t qType, IOClass ioClass);
 
-    void lessWork(task_type_t qType);
+    void lessWork(task_type_t qType, IOClass ioClass);
 
     void startWork(task_type_t taskType);
 
-    void doneWork(task_type_t taskType);
+    void doneWork(task_type_t taskType, IOClass ioClass);
+
+    /**
+     * Account a task of the given class as running on a thread of the given
+     * type. Front-end tasks always succeed; other classes only succeed while
+     * fewer than getMaxNonFrontEndWorkers() threads run non front-end tasks,
+     * unless force is set (used to clean out dead tasks).
+     *
+     * @return true if the task may run, false if it is throttled.
+     */
+    bool tryStartIOClass(task_type_t qType, IOClass ioClass, bool force);
+
+    /**
+     * @return true if all of the threads available to non front-end tasks of
+     *         the given type are busy.
+     */
+    bool isNonFrontEndLimitReached(task_type_t qType);
+
+    /**
+     * @return the maximum number of threads of the given type which may run
+     *         non front-end tasks concurrently.
+     */
+    size_t getMaxNonFrontEndWorkers(task_type_t qType);
+
+    /**
+     * Set the percentage of the threads of each type which is reserved for
+     * front-end (IOClass::FrontEnd) tasks. At least one thread per type is
+     * always left for the other classes.
+     */
+    void setFrontEndReservedPcnt(size_t pcnt);
+
+    size_t getFrontEndReservedPcnt() const {
+        return frontEndReservedPcnt;
+    }
 
-    bool trySleep(task_type_t task_type) {
-        if (!numReadyTasks[task_type]) {
-            numSleepers++;
-            return true;
-        }
-        return false;
+    /**
+     * Set the relative share of the non-reserved threads given to tasks of
+     * the given (non front-end) class.
+     */
+    void setIOClassWeight(IOClass ioClass, size_t weight);
+
+    size_t getIOClassWeight(IOClass ioClass) const {
+        return ioClassWeight[size_t(ioClass)];
     }
 
+    /**
+     * Set how new threads are placed on the CPUs; threads are spread across
+     * the NUMA nodes by their process-wide ordinal. Only affects threads
+     * started afterwards.
+     */
+    void setThreadPlacement(cb::ThreadPlacement placement) {
+        threadPlacement = placement;
+    }
+
+    cb::ThreadPlacement getThreadPlacement() const {
+        return threadPlacement;
+    }
+
+    bool trySleep(task_type_t task_type);
+
     void woke(void) {
         numSleepers--;
     }
@@ -259,6 +331,20 @@ protected:
     std::atomic<uint16_t>* numWorkers; // and limit it to the value set here
     std::atomic<size_t> *numReadyTasks; // number of ready tasks per task set
 
+    template <typename T>
+    using PerIOClass = std::array<std::atomic<T>, size_t(IOClass::COUNT)>;
+
+    // number of ready tasks and active workers per task set and IOClass
+    std::array<PerIOClass<size_t>, NUM_TASK_GROUPS> numReadyTasksByClass;
+    std::array<PerIOClass<uint16_t>, NUM_TASK_GROUPS> curWorkersByClass;
+    // active workers running non front-end tasks per task set
+    std::array<std::atomic<uint16_t>, NUM_TASK_GROUPS> curNonFrontEndWorkers;
+
+    std::atomic<size_t> frontEndReservedPcnt;
+    PerIOClass<size_t> ioClassWeight;
+
+    std::atomic<cb::ThreadPlacement> threadPlacement;
+
     // Set of all known task owners
     std::set<void *> taskOwners;
 
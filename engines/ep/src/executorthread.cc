@@ -20,6 +20,9 @@
 #include <chrono>
 #include <queue>
 
+#include <memcached/thread_placement.h>
+#include <platform/strerror.h>
+
 #include "common.h"
 #include "executorpool.h"
 #include "executorthread.h"
@@ -71,6 +74,21 @@ void ExecutorThread::stop(bool wait) {
 void ExecutorThread::run() {
     LOG(EXTENSION_LOG_DEBUG, "Thread %s running..", getName().c_str());
 
+    if (!placement.empty()) {
+        const auto cpuList = cb::CpuTopology::formatCpuList(placement);
+        if (cb::bindCurrentThread(placement)) {
+            bound = true;
+            // Allocate from this thread's own node (e.g. bg fetched items
+            // for a reader), rather than interleaving across all of them.
+            cb::setLocalMemoryPolicy();
+            LOG(EXTENSION_LOG_INFO, "%s: Bound to CPUs %s", name.c_str(),
+                cpuList.c_str());
+        } else {
+            LOG(EXTENSION_LOG_WARNING, "%s: Failed to bind to CPUs %s: %s",
+                name.c_str(), cpuList.c_str(), cb_strerror().c_str());
+        }
+    }
+
     for (uint8_t tick = 1;; tick++) {
         resetCurrentTask();
 
@@ -81,6 +99,7 @@ void ExecutorThread::run() {
         updateCurrentTime();
         if (TaskQueue *q = manager->nextTask(*this, tick)) {
             manager->startWork(taskType);
+            lastCpu.store(cb::getCurrentCpu(), std::memory_order_relaxed);
             EventuallyPersistentEngine *engine = currentTask->getEngine();
 
             // Not all tasks are associated with an engine, only switch
@@ -90,7 +109,7 @@ void ExecutorThread::run() {
             }
 
             if (currentTask->isdead()) {
-                manager->doneWork(taskType);
+                manager->doneWork(taskType, curIOClass);
                 manager->cancel(currentTask->uid, true);
                 continue;
             }
@@ -166,7 +185,7 @@ void ExecutorThread::run() {
                                      .count()),
                     uint64_t(to_ns_since_epoch(getWaketime()).count()));
             }
-            manager->doneWork(taskType);
+            manager->doneWork(taskType, curIOClass);
         }
     }
     // Thread is about to terminate - disassociate it from any engine.
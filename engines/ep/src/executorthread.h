@@ -23,6 +23,8 @@
 #include "task_type.h"
 #include "tasklogentry.h"
 
+#include <memcached/thread_placement.h>
+
 #include <platform/ring_buffer.h>
 #include <platform/processclock.h>
 #include <relaxed_atomic.h>
@@ -85,19 +87,55 @@ public:
         ProcessClock::time_point timepoint;
     };
 
-    ExecutorThread(ExecutorPool* m, task_type_t type, const std::string nm)
+    /**
+     * @param m the pool the thread belongs to
+     * @param type the type of tasks the thread runs
+     * @param nm the name of the thread
+     * @param idx the index of the thread amongst those of its type
+     */
+    ExecutorThread(ExecutorPool* m,
+                   task_type_t type,
+                   const std::string nm,
+                   size_t idx = 0)
         : manager(m),
           taskType(type),
           name(nm),
+          index(idx),
+          ordinal(cb::acquireThreadOrdinal()),
           state(EXECUTOR_RUNNING),
           now(ProcessClock::now()),
           waketime(ProcessClock::time_point::max()),
           taskStart(),
-          currentTask(NULL) {
+          currentTask(NULL),
+          curIOClass(IOClass::FrontEnd) {
     }
 
     ~ExecutorThread() {
         LOG(EXTENSION_LOG_INFO, "Executor killing %s", name.c_str());
+        cb::releaseThreadOrdinal(ordinal);
+    }
+
+    /// @returns the process-wide ordinal the thread is placed by.
+    size_t getOrdinal() const {
+        return ordinal;
+    }
+
+    /**
+     * Set the CPUs the thread should bind itself to when it starts; by
+     * default it is not bound. Must be called before start().
+     */
+    void setPlacement(std::vector<int> cpus) {
+        placement = std::move(cpus);
+    }
+
+    /// @returns the CPUs the thread is bound to (empty if it isn't bound).
+    std::vector<int> getBoundCpus() const {
+        return bound ? placement : std::vector<int>();
+    }
+
+    /// @returns the CPU the thread was last seen running on.
+    int getLastCpu() const {
+        return lastCpu.load(std::memory_order_relaxed);
     }
 
     void start(void);
@@ -122,6 +160,10 @@ public:
 
     const std::string& getName() const { return name; }
 
+    size_t getIndex() const {
+        return index;
+    }
+
     cb::const_char_buffer getTaskName();
 
     const std::string getTaskableName();
@@ -174,8 +216,16 @@ protected:
     ExecutorPool *manager;
     task_type_t taskType;
     const std::string name;
+    const size_t index;
+    // Reserved for the lifetime of the thread (see cb::acquireThreadOrdinal)
+    const size_t ordinal;
     std::atomic<executor_state_t> state;
 
+    // CPUs to bind to when the thread starts, and whether it succeeded
+    std::vector<int> placement;
+    std::atomic<bool> bound{false};
+    std::atomic<int> lastCpu{-1};
+
     // record of current time
     AtomicProcessTime now;
     // record of the earliest time the task can be woken-up
@@ -184,6 +234,8 @@ protected:
 
     std::mutex currentTaskMutex; // Protects currentTask
     ExTask currentTask;
+    // IOClass the current task was accounted against when it was fetched
+    IOClass curIOClass;
 
     std::mutex logMutex;
     cb::RingBuffer<TaskLogEntry, TASK_LOG_SIZE> tasklog;
@@ -189,7 +189,7 @@ public:
 
     ProcessClock::time_point completeCurrentTask() {
         auto min_waketime = ProcessClock::time_point::min();
-        manager->doneWork(taskType);
+        manager->doneWork(taskType, curIOClass);
         if (rescheduled && !currentTask->isdead()) {
             min_waketime = queue.reschedule(currentTask);
         } else {
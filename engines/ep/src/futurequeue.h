@@ -22,45 +22,102 @@
  *
  * FutureQueue provides methods that allow a task's wakeTime to be mutated
  * whilst maintaining the priority ordering.
+ *
+ * It is implemented as a hierarchical timer wheel, so that the frequent
+ * snooze / wake of tasks doesn't need a search and re-heapify of every queued
+ * task:
+ *
+ * - Level L of the wheel has 2^SlotBits slots, each covering
+ *   2^(ResolutionBits + L * SlotBits) ns. A task is placed at the lowest
+ *   level at which its wakeTime falls in the same slot of the level above as
+ *   the wheel's cursor; i.e. near-future tasks are in small slots, far-future
+ *   ones in big slots.
+ * - When the lower levels run out of tasks, the cursor moves to the next
+ *   occupied slot of a higher level and that slot's tasks are cascaded down.
+ *   Occupied slots are tracked in a bitmap per level, so finding the next one
+ *   is constant time.
+ * - A task due before every queued task moves the cursor back to it, so a
+ *   cursor which ran ahead of the present (to the next far-future task)
+ *   doesn't leave all the nearer tasks queued after that outside the wheel.
+ *   Other tasks whose wakeTime is before the cursor (typically just woken)
+ *   are kept in an "expired" slot, and those beyond the top level in an
+ *   "overflow" slot.
+ * - Each slot is ordered by wakeTime, so top() is exact; and every queued
+ *   task is indexed by id, so it can be found and moved without a search.
  */
 
 #pragma once
 
+#include <platform/processclock.h>
+
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
 #include <mutex>
-#include <platform/processclock.h>
-#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "globaltask.h"
 
-template <class C = std::deque<ExTask>,
-          class Compare = CompareByDueDate>
+template <size_t SlotBits = 6, size_t Levels = 4, size_t ResolutionBits = 20>
 class FutureQueue {
 public:
 
     void push(ExTask task) {
         std::lock_guard<std::mutex> lock(queueMutex);
-        queue.push(task);
+        insert(std::move(task));
     }
 
     void pop() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        queue.pop();
+        auto& slot = headSlot();
+        erase(slot.level, slot.index, slot.entries.begin());
     }
 
     ExTask top() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.top();
+        return headSlot().entries.begin()->second;
     }
 
     size_t size() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.size();
+        return count;
     }
 
     bool empty() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.empty();
+        return count == 0;
+    }
+
+    /**
+     * Pop all the tasks whose wakeTime is no later than 'now' (in wakeTime
+     * order), appending them to 'out'.
+     * @returns the number of tasks popped.
+     */
+    template <class Container>
+    size_t popExpired(ProcessClock::time_point now, Container& out) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        const int64_t nowKey = toKey(now);
+        size_t popped = 0;
+        while (count) {
+            auto& slot = headSlot();
+            auto it = slot.entries.begin();
+            if (it->first > nowKey) {
+                break;
+            }
+            out.push_back(it->second);
+            erase(slot.level, slot.index, it);
+            ++popped;
+        }
+        return popped;
     }
 
     /*
@@ -71,8 +128,7 @@ public:
     bool updateWaketime(const ExTask& task, ProcessClock::time_point newTime) {
         std::lock_guard<std::mutex> lock(queueMutex);
         task->updateWaketime(newTime);
-        // After modifiying the task's wakeTime, rebuild the heap
-        return queue.heapify(task);
+        return requeue(task);
     }
 
     /*
@@ -83,55 +139,307 @@ public:
     bool snooze(const ExTask& task, const double secs) {
         std::lock_guard<std::mutex> lock(queueMutex);
         task->snooze(secs);
-        // After modifiying the task's wakeTime, rebuild the heap
-        return queue.heapify(task);
+        return requeue(task);
     }
 
 protected:
+    static_assert(SlotBits > 0 && SlotBits <= 6,
+                  "FutureQueue: a level's occupancy must fit in 64 bits");
+    static_assert(ResolutionBits + (Levels + 1) * SlotBits < 63,
+                  "FutureQueue: wheel covers more than the range of a key");
 
-    /*
-     * HeapifiableQueue exposes a method to maintain the heap ordering
-     * of the underlying queue.
-     *
-     * This class is deliberately hidden inside FutureQueue so that any
-     * extensions made to priority_queue can't be accessed without work.
-     * I.e. correct locking and any need to 'heapify'.
+    static const size_t numSlots = size_t(1) << SlotBits;
+    // Pseudo-levels for the slots outside of the wheel.
+    static const int expiredLevel = -1;
+    static const int overflowLevel = int(Levels);
+
+    /// A slot of tasks, ordered by wakeTime (ns since epoch).
+    struct Slot {
+        using Entries = std::multimap<int64_t, ExTask>;
+        Entries entries;
+        int level = 0;
+        size_t index = 0;
+    };
+
+    /// Where a task is in the wheel.
+    struct Location {
+        int level;
+        size_t index;
+        typename Slot::Entries::iterator it;
+    };
+
+    static int64_t toKey(ProcessClock::time_point tp) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       tp.time_since_epoch())
+                .count();
+    }
+
+    static size_t shift(size_t level) {
+        return ResolutionBits + level * SlotBits;
+    }
+
+    static size_t slotIndex(int64_t key, size_t level) {
+        return size_t(key >> shift(level)) & (numSlots - 1);
+    }
+
+    /// Returns the start of the slot of the given level which 'key' is in.
+    static int64_t slotStart(int64_t key, size_t level) {
+        // Masked rather than shifted down and up, as keys may be negative.
+        return key & ~((int64_t(1) << shift(level)) - 1);
+    }
+
+    /// Returns the index of the lowest set bit of a (non-zero) bitmap.
+    static size_t lowestSetBit(uint64_t bitmap) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, bitmap);
+        return size_t(index);
+#else
+        return size_t(__builtin_ctzll(bitmap));
+#endif
+    }
+
+    Slot& getSlot(int level, size_t index) {
+        if (level == expiredLevel) {
+            return expired;
+        }
+        if (level == overflowLevel) {
+            return overflow;
+        }
+        return wheel[level][index];
+    }
+
+    /// Returns the level of the wheel a task with the given key belongs at,
+    /// relative to the current cursor.
+    int placement(int64_t key) const {
+        if (key < cursor) {
+            return expiredLevel;
+        }
+        for (size_t level = 0; level < Levels; ++level) {
+            if ((key >> shift(level + 1)) == (cursor >> shift(level + 1))) {
+                return int(level);
+            }
+        }
+        return overflowLevel;
+    }
+
+    /// Insert a task; moving the cursor to it first if the wheel is empty.
+    void insert(ExTask task) {
+        const int64_t key = toKey(task->getWaketime());
+        if (expired.entries.empty() && isWheelEmpty()) {
+            // Nothing is ordered relative to the cursor, so it can be moved
+            // (even backwards) to where the tasks now are. Overflow tasks
+            // which then fit are pulled into the wheel.
+            int64_t start = key;
+            if (!overflow.entries.empty()) {
+                start = std::min(start, overflow.entries.begin()->first);
+            }
+            cursor = slotStart(start, 0);
+            cascade(overflowLevel, 0);
+        } else if (key < cursor && expired.entries.empty()) {
+            // Due before everything queued.
+            rewind(key);
+        }
+        place(std::move(task), key);
+    }
+
+    /**
+     * Move the cursor back to the start of the level 0 slot of 'key', which
+     * must be before every queued task. The tasks at or above the lowest
+     * level whose current slot holds both the old and the new cursor stay
+     * where they are (they are in later slots of it); only those below it,
+     * which were all in the old cursor's slot of that level, are re-placed.
+     * Not done if the cursor would leave the span of the top level (the
+     * task is then kept in the expired slot).
      */
-    class HeapifiableQueue : public std::priority_queue<ExTask, C, Compare> {
-    public:
-        /*
-         * Ensure the heap property is maintained
-         * @returns true if 'task' is in the queue and heapify() did something.
-         */
-        bool heapify(const ExTask& task) {
-            // if the task exists, rebuild
-            if (exists(task)) {
-                if (this->c.back()->getId() == task->getId()) {
-                    std::push_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                } else {
-                    std::make_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                }
-                return true;
-            } else {
+    void rewind(int64_t key) {
+        const int64_t start = slotStart(key, 0);
+        if ((start >> shift(Levels)) != (cursor >> shift(Levels))) {
+            return;
+        }
+        const int64_t old = cursor;
+        cursor = start;
+        const int keep = placement(old);
+        for (int level = 0; level < keep; ++level) {
+            for (uint64_t bitmap = occupied[level]; bitmap;
+                 bitmap &= bitmap - 1) {
+                cascade(level, lowestSetBit(bitmap));
+            }
+        }
+    }
+
+    /// Put a task in the slot it belongs in, relative to the current cursor.
+    void place(ExTask task, int64_t key) {
+        const size_t id = task->getId();
+        const int level = placement(key);
+        const size_t index =
+                (level == expiredLevel || level == overflowLevel)
+                        ? 0
+                        : slotIndex(key, level);
+        auto& slot = getSlot(level, index);
+        auto it = slot.entries.emplace(key, std::move(task));
+        if (level != expiredLevel && level != overflowLevel) {
+            occupied[level] |= uint64_t(1) << index;
+        }
+        locator.emplace(id, Location{level, index, it});
+        ++count;
+    }
+
+    void erase(int level, size_t index, typename Slot::Entries::iterator it) {
+        auto range = locator.equal_range(it->second->getId());
+        for (auto loc = range.first; loc != range.second; ++loc) {
+            if (loc->second.it == it) {
+                locator.erase(loc);
+                break;
+            }
+        }
+        auto& slot = getSlot(level, index);
+        slot.entries.erase(it);
+        if (slot.entries.empty() && level != expiredLevel &&
+            level != overflowLevel) {
+            occupied[level] &= ~(uint64_t(1) << index);
+        }
+        --count;
+    }
+
+    /// Re-place every copy of 'task' in the queue according to its (updated)
+    /// wakeTime. @returns true if the task was queued.
+    bool requeue(const ExTask& task) {
+        auto range = locator.equal_range(task->getId());
+        if (range.first == range.second) {
+            return false;
+        }
+        // Take every copy out before putting any back; inserting may
+        // cascade tasks (so invalidate the other copies' locations).
+        std::vector<Location> locations;
+        for (auto loc = range.first; loc != range.second; ++loc) {
+            locations.push_back(loc->second);
+        }
+        std::vector<ExTask> queued;
+        for (auto& loc : locations) {
+            queued.push_back(loc.it->second);
+            erase(loc.level, loc.index, loc.it);
+        }
+        for (auto& t : queued) {
+            insert(std::move(t));
+        }
+        return true;
+    }
+
+    bool isWheelEmpty() const {
+        for (const auto bitmap : occupied) {
+            if (bitmap) {
                 return false;
             }
         }
+        return true;
+    }
+
+    /// Move all the tasks of the given slot to where they now belong.
+    void cascade(int level, size_t index) {
+        auto& slot = getSlot(level, index);
+        while (!slot.entries.empty()) {
+            auto it = slot.entries.begin();
+            const int64_t key = it->first;
+            // Stop at the first overflow task which still doesn't fit in
+            // the wheel; all the later ones won't either.
+            if (level == overflowLevel && placement(key) == level) {
+                break;
+            }
+            ExTask task = it->second;
+            erase(level, index, it);
+            place(std::move(task), key);
+        }
+    }
 
-    protected:
-        bool exists(const ExTask& task) {
-            return std::find_if(this->c.begin(),
-                                this->c.end(),
-                                [&task](const ExTask& qTask) {
-                                    return task->getId() == qTask->getId();
-                                }) != this->c.end();
+    /**
+     * Returns the slot holding the task with the lowest wakeTime, advancing
+     * the cursor (and cascading tasks down the wheel) as necessary.
+     * The cursor never leaves the span of the top level; overflow tasks are
+     * only pulled into the wheel when it is next rebased by insert(), which
+     * keeps a few far-future tasks from dragging the cursor away from "now".
+     * Must not be called on an empty queue.
+     */
+    Slot& headSlot() {
+        if (count == 0) {
+            throw std::logic_error("FutureQueue::headSlot: queue is empty");
+        }
+        if (!expired.entries.empty()) {
+            // Everything in the wheel is at or after the cursor.
+            return expired;
         }
+        while (true) {
+            // The current level 0 slot, or a later one.
+            uint64_t candidates = occupied[0] & (~uint64_t(0)
+                                                 << slotIndex(cursor, 0));
+            if (candidates) {
+                return wheel[0][lowestSetBit(candidates)];
+            }
 
-    } queue;
+            // Find the next occupied slot of the lowest level which has
+            // one (the current slot of each level is represented by the
+            // levels below it), move the cursor to its start and cascade.
+            bool advanced = false;
+            for (size_t level = 1; level < Levels && !advanced; ++level) {
+                const size_t current = slotIndex(cursor, level);
+                if (current == numSlots - 1) {
+                    continue;
+                }
+                candidates = occupied[level] & (~uint64_t(0) << (current + 1));
+                if (candidates) {
+                    const size_t next = lowestSetBit(candidates);
+                    cursor = slotStart(cursor, level + 1) +
+                             (int64_t(next) << shift(level));
+                    cascade(int(level), next);
+                    advanced = true;
+                }
+            }
+            if (advanced) {
+                continue;
+            }
+
+            // The wheel is empty; everything left is beyond it.
+            if (overflow.entries.empty()) {
+                throw std::logic_error(
+                        "FutureQueue::headSlot: count is non-zero but no "
+                        "task found");
+            }
+            return overflow;
+        }
+    }
 
-    // All access to queue must be done with the queueMutex
+    // All access to the members below must be done with the queueMutex
     std::mutex queueMutex;
+
+    std::array<std::array<Slot, numSlots>, Levels> wheel = initWheel();
+    std::array<uint64_t, Levels> occupied{};
+    Slot expired = makeSlot(expiredLevel, 0);
+    Slot overflow = makeSlot(overflowLevel, 0);
+
+    // Start of the wheel; every task in it has a wakeTime at or after this.
+    int64_t cursor = std::numeric_limits<int64_t>::min();
+
+    // Every queued task (there may be more than one copy of a task).
+    std::unordered_multimap<size_t, Location> locator;
+
+    size_t count = 0;
+
+private:
+    static Slot makeSlot(int level, size_t index) {
+        Slot slot;
+        slot.level = level;
+        slot.index = index;
+        return slot;
+    }
+
+    static std::array<std::array<Slot, numSlots>, Levels> initWheel() {
+        std::array<std::array<Slot, numSlots>, Levels> w;
+        for (size_t level = 0; level < Levels; ++level) {
+            for (size_t index = 0; index < numSlots; ++index) {
+                w[level][index].level = int(level);
+                w[level][index].index = index;
+            }
+        }
+        return w;
+    }
 };
@@ -40,6 +40,7 @@ GlobalTask::GlobalTask(Taskable& t,
       state(TASK_RUNNING),
       uid(nextTaskId()),
       typeId(taskId),
+      ioClass(getTaskIOClass(taskId)),
       engine(NULL),
       taskable(t),
       totalRuntime(0),
@@ -86,9 +87,9 @@ void GlobalTask::wakeUp() {
  */
 const char* GlobalTask::getTaskName(TaskId id) {
     switch(id) {
-#define TASK(name, type, prio) \
-    case TaskId::name: {       \
-        return #name;          \
+#define TASK(name, type, prio, ioclass) \
+    case TaskId::name: {                \
+        return #name;                   \
     }
 #include "tasks.def.h"
 #undef TASK
@@ -106,9 +107,9 @@ const char* GlobalTask::getTaskName(TaskId id) {
  */
 TaskPriority GlobalTask::getTaskPriority(TaskId id) {
    switch(id) {
-#define TASK(name, type, prio)     \
-    case TaskId::name: {           \
-        return TaskPriority::name; \
+#define TASK(name, type, prio, ioclass) \
+    case TaskId::name: {                \
+        return TaskPriority::name;      \
     }
 #include "tasks.def.h"
 #undef TASK
@@ -126,9 +127,9 @@ TaskPriority GlobalTask::getTaskPriority(TaskId id) {
  */
 task_type_t GlobalTask::getTaskType(TaskId id) {
     switch (id) {
-#define TASK(name, type, prio) \
-    case TaskId::name: {       \
-        return type;           \
+#define TASK(name, type, prio, ioclass) \
+    case TaskId::name: {                \
+        return type;                    \
     }
 #include "tasks.def.h"
 #undef TASK
@@ -141,8 +142,28 @@ task_type_t GlobalTask::getTaskType(TaskId id) {
                            std::to_string(static_cast<int>(id)));
 }
 
+/*
+ * Generate a switch statement from tasks.def.h that maps TaskId to I/O class
+ */
+IOClass GlobalTask::getTaskIOClass(TaskId id) {
+    switch (id) {
+#define TASK(name, type, prio, ioclass) \
+    case TaskId::name: {                \
+        return IOClass::ioclass;        \
+    }
+#include "tasks.def.h"
+#undef TASK
+    case TaskId::TASK_COUNT: {
+        throw std::invalid_argument(
+                "GlobalTask::getTaskIOClass(TaskId::TASK_COUNT) called.");
+    }
+    }
+    throw std::logic_error("GlobalTask::getTaskIOClass() unknown id " +
+                           std::to_string(static_cast<int>(id)));
+}
+
 std::array<TaskId, static_cast<int>(TaskId::TASK_COUNT)> GlobalTask::allTaskIds = {{
-#define TASK(name, type, prio) TaskId::name,
+#define TASK(name, type, prio, ioclass) TaskId::name,
 #include "tasks.def.h"
 #undef TASK
 }};
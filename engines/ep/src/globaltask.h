@@ -34,7 +34,7 @@ enum task_state_t {
 std::string to_string(task_state_t state);
 
 enum class TaskId : int {
-#define TASK(name, type, prio) name,
+#define TASK(name, type, prio, ioclass) name,
 #include "tasks.def.h"
 #undef TASK
     TASK_COUNT
@@ -43,7 +43,7 @@ enum class TaskId : int {
 typedef int queue_priority_t;
 
 enum class TaskPriority : int {
-#define TASK(name, type, prio) name = prio,
+#define TASK(name, type, prio, ioclass) name = prio,
 #include "tasks.def.h"
 #undef TASK
     PRIORITY_COUNT
@@ -200,6 +200,10 @@ public:
         return static_cast<queue_priority_t>(priority);
     }
 
+    IOClass getIOClass() const {
+        return ioClass;
+    }
+
     /*
      * Lookup the task name for TaskId id.
      * The data used is generated from tasks.def.h
@@ -218,6 +222,12 @@ public:
      */
     static task_type_t getTaskType(TaskId id);
 
+    /*
+     * Lookup the I/O QoS class for TaskId id.
+     * The data used is generated from tasks.def.h
+     */
+    static IOClass getTaskIOClass(TaskId id);
+
     /*
      * A vector of all TaskId generated from tasks.def.h
      */
@@ -238,6 +248,7 @@ protected:
     const size_t uid;
     const TaskId typeId;
     TaskPriority priority;
+    const IOClass ioClass;
     EventuallyPersistentEngine *engine;
     Taskable& taskable;
 
@@ -47,7 +47,8 @@ Item::Item(const DocKey& k,
       vbucketId(vbid),
       op(k.getDocNamespace() == DocNamespace::System ? queue_op::system_event
                                                      : queue_op::set),
-      nru(nru_value) {
+      nru(nru_value),
+      valueView(static_cast<uint8_t>(ValueView::Whole)) {
     if (bySeqno == 0) {
         throw std::invalid_argument("Item(): bySeqno must be non-zero");
     }
@@ -78,7 +79,8 @@ Item::Item(const DocKey& k,
       vbucketId(vbid),
       op(k.getDocNamespace() == DocNamespace::System ? queue_op::system_event
                                                      : queue_op::set),
-      nru(nru_value) {
+      nru(nru_value),
+      valueView(static_cast<uint8_t>(ValueView::Whole)) {
     if (bySeqno == 0) {
         throw std::invalid_argument("Item(): bySeqno must be non-zero");
     }
@@ -99,7 +101,8 @@ Item::Item(const DocKey& k,
       queuedTime(ep_current_time()),
       vbucketId(vb),
       op(o),
-      nru(nru_value) {
+      nru(nru_value),
+      valueView(static_cast<uint8_t>(ValueView::Whole)) {
     if (bySeqno < 0) {
         throw std::invalid_argument("Item(): bySeqno must be non-negative");
     }
@@ -116,7 +119,9 @@ Item::Item(const Item& other)
       vbucketId(other.vbucketId),
       op(other.op),
       nru(other.nru),
-      datatype(other.datatype) {
+      valueView(other.valueView),
+      datatype(other.datatype),
+      valueViewOffset(other.valueViewOffset) {
     ObjectRegistry::onCreateItem(this);
 }
 
@@ -144,6 +149,8 @@ std::string to_string(queue_op op) {
 bool operator==(const Item& lhs, const Item& rhs) {
     return (lhs.metaData == rhs.metaData) &&
            (*lhs.value == *rhs.value) &&
+           (lhs.valueView == rhs.valueView) &&
+           (lhs.valueViewOffset == rhs.valueViewOffset) &&
            (lhs.key == rhs.key) &&
            (lhs.bySeqno == rhs.bySeqno) &&
            // Note: queuedTime is *not* compared. The rationale is it is
@@ -301,19 +308,18 @@ void Item::pruneValueAndOrXattrs(IncludeValue includeVal,
         }
     }
 
+    // The value Blob is typically shared with the checkpoint / hash table
+    // (this is normally a copy made for DCP), so rather than copying the
+    // retained part into a new Blob just narrow the view onto it; the
+    // daemon then sends that part straight from the shared Blob.
     auto root = reinterpret_cast<const char*>(value->getData());
     const cb::const_char_buffer buffer{root, value->vlength()};
     const auto sz = cb::xattr::get_body_offset(buffer);
 
-    char* extMeta = const_cast<char*>(value->getExtMeta());
-
     if (includeXattrs == IncludeXattrs::Yes) {
         if (mcbp::datatype::is_xattr(getDataType())) {
             // Want just the xattributes
-            setData(value->getData(),
-                    sz,
-                    reinterpret_cast<uint8_t*>(extMeta),
-                    value->getExtLen());
+            setValueView(ValueView::Xattrs, sz);
             // Remove all other datatype flags as we're only sending the xattrs
             setDataType(PROTOCOL_BINARY_DATATYPE_XATTR);
         } else {
@@ -325,10 +331,7 @@ void Item::pruneValueAndOrXattrs(IncludeValue includeVal,
     } else if (includeVal == IncludeValue::Yes)  {
         // Want just the value, so remove xattributes if there are any
         if (mcbp::datatype::is_xattr(getDataType())) {
-            setData(value->getData() + sz,
-                value->vlength() - sz,
-                reinterpret_cast<uint8_t*>(extMeta),
-                value->getExtLen());
+            setValueView(ValueView::Body, sz);
             // Clear the xattr datatype
             setDataType(getDataType() & ~PROTOCOL_BINARY_DATATYPE_XATTR);
         }
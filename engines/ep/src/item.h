@@ -184,14 +184,29 @@ public:
     /* Snappy uncompress value and update datatype */
     bool decompressValue();
 
+    /**
+     * @return pointer to the start of the value. If the item is a view onto
+     * part of a shared Blob (see pruneValueAndOrXattrs()) this points into
+     * that Blob.
+     */
     const char *getData() const {
-        return value.get() ? value->getData() : NULL;
+        if (!value.get()) {
+            return NULL;
+        }
+        if (getValueView() == ValueView::Body) {
+            return value->getData() + valueViewOffset;
+        }
+        return value->getData();
     }
 
     const char *getBlob() const {
         return value.get() ? value->getBlob() : NULL;
     }
 
+    /**
+     * @return the underlying Blob. Note that this is the whole Blob, even
+     * if this item only exposes a view of it (see getData() / getNBytes()).
+     */
     const value_t &getValue() const {
         return value;
     }
@@ -209,7 +224,18 @@ public:
     }
 
     uint32_t getNBytes() const {
-        return value.get() ? static_cast<uint32_t>(value->vlength()) : 0;
+        if (!value.get()) {
+            return 0;
+        }
+        switch (getValueView()) {
+        case ValueView::Whole:
+            break;
+        case ValueView::Xattrs:
+            return valueViewOffset;
+        case ValueView::Body:
+            return static_cast<uint32_t>(value->vlength()) - valueViewOffset;
+        }
+        return static_cast<uint32_t>(value->vlength());
     }
 
     size_t getValMemSize() const {
@@ -234,7 +260,9 @@ public:
     }
 
     void setDataType(protocol_binary_datatype_t datatype_) {
-        if (haveExtMetaData()) {
+        // A view must not modify the (shared) Blob it refers to; the cached
+        // datatype is authoritative for it.
+        if (haveExtMetaData() && getValueView() == ValueView::Whole) {
             value->setDataType(datatype_);
         }
         // update the cached datatype
@@ -259,6 +287,7 @@ public:
 
     void setValue(const value_t &v) {
         value.reset(v);
+        setValueView(ValueView::Whole, 0);
         // update the cached datatype
         datatype = value.get() ? value->getDataType() :
                 PROTOCOL_BINARY_RAW_BYTES;
@@ -424,6 +453,27 @@ public:
                                IncludeXattrs includeXattrs);
 
 private:
+    /**
+     * Which part of the value Blob this item exposes. An item normally
+     * exposes the whole Blob; pruneValueAndOrXattrs() narrows it to the
+     * xattrs or the body so the (possibly shared) Blob doesn't need to be
+     * copied.
+     */
+    enum class ValueView : uint8_t {
+        Whole,  // The whole Blob
+        Xattrs, // [0, valueViewOffset)
+        Body    // [valueViewOffset, vlength)
+    };
+
+    ValueView getValueView() const {
+        return static_cast<ValueView>(valueView);
+    }
+
+    void setValueView(ValueView view, uint32_t offset) {
+        valueView = static_cast<uint8_t>(view);
+        valueViewOffset = offset;
+    }
+
     /**
      * Set the item's data. This is only used by constructors, so we
      * make it private.
@@ -459,6 +509,7 @@ private:
     uint16_t vbucketId;
     queue_op op;
     uint8_t nru  : 2;
+    uint8_t valueView : 2; // ValueView
 
     // Keep a cached version of the datatype. It allows for using
     // "partial" items created from from the hashtable. Every time the
@@ -467,6 +518,10 @@ private:
     // this cached version.
     mutable protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
 
+    // Offset of the xattrs / body boundary when valueView != Whole. Sits
+    // in what would otherwise be tail padding.
+    uint32_t valueViewOffset = 0;
+
     static std::atomic<uint64_t> casCounter;
     static const uint32_t metaDataSize;
     DISALLOW_ASSIGN(Item);
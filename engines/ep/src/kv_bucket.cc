@@ -378,6 +378,12 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
         stats.schedulingHisto[i].reset();
         stats.taskRuntimeHisto[i].reset();
     }
+    for (auto& histo : stats.ioClassSchedulingHisto) {
+        histo.reset();
+    }
+    for (auto& histo : stats.ioClassRuntimeHisto) {
+        histo.reset();
+    }
 
     ExecutorPool::get()->registerTaskable(ObjectRegistry::getCurrentEngine()->getTaskable());
 
@@ -1433,6 +1439,20 @@ void KVBucket::completeBGFetch(const DocKey& key,
 void KVBucket::completeBGFetchMulti(uint16_t vbId,
                                     std::vector<bgfetched_item_t>& fetchedItems,
                                     ProcessClock::time_point startTime) {
+    // Notify all of the cookies in one go so the front end only has to
+    // wake up each of its worker threads once for the whole batch
+    std::vector<cb::IoCompletion> completions;
+    completions.reserve(fetchedItems.size());
+    auto addCompletion = [this, &completions](const void* cookie,
+                                              ENGINE_ERROR_CODE status) {
+        if (cookie == nullptr) {
+            // Logs the warning about the NULL cookie
+            engine.notifyIOComplete(cookie, status);
+        } else {
+            completions.push_back({cookie, status});
+        }
+    };
+
     VBucketPtr vb = getVBucket(vbId);
     if (vb) {
         for (const auto& item : fetchedItems) {
@@ -1440,17 +1460,18 @@ void KVBucket::completeBGFetchMulti(uint16_t vbId,
             auto* fetched_item = item.second;
             ENGINE_ERROR_CODE status = vb->completeBGFetchForSingleItem(
                     key, *fetched_item, startTime);
-            engine.notifyIOComplete(fetched_item->cookie, status);
+            addCompletion(fetched_item->cookie, status);
         }
+        engine.notifyIOComplete(completions);
         LOG(EXTENSION_LOG_DEBUG,
             "EP Store completes %" PRIu64 " of batched background fetch "
             "for vBucket = %d endTime = %" PRIu64,
             uint64_t(fetchedItems.size()), vbId, gethrtime()/1000000);
     } else {
         for (const auto& item : fetchedItems) {
-            engine.notifyIOComplete(item.second->cookie,
-                                    ENGINE_NOT_MY_VBUCKET);
+            addCompletion(item.second->cookie, ENGINE_NOT_MY_VBUCKET);
         }
+        engine.notifyIOComplete(completions);
         LOG(EXTENSION_LOG_WARNING,
             "EP Store completes %d of batched background fetch for "
             "for vBucket = %d that is already deleted\n",
@@ -2775,6 +2796,12 @@ void KVBucket::resetUnderlyingStats(void)
         stats.schedulingHisto[i].reset();
         stats.taskRuntimeHisto[i].reset();
     }
+    for (auto& histo : stats.ioClassSchedulingHisto) {
+        histo.reset();
+    }
+    for (auto& histo : stats.ioClassRuntimeHisto) {
+        histo.reset();
+    }
 }
 
 void KVBucket::addKVStoreStats(ADD_STAT add_stat, const void* cookie) {
@@ -613,12 +613,16 @@ public:
         const auto ns_count = std::chrono::duration_cast
                 <std::chrono::microseconds>(enqTime).count();
         stats.schedulingHisto[static_cast<int>(taskType)].add(ns_count);
+        const auto ioClass = GlobalTask::getTaskIOClass(taskType);
+        stats.ioClassSchedulingHisto[size_t(ioClass)].add(ns_count);
     }
 
     void logRunTime(TaskId taskType, const ProcessClock::duration runTime) {
         const auto ns_count = std::chrono::duration_cast
                 <std::chrono::microseconds>(runTime).count();
         stats.taskRuntimeHisto[static_cast<int>(taskType)].add(ns_count);
+        const auto ioClass = GlobalTask::getTaskIOClass(taskType);
+        stats.ioClassRuntimeHisto[size_t(ioClass)].add(ns_count);
     }
 
     bool multiBGFetchEnabled() {
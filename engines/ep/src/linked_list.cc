@@ -19,11 +19,13 @@
 
 #include "stats.h"
 
+#include <limits>
 #include <mutex>
+#include <tuple>
 
 BasicLinkedList::BasicLinkedList(uint16_t vbucketId, EPStats& st)
     : SequenceList(),
-      readRange(0, 0),
+      purgeRange(0, 0),
       staleSize(0),
       staleMetaDataSize(0),
       highSeqno(0),
@@ -31,6 +33,7 @@ BasicLinkedList::BasicLinkedList(uint16_t vbucketId, EPStats& st)
       highestPurgedDeletedSeqno(0),
       numStaleItems(0),
       numDeletedItems(0),
+      elemsSinceIndexed(0),
       vbid(vbucketId),
       st(st) {
 }
@@ -57,16 +60,17 @@ void BasicLinkedList::appendToList(std::lock_guard<std::mutex>& seqLock,
                                    std::lock_guard<std::mutex>& writeLock,
                                    OrderedStoredValue& v) {
     seqList.push_back(v);
+    listElemAppended(writeLock, v);
 }
 
 SequenceList::UpdateStatus BasicLinkedList::updateListElem(
         std::lock_guard<std::mutex>& seqLock,
         std::lock_guard<std::mutex>& writeLock,
         OrderedStoredValue& v) {
-    /* Lock that needed for consistent read of SeqRange 'readRange' */
+    /* Lock that needed for consistent read of the read ranges */
     std::lock_guard<SpinLock> lh(rangeLock);
 
-    if (readRange.fallsInRange(v.getBySeqno())) {
+    if (isInReadRange(lh, v.getBySeqno())) {
         /* Range read is in middle of a point-in-time snapshot, hence we cannot
            move the element to the end of the list. Return a temp failure */
         return UpdateStatus::Append;
@@ -74,9 +78,12 @@ SequenceList::UpdateStatus BasicLinkedList::updateListElem(
 
     /* Since there is no other reads or writes happenning in this range, we can
        move the item to the end of the list */
-    auto it = seqList.iterator_to(v);
-    seqList.erase(it);
+    listElemRemoved(writeLock, v);
+    auto prev = findPrevListElem(writeLock, v);
+    unindexListElem(writeLock, v);
+    seqList.erase_after(prev);
     seqList.push_back(v);
+    listElemAppended(writeLock, v);
 
     return UpdateStatus::Success;
 }
@@ -93,9 +100,11 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
         return std::make_tuple(ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
     }
 
-    /* Allows only 1 rangeRead for now */
-    std::lock_guard<std::mutex> lckGd(rangeReadLock);
+    /* Allocated outside the locks, and registered on the list below */
+    ReadRanges rangeNode(1, SeqRange(0, 0));
+    ReadRanges::iterator readRange;
 
+    OrderedLL::iterator startIt;
     {
         std::lock_guard<std::mutex> listWriteLg(getListWriteLock());
         std::lock_guard<SpinLock> lh(rangeLock);
@@ -115,13 +124,19 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
         /* Mark the initial read range */
         end = std::min(end, static_cast<seqno_t>(highSeqno));
         end = std::max(end, static_cast<seqno_t>(highestDedupedSeqno));
-        readRange = SeqRange(1, end);
+        rangeNode.front() = SeqRange(1, end);
+        readRange = addReadRange(lh, rangeNode);
+
+        /* Elements before startIt are not read, and are not stopped from
+           moving by the read range as we pass them */
+        startIt = seekListElem(listWriteLg, start).first;
     }
 
     /* Read items in the range */
     std::vector<UniqueItemPtr> items;
 
-    for (const auto& osv : seqList) {
+    for (auto it = startIt; it != seqList.end(); ++it) {
+        const auto& osv = *it;
         int64_t currSeqno(osv.getBySeqno());
 
         if (currSeqno > end || currSeqno < 0) {
@@ -132,9 +147,9 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
 
         {
             std::lock_guard<SpinLock> lh(rangeLock);
-            readRange.setBegin(currSeqno); /* [EPHE TODO]: should we
-                                                     update the min every time ?
-                                                   */
+            readRange->setBegin(currSeqno); /* [EPHE TODO]: should we
+                                                      update the min every time ?
+                                                    */
         }
 
         if (currSeqno < start) {
@@ -169,15 +184,19 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
                 "item with seqno %" PRIi64 "before streaming it",
                 vbid,
                 currSeqno);
+            {
+                std::lock_guard<SpinLock> lh(rangeLock);
+                removeReadRange(lh, readRange, rangeNode);
+            }
             return std::make_tuple(
                     ENGINE_ENOMEM, std::vector<UniqueItemPtr>(), 0);
         }
     }
 
-    /* Done with range read, reset the range */
+    /* Done with range read, remove the range */
     {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
+        removeReadRange(lh, readRange, rangeNode);
     }
 
     /* Return all the range read items */
@@ -194,7 +213,23 @@ void BasicLinkedList::updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
                                     " which is < 1");
     }
     highSeqno = v.getBySeqno();
+
+    /* Index the element just given its seqno (the last of the list) every
+       seqnoIndexInterval elements, if it keeps the index in list order */
+    if (seqList.empty() || &seqList.back() != &v ||
+        ++elemsSinceIndexed < seqnoIndexInterval ||
+        (!seqnoIndex.empty() &&
+         seqnoIndex.rbegin()->first >= v.getBySeqno())) {
+        return;
+    }
+    /* The list does not change the element (seqList holds non-const
+       references), we only need a non-const pointer to get an iterator */
+    seqnoIndex.emplace_hint(seqnoIndex.end(),
+                            v.getBySeqno(),
+                            const_cast<OrderedStoredValue*>(&v));
+    elemsSinceIndexed = 0;
 }
+
 void BasicLinkedList::updateHighestDedupedSeqno(
         std::lock_guard<std::mutex>& listWriteLg, const OrderedStoredValue& v) {
     if (v.getBySeqno() < 1) {
@@ -227,15 +262,13 @@ void BasicLinkedList::markItemStale(std::lock_guard<std::mutex>& listWriteLg,
 size_t BasicLinkedList::purgeTombstones() {
     // Purge items marked as stale from the seqList.
     //
-    // Strategy - we try to ensure that this function does not block
-    // frontend-writes (adding new OrderedStoredValues (OSVs) to the seqList).
-    // To achieve this (safely),
-    // we (try to) acquire the rangeReadLock and setup a 'read' range for the
-    // whole of the seqList. This prevents any other readers from iterating
-    // the list (and accessing stale items) while we purge on it; but permits
-    // front-end operations to continue as they:
+    // Strategy - we try to ensure that this function neither blocks
+    // frontend-writes (adding new OrderedStoredValues (OSVs) to the seqList)
+    // nor range reads. To achieve this (safely), we setup a 'purge' range
+    // from our position to the end of the part of the seqList we purge. This
+    // permits front-end operations to continue as they:
     //   a) Only read/modify non-stale items (we only change stale items) and
-    //   b) Do not change the list membership of anything within the read-range.
+    //   b) Do not change the list membership of anything within the range.
     // However, we do need to be careful about what members of OSVs we access
     // here - the only OSVs we can safely access are ones marked stale as they
     // are no longer in the HashTable (and hence subject to HashTable locks).
@@ -245,19 +278,23 @@ size_t BasicLinkedList::purgeTombstones() {
     // release the lock between each element so front-end operations can
     // have the opportunity to acquire it.
     //
-    // Attempt to acquire the readRangeLock, to block anyone else concurrently
-    // reading from the list while we remove elements from it.
-    std::unique_lock<std::mutex> rrGuard(rangeReadLock, std::try_to_lock);
-    if (!rrGuard) {
-        // If we cannot acquire the lock then another thread is
-        // running a range read. Given these are typically long-running,
-        // return without blocking.
+    // Range reads may be created (or move forward) at any time while we
+    // purge. A reader never goes back behind the begin of its read range, so
+    // we only remove elements which are behind the slowest reader. This is
+    // checked for each element in the same writeLock critical section as the
+    // removal, and we stop once we catch up with the slowest reader.
+    //
+    // Attempt to acquire the purgeLock, only one purge runs at a time.
+    std::unique_lock<std::mutex> purgeGuard(purgeLock, std::try_to_lock);
+    if (!purgeGuard) {
+        // Another thread is purging this list, return without blocking.
         return 0;
     }
 
     // Determine the start and end iterators.
     OrderedLL::iterator startIt;
     OrderedLL::iterator endIt;
+    OrderedLL::iterator prevIt = seqList.before_begin();
     {
         std::lock_guard<std::mutex> writeGuard(getListWriteLock());
         if (seqList.empty()) {
@@ -272,13 +309,13 @@ size_t BasicLinkedList::purgeTombstones() {
         // (i.e. we don't consider this "in-flight" item), as long as
         // there is at least two elements.
         startIt = seqList.begin();
-        endIt = std::prev(seqList.end());
-        // Need rangeLock for highSeqno & readRange
-        std::lock_guard<SpinLock> rangeGuard(rangeLock);
+        endIt = seqList.iterator_to(seqList.back());
         if ((startIt != endIt) && (!endIt->isStale(writeGuard))) {
-            endIt = std::prev(endIt);
+            endIt = findPrevListElem(writeGuard, *endIt);
         }
-        readRange = SeqRange(startIt->getBySeqno(), endIt->getBySeqno());
+        // Need rangeLock for highSeqno & purgeRange
+        std::lock_guard<SpinLock> rangeGuard(rangeLock);
+        purgeRange = SeqRange(startIt->getBySeqno(), endIt->getBySeqno());
     }
 
     // Iterate across all but the last item in the seqList, looking
@@ -290,22 +327,41 @@ size_t BasicLinkedList::purgeTombstones() {
     // endIt explicilty at the end.
     // Note(2): Iterator is manually incremented outside the for() loop as it
     // is invalidated when we erase items.
+    // Note(3): As the list is singly linked we erase the element after
+    // prevIt. The purge range starts at prevIt (once it is an element), so
+    // that it is not moved to the end of the list from under us.
     size_t purgedCount = 0;
-    bool stale;
     for (auto it = startIt; it != endIt;) {
+        StoredValue::UniquePtr purged;
         {
             std::lock_guard<std::mutex> writeGuard(getListWriteLock());
-            stale = it->isStale(writeGuard);
+            {
+                std::lock_guard<SpinLock> rangeGuard(rangeLock);
+                if (it->getBySeqno() >= getSlowestReaderBegin(rangeGuard)) {
+                    // Caught up with the slowest reader; the rest of the
+                    // list may still be read.
+                    break;
+                }
+            }
+
+            // Only stale items are purged.
+            if (it->isStale(writeGuard)) {
+                // Checks pass, remove from list (it is deleted outside the
+                // writeLock).
+                purged.reset(&*it);
+                it = purgeListElem(writeGuard, prevIt);
+                ++purgedCount;
+            } else {
+                prevIt = it++;
+            }
+
+            // As we move forward, shrink the purge range so that front-end
+            // updates behind us do not have to create stale items.
+            std::lock_guard<SpinLock> rangeGuard(rangeLock);
+            purgeRange.setBegin(prevIt == seqList.before_begin()
+                                        ? it->getBySeqno()
+                                        : prevIt->getBySeqno());
         }
-        // Only stale items are purged.
-        if (!stale) {
-            ++it;
-            continue;
-        }
-
-        // Checks pass, remove from list and delete.
-        it = purgeListElem(it);
-        ++purgedCount;
     }
 #if 0
     // TEMP - MB-25102 - skip purging the last element in the sequence list
@@ -325,10 +381,10 @@ size_t BasicLinkedList::purgeTombstones() {
     }
 #endif
 
-    // Complete; reset the readRange.
+    // Complete; reset the purgeRange.
     {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
+        purgeRange.reset();
     }
     return purgedCount;
 }
@@ -379,24 +435,89 @@ seqno_t BasicLinkedList::getHighestPurgedDeletedSeqno() const {
 
 uint64_t BasicLinkedList::getRangeReadBegin() const {
     std::lock_guard<SpinLock> lh(rangeLock);
-    return readRange.getBegin();
+    seqno_t begin = purgeRange.getBegin();
+    for (const auto& range : readRanges) {
+        if (begin == 0 || range.getBegin() < begin) {
+            begin = range.getBegin();
+        }
+    }
+    return begin;
+}
+
+size_t BasicLinkedList::getIndexBytes() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    /* Approximate size of a red-black tree node of seqnoIndex */
+    return seqnoIndex.size() *
+           (sizeof(decltype(seqnoIndex)::value_type) + 4 * sizeof(void*));
 }
 
 uint64_t BasicLinkedList::getRangeReadEnd() const {
     std::lock_guard<SpinLock> lh(rangeLock);
-    return readRange.getEnd();
+    seqno_t end = purgeRange.getEnd();
+    for (const auto& range : readRanges) {
+        end = std::max(end, range.getEnd());
+    }
+    return end;
 }
+
 std::mutex& BasicLinkedList::getListWriteLock() const {
     return writeLock;
 }
 
 boost::optional<SequenceList::RangeIterator> BasicLinkedList::makeRangeIterator(
-        bool isBackfill) {
-    auto pRangeItr = RangeIteratorLL::create(*this, isBackfill);
+        bool isBackfill, seqno_t start) {
+    auto pRangeItr = RangeIteratorLL::create(*this, isBackfill, start);
     return pRangeItr ? RangeIterator(std::move(pRangeItr))
                      : boost::optional<SequenceList::RangeIterator>{};
 }
 
+std::pair<OrderedLL::iterator, uint64_t> BasicLinkedList::seekListElem(
+        std::lock_guard<std::mutex>& writeLock, seqno_t start) {
+    return {seqList.begin(), 0};
+}
+
+OrderedLL::iterator BasicLinkedList::findPrevListElem(
+        std::lock_guard<std::mutex>& writeLock, const OrderedStoredValue& v) {
+    /* Start from the last indexed element before 'v'. The last element of
+       the list may not have its final seqno yet, so for it start from the
+       last indexed element */
+    auto indexed = (&v == &seqList.back())
+                           ? seqnoIndex.end()
+                           : seqnoIndex.lower_bound(v.getBySeqno());
+    if (indexed != seqnoIndex.begin() && std::prev(indexed)->second == &v) {
+        --indexed;
+    }
+
+    auto it = seqList.before_begin();
+    if (indexed != seqnoIndex.begin()) {
+        it = seqList.iterator_to(*std::prev(indexed)->second);
+    }
+
+    for (auto next = std::next(it); &*next != &v; ++next) {
+        it = next;
+    }
+    return it;
+}
+
+void BasicLinkedList::unindexListElem(std::lock_guard<std::mutex>& writeLock,
+                                      OrderedStoredValue& v) {
+    auto indexed = seqnoIndex.find(v.getBySeqno());
+    if (indexed == seqnoIndex.end() || indexed->second != &v) {
+        return;
+    }
+    auto after = seqnoIndex.erase(indexed);
+
+    /* Index the next element instead so the index does not thin out, unless
+       it is already indexed or is the last element (which may not have its
+       final seqno yet) */
+    auto next = std::next(seqList.iterator_to(v));
+    if (next == seqList.end() || &*next == &seqList.back() ||
+        (after != seqnoIndex.end() && after->second == &*next)) {
+        return;
+    }
+    seqnoIndex.emplace_hint(after, next->getBySeqno(), &*next);
+}
+
 void BasicLinkedList::dump() const {
     std::cerr << *this << std::endl;
 }
@@ -416,88 +537,137 @@ std::ostream& operator <<(std::ostream& os, const BasicLinkedList& ll) {
     return os;
 }
 
-OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it) {
-    StoredValue::UniquePtr purged(&*it);
-    {
-        std::lock_guard<std::mutex> lckGd(getListWriteLock());
-        it = seqList.erase(it);
-    }
+OrderedLL::iterator BasicLinkedList::purgeListElem(
+        std::lock_guard<std::mutex>& writeLock, OrderedLL::iterator prev) {
+    OrderedStoredValue& purged = *std::next(prev);
 
     /* Update the stats tracking the memory owned by the list */
-    staleSize.fetch_sub(purged->size());
-    staleMetaDataSize.fetch_sub(purged->metaDataSize());
-    st.currentSize.fetch_sub(purged->metaDataSize());
+    staleSize.fetch_sub(purged.size());
+    staleMetaDataSize.fetch_sub(purged.metaDataSize());
+    st.currentSize.fetch_sub(purged.metaDataSize());
 
     // Similary for the item counts:
     --numStaleItems;
-    if (purged->isDeleted()) {
+    if (purged.isDeleted()) {
         --numDeletedItems;
     }
 
-    if (purged->isDeleted()) {
+    if (purged.isDeleted()) {
         highestPurgedDeletedSeqno = std::max(seqno_t(highestPurgedDeletedSeqno),
-                                             purged->getBySeqno());
+                                             purged.getBySeqno());
     }
-    return it;
+
+    listElemRemoved(writeLock, *std::next(prev));
+    unindexListElem(writeLock, purged);
+    return seqList.erase_after(prev);
+}
+
+BasicLinkedList::ReadRanges::iterator BasicLinkedList::addReadRange(
+        std::lock_guard<SpinLock>& rangeGuard, ReadRanges& node) {
+    readRanges.splice(readRanges.end(), node);
+    return std::prev(readRanges.end());
+}
+
+void BasicLinkedList::removeReadRange(std::lock_guard<SpinLock>& rangeGuard,
+                                      ReadRanges::iterator range,
+                                      ReadRanges& node) {
+    node.splice(node.end(), readRanges, range);
+}
+
+bool BasicLinkedList::isInReadRange(std::lock_guard<SpinLock>& rangeGuard,
+                                    seqno_t seqno) const {
+    if (purgeRange.fallsInRange(seqno)) {
+        return true;
+    }
+    for (const auto& range : readRanges) {
+        if (range.fallsInRange(seqno)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+seqno_t BasicLinkedList::getSlowestReaderBegin(
+        std::lock_guard<SpinLock>& rangeGuard) const {
+    seqno_t begin = std::numeric_limits<seqno_t>::max();
+    for (const auto& range : readRanges) {
+        begin = std::min(begin, range.getBegin());
+    }
+    return begin;
 }
 
 std::unique_ptr<BasicLinkedList::RangeIteratorLL>
-BasicLinkedList::RangeIteratorLL::create(BasicLinkedList& ll, bool isBackfill) {
+BasicLinkedList::RangeIteratorLL::create(BasicLinkedList& ll,
+                                         bool isBackfill,
+                                         seqno_t start) {
     /* Note: cannot use std::make_unique because the constructor of
        RangeIteratorLL is private */
-    std::unique_ptr<BasicLinkedList::RangeIteratorLL> pRangeItr(
-            new BasicLinkedList::RangeIteratorLL(ll, isBackfill));
-    return pRangeItr->tryLater() ? nullptr : std::move(pRangeItr);
+    return std::unique_ptr<BasicLinkedList::RangeIteratorLL>(
+            new BasicLinkedList::RangeIteratorLL(ll, isBackfill, start));
 }
 
 BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
-                                                  bool isBackfill)
+                                                  bool isBackfill,
+                                                  seqno_t start)
     : list(ll),
-      /* Try to get range read lock, do not block */
-      readLockHolder(list.rangeReadLock, std::try_to_lock),
+      /* Allocated here so that registering the range on the list does not
+         allocate under the rangeLock */
+      rangeNode(1, SeqRange(0, 0)),
+      registered(false),
       itrRange(0, 0),
       numRemaining(0),
       earlySnapShotEndSeqno(0),
       isBackfill(isBackfill) {
-    if (!readLockHolder) {
-        /* no blocking */
-        return;
-    }
+    seqno_t lastSeqno;
+    {
+        std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        if (list.highSeqno < 1) {
+            /* No need of a snapshot range as there are no items; Also
+               iterator range is at default (0, 0) */
+            return;
+        }
 
-    std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
-    std::lock_guard<SpinLock> lh(list.rangeLock);
-    if (list.highSeqno < 1) {
-        /* No need of holding a lock for the snapshot as there are no items;
-           Also iterator range is at default (0, 0) */
-        readLockHolder.unlock();
-        return;
-    }
+        /* Iterator to where the walk to 'start' begins */
+        uint64_t numBefore;
+        std::tie(currIt, numBefore) = list.seekListElem(listWriteLg, start);
 
-    /* Iterator to the beginning of linked list */
-    currIt = list.seqList.begin();
+        /* Number of items that can be iterated over */
+        numRemaining = list.seqList.size() - numBefore;
 
-    /* Number of items that can be iterated over */
-    numRemaining = list.seqList.size();
+        /* The minimum seqno in the iterator that must be read to get a
+           consistent read snapshot */
+        earlySnapShotEndSeqno = list.highestDedupedSeqno;
 
-    /* The minimum seqno in the iterator that must be read to get a consistent
-       read snapshot */
-    earlySnapShotEndSeqno = list.highestDedupedSeqno;
+        /* Mark the snapshot range on linked list. The range that can be read
+           by the iterator is inclusive of the start and the end. */
+        lastSeqno = list.seqList.back().getBySeqno();
+        rangeNode.front() = SeqRange(currIt->getBySeqno(), lastSeqno);
+        readRange = list.addReadRange(lh, rangeNode);
+        registered = true;
+    }
 
-    /* Mark the snapshot range on linked list. The range that can be read by the
-       iterator is inclusive of the start and the end. */
-    list.readRange =
-            SeqRange(currIt->getBySeqno(), list.seqList.back().getBySeqno());
+    /* Walk to the first item at or after 'start' (or to the last item). The
+       items walked over are in the read range, so they cannot move or be
+       purged and we need not hold the writeLock */
+    while (currIt->getBySeqno() < start && currIt->getBySeqno() < lastSeqno) {
+        ++currIt;
+        --numRemaining;
+    }
+    {
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        readRange->setBegin(currIt->getBySeqno());
+    }
 
     /* Keep the range in the iterator obj. We store the range end seqno as one
        higher than the end seqno that can be read by this iterator.
        This is because, we must identify the end point of the iterator, and
-       we the read is inclusive of the end points of list.readRange.
+       we the read is inclusive of the end points of the read range.
 
        Further, since use the class 'SeqRange' for 'itrRange' we cannot use
        curr() == end() + 1 to identify the end point because 'SeqRange' does
        not internally allow curr > end */
-    itrRange = SeqRange(currIt->getBySeqno(),
-                        list.seqList.back().getBySeqno() + 1);
+    itrRange = SeqRange(currIt->getBySeqno(), lastSeqno + 1);
 
     EXTENSION_LOG_LEVEL severity =
             isBackfill ? EXTENSION_LOG_NOTICE : EXTENSION_LOG_INFO;
@@ -509,17 +679,21 @@ BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
 }
 
 BasicLinkedList::RangeIteratorLL::~RangeIteratorLL() {
-    std::lock_guard<SpinLock> lh(list.rangeLock);
-    if (readLockHolder.owns_lock()) {
-        /* we must reset the list readRange only if the list iterator still owns
-           the read lock on the list */
-        list.readRange.reset();
-        EXTENSION_LOG_LEVEL severity =
-                isBackfill ? EXTENSION_LOG_NOTICE : EXTENSION_LOG_INFO;
-        LOG(severity, "vb:%" PRIu16 " Releasing the range iterator", list.vbid);
+    releaseReadRange();
+}
+
+void BasicLinkedList::RangeIteratorLL::releaseReadRange() {
+    if (!registered) {
+        return;
     }
-    /* As readLockHolder goes out of scope here, it will automatically release
-       the snapshot read lock on the linked list */
+    {
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        list.removeReadRange(lh, readRange, rangeNode);
+    }
+    registered = false;
+    EXTENSION_LOG_LEVEL severity =
+            isBackfill ? EXTENSION_LOG_NOTICE : EXTENSION_LOG_INFO;
+    LOG(severity, "vb:%" PRIu16 " Releasing the range iterator", list.vbid);
 }
 
 OrderedStoredValue& BasicLinkedList::RangeIteratorLL::operator*() const {
@@ -548,15 +722,10 @@ operator++() {
     /* Check if the iterator is pointing to the last element. Increment beyond
        the last element indicates the end of the iteration */
     if (curr() == itrRange.getEnd() - 1) {
-        std::lock_guard<SpinLock> lh(list.rangeLock);
-        /* We reset the range and release the readRange lock here so that any
-           iterator client that does not delete the iterator obj will not end up
-           holding the list readRange lock forever */
-        list.readRange.reset();
-        EXTENSION_LOG_LEVEL severity =
-                isBackfill ? EXTENSION_LOG_NOTICE : EXTENSION_LOG_INFO;
-        LOG(severity, "vb:%" PRIu16 " Releasing the range iterator", list.vbid);
-        readLockHolder.unlock();
+        /* We release the read range here so that any iterator client that
+           does not delete the iterator obj will not end up holding the range
+           on the list forever */
+        releaseReadRange();
 
         /* Update the begin to end() so the client can see that the iteration
            has ended */
@@ -568,9 +737,9 @@ operator++() {
     {
         /* As the iterator moves we reduce the snapshot range being read on the
            linked list. This helps reduce the stale items in the list during
-           heavy update load from the front end */
+           heavy update load from the front end, and lets purge proceed */
         std::lock_guard<SpinLock> lh(list.rangeLock);
-        list.readRange.setBegin(currIt->getBySeqno());
+        readRange->setBegin(currIt->getBySeqno());
     }
 
     /* Also update the current range stored in the iterator obj */
@@ -29,18 +29,25 @@
 #include "seqlist.h"
 #include "stored-value.h"
 
-#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/slist.hpp>
 #include <platform/non_negative_counter.h>
 #include <relaxed_atomic.h>
 
-/* This option will configure "list" to use the member hook */
+#include <list>
+#include <map>
+
+/* This option will configure "slist" to use the member hook */
 using MemberHookOption =
         boost::intrusive::member_hook<OrderedStoredValue,
-                                      boost::intrusive::list_member_hook<>,
+                                      boost::intrusive::slist_member_hook<>,
                                       &OrderedStoredValue::seqno_hook>;
 
-/* This list will use the member hook */
-using OrderedLL = boost::intrusive::list<OrderedStoredValue, MemberHookOption>;
+/* This list will use the member hook. It is singly linked (to keep
+   OrderedStoredValue small) and caches its last element, so that push_back()
+   and back() are constant time */
+using OrderedLL = boost::intrusive::slist<OrderedStoredValue,
+                                          MemberHookOption,
+                                          boost::intrusive::cache_last<true>>;
 
 /**
  * Class that represents a range of sequence numbers.
@@ -109,16 +116,22 @@ private:
 };
 
 /**
- * This class implements SequenceList as a basic doubly linked list.
- * Uses boost intrusive list for doubly linked list implementation.
+ * This class implements SequenceList as a basic singly linked list.
+ * Uses boost intrusive slist for singly linked list implementation.
  *
  * Intrusive hook is to be added to OrderedStoredValue for it to be used in the
  * BasicLinkedList. Once in the BasicLinkedList, OrderedStoredValue is now
  * shared between HashTable and BasicLinkedList.
  *
- * BasicLinkedList sees only the hook for next and prev; HashTable
+ * BasicLinkedList sees only the hook for next; HashTable
  * see only the hook for hashtable chaining.
  *
+ * Removing an element from the middle of the list (when it is updated, or
+ * purged) needs the element before it. Rather than pay for a prev pointer in
+ * every element, the list keeps a sparse index of every
+ * 'seqnoIndexInterval'th element, and walks forward from the nearest indexed
+ * element before the one being removed.
+ *
  * But there should be an agreement on the deletion (invalidation of next and
  * prev link; chaining link) of the elements between these 2 class objects.
  * Currently,
@@ -134,17 +147,25 @@ private:
  * Ordering/Hierarchy of Locks:
  * ===========================
  * BasicLinkedList has 3 locks namely:
- * (i) writeLock (ii) rangeLock (iii) rangeReadLock
+ * (i) writeLock (ii) rangeLock (iii) purgeLock
  * Description of each lock can be found below in the class declaration, here
  * we describe in what order the locks should be grabbed
  *
- * rangeReadLock ==> writeLock ==> rangeLock is the valid lock hierarchy.
+ * purgeLock ==> writeLock ==> rangeLock is the valid lock hierarchy.
  *
  * Preferred/Expected Lock Duration:
  * ================================
  * 'writeLock' and 'rangeLock' are held for short durations, typically for
  * single list element writes and reads.
- * 'rangeReadLock' is held for longer duration on the list (for entire range).
+ * 'purgeLock' is held for longer duration on the list (for an entire purge).
+ *
+ * Concurrent Range Reads:
+ * ======================
+ * Any number of range reads (rangeRead() and RangeIterators) can be in flight
+ * at once. Each registers its own SeqRange in 'readRanges' and shrinks it as
+ * it moves forward. An element is not moved to the end of the list while its
+ * seqno falls in any registered range, and purgeTombstones() only removes
+ * stale elements which are behind the slowest reader.
  */
 class BasicLinkedList : public SequenceList {
 public:
@@ -198,14 +219,59 @@ public:
 
     uint64_t getRangeReadEnd() const override;
 
+    size_t getIndexBytes() const override;
+
     std::mutex& getListWriteLock() const override;
 
     boost::optional<SequenceList::RangeIterator> makeRangeIterator(
-            bool isBackfill) override;
+            bool isBackfill, seqno_t start) override;
 
     void dump() const override;
 
 protected:
+    /**
+     * Finds where a read starting at 'start' should begin walking the list.
+     * The list must not be empty.
+     *
+     * @param writeLock Write lock of the sequenceList
+     * @param start the seqno to seek to
+     *
+     * @return an iterator to an element which is not after the first element
+     *         with seqno >= start, and the number of elements before it.
+     *         BasicLinkedList returns the head of the list; subclasses which
+     *         index the list may do better.
+     */
+    virtual std::pair<OrderedLL::iterator, uint64_t> seekListElem(
+            std::lock_guard<std::mutex>& writeLock, seqno_t start);
+
+    /**
+     * Finds the element before 'v' in the list.
+     *
+     * @param writeLock Write lock of the sequenceList
+     * @param v an element in the list
+     *
+     * @return iterator to the element before 'v', or before_begin() if 'v'
+     *         is the first element
+     */
+    OrderedLL::iterator findPrevListElem(std::lock_guard<std::mutex>& writeLock,
+                                         const OrderedStoredValue& v);
+
+    /**
+     * Called (with the writeLock held) after 'v' is added to the end of
+     * 'seqList'.
+     */
+    virtual void listElemAppended(std::lock_guard<std::mutex>& writeLock,
+                                  OrderedStoredValue& v) {
+    }
+
+    /**
+     * Called (with the writeLock held) just before 'v' is removed from
+     * 'seqList', while it still has its position and seqno in the list.
+     */
+    virtual void listElemRemoved(std::lock_guard<std::mutex>& writeLock,
+                                 OrderedStoredValue& v) {
+    }
+
     /* Underlying data structure that holds the items in an Ordered Sequence */
     OrderedLL seqList;
 
@@ -216,34 +282,34 @@ protected:
      */
     mutable std::mutex writeLock;
 
+    using ReadRanges = std::list<SeqRange>;
+
     /**
-     * Used to mark of the range where point-in-time snapshot is happening.
-     * To get a valid point-in-time snapshot and for correct list iteration we
-     * must not de-duplicate an item in the list in this range.
+     * The ranges where point-in-time snapshots are happening, one per range
+     * read in flight. To get a valid point-in-time snapshot and for correct
+     * list iteration we must not de-duplicate an item in the list in any of
+     * these ranges.
      */
-    SeqRange readRange;
+    ReadRanges readRanges;
 
     /**
-     * Lock that protects readRange.
+     * The range of the list being walked by purgeTombstones(). Kept apart from
+     * 'readRanges' as purge must not wait for itself.
+     */
+    SeqRange purgeRange;
+
+    /**
+     * Lock that protects readRanges and purgeRange.
      * We use spinlock here since the lock is held only for very small time
      * periods.
      */
     mutable SpinLock rangeLock;
 
     /**
-     * Lock that serializes range reads on the 'seqList' - i.e. serializes
-     * the addition / removal of range reads from the set in-flight.
-     * We need to serialize range reads because, range reads set a list level
-     * range in which items are read. If we have multiple range reads then we
-     * must handle the races in the updation of the range to have most inclusive
-     * range.
-     * For now we use this lock to allow only one range read at a time.
-     *
-     * It is also additionally used in purgeTombstones() to prevent the
-     * creation of any new rangeReads while purge is in-progress - see
-     * detailed comments there.
+     * Lock that serializes runs of purgeTombstones(). Range reads do not take
+     * it, so a purge never stops readers from being created.
      */
-    std::mutex rangeReadLock;
+    std::mutex purgeLock;
 
     /* Overall memory consumed by (stale) OrderedStoredValues owned by the
        list */
@@ -254,7 +320,54 @@ protected:
     Couchbase::RelaxedAtomic<size_t> staleMetaDataSize;
 
 private:
-    OrderedLL::iterator purgeListElem(OrderedLL::iterator it);
+    /**
+     * Removes the stale element after 'prev' from the list and updates the
+     * stats. The caller takes ownership of (and must delete) the removed
+     * element.
+     *
+     * @param writeLock Write lock of the sequenceList
+     * @param prev the element before the one to remove
+     *
+     * @return iterator to the element after the removed one
+     */
+    OrderedLL::iterator purgeListElem(std::lock_guard<std::mutex>& writeLock,
+                                      OrderedLL::iterator prev);
+
+    /**
+     * Removes 'v' from 'seqnoIndex' (if indexed) before it is removed from
+     * the list; the element after it is indexed instead where possible.
+     */
+    void unindexListElem(std::lock_guard<std::mutex>& writeLock,
+                         OrderedStoredValue& v);
+
+    /**
+     * Registers a range read. The (single) range in 'node' is moved into
+     * 'readRanges', so that no allocation is done under the rangeLock.
+     *
+     * @return handle to the range in 'readRanges'
+     */
+    ReadRanges::iterator addReadRange(std::lock_guard<SpinLock>& rangeGuard,
+                                      ReadRanges& node);
+
+    /**
+     * Unregisters the range read 'range', moving it back into 'node'.
+     */
+    void removeReadRange(std::lock_guard<SpinLock>& rangeGuard,
+                         ReadRanges::iterator range,
+                         ReadRanges& node);
+
+    /**
+     * @return true if the seqno falls in the range of any range read or of
+     *         an in-progress purge
+     */
+    bool isInReadRange(std::lock_guard<SpinLock>& rangeGuard,
+                       seqno_t seqno) const;
+
+    /**
+     * @return the lowest begin of all the range reads, that is the position
+     *         of the slowest reader; or the max seqno if there are none
+     */
+    seqno_t getSlowestReaderBegin(std::lock_guard<SpinLock>& rangeGuard) const;
 
     /**
      * We need to keep track of the highest seqno separately because there is a
@@ -299,6 +412,24 @@ private:
      */
     cb::NonNegativeCounter<uint64_t> numDeletedItems;
 
+    /* One in every 'seqnoIndexInterval' elements is put in 'seqnoIndex' */
+    static const size_t seqnoIndexInterval = 64;
+
+    /**
+     * Sparse index over 'seqList', from seqno to element, of (about) every
+     * seqnoIndexInterval'th element. Used by findPrevListElem().
+     * Only elements which have their final seqno and are not the last
+     * element are indexed, apart from the element just given a seqno in
+     * updateHighSeqno().
+     *
+     * Guarded by the writeLock.
+     */
+    std::map<seqno_t, OrderedStoredValue*> seqnoIndex;
+
+    /* Number of elements given a seqno since one was last indexed. Guarded
+       by the writeLock */
+    size_t elemsSinceIndexed;
+
     /* Used only to log debug messages */
     const uint16_t vbid;
 
@@ -311,20 +442,21 @@ private:
     class RangeIteratorLL : public SequenceList::RangeIteratorImpl {
     public:
         /**
-         * Method to create instances of RangeIteratorLL. We only
-         * allow one RangeIteratorLL object to exist at any one time,
-         * hence creation can fail and that's why object creation is via a
-         * public method and not constructor.
+         * Method to create instances of RangeIteratorLL. Any number of
+         * RangeIteratorLL objects can exist at once; creation is via a
+         * public method so that a limit can be imposed in future.
          *
          * @param ll ref to the linkedlist on which the iterator is created
          * @param isBackfill indicates if the iterator is for backfill (for
          *                   debug)
+         * @param start seqno from which the iterator should start
          *
-         * @return Non-null pointer on success, or null if a RangeIteratorLL
-         *         already exists.
+         * @return Non-null pointer on success, or null if the iterator cannot
+         *         be created now.
          */
         static std::unique_ptr<RangeIteratorLL> create(BasicLinkedList& ll,
-                                                       bool isBackfill);
+                                                       bool isBackfill,
+                                                       seqno_t start);
 
         ~RangeIteratorLL();
 
@@ -354,20 +486,12 @@ private:
 
     private:
         /* We have a private constructor because we want to create the iterator
-           optionally, that is, only when it is possible to get a read lock */
-        RangeIteratorLL(BasicLinkedList& ll, bool isBackfill);
+           optionally */
+        RangeIteratorLL(BasicLinkedList& ll, bool isBackfill, seqno_t start);
 
-        /**
-         * Indicates if the client should try creating the iterator at a later
-         * point.
-         *
-         * @return true: iterator should be created later again
-         *         false: iterator created successfully
-         */
-        bool tryLater() const {
-            /* could not lock and the list has items */
-            return (!readLockHolder && (list.getHighSeqno() > 0));
-        }
+        /* Unregisters the snapshot range of the iterator from the list (if
+           still registered) */
+        void releaseReadRange();
 
         /* Ref to BasicLinkedList object which is iterated by this iterator.
            By setting the member variables of the list obj appropriately we
@@ -377,8 +501,16 @@ private:
         /* The current list element pointed by the iterator */
         OrderedLL::iterator currIt;
 
-        /* Lock holder which allows having only one iterator at a time */
-        std::unique_lock<std::mutex> readLockHolder;
+        /* Holds the snapshot range of the iterator while it is not registered
+           on the list */
+        ReadRanges rangeNode;
+
+        /* The snapshot range of the iterator registered in list.readRanges;
+           valid only while 'registered' is true */
+        ReadRanges::iterator readRange;
+
+        /* Indicates if the iterator has a snapshot range on the list */
+        bool registered;
 
         /* Current range of the iterator */
         SeqRange itrRange;
@@ -73,8 +73,9 @@ protected:
      * (b) Iterator cannot be invalidated while in use.
      * (c) Reading all the items from the iterator results in point-in-time
      *     snapshot.
-     * (d) Only 1 iterator can be created for now.
-     * (e) Currently iterator can be created only from start till end
+     * (d) Multiple iterators can be in use at once, each with its own
+     *     snapshot.
+     * (e) Iterator can be created from a given seqno till end
      */
     class RangeIteratorImpl {
     public:
@@ -156,8 +157,8 @@ public:
      * Note: (a) Do not hold the iterator for long, as it will result in stale
      *           items in list and hence increased memory usage.
      *       (b) Make sure to delete the iterator after using it.
-     *       (c) For now, we allow on one RangeIterator. Try to create more
-     *           iterators will result in the create call(s) being blocked.
+     *       (c) Several RangeIterators can exist at once; stale items are
+     *           only purged once all of them have moved past them.
      */
     class RangeIterator {
     public:
@@ -386,15 +387,23 @@ public:
     virtual seqno_t getHighestPurgedDeletedSeqno() const = 0;
 
     /**
-     * Returns the current range read begin sequence number.
+     * Returns the current range read begin sequence number, that is the
+     * lowest begin of all the range reads in progress.
      */
     virtual uint64_t getRangeReadBegin() const = 0;
 
     /**
-     * Returns the current range read end sequence number.
+     * Returns the current range read end sequence number, that is the
+     * highest end of all the range reads in progress.
      */
     virtual uint64_t getRangeReadEnd() const = 0;
 
+    /**
+     * Returns the memory (in bytes) used by any index the list keeps over its
+     * items, in addition to the links in the items themselves.
+     */
+    virtual size_t getIndexBytes() const = 0;
+
     /**
      * Returns the lock which must be held to make append/update to the seqList
      * + the updation of the corresponding highSeqno or the
@@ -408,12 +417,16 @@ public:
      * the SequenceList, new range iterator will not be allowed
      *
      * @param isBackfill indicates if the iterator is for backfill (for debug)
+     * @param start seqno the iterator should start from; the iterator is
+     *              positioned on the first item with seqno >= start (or on
+     *              the last item if there is none). Items before that are
+     *              not part of the iterator's snapshot.
      *
      * @return range iterator object when possible
      *         null when not possible
      */
     virtual boost::optional<SequenceList::RangeIterator> makeRangeIterator(
-            bool isBackfill) = 0;
+            bool isBackfill, seqno_t start) = 0;
 
     /**
      * Debug - prints a representation of the list to stderr.
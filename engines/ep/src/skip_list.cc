@@ -0,0 +1,181 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "skip_list.h"
+
+#include <algorithm>
+#include <mutex>
+
+SkipList::SkipList(uint16_t vbucketId, EPStats& st)
+    : BasicLinkedList(vbucketId, st),
+      head(0, nullptr, maxLanes),
+      numLanes(0),
+      numIndexNodes(0),
+      indexNodeBytes(0),
+      rng(vbucketId + 1) {
+    /* The list is empty, so every lane of the head reaches one past the end
+       of the list */
+    for (auto& link : head.links) {
+        link.width = 1;
+    }
+    tails.fill(&head);
+}
+
+SkipList::~SkipList() {
+    /* The list elements themselves are deleted by BasicLinkedList and the
+       hash table; we only own the index nodes */
+    IndexNode* node = head.links[0].next;
+    while (node) {
+        IndexNode* next = node->links[0].next;
+        delete node;
+        node = next;
+    }
+}
+
+void SkipList::updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                               const OrderedStoredValue& v) {
+    BasicLinkedList::updateHighSeqno(listWriteLg, v);
+
+    /* Only the element just added to the end of the list gets its seqno
+       here; index it if it keeps the lanes in seqno order */
+    if (seqList.empty() || &seqList.back() != &v ||
+        (tails[0] != &head && tails[0]->seqno >= v.getBySeqno())) {
+        return;
+    }
+
+    const size_t lanes = randomLanes();
+    if (lanes == 0) {
+        return;
+    }
+
+    /* The list does not change the element (seqList holds non-const
+       references), we only need a non-const pointer to get an iterator */
+    auto* node = new IndexNode(
+            v.getBySeqno(), const_cast<OrderedStoredValue*>(&v), lanes);
+    for (size_t l = 0; l < lanes; ++l) {
+        /* The element is the last of the list, so the previous tail of the
+           lane now stops one element earlier */
+        Link& prev = tails[l]->links[l];
+        --prev.width;
+        prev.next = node;
+        node->links[l].width = 1;
+        tails[l] = node;
+    }
+    numLanes = std::max(numLanes, lanes);
+    ++numIndexNodes;
+    indexNodeBytes += sizeof(IndexNode) + lanes * sizeof(Link);
+}
+
+size_t SkipList::getIndexBytes() const {
+    const size_t basicIndexBytes = BasicLinkedList::getIndexBytes();
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return basicIndexBytes + indexNodeBytes;
+}
+
+size_t SkipList::getNumIndexNodes() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return numIndexNodes;
+}
+
+std::pair<OrderedLL::iterator, uint64_t> SkipList::seekListElem(
+        std::lock_guard<std::mutex>& writeLock, seqno_t start) {
+    /* Find the last index node with seqno <= start, and its position in the
+       list (the head is at position 0, the first element at 1) */
+    IndexNode* node = &head;
+    uint64_t pos = 0;
+    for (size_t l = numLanes; l-- > 0;) {
+        while (node->links[l].next && node->links[l].next->seqno <= start) {
+            pos += node->links[l].width;
+            node = node->links[l].next;
+        }
+    }
+
+    if (node == &head) {
+        return {seqList.begin(), 0};
+    }
+    return {seqList.iterator_to(*node->osv), pos - 1};
+}
+
+void SkipList::listElemAppended(std::lock_guard<std::mutex>& writeLock,
+                                OrderedStoredValue& v) {
+    /* The element is not indexed until it has a seqno; for now it just
+       lengthens the last span of every lane */
+    for (size_t l = 0; l < maxLanes; ++l) {
+        ++tails[l]->links[l].width;
+    }
+}
+
+void SkipList::listElemRemoved(std::lock_guard<std::mutex>& writeLock,
+                               OrderedStoredValue& v) {
+    if (&v == &seqList.back() && (tails[0] == &head || tails[0]->osv != &v)) {
+        /* The last element and not indexed; it may not have a seqno yet so
+           don't search for it, it is in the last span of every lane */
+        for (size_t l = 0; l < maxLanes; ++l) {
+            --tails[l]->links[l].width;
+        }
+        return;
+    }
+
+    /* Find, in each lane, the node whose span contains the element */
+    std::array<IndexNode*, maxLanes> prev;
+    prev.fill(&head);
+    IndexNode* node = &head;
+    for (size_t l = numLanes; l-- > 0;) {
+        while (node->links[l].next &&
+               node->links[l].next->seqno < v.getBySeqno()) {
+            node = node->links[l].next;
+        }
+        prev[l] = node;
+    }
+
+    IndexNode* removed = prev[0]->links[0].next;
+    if (removed && removed->osv != &v) {
+        removed = nullptr;
+    }
+
+    for (size_t l = 0; l < maxLanes; ++l) {
+        Link& link = prev[l]->links[l];
+        if (removed && l < removed->links.size()) {
+            /* Splice the element's node out of the lane */
+            link.width += removed->links[l].width - 1;
+            link.next = removed->links[l].next;
+            if (tails[l] == removed) {
+                tails[l] = prev[l];
+            }
+        } else {
+            --link.width;
+        }
+    }
+
+    if (removed) {
+        indexNodeBytes -=
+                sizeof(IndexNode) + removed->links.size() * sizeof(Link);
+        delete removed;
+        --numIndexNodes;
+        while (numLanes > 0 && !head.links[numLanes - 1].next) {
+            --numLanes;
+        }
+    }
+}
+
+size_t SkipList::randomLanes() {
+    size_t lanes = 0;
+    while (lanes < maxLanes && (rng() % branchingFactor) == 0) {
+        ++lanes;
+    }
+    return lanes;
+}
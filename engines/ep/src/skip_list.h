@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * This header file contains the class definition of the skiplist
+ * implementation of the abstract class SequenceList
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "linked_list.h"
+
+#include <array>
+#include <random>
+#include <vector>
+
+/**
+ * This class implements SequenceList as a skiplist.
+ *
+ * The bottom level of the skiplist is the BasicLinkedList 'seqList' itself,
+ * so everything about ownership, locking, stale items, range reads and range
+ * iterators is as described for BasicLinkedList. On top of it, SkipList
+ * keeps express lanes of index nodes: an element is promoted to lane 'l'
+ * with probability 1/(branchingFactor ^ (l + 1)) when it gets its seqno.
+ * Seeking to a seqno (rangeRead, makeRangeIterator from a start seqno) then
+ * costs O(log n) instead of a walk from the head of the list.
+ *
+ * Each index node also records how many list elements its lane skips over,
+ * so the position of an element (needed for RangeIterator::count()) is
+ * known without walking the list.
+ *
+ * The index is guarded by the writeLock of the list.
+ */
+class SkipList : public BasicLinkedList {
+public:
+    SkipList(uint16_t vbucketId, EPStats& st);
+
+    ~SkipList();
+
+    void updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                         const OrderedStoredValue& v) override;
+
+    size_t getIndexBytes() const override;
+
+    /**
+     * Returns the number of index nodes (elements promoted to at least one
+     * express lane).
+     */
+    size_t getNumIndexNodes() const;
+
+protected:
+    std::pair<OrderedLL::iterator, uint64_t> seekListElem(
+            std::lock_guard<std::mutex>& writeLock, seqno_t start) override;
+
+    void listElemAppended(std::lock_guard<std::mutex>& writeLock,
+                          OrderedStoredValue& v) override;
+
+    void listElemRemoved(std::lock_guard<std::mutex>& writeLock,
+                         OrderedStoredValue& v) override;
+
+private:
+    /* Max number of express lanes; enough for billions of items */
+    static const size_t maxLanes = 16;
+
+    /* 1 in branchingFactor elements of a lane are promoted to the next */
+    static const uint32_t branchingFactor = 4;
+
+    struct IndexNode;
+
+    struct Link {
+        IndexNode* next;
+        /* Number of list elements from this node up to 'next' (or up to one
+           past the end of the list for the last node of the lane) */
+        uint64_t width;
+    };
+
+    struct IndexNode {
+        IndexNode(seqno_t seqno, OrderedStoredValue* osv, size_t lanes)
+            : seqno(seqno), osv(osv), links(lanes, Link{nullptr, 0}) {
+        }
+
+        seqno_t seqno;
+        /* nullptr for the head */
+        OrderedStoredValue* osv;
+        std::vector<Link> links;
+    };
+
+    /* Number of lanes to promote a newly seqno'd element to */
+    size_t randomLanes();
+
+    /* Sentinel before the first element of the list, in all lanes */
+    IndexNode head;
+
+    /* Last node of each lane (the head if the lane is empty) */
+    std::array<IndexNode*, maxLanes> tails;
+
+    /* Number of lanes with at least one node */
+    size_t numLanes;
+
+    size_t numIndexNodes;
+
+    /* Memory used by the index nodes (not counting the head) */
+    size_t indexNodeBytes;
+
+    std::minstd_rand rng;
+};
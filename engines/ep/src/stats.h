@@ -29,9 +29,11 @@
 #include <platform/non_negative_counter.h>
 #include <platform/processclock.h>
 #include <relaxed_atomic.h>
+#include <array>
 #include <atomic>
 #include "memory_tracker.h"
 #include "objectregistry.h"
+#include "task_type.h"
 #include "threadlocal.h"
 #include "utility.h"
 
@@ -539,6 +541,12 @@ public:
     // ! Histograms of various task run times, one per Task.
     std::vector<ProcessDurationHistogram> taskRuntimeHisto;
 
+    // ! Histograms of task wait / run times, one per IOClass.
+    std::array<ProcessDurationHistogram, size_t(IOClass::COUNT)>
+            ioClassSchedulingHisto;
+    std::array<ProcessDurationHistogram, size_t(IOClass::COUNT)>
+            ioClassRuntimeHisto;
+
     //! Checkpoint Cursor histograms
     Histogram<hrtime_t> persistenceCursorGetItemsHisto;
     Histogram<hrtime_t> dcpCursorsGetItemsHisto;
@@ -24,7 +24,7 @@
 #include "storeddockey.h"
 #include "utility.h"
 
-#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/slist.hpp>
 
 class Item;
 class OrderedStoredValue;
@@ -95,7 +95,6 @@ class OrderedStoredValue;
  *     fixed {   | StoredValue fixed ...
  *    length {   + - - - - - - - - - -+
  *           {   | seqno next [ptr]   |
- *           {   | seqno prev [ptr]   |
  *               + - - - - - - - - - -+
  *  variable {   | key[]              |
  *   length  {   | ...                |
@@ -696,9 +695,11 @@ std::ostream& operator<<(std::ostream& os, const StoredValue& sv);
  */
 class OrderedStoredValue : public StoredValue {
 public:
-    // Intrusive linked-list for sequence number ordering.
+    // Intrusive (singly) linked-list for sequence number ordering. Only a
+    // next pointer is kept to save 8 bytes per item; see BasicLinkedList for
+    // how the previous element is found.
     // Guarded by the SequenceList's writeLock.
-    boost::intrusive::list_member_hook<> seqno_hook;
+    boost::intrusive::slist_member_hook<> seqno_hook;
 
     ~OrderedStoredValue() {
         if (stale) {
@@ -47,3 +47,36 @@ static inline std::string to_string(const task_type_t type) {
                                     std::to_string(int(type)) + "}");
     }
 }
+
+/**
+ * I/O QoS class of a task. Tasks of the same task_type_t share the same
+ * threads; the class determines how a TaskQueue chooses between ready tasks
+ * of that type:
+ *
+ * - FrontEnd tasks are performing work a client is directly waiting on (e.g.
+ *   bgfetches). They are always picked first, and a share of the threads of
+ *   each type is reserved for them (see ExecutorPool::setFrontEndReservedPcnt).
+ * - All other classes share the remaining threads, weighted by
+ *   ExecutorPool::setIOClassWeight.
+ */
+enum class IOClass : int {
+    FrontEnd = 0,
+    Replication = 1,
+    Background = 2,
+    COUNT = 3 // keep this as last element of the enum
+};
+
+static inline std::string to_string(const IOClass ioClass) {
+    switch (ioClass) {
+    case IOClass::FrontEnd:
+        return "frontend";
+    case IOClass::Replication:
+        return "replication";
+    case IOClass::Background:
+        return "background";
+    case IOClass::COUNT:
+        return "COUNT";
+    }
+    throw std::invalid_argument("to_string(IOClass) unknown class:{" +
+                                std::to_string(int(ioClass)) + "}");
+}
@@ -20,12 +20,22 @@
 #include "executorpool.h"
 #include "executorthread.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <vector>
+
+// Numerator of the stride scheduling between non front-end IOClasses; a
+// class of weight w advances its pass by IO_CLASS_STRIDE / w per task run.
+static const uint64_t IO_CLASS_STRIDE = 1 << 20;
+
+const size_t TaskQueue::numLocalQueues;
+const size_t TaskQueue::localBatchSize;
 
 TaskQueue::TaskQueue(ExecutorPool *m, task_type_t t, const char *nm) :
     name(nm), queueType(t), manager(m), sleepers(0)
 {
-    // EMPTY
+    ioClassPass.fill(0);
 }
 
 TaskQueue::~TaskQueue() {
@@ -38,7 +48,32 @@ const std::string TaskQueue::getName() const {
 
 size_t TaskQueue::getReadyQueueSize() {
     LockHolder lh(mutex);
-    return readyQueue.size();
+    size_t size = _getLocalQueueSize();
+    for (const auto& queue : readyQueue) {
+        size += queue.size();
+    }
+    return size;
+}
+
+size_t TaskQueue::getReadyQueueSize(IOClass ioClass) {
+    LockHolder lh(mutex);
+    size_t size = readyQueue[size_t(ioClass)].size();
+    if (ioClass == IOClass::FrontEnd) {
+        size += _getLocalQueueSize();
+    }
+    return size;
+}
+
+size_t TaskQueue::_getLocalQueueSize() const {
+    size_t size = 0;
+    for (const auto& local : localQueues) {
+        size += local.size;
+    }
+    return size;
+}
+
+TaskQueue::LocalQueue& TaskQueue::_getLocalQueue(const ExecutorThread& thread) {
+    return localQueues[thread.getIndex() % numLocalQueues];
 }
 
 size_t TaskQueue::getFutureQueueSize() {
@@ -51,13 +86,161 @@ size_t TaskQueue::getPendingQueueSize() {
     return pendingQueue.size();
 }
 
-ExTask TaskQueue::_popReadyTask(void) {
-    ExTask t = readyQueue.top();
-    readyQueue.pop();
-    manager->lessWork(queueType);
+bool TaskQueue::_readyQueueEmpty() const {
+    return std::all_of(readyQueue.begin(),
+                       readyQueue.end(),
+                       [](const ReadyQueue& q) { return q.empty(); });
+}
+
+bool TaskQueue::_hasRunnableReadyTask() {
+    if (!readyQueue[size_t(IOClass::FrontEnd)].empty()) {
+        return true;
+    }
+    if (_readyQueueEmpty()) {
+        return false;
+    }
+    // Only non front-end tasks are ready; they can run iff there is a free
+    // slot for them.
+    return !manager->isNonFrontEndLimitReached(queueType);
+}
+
+void TaskQueue::_pushReadyTask(ExTask& task) {
+    const IOClass ioClass = task->getIOClass();
+    auto& queue = readyQueue[size_t(ioClass)];
+    if (queue.empty() && ioClass != IOClass::FrontEnd) {
+        // A class which has been idle must not be credited for the time it
+        // had nothing to run - move its pass up to the lowest active pass.
+        uint64_t minPass = std::numeric_limits<uint64_t>::max();
+        for (size_t i = 0; i < readyQueue.size(); ++i) {
+            if (IOClass(i) != IOClass::FrontEnd && !readyQueue[i].empty()) {
+                minPass = std::min(minPass, ioClassPass[i]);
+            }
+        }
+        if (minPass != std::numeric_limits<uint64_t>::max()) {
+            auto& pass = ioClassPass[size_t(ioClass)];
+            pass = std::max(pass, minPass);
+        }
+    }
+    queue.push(task);
+    manager->addWork(1, queueType, ioClass);
+}
+
+ExTask TaskQueue::_popReadyTask(IOClass ioClass) {
+    auto& queue = readyQueue[size_t(ioClass)];
+    ExTask t = queue.top();
+    queue.pop();
+    manager->lessWork(queueType, ioClass);
     return t;
 }
 
+ExTask TaskQueue::_selectReadyTask(ExecutorThread& thread) {
+    // Clean out dead tasks first, regardless of their class.
+    for (size_t i = 0; i < readyQueue.size(); ++i) {
+        if (!readyQueue[i].empty() && readyQueue[i].top()->isdead()) {
+            const IOClass ioClass = IOClass(i);
+            manager->tryStartIOClass(queueType, ioClass, /*force*/ true);
+            thread.curIOClass = ioClass;
+            return _popReadyTask(ioClass);
+        }
+    }
+
+    if (!readyQueue[size_t(IOClass::FrontEnd)].empty()) {
+        manager->tryStartIOClass(queueType, IOClass::FrontEnd, false);
+        thread.curIOClass = IOClass::FrontEnd;
+        return _popReadyTask(IOClass::FrontEnd);
+    }
+
+    size_t next = readyQueue.size();
+    for (size_t i = 0; i < readyQueue.size(); ++i) {
+        if (readyQueue[i].empty()) {
+            continue;
+        }
+        if (next == readyQueue.size() || ioClassPass[i] < ioClassPass[next]) {
+            next = i;
+        }
+    }
+    if (next == readyQueue.size()) {
+        return nullptr;
+    }
+
+    const IOClass ioClass = IOClass(next);
+    if (!manager->tryStartIOClass(queueType, ioClass, false)) {
+        // All non front-end slots are in use; leave the remaining threads
+        // for front-end work.
+        return nullptr;
+    }
+    ioClassPass[next] += IO_CLASS_STRIDE / manager->getIOClassWeight(ioClass);
+    thread.curIOClass = ioClass;
+    return _popReadyTask(ioClass);
+}
+
+void TaskQueue::_fillLocalQueue(ExecutorThread& thread,
+                                queue_priority_t priority) {
+    auto& queue = readyQueue[size_t(IOClass::FrontEnd)];
+    size_t batch = std::min(localBatchSize, queue.size() / 2);
+    if (batch == 0) {
+        return;
+    }
+
+    auto& local = _getLocalQueue(thread);
+    std::lock_guard<std::mutex> lg(local.mutex);
+    // Only take tasks which would have been run next anyway, so the batch
+    // can't delay a more important task by more than localBatchSize runs.
+    for (; batch && queue.top()->getQueuePriority() == priority &&
+           !queue.top()->isdead();
+         --batch) {
+        local.tasks.push_back(queue.top());
+        queue.pop();
+        ++local.size;
+        ++batchedTasks;
+    }
+}
+
+bool TaskQueue::_fetchLocalTask(ExecutorThread& thread) {
+    ExTask task;
+    auto pop = [&task](LocalQueue& local, bool oldest) {
+        if (local.size == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lg(local.mutex);
+        if (local.tasks.empty()) {
+            return false;
+        }
+        if (oldest) {
+            task = std::move(local.tasks.front());
+            local.tasks.pop_front();
+        } else {
+            task = std::move(local.tasks.back());
+            local.tasks.pop_back();
+        }
+        --local.size;
+        return true;
+    };
+
+    bool found = pop(_getLocalQueue(thread), true);
+    if (!found) {
+        // Start looking after our own queue, so that idle threads spread
+        // themselves across the busy ones.
+        const size_t own = thread.getIndex() % numLocalQueues;
+        for (size_t i = 1; i < numLocalQueues && !found; ++i) {
+            found = pop(localQueues[(own + i) % numLocalQueues], false);
+        }
+        if (found) {
+            ++stolenTasks;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    // Local queues only hold front-end tasks, which are never throttled.
+    manager->lessWork(queueType, IOClass::FrontEnd);
+    manager->tryStartIOClass(queueType, IOClass::FrontEnd, false);
+    thread.curIOClass = IOClass::FrontEnd;
+    thread.setCurrentTask(task);
+    return true;
+}
+
 void TaskQueue::doWake(size_t &numToWake) {
     LockHolder lh(mutex);
     _doWake_UNLOCKED(numToWake);
@@ -114,6 +297,13 @@ bool TaskQueue::_doSleep(ExecutorThread &t,
 }
 
 bool TaskQueue::_fetchNextTask(ExecutorThread &t, bool toSleep) {
+    // Work through any tasks we (or a busy thread) batched earlier first;
+    // they were the most important ready tasks when batched, and don't need
+    // the (shared) TaskQueue mutex.
+    if (!toSleep && _fetchLocalTask(t)) {
+        return true;
+    }
+
     bool ret = false;
     std::unique_lock<std::mutex> lh(mutex);
 
@@ -129,17 +319,24 @@ bool TaskQueue::_fetchNextTask(ExecutorThread &t, bool toSleep) {
         t.setWaketime(futureQueue.top()->getWaketime());
     }
 
-    if (!readyQueue.empty() && readyQueue.top()->isdead()) {
-        t.setCurrentTask(_popReadyTask()); // clean out dead tasks first
-        ret = true;
-    } else if (!readyQueue.empty() || !pendingQueue.empty()) {
+    if (!_readyQueueEmpty() || !pendingQueue.empty()) {
         // we must consider any pending tasks too. To ensure prioritized run
         // order, the function below will push any pending task back into the
         // readyQueue (sorted by priority)
         _checkPendingQueue();
-        ExTask tid = _popReadyTask(); // and pop out the top task
-        t.setCurrentTask(tid);
-        ret = true;
+        // pop out the top task (dead tasks are cleaned out first)
+        ExTask tid = _selectReadyTask(t);
+        if (tid) {
+            t.setCurrentTask(tid);
+            ret = true;
+            if (t.curIOClass == IOClass::FrontEnd && !tid->isdead()) {
+                _fillLocalQueue(t, tid->getQueuePriority());
+            }
+        } else {
+            // Everything which is ready is throttled by its IOClass; waking
+            // other threads would not get it run any sooner.
+            numToWake = 0;
+        }
     } else { // Let the task continue waiting in pendingQueue
         numToWake = numToWake ? numToWake - 1 : 0; // 1 fewer task ready
     }
@@ -147,6 +344,11 @@ bool TaskQueue::_fetchNextTask(ExecutorThread &t, bool toSleep) {
     _doWake_UNLOCKED(numToWake);
     lh.unlock();
 
+    if (!ret) {
+        // Nothing runnable in the shared queues; tasks may have been batched
+        // while we were looking.
+        ret = _fetchLocalTask(t);
+    }
     return ret;
 }
 
@@ -158,24 +360,20 @@ bool TaskQueue::fetchNextTask(ExecutorThread &thread, bool toSleep) {
 }
 
 size_t TaskQueue::_moveReadyTasks(const ProcessClock::time_point tv) {
-    if (!readyQueue.empty()) {
+    // Ready tasks which are throttled by their IOClass don't count; they must
+    // not prevent front-end tasks in the futureQueue from becoming ready.
+    if (_hasRunnableReadyTask()) {
         return 0;
     }
 
-    size_t numReady = 0;
-    while (!futureQueue.empty()) {
-        ExTask tid = futureQueue.top();
-        if (tid->getWaketime() <= tv) {
-            futureQueue.pop();
-            readyQueue.push(tid);
-            numReady++;
-        } else {
-            break;
-        }
+    // Expire everything which is due in one go, rather than a top() / pop()
+    // (and a lock of the futureQueue) per task.
+    std::vector<ExTask> expired;
+    const size_t numReady = futureQueue.popExpired(tv, expired);
+    for (auto& tid : expired) {
+        _pushReadyTask(tid);
     }
 
-    manager->addWork(numReady, queueType);
-
     // Current thread will pop one task, so wake up one less thread
     return numReady ? numReady - 1 : 0;
 }
@@ -183,8 +381,7 @@ size_t TaskQueue::_moveReadyTasks(const ProcessClock::time_point tv) {
 void TaskQueue::_checkPendingQueue(void) {
     if (!pendingQueue.empty()) {
         ExTask runnableTask = pendingQueue.front();
-        readyQueue.push(runnableTask);
-        manager->addWork(1, queueType);
+        _pushReadyTask(runnableTask);
         pendingQueue.pop_front();
     }
 }
@@ -25,7 +25,11 @@
 
 #include <platform/processclock.h>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <list>
+#include <mutex>
 #include <queue>
 
 class ExecutorPool;
@@ -57,6 +61,8 @@ public:
 
     size_t getReadyQueueSize();
 
+    size_t getReadyQueueSize(IOClass ioClass);
+
     size_t getFutureQueueSize();
 
     size_t getPendingQueueSize();
@@ -65,7 +71,40 @@ public:
         futureQueue.snooze(task, secs);
     }
 
+    /// Number of local (work-stealing) queues per TaskQueue; worker threads
+    /// are mapped onto them by their index.
+    static const size_t numLocalQueues = 32;
+
+    /// Maximum number of ready front-end tasks a thread moves into its
+    /// local queue each time it fetches from the shared ready queue.
+    static const size_t localBatchSize = 4;
+
+    /// Total number of ready tasks moved into the local queues.
+    size_t getBatchedTaskCount() const {
+        return batchedTasks;
+    }
+
+    /// Total number of tasks fetched from another thread's local queue.
+    size_t getStolenTaskCount() const {
+        return stolenTasks;
+    }
+
 private:
+    /**
+     * A queue of ready front-end tasks, filled by (and normally drained by)
+     * the threads mapped onto it, but which any other thread of this queue
+     * with an empty local queue steals from. Only accessed under
+     * its own mutex, so threads working through their batches don't contend
+     * on the TaskQueue mutex.
+     */
+    struct LocalQueue {
+        std::mutex mutex;
+        std::deque<ExTask> tasks;
+        // Number of tasks; can be read without the mutex to skip empty
+        // queues when stealing.
+        std::atomic<size_t> size{0};
+    };
+
     void _schedule(ExTask &task);
     ProcessClock::time_point _reschedule(ExTask &task);
     void _checkPendingQueue(void);
@@ -74,7 +113,45 @@ private:
     bool _doSleep(ExecutorThread &thread, std::unique_lock<std::mutex>& lock);
     void _doWake_UNLOCKED(size_t &numToWake);
     size_t _moveReadyTasks(const ProcessClock::time_point tv);
-    ExTask _popReadyTask(void);
+    void _pushReadyTask(ExTask& task);
+    ExTask _popReadyTask(IOClass ioClass);
+    bool _readyQueueEmpty() const;
+    bool _hasRunnableReadyTask();
+
+    /**
+     * Select the next task to run on the given thread. Dead tasks are picked
+     * first, then front-end tasks, then the non front-end class with the
+     * lowest pass (see ioClassPass) - provided the pool has a free
+     * non front-end slot for this task type.
+     *
+     * @return the task to run, or nullptr if all ready tasks are throttled.
+     */
+    ExTask _selectReadyTask(ExecutorThread& thread);
+
+    /**
+     * Move up to localBatchSize of the ready front-end tasks with the given
+     * priority (i.e. those the thread would have run next anyway) into the
+     * thread's local queue, leaving at least half of them for other threads.
+     * Called with the TaskQueue mutex held.
+     */
+    void _fillLocalQueue(ExecutorThread& thread, queue_priority_t priority);
+
+    /**
+     * Fetch a task from the thread's own local queue (oldest first), or if
+     * that is empty, from the back of another thread's. A thread always
+     * drains its own local queue before fetching anything else, so tasks
+     * left in another one belong to a thread which is busy running a task
+     * (or which has been removed); they must not wait for the shared queues
+     * to empty. Doesn't need the TaskQueue mutex.
+     *
+     * @return true if a task was fetched (and set as the thread's current
+     *         task).
+     */
+    bool _fetchLocalTask(ExecutorThread& thread);
+
+    size_t _getLocalQueueSize() const;
+
+    LocalQueue& _getLocalQueue(const ExecutorThread& thread);
 
     SyncObject mutex;
     const std::string name;
@@ -82,14 +159,29 @@ private:
     ExecutorPool *manager;
     size_t sleepers; // number of threads sleeping in this taskQueue
 
-    // sorted by task priority.
-    std::priority_queue<ExTask, std::deque<ExTask>,
-                        CompareByPriority> readyQueue;
+    using ReadyQueue =
+            std::priority_queue<ExTask, std::deque<ExTask>, CompareByPriority>;
+
+    // sorted by task priority, one per IOClass.
+    std::array<ReadyQueue, size_t(IOClass::COUNT)> readyQueue;
+
+    // Stride scheduling state for the non front-end IOClasses; each time a
+    // class is served its pass advances by IO_CLASS_STRIDE / weight, and the
+    // ready class with the lowest pass is served next.
+    std::array<uint64_t, size_t(IOClass::COUNT)> ioClassPass;
 
     // sorted by waketime.
     FutureQueue<> futureQueue;
 
     std::list<ExTask> pendingQueue;
+
+    // Ready front-end tasks batched out of readyQueue for the worker threads.
+    // Tasks in here are still accounted as ready work (ExecutorPool::addWork)
+    // until they are fetched.
+    std::array<LocalQueue, numLocalQueues> localQueues;
+
+    std::atomic<size_t> batchedTasks{0};
+    std::atomic<size_t> stolenTasks{0};
 };
 
 #endif  // SRC_TASKQUEUE_H_
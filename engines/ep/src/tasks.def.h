@@ -18,64 +18,66 @@
 /*
  * Every task within ep-engine is declared in this file
  *
- * The TASK(name, task-type, priority) macro will be pre-processed to generate
+ * The TASK(name, task-type, priority, io-class) macro will be pre-processed to
+ * generate
  *   - a unique std::string name
  *   - a unique type-id
  *   - a unique priority object
  *   - a mapping from type-id to task type
+ *   - a mapping from type-id to I/O QoS class (see IOClass)
  *
  * task.h and .cc include this file with a customised TASK macro.
  */
 
 // Read IO tasks
-TASK(MultiBGFetcherTask, READER_TASK_IDX, 0)
-TASK(FetchAllKeysTask, READER_TASK_IDX, 0)
-TASK(Warmup, READER_TASK_IDX, 0)
-TASK(WarmupInitialize, READER_TASK_IDX, 0)
-TASK(WarmupCreateVBuckets, READER_TASK_IDX, 0)
-TASK(WarmupEstimateDatabaseItemCount, READER_TASK_IDX, 0)
-TASK(WarmupKeyDump, READER_TASK_IDX, 0)
-TASK(WarmupCheckforAccessLog, READER_TASK_IDX, 0)
-TASK(WarmupLoadAccessLog, READER_TASK_IDX, 0)
-TASK(WarmupLoadingKVPairs, READER_TASK_IDX, 0)
-TASK(WarmupLoadingData, READER_TASK_IDX, 0)
-TASK(WarmupCompletion, READER_TASK_IDX, 0)
-TASK(SingleBGFetcherTask, READER_TASK_IDX, 1)
-TASK(VKeyStatBGFetchTask, READER_TASK_IDX, 3)
+TASK(MultiBGFetcherTask, READER_TASK_IDX, 0, FrontEnd)
+TASK(FetchAllKeysTask, READER_TASK_IDX, 0, Background)
+TASK(Warmup, READER_TASK_IDX, 0, Background)
+TASK(WarmupInitialize, READER_TASK_IDX, 0, Background)
+TASK(WarmupCreateVBuckets, READER_TASK_IDX, 0, Background)
+TASK(WarmupEstimateDatabaseItemCount, READER_TASK_IDX, 0, Background)
+TASK(WarmupKeyDump, READER_TASK_IDX, 0, Background)
+TASK(WarmupCheckforAccessLog, READER_TASK_IDX, 0, Background)
+TASK(WarmupLoadAccessLog, READER_TASK_IDX, 0, Background)
+TASK(WarmupLoadingKVPairs, READER_TASK_IDX, 0, Background)
+TASK(WarmupLoadingData, READER_TASK_IDX, 0, Background)
+TASK(WarmupCompletion, READER_TASK_IDX, 0, Background)
+TASK(SingleBGFetcherTask, READER_TASK_IDX, 1, FrontEnd)
+TASK(VKeyStatBGFetchTask, READER_TASK_IDX, 3, FrontEnd)
 
 // Aux IO tasks
-TASK(BackfillDiskLoad, AUXIO_TASK_IDX, 1)
-TASK(VBucketMemoryAndDiskDeletionTask, AUXIO_TASK_IDX, 1)
-TASK(AccessScanner, AUXIO_TASK_IDX, 3)
-TASK(AccessScannerVisitor, AUXIO_TASK_IDX, 3)
-TASK(ActiveStreamCheckpointProcessorTask, AUXIO_TASK_IDX, 5)
-TASK(BackfillManagerTask, AUXIO_TASK_IDX, 8)
+TASK(BackfillDiskLoad, AUXIO_TASK_IDX, 1, Replication)
+TASK(VBucketMemoryAndDiskDeletionTask, AUXIO_TASK_IDX, 1, Background)
+TASK(AccessScanner, AUXIO_TASK_IDX, 3, Background)
+TASK(AccessScannerVisitor, AUXIO_TASK_IDX, 3, Background)
+TASK(ActiveStreamCheckpointProcessorTask, AUXIO_TASK_IDX, 5, Replication)
+TASK(BackfillManagerTask, AUXIO_TASK_IDX, 8, Replication)
 
 
 // Read/Write IO tasks
-TASK(RollbackTask, WRITER_TASK_IDX, 1)
-TASK(CompactVBucketTask, WRITER_TASK_IDX, 2)
-TASK(FlusherTask, WRITER_TASK_IDX, 5)
-TASK(StatSnap, WRITER_TASK_IDX, 9)
+TASK(RollbackTask, WRITER_TASK_IDX, 1, Replication)
+TASK(CompactVBucketTask, WRITER_TASK_IDX, 2, Background)
+TASK(FlusherTask, WRITER_TASK_IDX, 5, FrontEnd)
+TASK(StatSnap, WRITER_TASK_IDX, 9, Background)
 
 // Non-IO tasks
-TASK(PendingOpsNotification, NONIO_TASK_IDX, 0)
-TASK(NotifyHighPriorityReqTask, NONIO_TASK_IDX, 0)
-TASK(Processor, NONIO_TASK_IDX, 0)
-TASK(FlushAllTask, NONIO_TASK_IDX, 3)
-TASK(ConnNotifierCallback, NONIO_TASK_IDX, 5)
-TASK(ClosedUnrefCheckpointRemoverTask, NONIO_TASK_IDX, 6)
-TASK(ClosedUnrefCheckpointRemoverVisitorTask, NONIO_TASK_IDX, 6)
-TASK(VBucketMemoryDeletionTask, NONIO_TASK_IDX, 6)
-TASK(StatCheckpointTask, NONIO_TASK_IDX, 7)
-TASK(ItemPager, NONIO_TASK_IDX, 7)
-TASK(ExpiredItemPager, NONIO_TASK_IDX, 7)
-TASK(ItemPagerVisitor, NONIO_TASK_IDX, 7)
-TASK(ExpiredItemPagerVisitor, NONIO_TASK_IDX, 7)
-TASK(DefragmenterTask, NONIO_TASK_IDX, 7)
-TASK(EphTombstoneHTCleaner, NONIO_TASK_IDX, 7)
-TASK(EphTombstoneStaleItemDeleter, NONIO_TASK_IDX, 7)
-TASK(ConnManager, NONIO_TASK_IDX, 8)
-TASK(WorkLoadMonitor, NONIO_TASK_IDX, 10)
-TASK(HashtableResizerTask, NONIO_TASK_IDX, 211)
-TASK(HashtableResizerVisitorTask, NONIO_TASK_IDX, 7)
+TASK(PendingOpsNotification, NONIO_TASK_IDX, 0, FrontEnd)
+TASK(NotifyHighPriorityReqTask, NONIO_TASK_IDX, 0, FrontEnd)
+TASK(Processor, NONIO_TASK_IDX, 0, Background)
+TASK(FlushAllTask, NONIO_TASK_IDX, 3, Background)
+TASK(ConnNotifierCallback, NONIO_TASK_IDX, 5, Replication)
+TASK(ClosedUnrefCheckpointRemoverTask, NONIO_TASK_IDX, 6, Background)
+TASK(ClosedUnrefCheckpointRemoverVisitorTask, NONIO_TASK_IDX, 6, Background)
+TASK(VBucketMemoryDeletionTask, NONIO_TASK_IDX, 6, Background)
+TASK(StatCheckpointTask, NONIO_TASK_IDX, 7, Background)
+TASK(ItemPager, NONIO_TASK_IDX, 7, Background)
+TASK(ExpiredItemPager, NONIO_TASK_IDX, 7, Background)
+TASK(ItemPagerVisitor, NONIO_TASK_IDX, 7, Background)
+TASK(ExpiredItemPagerVisitor, NONIO_TASK_IDX, 7, Background)
+TASK(DefragmenterTask, NONIO_TASK_IDX, 7, Background)
+TASK(EphTombstoneHTCleaner, NONIO_TASK_IDX, 7, Background)
+TASK(EphTombstoneStaleItemDeleter, NONIO_TASK_IDX, 7, Background)
+TASK(ConnManager, NONIO_TASK_IDX, 8, Replication)
+TASK(WorkLoadMonitor, NONIO_TASK_IDX, 10, Background)
+TASK(HashtableResizerTask, NONIO_TASK_IDX, 211, Background)
+TASK(HashtableResizerVisitorTask, NONIO_TASK_IDX, 7, Background)
@@ -20,11 +20,15 @@
 #include "vbucket.h"
 
 PauseResumeVBAdapter::PauseResumeVBAdapter(
-        std::unique_ptr<VBucketAwareHTVisitor> htVisitor)
-    : htVisitor(std::move(htVisitor)) {
+        std::unique_ptr<VBucketAwareHTVisitor> htVisitor, VBucketFilter filter)
+    : htVisitor(std::move(htVisitor)), filter(std::move(filter)) {
 }
 
 bool PauseResumeVBAdapter::visit(VBucket& vb) {
+    if (!filter(vb.getId())) {
+        return true;
+    }
+
     // Check if this vbucket_id matches the position we should resume
     // from. If so then call the visitor using our stored HashTable::Position.
     HashTable::Position ht_start;
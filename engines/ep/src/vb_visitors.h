@@ -112,12 +112,18 @@ public:
  */
 class PauseResumeVBAdapter : public PauseResumeVBVisitor {
 public:
-    PauseResumeVBAdapter(std::unique_ptr<VBucketAwareHTVisitor> htVisitor);
+    /**
+     * @param htVisitor the HashTable visitor to apply to each VBucket
+     * @param filter the vBuckets to visit (all vBuckets if empty)
+     */
+    PauseResumeVBAdapter(std::unique_ptr<VBucketAwareHTVisitor> htVisitor,
+                         VBucketFilter filter = VBucketFilter());
 
     /**
      * Visit a VBucket within an epStore. Records the place where the visit
      * stops (when the wrapped htVisitor returns false), for later resuming
-     * from *approximately* the same place.
+     * from *approximately* the same place. VBuckets not accepted by the
+     * filter are skipped.
      */
     bool visit(VBucket& vb) override;
 
@@ -135,6 +141,9 @@ private:
     // The HashTable visitor to apply to each VBucket's HashTable.
     std::unique_ptr<VBucketAwareHTVisitor> htVisitor;
 
+    // Which vBuckets to visit.
+    const VBucketFilter filter;
+
     // When resuming, which vbucket should we start from?
     uint16_t resume_vbucket_id = 0;
 
@@ -46,6 +46,8 @@
 #include <type_traits>
 #include <unordered_map>
 
+#include <xattr/blob.h>
+
 #include "ep_testsuite_common.h"
 #include "ep_test_apis.h"
 
@@ -621,9 +623,21 @@ static enum test_result perf_latency_baseline_multi_bucket_4(engine_test_t* test
 enum class Doc_format {
     JSON_PADDED,
     JSON_RANDOM,
-    BINARY_RANDOM
+    BINARY_RANDOM,
+    JSON_LARGE_WITH_XATTRS
 };
 
+/* Size of the JSON body of Doc_format::JSON_LARGE_WITH_XATTRS documents */
+static const size_t LARGE_DOC_BODY_SIZE = 100 * 1024;
+
+/* Datatype documents of the given format should be stored with */
+static uint8_t getDocDatatype(Doc_format type) {
+    if (type == Doc_format::JSON_LARGE_WITH_XATTRS) {
+        return PROTOCOL_BINARY_DATATYPE_XATTR;
+    }
+    return PROTOCOL_BINARY_RAW_BYTES;
+}
+
 struct Handle_args {
     Handle_args(ENGINE_HANDLE *_h, ENGINE_HANDLE_V1 *_h1, int _count,
                 Doc_format _type, std::string _name, uint32_t _opaque,
@@ -757,6 +771,21 @@ std::vector<std::string> genVectorOfValues(Doc_format type,
                 vals.push_back(str);
             }
             break;
+        case Doc_format::JSON_LARGE_WITH_XATTRS:
+            for (size_t i = 0; i < count; ++i) {
+                // A small set of system xattrs in front of a large JSON body,
+                // as written by e.g. mobile sync.
+                cb::xattr::Blob blob;
+                blob.set("_sync", "{\"rev\":\"" + std::to_string(i) + "\"}");
+                auto xattrs = blob.finalize();
+                std::string doc(reinterpret_cast<const char*>(xattrs.buf),
+                                xattrs.len);
+                doc += "{\"one\":\"" + std::to_string(i) + "\", \"two\":\"" +
+                       make_random_string(alpha_dist, dre, LARGE_DOC_BODY_SIZE) +
+                       "\"}";
+                vals.push_back(doc);
+            }
+            break;
         default:
             check(false, "Unknown DATA requested!");
     }
@@ -781,7 +810,8 @@ static void perf_load_client(ENGINE_HANDLE* h,
     for (int i = 0; i < count; ++i) {
         checkeq(storeCasVb11(h, h1, NULL, OPERATION_SET, keys[i].c_str(),
                              vals[i].data(), vals[i].size(), /*flags*/9258,
-                             0, vbid).first,
+                             0, vbid, /*exp*/3600,
+                             getDocDatatype(typeOfData)).first,
                 cb::engine_errc::success,
                 "Failed set.");
         insertTimes.push_back(gethrtime());
@@ -1080,6 +1110,165 @@ static enum test_result perf_dcp_latency_with_random_binary(ENGINE_HANDLE *h,
                             Doc_format::BINARY_RANDOM, ITERATIONS / 20);
 }
 
+/*
+ * Large documents with xattrs streamed to a client which hasn't negotiated
+ * xattrs - i.e. the producer has to strip the xattrs from every mutation
+ * before sending the body.
+ */
+static enum test_result perf_dcp_latency_with_large_xattr_json(
+        ENGINE_HANDLE *h, ENGINE_HANDLE_V1 *h1) {
+    return perf_dcp_latency_and_bandwidth(h, h1,
+                            "DCP In-memory (JSON-LARGE-XATTR) [As_is vs. Compress]",
+                            Doc_format::JSON_LARGE_WITH_XATTRS, ITERATIONS / 200);
+}
+
+/*
+ * Opens a DCP consumer on `cookie` and adds a stream for each of the given
+ * (replica) vBuckets, acknowledging the resulting stream requests.
+ * Returns the opaque to use when sending messages for each stream.
+ */
+static std::vector<uint32_t> perf_open_consumer_streams(
+        ENGINE_HANDLE* h, ENGINE_HANDLE_V1* h1, const void* cookie,
+        const std::string& name, const std::vector<uint16_t>& vbuckets) {
+    checkeq(ENGINE_SUCCESS,
+            h1->dcp.open(h, cookie, /*opaque*/0, /*seqno*/0, /*flags*/0,
+                         name, {}),
+            "Failed dcp consumer open connection");
+    std::unique_ptr<dcp_message_producers> producers(get_dcp_producers(h, h1));
+
+    std::vector<uint32_t> opaques;
+    for (const auto vb : vbuckets) {
+        checkeq(ENGINE_SUCCESS,
+                h1->dcp.add_stream(h, cookie, /*opaque*/0, vb, /*flags*/0),
+                "Failed to add stream");
+        uint32_t streamOpaque = 0;
+        do {
+            dcp_last_op = 0;
+            h1->dcp.step(h, cookie, producers.get());
+            if (dcp_last_op != PROTOCOL_BINARY_CMD_DCP_STREAM_REQ) {
+                continue;
+            }
+            // Accept the stream with a single failover entry.
+            streamOpaque = dcp_last_opaque;
+            std::vector<uint8_t> buffer(
+                    sizeof(protocol_binary_response_header) + 16);
+            auto* pkt = reinterpret_cast<protocol_binary_response_header*>(
+                    buffer.data());
+            pkt->response.magic = PROTOCOL_BINARY_RES;
+            pkt->response.opcode = PROTOCOL_BINARY_CMD_DCP_STREAM_REQ;
+            pkt->response.status = htons(PROTOCOL_BINARY_RESPONSE_SUCCESS);
+            pkt->response.opaque = streamOpaque;
+            pkt->response.bodylen = htonl(16);
+            const uint64_t vb_uuid = htonll(123456789);
+            memcpy(buffer.data() + sizeof(*pkt), &vb_uuid, sizeof(vb_uuid));
+            checkeq(ENGINE_SUCCESS,
+                    h1->dcp.response_handler(h, cookie, pkt),
+                    "Failed to accept stream request");
+        } while (dcp_last_op != PROTOCOL_BINARY_CMD_DCP_ADD_STREAM);
+        opaques.push_back(streamOpaque);
+    }
+    return opaques;
+}
+
+/*
+ * Replica catch-up: buffers `items_per_vb` mutations for each of `num_vbs`
+ * replica vBuckets on one consumer while replication is throttled, then
+ * lifts the throttle and measures how long the consumer's Processor
+ * task(s) take to apply the backlog.
+ */
+static double perf_replica_catchup_run(ENGINE_HANDLE* h,
+                                       ENGINE_HANDLE_V1* h1,
+                                       const std::string& name,
+                                       uint16_t first_vb,
+                                       uint16_t num_vbs,
+                                       size_t items_per_vb,
+                                       size_t processor_tasks) {
+    check(set_param(h, h1, protocol_binary_engine_param_dcp,
+                    "dcp_consumer_processor_tasks",
+                    std::to_string(processor_tasks).c_str()),
+          "Failed to set dcp_consumer_processor_tasks");
+
+    std::vector<uint16_t> vbuckets;
+    for (uint16_t vb = first_vb; vb < first_vb + num_vbs; ++vb) {
+        check(set_vbucket_state(h, h1, vb, vbucket_state_replica),
+              "Failed set_vbucket_state for vbucket");
+        vbuckets.push_back(vb);
+    }
+
+    const void* cookie = testHarness.create_cookie();
+    const auto opaques =
+            perf_open_consumer_streams(h, h1, cookie, name, vbuckets);
+
+    const int initial_items = get_int_stat(h, h1, "vb_replica_curr_items");
+
+    // Force every message to be buffered by the PassiveStreams.
+    check(set_param(h, h1, protocol_binary_engine_param_flush,
+                    "replication_throttle_threshold", "0"),
+          "Failed to throttle replication");
+
+    const std::string value(256, 'x');
+    for (size_t ii = 0; ii < vbuckets.size(); ++ii) {
+        h1->dcp.snapshot_marker(h, cookie, opaques[ii], vbuckets[ii],
+                                /*start*/0, items_per_vb, /*flags*/1);
+        for (size_t seqno = 1; seqno <= items_per_vb; ++seqno) {
+            const std::string key = "key" + std::to_string(seqno);
+            h1->dcp.mutation(h, cookie, opaques[ii],
+                             {key, DocNamespace::DefaultCollection},
+                             {reinterpret_cast<const uint8_t*>(value.data()),
+                              value.size()},
+                             /*priv_bytes*/0, PROTOCOL_BINARY_RAW_BYTES,
+                             /*cas*/seqno, vbuckets[ii], /*flags*/0,
+                             /*by_seqno*/seqno, /*rev_seqno*/1,
+                             /*expiration*/0, /*lock_time*/0, {}, 0);
+        }
+    }
+
+    check(set_param(h, h1, protocol_binary_engine_param_flush,
+                    "replication_throttle_threshold", "99"),
+          "Failed to unthrottle replication");
+
+    // Time from the first applied mutation, so the Processors' back-off
+    // while throttled isn't measured.
+    const int expected = initial_items + int(num_vbs * items_per_vb);
+    while (get_int_stat(h, h1, "vb_replica_curr_items") == initial_items) {
+        std::this_thread::yield();
+    }
+    const hrtime_t start = gethrtime();
+    while (get_int_stat(h, h1, "vb_replica_curr_items") < expected) {
+        std::this_thread::yield();
+    }
+    const hrtime_t end = gethrtime();
+
+    testHarness.destroy_cookie(cookie);
+    return double(end - start) / 1e9;
+}
+
+static enum test_result perf_replica_catchup(ENGINE_HANDLE* h,
+                                             ENGINE_HANDLE_V1* h1) {
+    const uint16_t num_vbs = 16;
+    const size_t items_per_vb = ITERATIONS / 100;
+
+    printf("\n\n");
+    int printed = printf("=== Replica catch-up - %u vBuckets x %zu items",
+                         num_vbs, items_per_vb);
+    fillLineWith('=', 86 - printed);
+
+    uint16_t first_vb = 0;
+    for (const size_t tasks : {1, 4}) {
+        const std::string name = "catchup_" + std::to_string(tasks);
+        const double elapsed_s = perf_replica_catchup_run(
+                h, h1, name, first_vb, num_vbs, items_per_vb, tasks);
+        const std::string label =
+                std::to_string(tasks) + " Processor task(s)";
+        printf("%-40s %12.0f items/s\n", label.c_str(),
+               (num_vbs * items_per_vb) / elapsed_s);
+        first_vb += num_vbs;
+    }
+    printf("\n\n");
+
+    return SUCCESS;
+}
+
 static enum test_result perf_multi_thread_latency(engine_test_t* test) {
     return perf_latency_baseline_multi_thread_bucket(test,
                                                      1, /* bucket */
@@ -1349,6 +1538,15 @@ BaseTestCase testsuite_testcases[] = {
                  test_setup, teardown,
                  "backend=couchdb;ht_size=393209",
                  prepare, cleanup),
+        TestCase("DCP latency (Large JSON with XATTRs)",
+                 perf_dcp_latency_with_large_xattr_json,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare, cleanup),
+        TestCase("DCP replica catch-up", perf_replica_catchup,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare, cleanup),
         TestCaseV2("Multi thread latency", perf_multi_thread_latency,
                    NULL, NULL,
                    "backend=couchdb;ht_size=393209",
@@ -6188,11 +6188,20 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
         },
         {"dcp",
             {
+                "ep_dcp_backfill_buffer_bytes",
+                "ep_dcp_backfill_buffer_max_bytes",
+                "ep_dcp_backfill_scan_waiters",
+                "ep_dcp_compression_cache_bytes",
+                "ep_dcp_compression_cache_hits",
+                "ep_dcp_compression_cache_items",
+                "ep_dcp_compression_cache_misses",
                 "ep_dcp_count",
                 "ep_dcp_dead_conn_count",
                 "ep_dcp_items_remaining",
                 "ep_dcp_items_sent",
+                "ep_dcp_max_running_backfill_scans",
                 "ep_dcp_max_running_backfills",
+                "ep_dcp_num_running_backfill_scans",
                 "ep_dcp_num_running_backfills",
                 "ep_dcp_producer_count",
                 "ep_dcp_queue_fill",
@@ -6361,7 +6370,10 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_cursor_dropping_upper_mark",
                 "ep_data_traffic_enabled",
                 "ep_dbname",
+                "ep_dcp_backfill_bucket_byte_limit",
                 "ep_dcp_backfill_byte_limit",
+                "ep_dcp_backfill_max_concurrent_scans",
+                "ep_dcp_compression_cache_size",
                 "ep_dcp_conn_buffer_size",
                 "ep_dcp_conn_buffer_size_aggr_mem_threshold",
                 "ep_dcp_conn_buffer_size_aggressive_perc",
@@ -6375,9 +6387,11 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_dcp_idle_timeout",
                 "ep_dcp_noop_mandatory_for_v5_features",
                 "ep_dcp_noop_tx_interval",
+                "ep_dcp_producer_checkpoint_processor_tasks",
                 "ep_dcp_producer_snapshot_marker_yield_limit",
                 "ep_dcp_consumer_process_buffered_messages_yield_limit",
                 "ep_dcp_consumer_process_buffered_messages_batch_size",
+                "ep_dcp_consumer_processor_tasks",
                 "ep_dcp_scan_byte_limit",
                 "ep_dcp_scan_item_limit",
                 "ep_dcp_takeover_max_time",
@@ -6387,6 +6401,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_defragmenter_enabled",
                 "ep_defragmenter_interval",
                 "ep_enable_chk_merge",
+                "ep_executor_thread_placement",
                 "ep_exp_pager_enabled",
                 "ep_exp_pager_initial_run_time",
                 "ep_exp_pager_stime",
@@ -6400,6 +6415,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_ht_resize_interval",
                 "ep_ht_size",
                 "ep_initfile",
+                "ep_io_background_weight",
+                "ep_io_frontend_reserved_pcnt",
+                "ep_io_replication_weight",
                 "ep_item_num_based_new_chk",
                 "ep_keep_closed_chks",
                 "ep_max_checkpoints",
@@ -6535,7 +6553,10 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_cursors_dropped",
                 "ep_data_traffic_enabled",
                 "ep_dbname",
+                "ep_dcp_backfill_bucket_byte_limit",
                 "ep_dcp_backfill_byte_limit",
+                "ep_dcp_backfill_max_concurrent_scans",
+                "ep_dcp_compression_cache_size",
                 "ep_dcp_conn_buffer_size",
                 "ep_dcp_conn_buffer_size_aggr_mem_threshold",
                 "ep_dcp_conn_buffer_size_aggressive_perc",
@@ -6543,6 +6564,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_dcp_conn_buffer_size_perc",
                 "ep_dcp_consumer_process_buffered_messages_batch_size",
                 "ep_dcp_consumer_process_buffered_messages_yield_limit",
+                "ep_dcp_consumer_processor_tasks",
                 "ep_dcp_enable_noop",
                 "ep_dcp_ephemeral_backfill_type",
                 "ep_dcp_flow_control_policy",
@@ -6551,6 +6573,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_dcp_min_compression_ratio",
                 "ep_dcp_noop_mandatory_for_v5_features",
                 "ep_dcp_noop_tx_interval",
+                "ep_dcp_producer_checkpoint_processor_tasks",
                 "ep_dcp_producer_snapshot_marker_yield_limit",
                 "ep_dcp_scan_byte_limit",
                 "ep_dcp_scan_item_limit",
@@ -6569,6 +6592,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_diskqueue_memory",
                 "ep_diskqueue_pending",
                 "ep_enable_chk_merge",
+                "ep_executor_thread_placement",
                 "ep_exp_pager_enabled",
                 "ep_exp_pager_initial_run_time",
                 "ep_exp_pager_stime",
@@ -6588,8 +6612,11 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_ht_resize_interval",
                 "ep_ht_size",
                 "ep_initfile",
+                "ep_io_background_weight",
                 "ep_io_compaction_read_bytes",
                 "ep_io_compaction_write_bytes",
+                "ep_io_frontend_reserved_pcnt",
+                "ep_io_replication_weight",
                 "ep_io_total_read_bytes",
                 "ep_io_total_write_bytes",
                 "ep_item_num",
@@ -6857,6 +6884,13 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                           "ep_ephemeral_metadata_purge_age",
                           "ep_ephemeral_metadata_purge_chunk_duration",
                           "ep_ephemeral_metadata_purge_interval",
+                          "ep_ephemeral_metadata_purge_tasks",
+                          "ep_ephemeral_purge_backlog",
+                          "ep_ephemeral_purge_chunk_duration",
+                          "ep_ephemeral_purge_items_deleted",
+                          "ep_ephemeral_purge_items_marked_stale",
+                          "ep_ephemeral_purge_items_per_sec",
+                          "ep_ephemeral_seqlist_type",
 
                           "vb_active_auto_delete_count",
                           "vb_active_ht_tombstone_purged_count",
@@ -6896,6 +6930,8 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                            "vb_0:seqlist_deleted_count",
                            "vb_0:seqlist_high_seqno",
                            "vb_0:seqlist_highest_deduped_seqno",
+                           "vb_0:seqlist_index_bytes",
+                           "vb_0:seqlist_overhead_per_item",
                            "vb_0:seqlist_purged_count",
                            "vb_0:seqlist_range_read_begin",
                            "vb_0:seqlist_range_read_count",
@@ -6909,7 +6945,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                             {"ep_ephemeral_full_policy",
                              "ep_ephemeral_metadata_purge_age",
                              "ep_ephemeral_metadata_purge_chunk_duration",
-                             "ep_ephemeral_metadata_purge_interval"});
+                             "ep_ephemeral_metadata_purge_interval",
+                             "ep_ephemeral_metadata_purge_tasks",
+                             "ep_ephemeral_seqlist_type"});
     }
 
     bool error = false;
@@ -1327,6 +1327,56 @@ static enum test_result test_dcp_consumer_flow_control_static(ENGINE_HANDLE *h,
     return SUCCESS;
 }
 
+static enum test_result test_dcp_consumer_flow_control_adaptive(
+                                                        ENGINE_HANDLE *h,
+                                                        ENGINE_HANDLE_V1 *h1) {
+    const auto *cookie = testHarness.create_cookie();
+    const std::string name("unittest");
+    const uint32_t opaque = 0;
+    const uint32_t seqno = 0;
+    const uint32_t flags = 0;
+    checkeq(ENGINE_SUCCESS,
+            h1->dcp.open(h, cookie, opaque, seqno, flags, name, {}),
+            "Failed dcp consumer open connection.");
+
+    /* The buffer starts at the min size until there is an estimate */
+    const std::string prefix("eq_dcpq:" + name + ":");
+    checkeq(10485760,
+            get_int_stat(h, h1, (prefix + "max_buffer_bytes").c_str(), "dcp"),
+            "Flow Control Buffer Size not equal to min");
+    checkeq(0,
+            get_int_stat(h, h1, (prefix + "acked_bytes_per_sec").c_str(),
+                         "dcp"),
+            "Expected no throughput before any buffer ack");
+
+    /* The response to the buffer size control message samples the rtt */
+    dcp_step(h, h1, cookie);
+    checkeq(static_cast<uint8_t>(PROTOCOL_BINARY_CMD_DCP_CONTROL),
+            dcp_last_op, "Expected a control message");
+    checkeq(std::string("connection_buffer_size"), dcp_last_key,
+            "Expected the flow control buffer size");
+    checkeq(0,
+            get_int_stat(h, h1, (prefix + "control_min_rtt_us").c_str(),
+                         "dcp"),
+            "Expected no rtt before the response");
+
+    protocol_binary_response_header resp;
+    memset(resp.bytes, 0, sizeof(resp.bytes));
+    resp.response.magic = PROTOCOL_BINARY_RES;
+    resp.response.opcode = PROTOCOL_BINARY_CMD_DCP_CONTROL;
+    resp.response.status = htons(PROTOCOL_BINARY_RESPONSE_SUCCESS);
+    resp.response.opaque = dcp_last_opaque;
+    checkeq(ENGINE_SUCCESS,
+            h1->dcp.response_handler(h, cookie, &resp),
+            "Expected success");
+    check(get_int_stat(h, h1, (prefix + "control_min_rtt_us").c_str(),
+                       "dcp") > 0,
+          "Expected the rtt to be sampled");
+
+    testHarness.destroy_cookie(cookie);
+    return SUCCESS;
+}
+
 static enum test_result test_dcp_consumer_flow_control_dynamic(ENGINE_HANDLE *h,
                                                         ENGINE_HANDLE_V1 *h1) {
     const auto *cookie1 = testHarness.create_cookie();
@@ -5936,6 +5986,10 @@ static enum test_result test_set_dcp_param(ENGINE_HANDLE *h,
     func("dcp_consumer_process_buffered_messages_batch_size", 1000, true);
     func("dcp_consumer_process_buffered_messages_yield_limit", 0, false);
     func("dcp_consumer_process_buffered_messages_batch_size", 0, false);
+    func("dcp_consumer_processor_tasks", 4, true);
+    func("dcp_consumer_processor_tasks", 0, false);
+    func("dcp_producer_checkpoint_processor_tasks", 4, true);
+    func("dcp_producer_checkpoint_processor_tasks", 0, false);
     return SUCCESS;
 }
 
@@ -5973,6 +6027,10 @@ BaseTestCase testsuite_testcases[] = {
                  test_dcp_consumer_flow_control_aggressive,
                  test_setup, teardown, "dcp_flow_control_policy=aggressive",
                  prepare, cleanup),
+        TestCase("test dcp consumer flow control adaptive",
+                 test_dcp_consumer_flow_control_adaptive,
+                 test_setup, teardown, "dcp_flow_control_policy=adaptive",
+                 prepare, cleanup),
         TestCase("test open producer", test_dcp_producer_open,
                  test_setup, teardown, nullptr, prepare, cleanup),
         TestCase("test open producer same cookie", test_dcp_producer_open_same_cookie,
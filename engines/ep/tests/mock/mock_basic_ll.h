@@ -46,19 +46,26 @@ public:
         return allSeqnos;
     }
 
-    /// Expose the rangeReadLock for testing.
-    std::mutex& getRangeReadLock() {
-        return rangeReadLock;
+    /// Expose the purgeLock for testing.
+    std::mutex& getPurgeLock() {
+        return purgeLock;
     }
 
-    /* Register fake read range for testing */
+    /* Register fake read range for testing (replacing any registered) */
     void registerFakeReadRange(seqno_t start, seqno_t end) {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange = SeqRange(start, end);
+        readRanges.clear();
+        readRanges.emplace_back(start, end);
+    }
+
+    /* Register an additional fake read range for testing */
+    void addFakeReadRange(seqno_t start, seqno_t end) {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        readRanges.emplace_back(start, end);
     }
 
     void resetReadRange() {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
+        readRanges.clear();
     }
 };
@@ -36,4 +36,8 @@ public:
     bool getBackfillBufferFullStatus() {
         return buffer.full;
     }
+
+    void setScanVTime(uint64_t vtime) {
+        scanVTime = vtime;
+    }
 };
@@ -36,6 +36,10 @@ public:
         return pendingNotifications;
     }
 
+    AtomicQueue<uint16_t>& getPendingVBNotifications() {
+        return pendingVBNotifications;
+    }
+
     void initialize() {
         connNotifier_ = new ConnNotifier(*this);
         // We do not create a ConnNotifierCallback task
@@ -47,6 +47,14 @@ public:
         notifyVbucketReady(vbid);
     }
 
+    size_t getNumProcessors() const {
+        return processors.size();
+    }
+
+    size_t getProcessorReadyQueueSize(size_t partition) {
+        return processors[partition]->vbReady.size();
+    }
+
     uint32_t getNumBackoffs() const {
         return backoffs.load();
     }
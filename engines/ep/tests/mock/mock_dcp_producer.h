@@ -70,23 +70,27 @@ public:
     }
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreatorTask
+     * Create the ActiveStreamCheckpointProcessorTasks and assign to
+     * checkpointCreatorTasks
      */
     void createCheckpointProcessorTask() {
         DcpProducer::createCheckpointProcessorTask();
     }
 
     /**
-     * Schedule the checkpointCreatorTask on the ExecutorPool
+     * Schedule the checkpointCreatorTasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask() {
         DcpProducer::scheduleCheckpointProcessorTask();
     }
 
-    ActiveStreamCheckpointProcessorTask& getCheckpointSnapshotTask() const {
-        return *static_cast<ActiveStreamCheckpointProcessorTask*>(
-                checkpointCreatorTask.get());
+    ActiveStreamCheckpointProcessorTask& getCheckpointSnapshotTask(
+            uint16_t vbid = 0) const {
+        return getCheckpointProcessorTask(vbid);
+    }
+
+    size_t getNumCheckpointSnapshotTasks() const {
+        return checkpointCreatorTasks.size();
     }
 
     /**
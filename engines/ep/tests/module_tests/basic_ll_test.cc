@@ -216,7 +216,8 @@ protected:
      * one always.
      */
     SequenceList::RangeIterator getRangeIterator() {
-        auto itrOptional = basicLL->makeRangeIterator(true /*isBackfill*/);
+        auto itrOptional =
+                basicLL->makeRangeIterator(true /*isBackfill*/, 0 /*start*/);
         EXPECT_TRUE(itrOptional);
         return std::move(*itrOptional);
     }
@@ -661,7 +662,7 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
 }
 
 /* Creates 2 range iterators such that iterator2 is created after iterator1
-   has read all items, and has hence released the rangeReadLock, but before
+   has read all items, and has hence released its read range, but before
    iterator1 is deleted */
 TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
     const int numItems = 3;
@@ -675,7 +676,8 @@ TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
        the function scope ends */
     auto itr1Optional =
             std::make_unique<boost::optional<SequenceList::RangeIterator>>(
-                    basicLL->makeRangeIterator(true /*isBackfill*/));
+                    basicLL->makeRangeIterator(true /*isBackfill*/,
+                                               0 /*start*/));
     auto itr1 = std::move(**itr1Optional);
 
     /* Read all items */
@@ -699,7 +701,7 @@ TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
     EXPECT_EQ(expectedSeqno, actualSeqno);
 }
 
-TEST_F(BasicLinkedListTest, NonBlockingRangeIterators) {
+TEST_F(BasicLinkedListTest, ConcurrentRangeIterators) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
@@ -707,25 +709,34 @@ TEST_F(BasicLinkedListTest, NonBlockingRangeIterators) {
     std::vector<seqno_t> expectedSeqno =
             addNewItemsToList(1, keyPrefix, numItems);
 
-    {
-        auto itr1 = getRangeIterator();
-        auto itr2 = basicLL->makeRangeIterator(true /*isBackfill*/);
-        /* itr1 is already using the list, we cannot have another iterator */
-        EXPECT_FALSE(itr2);
+    /* Both iterators can exist at once, each with its own snapshot */
+    auto itr1 = getRangeIterator();
+    auto itr2 = getRangeIterator();
 
-        /* itr1 goes out of scope and releases the read lock on the list */
+    /* Read all the items with itr2, while itr1 stays at the first item */
+    std::vector<seqno_t> actualSeqno;
+    while (itr2.curr() != itr2.end()) {
+        actualSeqno.push_back((*itr2).getBySeqno());
+        ++itr2;
     }
+    EXPECT_EQ(expectedSeqno, actualSeqno);
+    EXPECT_EQ(1, basicLL->getRangeReadBegin());
+    EXPECT_EQ(numItems, basicLL->getRangeReadEnd());
 
-    /* Iterator created now, should be able to read all items */
-    auto itr = getRangeIterator();
-    std::vector<seqno_t> actualSeqno;
+    /* The first item is still in itr1's range and hence cannot be moved */
+    updateItemDuringRangeRead(numItems, keyPrefix + std::to_string(1));
 
-    /* Read all the items with the iterator */
-    while (itr.curr() != itr.end()) {
-        actualSeqno.push_back((*itr).getBySeqno());
-        ++itr;
+    /* itr1 still reads its point-in-time snapshot */
+    actualSeqno.clear();
+    while (itr1.curr() != itr1.end()) {
+        actualSeqno.push_back((*itr1).getBySeqno());
+        ++itr1;
     }
     EXPECT_EQ(expectedSeqno, actualSeqno);
+
+    /* Both iterators are done; no range remains on the list */
+    EXPECT_EQ(0, basicLL->getRangeReadBegin());
+    EXPECT_EQ(0, basicLL->getRangeReadEnd());
 }
 
 TEST_F(BasicLinkedListTest, RangeReadStopsOnInvalidSeqno) {
@@ -31,6 +31,7 @@
 #include "dcp/backfill_disk.h"
 #include "dcp/dcp-types.h"
 #include "dcp/dcpconnmap.h"
+#include "dcp/flow-control-manager.h"
 #include "dcp/producer.h"
 #include "dcp/stream.h"
 #include "ep_time.h"
@@ -286,6 +287,59 @@ TEST_P(StreamTest, test_streamIsKeyOnlyFalseBecauseOfIncludeXattrs) {
     destroy_dcp_stream();
 }
 
+/*
+ * Test that DcpProducer::stepBatch() sends all ready messages, up to the
+ * requested maximum, in a single call.
+ */
+TEST_P(StreamTest, stepBatch) {
+    for (int i = 0; i < 3; ++i) {
+        store_item(vbid, "key" + std::to_string(i), "value");
+    }
+
+    const void* cookie = create_mock_cookie();
+    mock_dcp_producer_t batchProducer = new MockDcpProducer(*engine,
+                                                            cookie,
+                                                            "test_producer",
+                                                            /*flags*/ 0,
+                                                            {/*no json*/});
+    uint64_t rollbackSeqno;
+    ASSERT_EQ(ENGINE_SUCCESS,
+              batchProducer->streamRequest(/*flags*/ 0,
+                                           /*opaque*/ 0,
+                                           vbid,
+                                           /*start_seqno*/ 0,
+                                           /*end_seqno*/ ~0,
+                                           /*vb_uuid*/ 0,
+                                           /*snap_start*/ 0,
+                                           /*snap_end*/ ~0,
+                                           &rollbackSeqno,
+                                           StreamTest::fakeDcpAddFailoverLog));
+    batchProducer->notifySeqnoAvailable(vbid, vb0->getHighSeqno());
+
+    std::unique_ptr<dcp_message_producers> producers(
+            get_dcp_producers(handle, engine_v1));
+
+    // Nothing is ready until the checkpoint processor task has run.
+    EXPECT_EQ(ENGINE_SUCCESS, batchProducer->stepBatch(producers.get(), 10));
+    batchProducer->getCheckpointSnapshotTask().run();
+
+    // A batch of 2 should give the snapshot marker and the first mutation.
+    EXPECT_EQ(ENGINE_WANT_MORE, batchProducer->stepBatch(producers.get(), 2));
+    EXPECT_EQ(PROTOCOL_BINARY_CMD_DCP_MUTATION, dcp_last_op);
+    EXPECT_EQ(1, dcp_last_byseqno);
+
+    // The remaining mutations should all be sent by the next call.
+    EXPECT_EQ(ENGINE_WANT_MORE, batchProducer->stepBatch(producers.get(), 10));
+    EXPECT_EQ(PROTOCOL_BINARY_CMD_DCP_MUTATION, dcp_last_op);
+    EXPECT_EQ(3, dcp_last_byseqno);
+
+    EXPECT_EQ(ENGINE_SUCCESS, batchProducer->stepBatch(producers.get(), 10));
+
+    batchProducer->closeAllStreams();
+    batchProducer->clearCheckpointProcessorTaskQueues();
+    destroy_mock_cookie(cookie);
+}
+
 /*
  * Test for a dcpResponse retrieved from a stream where IncludeValue and
  * IncludeXattrs are both No, that the message size does not include the size of
@@ -549,6 +603,34 @@ TEST_P(StreamTest, MB17653_ItemsRemaining) {
     destroy_dcp_stream();
 }
 
+/*
+ * Test that a producer's checkpoint processing is sharded across
+ * dcp_producer_checkpoint_processor_tasks tasks by vbucket, and that a
+ * stream is only ever queued once, on the task owning its vbucket.
+ */
+TEST_P(StreamTest, checkpointProcessorTaskSharding) {
+    engine->getConfiguration().setDcpProducerCheckpointProcessorTasks(4);
+    setup_dcp_stream();
+    ASSERT_EQ(4, producer->getNumCheckpointSnapshotTasks());
+
+    producer->scheduleCheckpointProcessorTask(stream);
+    producer->scheduleCheckpointProcessorTask(stream);
+
+    for (uint16_t shard = 0; shard < 4; ++shard) {
+        EXPECT_EQ(shard == (vbid % 4) ? 1 : 0,
+                  producer->getCheckpointSnapshotTask(shard).queueSize())
+                << "Unexpected queue size for task " << shard;
+    }
+
+    // Every vbucket which maps to the same task shares its queue.
+    EXPECT_EQ(&producer->getCheckpointSnapshotTask(vbid),
+              &producer->getCheckpointSnapshotTask(vbid + 4));
+
+    producer->clearCheckpointProcessorTaskQueues();
+    EXPECT_EQ(0, producer->getCheckpointSnapshotTask(vbid).queueSize());
+    destroy_dcp_stream();
+}
+
 TEST_P(StreamTest, test_mb18625) {
     // Add an item.
     store_item(vbid, "key", "value");
@@ -1747,6 +1829,262 @@ TEST_F(NotifyTest, test_mb19503_connmap_notify_paused) {
     EXPECT_EQ(1, notifyTest.getCallbacks());
 }
 
+// Check that seqno notifications for a vbucket are coalesced until the
+// ConnNotifier has processed them, and that vbuckets without connections
+// are not queued at all.
+TEST_F(NotifyTest, coalescedVBNotifications) {
+    ConnMapNotifyTest notifyTest(*engine);
+    auto& connMap = *notifyTest.connMap;
+    connection_t conn(notifyTest.producer.get());
+    connMap.addVBConnByVBId(conn, 0);
+
+    for (uint64_t seqno = 1; seqno <= 10; ++seqno) {
+        connMap.notifyVBConnections(0, seqno);
+    }
+    EXPECT_EQ(1, connMap.getPendingVBNotifications().size());
+
+    connMap.notifyVBConnections(1, 1);
+    EXPECT_EQ(1, connMap.getPendingVBNotifications().size());
+
+    connMap.processDeferredNotifications();
+    EXPECT_EQ(0, connMap.getPendingVBNotifications().size());
+
+    // Once processed, the next notification queues the vbucket again.
+    connMap.notifyVBConnections(0, 11);
+    EXPECT_EQ(1, connMap.getPendingVBNotifications().size());
+
+    connMap.processDeferredNotifications();
+    connMap.removeVBConnByVBId(conn, 0);
+    connMap.notifyVBConnections(0, 12);
+    EXPECT_EQ(0, connMap.getPendingVBNotifications().size());
+}
+
+static int coalescedNotifyCallbacks;
+static void count_notify_io_complete(const void*, ENGINE_ERROR_CODE) {
+    coalescedNotifyCallbacks++;
+}
+
+/**
+ * Replaces the notify_io_complete method of the mock server API, and puts
+ * the original back when it goes out of scope (even if the test fails), so
+ * that later tests don't inherit the replacement.
+ */
+class NotifyIoCompleteHook {
+public:
+    using Callback = decltype(SERVER_COOKIE_API::notify_io_complete);
+
+    explicit NotifyIoCompleteHook(Callback hook)
+        : scapi(get_mock_server_api()->cookie),
+          original(scapi->notify_io_complete) {
+        scapi->notify_io_complete = hook;
+    }
+
+    ~NotifyIoCompleteHook() {
+        scapi->notify_io_complete = original;
+    }
+
+private:
+    SERVER_COOKIE_API* scapi;
+    const Callback original;
+};
+
+// Check that a connection queued several times is only notified once per
+// call to notifyAllPausedConnections.
+TEST_F(NotifyTest, notifyPausedConnectionOncePerPass) {
+    ConnMapNotifyTest notifyTest(*engine);
+    NotifyIoCompleteHook hook(count_notify_io_complete);
+    coalescedNotifyCallbacks = 0;
+
+    ASSERT_TRUE(notifyTest.producer->isPaused());
+    for (int ii = 0; ii < 3; ++ii) {
+        notifyTest.connMap->notifyPausedConnection(notifyTest.producer.get(),
+                                                   /*schedule*/true);
+    }
+    EXPECT_EQ(3, notifyTest.connMap->getPendingNotifications().size());
+
+    notifyTest.connMap->notifyAllPausedConnections();
+    EXPECT_EQ(1, coalescedNotifyCallbacks);
+    EXPECT_EQ(0, notifyTest.connMap->getPendingNotifications().size());
+}
+
+// Check that a consumer's vbuckets are partitioned across its Processor
+// tasks, and that processing one partition leaves the others untouched.
+TEST_P(ConnectionTest, consumerProcessorPartitions) {
+    engine->getConfiguration().setDcpConsumerProcessorTasks(2);
+    const void* cookie = create_mock_cookie();
+    connection_t conn = new MockDcpConsumer(*engine, cookie, "test_consumer");
+    auto* consumer = dynamic_cast<MockDcpConsumer*>(conn.get());
+    ASSERT_EQ(2, consumer->getNumProcessors());
+
+    consumer->public_notifyVbucketReady(0);
+    consumer->public_notifyVbucketReady(1);
+    consumer->public_notifyVbucketReady(2);
+    // Already queued - must not be queued twice.
+    consumer->public_notifyVbucketReady(2);
+    EXPECT_EQ(2, consumer->getProcessorReadyQueueSize(0));
+    EXPECT_EQ(1, consumer->getProcessorReadyQueueSize(1));
+
+    // No streams exist, so each queued vbucket is simply dropped.
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(1));
+    EXPECT_EQ(2, consumer->getProcessorReadyQueueSize(0));
+    EXPECT_EQ(0, consumer->getProcessorReadyQueueSize(1));
+
+    destroy_mock_cookie(cookie);
+}
+
+/*
+ * The adaptive flow control policy resizes buffers to the size requested by
+ * the connections, within the min/max sizes, and only grows a buffer into the
+ * memory left under the aggregate threshold by the other connections.
+ */
+TEST_P(ConnectionTest, adaptiveFlowControlResize) {
+    Configuration& config = engine->getConfiguration();
+    const size_t minSize = config.getDcpConnBufferSize();
+    const size_t maxSize = config.getDcpConnBufferSizeMax();
+    ASSERT_LT(2 * minSize, maxSize);
+
+    // Leave room for 3 min size buffers under the threshold.
+    engine->getEpStats().setMaxDataSize(
+            3 * minSize * 100 /
+            config.getDcpConnBufferSizeAggrMemThreshold());
+
+    DcpFlowControlManagerAdaptive manager(*engine);
+    EXPECT_TRUE(manager.isAdaptive());
+    const void* cookie1 = create_mock_cookie();
+    const void* cookie2 = create_mock_cookie();
+    connection_t conn1 = new MockDcpConsumer(*engine, cookie1, "consumer1");
+    connection_t conn2 = new MockDcpConsumer(*engine, cookie2, "consumer2");
+    auto* consumer1 = dynamic_cast<MockDcpConsumer*>(conn1.get());
+    auto* consumer2 = dynamic_cast<MockDcpConsumer*>(conn2.get());
+
+    EXPECT_EQ(minSize, manager.newConsumerConn(consumer1));
+    EXPECT_EQ(minSize, manager.newConsumerConn(consumer2));
+
+    // consumer1 may only grow into the free 2 * minSize.
+    EXPECT_EQ(2 * minSize, manager.resizeConsumerConn(consumer1, maxSize));
+    // Nothing is left for consumer2 to grow into.
+    EXPECT_EQ(minSize, manager.resizeConsumerConn(consumer2, maxSize));
+
+    // A buffer is never shrunk below the min size...
+    EXPECT_EQ(minSize, manager.resizeConsumerConn(consumer1, 0));
+    // ...and shrinking one lets the others grow.
+    EXPECT_EQ(2 * minSize, manager.resizeConsumerConn(consumer2, maxSize));
+
+    manager.handleDisconnect(consumer2);
+    EXPECT_THROW(manager.resizeConsumerConn(consumer2, maxSize),
+                 std::invalid_argument);
+    manager.handleDisconnect(consumer1);
+
+    destroy_mock_cookie(cookie1);
+    destroy_mock_cookie(cookie2);
+}
+
+/*
+ * Backfill scan slots are shared by all the connections of the bucket: once
+ * they are all in use, a freed slot goes to the waiting connection which has
+ * scanned the least.
+ */
+TEST_P(ConnectionTest, backfillScanSlotsSharedFairly) {
+    DcpConnMap& connMap = engine->getDcpConnMap();
+    const size_t maxScans =
+            engine->getConfiguration().getDcpBackfillMaxConcurrentScans();
+    auto busy = std::make_shared<MockDcpBackfillManager>(*engine);
+    auto idle = std::make_shared<MockDcpBackfillManager>(*engine);
+    busy->setScanVTime(1000);
+
+    for (size_t i = 0; i < maxScans; ++i) {
+        EXPECT_TRUE(connMap.acquireBackfillScan(*busy));
+    }
+    EXPECT_EQ(maxScans, connMap.getNumRunningBackfillScans());
+
+    // No slot left; idle is remembered as a waiter.
+    EXPECT_FALSE(connMap.acquireBackfillScan(*idle));
+
+    // A freed slot must go to idle, even if busy asks first.
+    connMap.releaseBackfillScan();
+    EXPECT_FALSE(connMap.acquireBackfillScan(*busy));
+    EXPECT_TRUE(connMap.acquireBackfillScan(*idle));
+
+    for (size_t i = 0; i < maxScans; ++i) {
+        connMap.releaseBackfillScan();
+    }
+    EXPECT_EQ(0, connMap.getNumRunningBackfillScans());
+    EXPECT_THROW(connMap.releaseBackfillScan(), std::logic_error);
+}
+
+/*
+ * The backfill byte budget is shared by all the connections of the bucket;
+ * reads beyond it are refused unless forced, until a quarter of it is freed.
+ */
+TEST_P(ConnectionTest, backfillBucketByteBudget) {
+    DcpConnMap& connMap = engine->getDcpConnMap();
+    engine->getConfiguration().setDcpBackfillBucketByteLimit(100);
+    connMap.updateMaxActiveSnoozingBackfills(
+            engine->getEpStats().getMaxDataSize());
+    auto mgr = std::make_shared<MockDcpBackfillManager>(*engine);
+
+    EXPECT_TRUE(connMap.canBackfillReadBytes(*mgr));
+    EXPECT_TRUE(connMap.reserveBackfillBytes(60, false));
+    EXPECT_FALSE(connMap.reserveBackfillBytes(60, false));
+    EXPECT_FALSE(connMap.canBackfillReadBytes(*mgr));
+    EXPECT_TRUE(connMap.reserveBackfillBytes(60, true));
+
+    // 80 bytes still buffered: not enough freed yet.
+    connMap.releaseBackfillBytes(40);
+    EXPECT_FALSE(connMap.canBackfillReadBytes(*mgr));
+
+    connMap.releaseBackfillBytes(10);
+    EXPECT_TRUE(connMap.canBackfillReadBytes(*mgr));
+    EXPECT_TRUE(connMap.reserveBackfillBytes(30, false));
+
+    connMap.releaseBackfillBytes(100);
+}
+
+/*
+ * Items streamed by several producers are compressed once: later requests
+ * for the same vbucket, seqno and CAS get the cached compressed copy, and
+ * the least recently used copies are evicted once the cache is full.
+ */
+TEST(DcpCompressedValueCacheTest, compressOnceAndEvict) {
+    const std::string value(4096, 'x');
+    uint8_t ext_meta[EXT_META_LEN] = {PROTOCOL_BINARY_DATATYPE_JSON};
+    auto makeItem = [&value, &ext_meta](int64_t seqno) {
+        return queued_item(new Item(makeStoredDocKey("key"),
+                                    /*flags*/ 0,
+                                    /*exp*/ 0,
+                                    value.c_str(),
+                                    value.size(),
+                                    ext_meta,
+                                    sizeof(ext_meta),
+                                    /*cas*/ 1,
+                                    seqno));
+    };
+
+    // Size the cache so each of its 16 shards holds two compressed items
+    auto item = makeItem(1);
+    Item copy(*item);
+    ASSERT_TRUE(copy.compressValue(0.85));
+    DcpCompressedValueCache cache(16 * (copy.size() * 5 / 2));
+    auto compressed = cache.getCompressed(item, 0.85);
+    EXPECT_TRUE(mcbp::datatype::is_snappy(compressed->getDataType()));
+    EXPECT_LT(compressed->getNBytes(), value.size());
+    EXPECT_FALSE(mcbp::datatype::is_snappy(item->getDataType()));
+    EXPECT_EQ(0, cache.getNumHits());
+    EXPECT_EQ(1, cache.getNumMisses());
+
+    // Another stream sending the same item shares the compressed copy.
+    EXPECT_EQ(compressed.get(), cache.getCompressed(makeItem(1), 0.85).get());
+    EXPECT_EQ(1, cache.getNumHits());
+
+    cache.getCompressed(makeItem(2), 0.85);
+    cache.getCompressed(makeItem(3), 0.85);
+    EXPECT_EQ(3, cache.getNumMisses());
+
+    // Seqno 1 was the least recently used so made room for seqno 3.
+    EXPECT_NE(compressed.get(), cache.getCompressed(makeItem(1), 0.85).get());
+    EXPECT_EQ(4, cache.getNumMisses());
+}
+
 // Tests that the MutationResponse created for the deletion response is of the
 // correct size.
 TEST_P(ConnectionTest, test_mb24424_deleteResponse) {
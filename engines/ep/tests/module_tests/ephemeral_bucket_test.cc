@@ -21,6 +21,7 @@
 
 #include "../mock/mock_dcp_consumer.h"
 #include "dcp/dcpconnmap.h"
+#include "ephemeral_tombstone_purger.h"
 /*
  * Test statistics related to an individual VBucket's sequence list.
  */
@@ -55,6 +56,10 @@ TEST_F(EphemeralBucketStatTest, VBSeqlistStats) {
     EXPECT_EQ("0", stats.at("vb_0:seqlist_stale_count"));
     EXPECT_EQ("0", stats.at("vb_0:seqlist_stale_value_bytes"));
     EXPECT_EQ("0", stats.at("vb_0:seqlist_stale_metadata_bytes"));
+    EXPECT_EQ("0", stats.at("vb_0:seqlist_index_bytes"))
+        << "Too few documents to be indexed";
+    EXPECT_EQ(std::to_string(sizeof(OrderedStoredValue) - sizeof(StoredValue)),
+              stats.at("vb_0:seqlist_overhead_per_item"));
 
     // Trigger the "automatic" deletion of an item by paging it out.
     auto vb = store->getVBucket(vbid);
@@ -177,3 +182,66 @@ TEST_F(SingleThreadedEphemeralBackfillTest, RangeIteratorVBDeleteRaceTest) {
     EXPECT_TRUE(
             task_executor->isTaskScheduled(NONIO_TASK_IDX, vbDeleteTaskName));
 }
+
+/*
+ * Test that the tombstone purger chunk duration backs off when the purger
+ * contends with front-end operations, and recovers when it doesn't.
+ */
+TEST(EphTombstonePurgeProgressTest, AdaptiveChunkDuration) {
+    using namespace std::chrono;
+    const milliseconds max{20};
+    EphTombstonePurgeProgress progress(2, max);
+    ASSERT_EQ(max, progress.getChunkDuration(max));
+
+    // Chunk spent half its time waiting for the list lock - halve.
+    progress.chunkCompleted(milliseconds(20), milliseconds(10), 5, max);
+    EXPECT_EQ(milliseconds(10), progress.getChunkDuration(max));
+
+    // Never drops below 1ms.
+    for (int i = 0; i < 10; ++i) {
+        progress.chunkCompleted(milliseconds(10), milliseconds(5), 0, max);
+    }
+    EXPECT_EQ(milliseconds(1), progress.getChunkDuration(max));
+
+    // Uncontended chunks grow it back (1ms at a time), up to the max.
+    progress.chunkCompleted(milliseconds(1), milliseconds(0), 0, max);
+    EXPECT_EQ(milliseconds(2), progress.getChunkDuration(max));
+    for (int i = 0; i < 100; ++i) {
+        progress.chunkCompleted(milliseconds(1), milliseconds(0), 0, max);
+    }
+    EXPECT_EQ(max, progress.getChunkDuration(max));
+
+    // A lowered configured max applies immediately.
+    EXPECT_EQ(milliseconds(5), progress.getChunkDuration(milliseconds(5)));
+}
+
+/*
+ * Test that the vBucket partitions of the tombstone purger tasks are
+ * disjoint and together cover every vBucket.
+ */
+TEST(EphTombstoneHTCleanerTest, PartitionFilters) {
+    const size_t maxVBuckets = 1024;
+    for (size_t numPartitions : {1, 2, 3, 7, 1024}) {
+        std::vector<int> owners(maxVBuckets, 0);
+        for (size_t partition = 0; partition < numPartitions; ++partition) {
+            const auto filter = EphTombstoneHTCleaner::makePartitionFilter(
+                    maxVBuckets, numPartitions, partition);
+            for (size_t vbid = 0; vbid < maxVBuckets; ++vbid) {
+                if (filter(uint16_t(vbid))) {
+                    ++owners[vbid];
+                }
+            }
+        }
+        for (size_t vbid = 0; vbid < maxVBuckets; ++vbid) {
+            EXPECT_EQ(1, owners[vbid]) << "vb:" << vbid << " with "
+                                       << numPartitions << " partitions";
+        }
+    }
+
+    // A partition without vBuckets is rejected (rather than given an empty,
+    // accept-all, filter)
+    EXPECT_THROW(EphTombstoneHTCleaner::makePartitionFilter(4, 8, 4),
+                 std::invalid_argument);
+    EXPECT_THROW(EphTombstoneHTCleaner::makePartitionFilter(1024, 2, 2),
+                 std::invalid_argument);
+}
@@ -501,36 +501,32 @@ TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
     // place; causing the initial OSV to be marked as stale and a new OSV to
     // be added for that key.
     auto& seqList = mockEpheVB->getLL()->getSeqList();
+    mockEpheVB->registerFakeReadRange(1, 2);
+    ASSERT_EQ(MutationStatus::WasClean, setOne(keys.at(1)));
+
+    // Sanity check - our state is as expected:
+    ASSERT_EQ(3, vbucket->getNumItems());
+    ASSERT_EQ(4, seqList.size());
+    auto staleIt = std::next(seqList.begin());
+    auto& newOsv = seqList.back();
+    ASSERT_EQ(staleIt->getKey(), newOsv.getKey());
     {
-        std::lock_guard<std::mutex> rrGuard(
-                mockEpheVB->getLL()->getRangeReadLock());
-        mockEpheVB->registerFakeReadRange(1, 2);
-        ASSERT_EQ(MutationStatus::WasClean, setOne(keys.at(1)));
-
-        // Sanity check - our state is as expected:
-        ASSERT_EQ(3, vbucket->getNumItems());
-        ASSERT_EQ(4, seqList.size());
-        auto staleIt = std::next(seqList.begin());
-        auto newIt = seqList.rbegin();
-        ASSERT_EQ(staleIt->getKey(), newIt->getKey());
-        {
-            std::lock_guard<std::mutex> writeGuard(
-                    mockEpheVB->getLL()->getListWriteLock());
-            ASSERT_TRUE(staleIt->isStale(writeGuard));
-            ASSERT_FALSE(newIt->isStale(writeGuard));
-        }
+        std::lock_guard<std::mutex> writeGuard(
+                mockEpheVB->getLL()->getListWriteLock());
+        ASSERT_TRUE(staleIt->isStale(writeGuard));
+        ASSERT_FALSE(newOsv.isStale(writeGuard));
+    }
 
-        // Attempt a purge - should not remove anything as read range is in
-        // place.
-        EXPECT_EQ(0, mockEpheVB->purgeStaleItems());
-        EXPECT_EQ(3, vbucket->getNumItems());
-        EXPECT_EQ(4, seqList.size());
-        EXPECT_EQ(0, vbucket->getPurgeSeqno());
+    // Attempt a purge - should not remove anything as the read range begins
+    // before the stale item.
+    EXPECT_EQ(0, mockEpheVB->purgeStaleItems());
+    EXPECT_EQ(3, vbucket->getNumItems());
+    EXPECT_EQ(4, seqList.size());
+    EXPECT_EQ(0, vbucket->getPurgeSeqno());
 
-        // Clear the ReadRange (so we can actually purge items) and retry the
-        // purge which should now succeed.
-        mockEpheVB->getLL()->resetReadRange();
-    } // END rrGuard.
+    // Clear the ReadRange (so we can actually purge items) and retry the
+    // purge which should now succeed.
+    mockEpheVB->getLL()->resetReadRange();
 
     // Scan sequenceList for stale items.
     EXPECT_EQ(1, mockEpheVB->purgeStaleItems());
@@ -538,6 +534,38 @@ TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
     EXPECT_EQ(3, seqList.size());
 }
 
+// Check that with several range reads in place, stale items behind the
+// slowest reader are purged and those it may still read are not.
+TEST_F(EphTombstoneTest, PurgeBehindSlowestReader) {
+    // Update the first two keys with a (fake) Range Read over all the items,
+    // making the OSVs at seqnos 1 and 2 stale.
+    auto& seqList = mockEpheVB->getLL()->getSeqList();
+    mockEpheVB->registerFakeReadRange(1, 3);
+    ASSERT_EQ(MutationStatus::WasClean, setOne(keys.at(0)));
+    ASSERT_EQ(MutationStatus::WasClean, setOne(keys.at(1)));
+    ASSERT_EQ(5, seqList.size());
+
+    // Two readers; the slowest is at seqno 2.
+    mockEpheVB->registerFakeReadRange(2, 5);
+    mockEpheVB->getLL()->addFakeReadRange(4, 5);
+    EXPECT_EQ(2, mockEpheVB->getLL()->getRangeReadBegin());
+    EXPECT_EQ(5, mockEpheVB->getLL()->getRangeReadEnd());
+
+    // Only seqno 1 is behind both readers.
+    EXPECT_EQ(1, mockEpheVB->purgeStaleItems());
+    EXPECT_EQ(4, seqList.size());
+    EXPECT_EQ(std::vector<seqno_t>({2, 3, 4, 5}),
+              mockEpheVB->getLL()->getAllSeqnoForVerification());
+
+    // Once the slowest reader moves on, the stale item at seqno 2 can go.
+    mockEpheVB->registerFakeReadRange(3, 5);
+    EXPECT_EQ(1, mockEpheVB->purgeStaleItems());
+    EXPECT_EQ(std::vector<seqno_t>({3, 4, 5}),
+              mockEpheVB->getLL()->getAllSeqnoForVerification());
+
+    mockEpheVB->resetReadRange();
+}
+
 // Test that deleted items purged out of order are handled correctly (and
 // highestDeletedPurged is updated).
 TEST_F(EphTombstoneTest, PurgeOutOfOrder) {
@@ -660,7 +688,8 @@ TEST_F(EphemeralVBucketTest, AppendUpdatesHighestDedupedSeqno) {
     ASSERT_EQ(0, mockEpheVB->getLL()->getHighestDedupedSeqno());
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/);
+        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/,
+                                                          0 /*start*/);
 
         /* Update the items */
         setMany(keys, MutationStatus::WasClean);
@@ -677,7 +706,8 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicates) {
     setMany(keys, MutationStatus::WasClean);
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/);
+        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/,
+                                                          0 /*start*/);
 
         /* Update the items  */
         setMany(keys, MutationStatus::WasClean);
@@ -700,7 +730,8 @@ TEST_F(EphemeralVBucketTest, SnapshotIncludesNonDuplicateStaleItems) {
     setMany(keys, MutationStatus::WasClean);
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/);
+        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/,
+                                                          0 /*start*/);
 
         /* Update the items  */
         setMany(keys, MutationStatus::WasClean);
@@ -726,7 +757,8 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithInterveningItems) {
     EXPECT_EQ(MutationStatus::WasClean, setOne(firstFillerKey));
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/);
+        auto itr = mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/,
+                                                          0 /*start*/);
 
         EXPECT_EQ(MutationStatus::WasClean, setOne(secondFillerKey));
 
@@ -755,8 +787,8 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithMultipleStale) {
     for (int i = 0; i < updateIterations; ++i) {
         /* Set up a mock backfill, cover all items */
         {
-            auto itr =
-                    mockEpheVB->getLL()->makeRangeIterator(true /*isBackfill*/);
+            auto itr = mockEpheVB->getLL()->makeRangeIterator(
+                    true /*isBackfill*/, 0 /*start*/);
             /* Update the items  */
             setMany(keys, MutationStatus::WasClean);
         }
@@ -771,3 +803,40 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithMultipleStale) {
     EXPECT_EQ(numItems * (updateIterations + 1),
               std::get<2>(res)); // extended end of readRange
 }
+
+/*
+ * A backfill starting near the end of the vBucket is positioned at its start
+ * seqno and covers only the tail of the list, for each SequenceList
+ * implementation.
+ */
+TEST_F(EphemeralVBucketTest, BackfillStartNearEnd) {
+    const int numItems = 1000;
+    auto keys = generateKeys(numItems);
+
+    for (const std::string type : {"linked_list", "skip_list"}) {
+        SCOPED_TRACE(type);
+        config.setEphemeralSeqlistType(type);
+        vbucket.reset();
+        auto* evb = new EphemeralVBucket(0,
+                                         vbucket_state_active,
+                                         global_stats,
+                                         checkpoint_config,
+                                         /*kvshard*/ nullptr,
+                                         /*lastSeqno*/ 0,
+                                         /*lastSnapStart*/ 0,
+                                         /*lastSnapEnd*/ 0,
+                                         /*table*/ nullptr,
+                                         /*newSeqnoCb*/ nullptr,
+                                         config,
+                                         VALUE_ONLY);
+        vbucket.reset(evb);
+        setMany(keys, MutationStatus::WasClean);
+
+        const seqno_t start = numItems - 10;
+        auto itr = evb->makeRangeIterator(true /*isBackfill*/, start);
+
+        ASSERT_TRUE(itr);
+        EXPECT_EQ(start, itr->curr());
+        EXPECT_EQ(11, itr->count());
+    }
+}
@@ -241,6 +241,112 @@ TEST_F(ExecutorPoolDynamicWorkerTest, reschedule_dead_task) {
     EXPECT_EQ(2, runCount);
 }
 
+/* With one of the two reader threads reserved for front-end tasks, a
+ * background task occupying the other reader must not prevent a front-end
+ * task from running, and a second background task must wait for the first.
+ */
+TEST_F(ExecutorPoolDynamicWorkerTest, frontend_reserved_threads) {
+    pool->setFrontEndReservedPcnt(50);
+    ASSERT_EQ(1, pool->getMaxNonFrontEndWorkers(READER_TASK_IDX));
+
+    tg.reset(new ThreadGate(2));
+    std::atomic<size_t> backgroundRuns{0};
+
+    for (int i = 0; i < 2; ++i) {
+        ExTask task = std::make_shared<LambdaTask>(
+                taskable, TaskId::FetchAllKeysTask, 0, true, [&] {
+                    if (++backgroundRuns == 1) {
+                        // Hold the only non-reserved reader until the
+                        // front-end task has run alongside us.
+                        tg->threadUp();
+                    }
+                    return false;
+                });
+        pool->schedule(task);
+    }
+
+    while (backgroundRuns == 0) {
+        std::this_thread::yield();
+    }
+
+    ExTask frontEnd = std::make_shared<LambdaTask>(
+            taskable, TaskId::MultiBGFetcherTask, 0, true, [&] {
+                EXPECT_EQ(1, backgroundRuns)
+                        << "Second background task should be throttled";
+                tg->threadUp();
+                return false;
+            });
+    pool->schedule(frontEnd);
+
+    tg->waitFor(std::chrono::seconds(10));
+    EXPECT_TRUE(tg->isComplete()) << "Timeout waiting for front-end task";
+
+    pool->waitForEmptyTaskLocator();
+    EXPECT_EQ(2, backgroundRuns);
+}
+
+/* Front-end tasks are batched into the worker threads' local queues; check
+ * that every one of them still runs, and that the tasks batched by a thread
+ * which is busy are stolen by the other reader straight away - rather than
+ * once the shared ready queue has been drained.
+ */
+TEST_F(ExecutorPoolDynamicWorkerTest, frontend_tasks_batched_and_stolen) {
+    ASSERT_EQ(2, pool->getNumReaders());
+
+    // Occupy both readers, so that all of the tasks below are ready by the
+    // time the first of them is fetched.
+    std::atomic<size_t> blocked{0};
+    std::atomic<bool> release{false};
+    for (int i = 0; i < 2; ++i) {
+        ExTask task = std::make_shared<LambdaTask>(
+                taskable, TaskId::MultiBGFetcherTask, 0, true, [&] {
+                    ++blocked;
+                    while (!release) {
+                        std::this_thread::yield();
+                    }
+                    return false;
+                });
+        pool->schedule(task);
+    }
+    while (blocked != 2) {
+        std::this_thread::yield();
+    }
+
+    const size_t numTasks = 200;
+    std::atomic<size_t> runs{0};
+    std::atomic<size_t> runsWhenStolen{0};
+    for (size_t i = 0; i < numTasks; ++i) {
+        ExTask task = std::make_shared<LambdaTask>(
+                taskable, TaskId::MultiBGFetcherTask, 0, true, [&] {
+                    if (++runs == 1) {
+                        // The thread running the first task has batched
+                        // some of the others; stay busy until the other
+                        // reader steals them.
+                        const auto deadline = std::chrono::steady_clock::now() +
+                                              std::chrono::seconds(10);
+                        while (pool->getNumStolenTasks() == 0 &&
+                               std::chrono::steady_clock::now() < deadline) {
+                            std::this_thread::yield();
+                        }
+                        runsWhenStolen = runs.load();
+                    }
+                    return false;
+                });
+        pool->schedule(task);
+    }
+    release = true;
+
+    pool->waitForEmptyTaskLocator();
+    EXPECT_EQ(numTasks, runs);
+    EXPECT_EQ(0, pool->getNumReadyTasks());
+
+    EXPECT_LE(TaskQueue::localBatchSize, pool->getNumBatchedTasks());
+    EXPECT_LE(1, pool->getNumStolenTasks());
+    // The other reader only works through its own batch before stealing.
+    EXPECT_GT(numTasks / 2, runsWhenStolen)
+            << "Batched tasks were only stolen once the shared queue drained";
+}
+
 /* Testing to ensure that repeatedly scheduling a task does not result in
  * multiple entries in the taskQueue - this could cause a deadlock in
  * _unregisterTaskable when the taskLocator is empty but duplicate tasks remain
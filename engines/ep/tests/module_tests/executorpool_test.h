@@ -26,6 +26,7 @@
 #include <fakes/fake_executorpool.h>
 #include <gtest/gtest.h>
 #include <taskable.h>
+#include <taskqueue.h>
 #include <thread>
 #include "thread_gate.h"
 
@@ -99,7 +100,29 @@ public:
         tMutex.wait(lh, [this] { return taskLocator.empty(); });
     }
 
+    /// Total number of tasks batched into the local queues of all TaskQueues
+    size_t getNumBatchedTasks() {
+        return sumTaskQueues(&TaskQueue::getBatchedTaskCount);
+    }
+
+    /// Total number of tasks stolen from the local queues of all TaskQueues
+    size_t getNumStolenTasks() {
+        return sumTaskQueues(&TaskQueue::getStolenTaskCount);
+    }
+
     ~TestExecutorPool() = default;
+
+private:
+    size_t sumTaskQueues(size_t (TaskQueue::*counter)() const) {
+        LockHolder lh(tMutex);
+        size_t total = 0;
+        for (const auto* taskQ : {&hpTaskQ, &lpTaskQ}) {
+            for (const auto* queue : *taskQ) {
+                total += (queue->*counter)();
+            }
+        }
+        return total;
+    }
 };
 
 class ExecutorPoolTest : public ::testing::Test {};
@@ -20,6 +20,10 @@
 #include "futurequeue.h"
 #include "tests/module_tests/test_task.h"
 
+#include <climits>
+#include <utility>
+#include <vector>
+
 class FutureQueueTest : public ::testing::TestWithParam<std::string> {
 public:
     FutureQueue<> queue;
@@ -218,3 +222,203 @@ TEST_F(FutureQueueTest, taskNotInQueue) {
     EXPECT_EQ(-1,
               static_cast<TestTask*>(queue.top().get())->order);
 }
+
+/*
+ * Push tasks spread from a millisecond to days ahead (so across every level
+ * of the wheel, and beyond it) plus one which sleeps forever, and check
+ * popExpired returns them in wakeTime order as time moves forward.
+ */
+TEST_F(FutureQueueTest, popExpired) {
+    const auto start = ProcessClock::now();
+    std::vector<ProcessClock::duration> delays;
+    for (auto delay = std::chrono::milliseconds(1);
+         delay < std::chrono::hours(24 * 7);
+         delay *= 3) {
+        delays.push_back(delay);
+    }
+    // Push them in reverse order, so each is due before everything queued.
+    for (int i = delays.size() - 1; i >= 0; i--) {
+        ExTask task = std::make_shared<TestTask>(
+                nullptr, TaskId::PendingOpsNotification, i);
+        task->updateWaketime(start + delays[i]);
+        queue.push(task);
+    }
+    ExTask sleeper =
+            std::make_shared<TestTask>(nullptr, TaskId::PendingOpsNotification);
+    sleeper->snooze(INT_MAX);
+    queue.push(sleeper);
+
+    std::vector<ExTask> expired;
+    EXPECT_EQ(0u, queue.popExpired(start, expired));
+    EXPECT_TRUE(expired.empty());
+
+    for (size_t i = 0; i < delays.size(); i++) {
+        // Nothing is due until the task's wakeTime.
+        EXPECT_EQ(0u,
+                  queue.popExpired(
+                          start + delays[i] - std::chrono::nanoseconds(1),
+                          expired));
+        EXPECT_EQ(1u, queue.popExpired(start + delays[i], expired));
+        ASSERT_EQ(i + 1, expired.size());
+        EXPECT_EQ(int(i), static_cast<TestTask*>(expired.back().get())->order);
+    }
+
+    // Only the sleeper is left, and it is never due.
+    EXPECT_EQ(1u, queue.size());
+    EXPECT_EQ(sleeper, queue.top());
+    EXPECT_EQ(0u,
+              queue.popExpired(ProcessClock::time_point::max() -
+                                       std::chrono::nanoseconds(1),
+                               expired));
+    EXPECT_EQ(1u, queue.popExpired(ProcessClock::time_point::max(), expired));
+    EXPECT_TRUE(queue.empty());
+}
+
+/*
+ * Wake a task which was pushed more than once; every copy of it should move.
+ */
+TEST_F(FutureQueueTest, updateWaketimeDuplicates) {
+    const auto start = ProcessClock::now();
+    ExTask other =
+            std::make_shared<TestTask>(nullptr, TaskId::PendingOpsNotification);
+    other->updateWaketime(start + std::chrono::seconds(1));
+    queue.push(other);
+
+    ExTask task =
+            std::make_shared<TestTask>(nullptr, TaskId::PendingOpsNotification);
+    task->updateWaketime(start + std::chrono::hours(1));
+    queue.push(task);
+    queue.push(task);
+    EXPECT_EQ(other, queue.top());
+
+    EXPECT_TRUE(queue.updateWaketime(task, start));
+    EXPECT_EQ(3u, queue.size());
+
+    std::vector<ExTask> expired;
+    EXPECT_EQ(2u, queue.popExpired(start, expired));
+    EXPECT_EQ(task, expired[0]);
+    EXPECT_EQ(task, expired[1]);
+    EXPECT_EQ(other, queue.top());
+}
+
+/// A FutureQueue which exposes where its tasks are in the wheel.
+class InspectableFutureQueue : public FutureQueue<> {
+public:
+    /// The level of the wheel the task is at; expiredLevel (-1) for the
+    /// expired slot and overflowLevel (the number of levels) for overflow.
+    int getLevel(const ExTask& task) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        auto it = locator.find(task->getId());
+        if (it == locator.end()) {
+            throw std::invalid_argument("getLevel: task not queued");
+        }
+        return it->second.level;
+    }
+
+    static const int expired = expiredLevel;
+    static const int overflow = overflowLevel;
+};
+
+const int InspectableFutureQueue::expired;
+const int InspectableFutureQueue::overflow;
+
+class FutureQueueWheelTest : public ::testing::Test {
+public:
+    ExTask makeTask(ProcessClock::duration delay) {
+        ExTask task = std::make_shared<TestTask>(
+                nullptr, TaskId::PendingOpsNotification);
+        task->updateWaketime(start + delay);
+        return task;
+    }
+
+    InspectableFutureQueue queue;
+
+    // Aligned to the span of the wheel's top level, so which level a task
+    // goes in only depends on its delay.
+    const ProcessClock::time_point start{
+            std::chrono::nanoseconds(int64_t(1) << 50)};
+};
+
+/*
+ * Tasks are placed at the level of the wheel matching how far after the
+ * cursor they are, and are cascaded down to level 0 by the time they are
+ * at the top of the queue.
+ */
+TEST_F(FutureQueueWheelTest, cascadeThroughLevels) {
+    const std::vector<std::pair<ProcessClock::duration, int>> delays = {
+            {std::chrono::milliseconds(1), 0},
+            {std::chrono::milliseconds(100), 1},
+            {std::chrono::seconds(10), 2},
+            {std::chrono::minutes(20), 3},
+            {std::chrono::hours(10), InspectableFutureQueue::overflow}};
+
+    std::vector<ExTask> tasks;
+    for (const auto& delay : delays) {
+        tasks.push_back(makeTask(delay.first));
+        queue.push(tasks.back());
+    }
+    for (size_t i = 0; i < tasks.size(); i++) {
+        EXPECT_EQ(delays[i].second, queue.getLevel(tasks[i])) << i;
+    }
+
+    std::vector<ExTask> expired;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        EXPECT_EQ(tasks[i], queue.top());
+        // Tasks beyond the wheel are only pulled into it by a push.
+        const bool overflowed =
+                delays[i].second == InspectableFutureQueue::overflow;
+        EXPECT_EQ(overflowed ? InspectableFutureQueue::overflow : 0,
+                  queue.getLevel(tasks[i]))
+                << i;
+        EXPECT_EQ(0u,
+                  queue.popExpired(start + delays[i].first -
+                                           std::chrono::nanoseconds(1),
+                                   expired));
+        EXPECT_EQ(1u, queue.popExpired(start + delays[i].first, expired));
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+/*
+ * Once top() has moved the cursor to a far-future task, a task due before it
+ * moves the cursor back (and is placed in the wheel) rather than going in
+ * the expired slot.
+ */
+TEST_F(FutureQueueWheelTest, nearerTaskRewindsCursor) {
+    auto first = makeTask(std::chrono::milliseconds(1));
+    auto far = makeTask(std::chrono::minutes(20));
+    queue.push(first);
+    queue.push(far);
+
+    std::vector<ExTask> expired;
+    EXPECT_EQ(1u,
+              queue.popExpired(start + std::chrono::milliseconds(1), expired));
+    EXPECT_EQ(far, queue.top());
+    EXPECT_EQ(0, queue.getLevel(far));
+
+    auto nearer = makeTask(std::chrono::milliseconds(2));
+    queue.push(nearer);
+    EXPECT_EQ(0, queue.getLevel(nearer));
+    EXPECT_EQ(3, queue.getLevel(far));
+    EXPECT_EQ(nearer, queue.top());
+
+    // In the same level 1 slot as the cursor; nothing else moves.
+    auto nearest = makeTask(std::chrono::milliseconds(1));
+    queue.push(nearest);
+    EXPECT_EQ(0, queue.getLevel(nearest));
+    EXPECT_EQ(0, queue.getLevel(nearer));
+    EXPECT_EQ(3, queue.getLevel(far));
+
+    // Before the span of the wheel's top level; kept in the expired slot.
+    auto past = makeTask(-std::chrono::nanoseconds(1));
+    queue.push(past);
+    EXPECT_EQ(InspectableFutureQueue::expired, queue.getLevel(past));
+
+    EXPECT_EQ(4u, queue.size());
+    EXPECT_EQ(4u, queue.popExpired(start + std::chrono::hours(1), expired));
+    ASSERT_EQ(5u, expired.size());
+    EXPECT_EQ(past, expired[1]);
+    EXPECT_EQ(nearest, expired[2]);
+    EXPECT_EQ(nearer, expired[3]);
+    EXPECT_EQ(far, expired[4]);
+}
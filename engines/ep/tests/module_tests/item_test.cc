@@ -182,6 +182,44 @@ TEST_F(ItemPruneTest, testPruneValueAndXattrs) {
     EXPECT_EQ(0, item->getNBytes());
 }
 
+// Pruning a copy of an item should not copy the value; the copy should
+// expose part of the same Blob and leave the original untouched.
+TEST_F(ItemPruneTest, testPruneCopySharesBlob) {
+    std::string valueData = R"({"json":"yes"})";
+    auto data = createXattrValue(valueData);
+
+    Item xattrsOnly(*item);
+    xattrsOnly.pruneValueAndOrXattrs(IncludeValue::No, IncludeXattrs::Yes);
+    EXPECT_EQ(item->getValue().get(), xattrsOnly.getValue().get());
+    auto xattrs = createXattrValue("");
+    EXPECT_EQ(xattrs.size(), xattrsOnly.getNBytes());
+    EXPECT_EQ(0, memcmp(xattrsOnly.getData(), xattrs.data(),
+                        xattrsOnly.getNBytes()));
+
+    Item bodyOnly(*item);
+    bodyOnly.pruneValueAndOrXattrs(IncludeValue::Yes, IncludeXattrs::No);
+    EXPECT_EQ(item->getValue().get(), bodyOnly.getValue().get());
+    EXPECT_EQ(valueData.size(), bodyOnly.getNBytes());
+    EXPECT_EQ(0, memcmp(bodyOnly.getData(), valueData.data(),
+                        bodyOnly.getNBytes()));
+    EXPECT_FALSE(mcbp::datatype::is_xattr(bodyOnly.getDataType()));
+
+    // The original item (and its Blob) must be unchanged.
+    EXPECT_EQ(data.size(), item->getNBytes());
+    EXPECT_EQ(0, memcmp(item->getData(), data.data(), item->getNBytes()));
+    EXPECT_TRUE(mcbp::datatype::is_xattr(item->getDataType()));
+    EXPECT_TRUE(mcbp::datatype::is_xattr(item->getValue()->getDataType()));
+
+    // Compressing a view must only compress the visible part.
+    ASSERT_TRUE(bodyOnly.compressValue(/*minCompressionRatio*/ 10.0));
+    EXPECT_TRUE(mcbp::datatype::is_snappy(bodyOnly.getDataType()));
+    EXPECT_FALSE(mcbp::datatype::is_snappy(item->getDataType()));
+    ASSERT_TRUE(bodyOnly.decompressValue());
+    EXPECT_EQ(valueData.size(), bodyOnly.getNBytes());
+    EXPECT_EQ(0, memcmp(bodyOnly.getData(), valueData.data(),
+                        bodyOnly.getNBytes()));
+}
+
 TEST_F(ItemPruneTest, testPruneValueWithNoXattrs) {
     std::string valueData = R"({"json":"yes"})";
     uint8_t ext_meta[EXT_META_LEN] = {PROTOCOL_BINARY_DATATYPE_JSON};
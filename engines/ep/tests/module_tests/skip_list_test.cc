@@ -0,0 +1,220 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * Tests of the index SkipList keeps on top of the BasicLinkedList; the
+ * behaviour shared with BasicLinkedList is covered by basic_ll_test.
+ */
+
+#include "config.h"
+
+#include <gtest/gtest.h>
+
+#include "hash_table.h"
+#include "item.h"
+#include "skip_list.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <algorithm>
+#include <vector>
+
+static EPStats global_stats;
+
+class SkipListTest : public ::testing::Test {
+public:
+    SkipListTest() : ht(global_stats, makeFactory(), 2, 1) {
+    }
+
+    static std::unique_ptr<AbstractStoredValueFactory> makeFactory() {
+        return std::make_unique<OrderedStoredValueFactory>(global_stats);
+    }
+
+protected:
+    void SetUp() {
+        skipList = std::make_unique<SkipList>(0, global_stats);
+    }
+
+    void TearDown() {
+        /* Like in a vbucket we want the list to be erased before HashTable is
+           is destroyed. */
+        skipList.reset();
+    }
+
+    /**
+     * Adds 'numItems' new items, with seqnos from highSeqno + 1 and keys
+     * "keyXX", XX being the seqno.
+     */
+    void addNewItems(int numItems) {
+        const std::string val("data");
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        for (int i = 0; i < numItems; ++i) {
+            const seqno_t seqno = ++highSeqno;
+            StoredDocKey key = makeStoredDocKey("key" + std::to_string(seqno));
+            Item item(key,
+                      0,
+                      0,
+                      val.data(),
+                      val.length(),
+                      /*ext_meta*/ nullptr,
+                      /*ext_len*/ 0,
+                      /*theCas*/ 0,
+                      /*bySeqno*/ seqno);
+            EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+            auto* osv = ht.find(key, TrackReference::No, WantsDeleted::No)
+                                ->toOrderedStoredValue();
+
+            std::lock_guard<std::mutex> listWriteLg(
+                    skipList->getListWriteLock());
+            skipList->appendToList(lg, listWriteLg, *osv);
+            skipList->updateHighSeqno(listWriteLg, *osv);
+            listOrder.push_back(seqno);
+        }
+    }
+
+    /**
+     * Updates the item originally added with seqno 'origSeqno', moving it to
+     * the end of the list with the next seqno.
+     */
+    void updateItem(seqno_t origSeqno) {
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        auto* osv = ht.find(makeStoredDocKey("key" + std::to_string(origSeqno)),
+                            TrackReference::No,
+                            WantsDeleted::Yes)
+                            ->toOrderedStoredValue();
+        const seqno_t oldSeqno = osv->getBySeqno();
+
+        std::lock_guard<std::mutex> listWriteLg(skipList->getListWriteLock());
+        ASSERT_EQ(SequenceList::UpdateStatus::Success,
+                  skipList->updateListElem(lg, listWriteLg, *osv));
+        osv->setBySeqno(++highSeqno);
+        skipList->updateHighSeqno(listWriteLg, *osv);
+
+        listOrder.erase(
+                std::find(listOrder.begin(), listOrder.end(), oldSeqno));
+        listOrder.push_back(highSeqno);
+    }
+
+    /**
+     * Releases the item originally added with seqno 'origSeqno' from the
+     * hash table and makes it stale, as the tombstone purger does.
+     */
+    void makeStale(seqno_t origSeqno) {
+        auto key = makeStoredDocKey("key" + std::to_string(origSeqno));
+        StoredValue::UniquePtr ownedSv;
+        {
+            auto hbl = ht.getLockedBucket(key);
+            ownedSv = ht.unlocked_release(hbl, key);
+        }
+        std::lock_guard<std::mutex> listWriteLg(skipList->getListWriteLock());
+        skipList->markItemStale(listWriteLg, std::move(ownedSv), nullptr);
+    }
+
+    /**
+     * Checks that a range iterator from every possible start seqno begins
+     * at the first element at or after it, with the right count.
+     */
+    void verifySeeks() {
+        for (seqno_t start = 1; start <= highSeqno + 1; ++start) {
+            auto first = std::find_if(
+                    listOrder.begin(),
+                    listOrder.end(),
+                    [start](seqno_t seqno) { return seqno >= start; });
+            if (first == listOrder.end()) {
+                first = std::prev(listOrder.end());
+            }
+
+            auto itr = skipList->makeRangeIterator(true /*isBackfill*/, start);
+            ASSERT_TRUE(itr);
+            EXPECT_EQ(*first, itr->curr()) << "start:" << start;
+            EXPECT_EQ(uint64_t(listOrder.end() - first), itr->count())
+                    << "start:" << start;
+            EXPECT_EQ(listOrder.back() + 1, itr->end());
+        }
+    }
+
+    HashTable ht;
+    std::unique_ptr<SkipList> skipList;
+
+    /* Expected seqnos of the list elements, in list order */
+    std::vector<seqno_t> listOrder;
+    seqno_t highSeqno = 0;
+};
+
+TEST_F(SkipListTest, SeekAfterAppends) {
+    addNewItems(1000);
+    EXPECT_LT(0, skipList->getNumIndexNodes());
+    verifySeeks();
+}
+
+/* Updated elements leave the index and are re-indexed at the end */
+TEST_F(SkipListTest, SeekAfterUpdates) {
+    addNewItems(1000);
+    for (seqno_t seqno = 1; seqno <= 1000; seqno += 3) {
+        updateItem(seqno);
+    }
+    /* Update the last element too */
+    updateItem(2);
+    updateItem(2);
+    verifySeeks();
+}
+
+/* Purged stale elements leave the index */
+TEST_F(SkipListTest, SeekAfterPurge) {
+    addNewItems(1000);
+    /* purgeTombstones() leaves the tail of the list alone */
+    for (seqno_t seqno = 1; seqno < 999; seqno += 2) {
+        makeStale(seqno);
+    }
+    EXPECT_EQ(499, skipList->purgeTombstones());
+    listOrder.erase(std::remove_if(listOrder.begin(),
+                                   listOrder.end(),
+                                   [](seqno_t seqno) {
+                                       return seqno < 999 && seqno % 2;
+                                   }),
+                    listOrder.end());
+    verifySeeks();
+
+    addNewItems(100);
+    verifySeeks();
+}
+
+TEST_F(SkipListTest, RangeReadFromMid) {
+    addNewItems(1000);
+    for (seqno_t seqno = 500; seqno <= 600; ++seqno) {
+        updateItem(seqno);
+    }
+
+    auto res = skipList->rangeRead(550, 700);
+    ASSERT_EQ(ENGINE_SUCCESS, std::get<0>(res));
+    std::vector<seqno_t> expected;
+    for (auto seqno : listOrder) {
+        if (seqno >= 550 && seqno <= 700) {
+            expected.push_back(seqno);
+        }
+    }
+    std::vector<seqno_t> actual;
+    for (const auto& item : std::get<1>(res)) {
+        actual.push_back(item->getBySeqno());
+    }
+    EXPECT_EQ(expected, actual);
+}
@@ -234,10 +234,10 @@ TEST(StoredValueTest, expectedSize) {
 }
 
 TEST(OrderedStoredValueTest, expectedSize) {
-    EXPECT_EQ(72, sizeof(OrderedStoredValue))
+    EXPECT_EQ(64, sizeof(OrderedStoredValue))
             << "Unexpected change in OrderedStoredValue fixed size";
     auto item = make_item(0, makeStoredDocKey("k"), "v");
-    EXPECT_EQ(75, OrderedStoredValue::getRequiredStorage(item))
+    EXPECT_EQ(67, OrderedStoredValue::getRequiredStorage(item))
             << "Unexpected change in OrderedStoredValue storage size for item: "
             << item;
 }
@@ -74,6 +74,7 @@
 #include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <memcached/engine.h>
 #include <memcached/extension.h>
@@ -218,6 +219,7 @@ public:
 
         const bool inject = iter->second.second->should_inject_error(cmd, err);
         const bool add_to_pending_io_ops = iter->second.second->add_to_pending_io_ops();
+        uint32_t suspend_id;
 
         if (inject) {
             auto logger = gsa()->log->get_logger();
@@ -225,11 +227,18 @@ public:
                         "EWB_Engine: injecting error:%d for cmd:%s",
                         err, to_string(cmd));
 
-            if (err == ENGINE_EWOULDBLOCK && add_to_pending_io_ops) {
+            if (err == ENGINE_EWOULDBLOCK &&
+                iter->second.second->get_suspend_id(suspend_id)) {
+                // The cookie is notified once resumed
+                suspend(cookie, suspend_id);
+            } else if (err == ENGINE_EWOULDBLOCK && add_to_pending_io_ops) {
                 // The server expects that if EWOULDBLOCK is returned then the
                 // server should be notified in the future when the operation is
-                // ready - so add this op to the pending IO queue.
-                schedule_notification(iter->second.first);
+                // ready - so add this op to the pending IO queue. Notify the
+                // cookie of the operation (which isn't necessarily the one
+                // which configured the connection if the server executes
+                // commands out of order).
+                schedule_notification(cookie);
             }
         }
 
@@ -564,6 +573,10 @@ public:
                     new_mode = std::make_shared<ErrSequence>(injected_error, value);
                     break;
 
+                case EWBEngineMode::SuspendSequence:
+                    new_mode = std::make_shared<SuspendSequence>(value);
+                    break;
+
                 case EWBEngineMode::No_Notify:
                     new_mode = std::make_shared<ErrOnNoNotify>(injected_error);
                     break;
@@ -589,6 +602,9 @@ public:
                 case EWBEngineMode::Resume:
                     return ewb->handleResume(cookie, value, response);
 
+                case EWBEngineMode::ResumeAll:
+                    return ewb->handleResumeAll(cookie, response);
+
                 case EWBEngineMode::SetItemCas:
                     return ewb->setItemCas(cookie, key, value, response);
             }
@@ -759,6 +775,16 @@ protected:
                                    uint32_t id,
                                    ADD_RESPONSE response);
 
+    /**
+     * Handle the control message for resume all
+     *
+     * @param cookie The cookie executing the operation
+     * @param response callback used to send a response to the client
+     * @return The standard engine error codes
+     */
+    ENGINE_ERROR_CODE handleResumeAll(const void* cookie,
+                                      ADD_RESPONSE response);
+
     /**
      * @param cookie the cookie executing the operation
      * @param key ID of the item whose CAS should be changed
@@ -776,6 +802,8 @@ private:
     std::mutex mutex;
     std::condition_variable condvar;
     std::queue<const void*> pending_io_ops;
+    // Cookies to notify with a single notify_io_complete_batch each
+    std::queue<std::vector<const void*>> pending_io_batches;
 
     std::atomic<bool> stop_notification_thread;
 
@@ -938,6 +966,16 @@ private:
         }
         virtual bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) = 0;
 
+        /**
+         * Should the cookie of the call which just had ENGINE_EWOULDBLOCK
+         * injected be suspended (rather than notified)?
+         *
+         * @param id where to store the id to suspend the cookie with
+         */
+        virtual bool get_suspend_id(uint32_t& id) {
+            return false;
+        }
+
         virtual std::string to_string() const = 0;
 
     protected:
@@ -1056,11 +1094,31 @@ private:
             return ss.str();
         }
 
-    private:
+    protected:
         uint32_t sequence;
         uint32_t pos;
     };
 
+    class SuspendSequence : public ErrSequence {
+    public:
+        SuspendSequence(uint32_t sequence_)
+            : ErrSequence(ENGINE_EWOULDBLOCK, sequence_) {}
+
+        bool add_to_pending_io_ops() {
+            return false;
+        }
+
+        bool get_suspend_id(uint32_t& id) {
+            // The position of the call which was just made
+            id = pos - 1;
+            return true;
+        }
+
+        std::string to_string() const {
+            return "Suspend" + ErrSequence::to_string();
+        }
+    };
+
     class ErrOnNoNotify : public FaultInjectMode {
         public:
             ErrOnNoNotify(ENGINE_ERROR_CODE injected_error_)
@@ -1182,6 +1240,31 @@ private:
         return true;
     }
 
+    /**
+     * Resume all of the suspended cookies with a single notification.
+     * @return the number of cookies resumed
+     */
+    size_t resume_all() {
+        std::vector<const void*> cookies;
+        {
+            std::lock_guard<std::mutex> guard(suspended_map_mutex);
+            for (const auto& entry : suspended_map) {
+                cookies.push_back(entry.second);
+            }
+            suspended_map.clear();
+        }
+
+        const size_t count = cookies.size();
+        if (count > 0) {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                pending_io_batches.push(std::move(cookies));
+            }
+            condvar.notify_one();
+        }
+        return count;
+    }
+
     bool is_connection_suspended(const void* cookie) {
         std::lock_guard<std::mutex> guard(suspended_map_mutex);
         for (const auto c : suspended_map) {
@@ -1251,6 +1334,8 @@ EWB_Engine::EWB_Engine(GET_SERVER_API gsa_)
 
     ENGINE_HANDLE_V1::dcp = {};
     ENGINE_HANDLE_V1::dcp.step = dcp_step;
+    // Not interposed - the core falls back to step().
+    ENGINE_HANDLE_V1::dcp.step_batch = nullptr;
     ENGINE_HANDLE_V1::dcp.open = dcp_open;
     ENGINE_HANDLE_V1::dcp.stream_req = dcp_stream_req;
     ENGINE_HANDLE_V1::dcp.add_stream = dcp_add_stream;
@@ -1764,12 +1849,27 @@ void EWB_Engine::process_notifications() {
     std::unique_lock<std::mutex> lk(mutex);
     while (!stop_notification_thread) {
         condvar.wait(lk);
-        while (!pending_io_ops.empty()) {
-            const void* cookie = pending_io_ops.front();
-            pending_io_ops.pop();
-            lk.unlock();
-            logger->log(EXTENSION_LOG_DEBUG, nullptr, "EWB_Engine: notify %p");
-            server->cookie->notify_io_complete(cookie, ENGINE_SUCCESS);
+        while (!pending_io_ops.empty() || !pending_io_batches.empty()) {
+            if (!pending_io_ops.empty()) {
+                const void* cookie = pending_io_ops.front();
+                pending_io_ops.pop();
+                lk.unlock();
+                logger->log(EXTENSION_LOG_DEBUG, nullptr,
+                            "EWB_Engine: notify %p", cookie);
+                server->cookie->notify_io_complete(cookie, ENGINE_SUCCESS);
+            } else {
+                std::vector<cb::IoCompletion> completions;
+                for (const auto* cookie : pending_io_batches.front()) {
+                    completions.push_back({cookie, ENGINE_SUCCESS});
+                }
+                pending_io_batches.pop();
+                lk.unlock();
+                logger->log(EXTENSION_LOG_DEBUG, nullptr,
+                            "EWB_Engine: notify %zu cookies",
+                            completions.size());
+                server->cookie->notify_io_complete_batch(completions.data(),
+                                                         completions.size());
+            }
             lk.lock();
         }
     }
@@ -1869,6 +1969,18 @@ ENGINE_ERROR_CODE EWB_Engine::handleResume(const void* cookie, uint32_t id,
     }
 }
 
+ENGINE_ERROR_CODE EWB_Engine::handleResumeAll(const void* cookie,
+                                              ADD_RESPONSE response) {
+    auto logger = gsa()->log->get_logger();
+    const auto count = resume_all();
+    logger->log(EXTENSION_LOG_DEBUG, nullptr,
+                "%zu suspended connections will be resumed", count);
+    response(nullptr, 0, nullptr, 0, nullptr, 0,
+             PROTOCOL_BINARY_RAW_BYTES,
+             PROTOCOL_BINARY_RESPONSE_SUCCESS, /*cas*/0, cookie);
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE EWB_Engine::setItemCas(const void *cookie,
                                          const std::string& key,
                                          uint32_t cas,
@@ -86,5 +86,17 @@ enum class EWBEngineMode : uint32_t {
     // Set the CAS for an item.
     // Requires the CAS of the item. Bear in mind that we're limited to
     // 32 bits.
-    SetItemCas = 10
+    SetItemCas = 10,
+
+    // Like Sequence, but the calls in the sequence return
+    // ENGINE_EWOULDBLOCK and their cookies are suspended (rather than
+    // notified) with the position of the call in the sequence as the id.
+    // The calls must be resumed with Resume, which allows a test to
+    // control the order in which blocked operations complete.
+    SuspendSequence = 11,
+
+    // Resume all of the suspended cookies (in the order of their ids) with
+    // a single call to notify_io_complete_batch, like the completion of a
+    // batch of background fetches.
+    ResumeAll = 12
 };
@@ -57,6 +57,7 @@ public:
         ENGINE_HANDLE_V1::get_item_info = get_item_info;
         ENGINE_HANDLE_V1::set_item_info = set_item_info;
         ENGINE_HANDLE_V1::dcp.step = dcp_step;
+        ENGINE_HANDLE_V1::dcp.step_batch = nullptr;
         ENGINE_HANDLE_V1::dcp.open = dcp_open;
         ENGINE_HANDLE_V1::dcp.add_stream = dcp_add_stream;
         ENGINE_HANDLE_V1::dcp.close_stream = dcp_close_stream;
@@ -0,0 +1,308 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <memcached/thread_placement.h>
+
+#include <platform/sysinfo.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::string cb::to_string(cb::ThreadPlacement placement) {
+    switch (placement) {
+    case cb::ThreadPlacement::None:
+        return "none";
+    case cb::ThreadPlacement::Core:
+        return "core";
+    case cb::ThreadPlacement::Numa:
+        return "numa";
+    }
+    throw std::invalid_argument(
+            "cb::to_string(ThreadPlacement): Invalid placement: " +
+            std::to_string(int(placement)));
+}
+
+cb::ThreadPlacement cb::to_thread_placement(const std::string& name) {
+    if (name == "none") {
+        return cb::ThreadPlacement::None;
+    }
+    if (name == "core") {
+        return cb::ThreadPlacement::Core;
+    }
+    if (name == "numa") {
+        return cb::ThreadPlacement::Numa;
+    }
+    throw std::invalid_argument(
+            "cb::to_thread_placement: Unknown placement: \"" + name + "\"");
+}
+
+cb::CpuTopology::CpuTopology(std::vector<std::vector<int>> nodes_)
+    : nodes(std::move(nodes_)) {
+    if (nodes.empty()) {
+        throw std::invalid_argument("CpuTopology: must have at least one node");
+    }
+    for (const auto& cpus : nodes) {
+        if (cpus.empty()) {
+            throw std::invalid_argument(
+                    "CpuTopology: every node must have at least one CPU");
+        }
+    }
+}
+
+#ifdef __linux__
+/**
+ * Read the CPUs of each node from sysfs, keeping only those in the process's
+ * affinity mask. Returns no nodes if it fails.
+ */
+static std::vector<std::vector<int>> readLinuxNodes() {
+    std::vector<std::vector<int>> nodes;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return nodes;
+    }
+
+    const std::string root = "/sys/devices/system/node";
+    DIR* dir = opendir(root.c_str());
+    if (dir == nullptr) {
+        return nodes;
+    }
+    // Node numbers may be sparse; order the nodes by their number.
+    std::map<int, std::vector<int>> byNumber;
+    while (auto* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name.compare(0, 4, "node") != 0 ||
+            name.find_first_not_of("0123456789", 4) != std::string::npos ||
+            name.size() == 4) {
+            continue;
+        }
+        std::ifstream file(root + "/" + name + "/cpulist");
+        std::string list;
+        if (!std::getline(file, list)) {
+            continue;
+        }
+        std::vector<int> cpus;
+        try {
+            for (auto cpu : cb::CpuTopology::parseCpuList(list)) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        } catch (const std::invalid_argument&) {
+            continue;
+        }
+        if (!cpus.empty()) {
+            byNumber[std::stoi(name.substr(4))] = std::move(cpus);
+        }
+    }
+    closedir(dir);
+
+    for (auto& node : byNumber) {
+        nodes.push_back(std::move(node.second));
+    }
+    return nodes;
+}
+#endif
+
+const cb::CpuTopology& cb::CpuTopology::get() {
+    static const CpuTopology topology = [] {
+        std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+        nodes = readLinuxNodes();
+#endif
+        if (nodes.empty()) {
+            std::vector<int> cpus(std::max(
+                    size_t(1), size_t(Couchbase::get_available_cpu_count())));
+            for (size_t ii = 0; ii < cpus.size(); ++ii) {
+                cpus[ii] = int(ii);
+            }
+            nodes.push_back(std::move(cpus));
+        }
+        return CpuTopology(std::move(nodes));
+    }();
+    return topology;
+}
+
+size_t cb::CpuTopology::getNumCpus() const {
+    size_t count = 0;
+    for (const auto& cpus : nodes) {
+        count += cpus.size();
+    }
+    return count;
+}
+
+int cb::CpuTopology::getNode(int cpu) const {
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        const auto& cpus = nodes[node];
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+            return int(node);
+        }
+    }
+    return -1;
+}
+
+std::vector<int> cb::CpuTopology::getPlacement(ThreadPlacement placement,
+                                               size_t index) const {
+    const auto& cpus = nodes[index % nodes.size()];
+    switch (placement) {
+    case ThreadPlacement::None:
+        return {};
+    case ThreadPlacement::Core:
+        return {cpus[(index / nodes.size()) % cpus.size()]};
+    case ThreadPlacement::Numa:
+        return cpus;
+    }
+    throw std::invalid_argument(
+            "CpuTopology::getPlacement: Invalid placement: " +
+            std::to_string(int(placement)));
+}
+
+std::vector<int> cb::CpuTopology::parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        auto end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const auto range = list.substr(pos, end - pos);
+        pos = end + 1;
+        if (range.find_first_not_of(" \n") == std::string::npos) {
+            continue;
+        }
+        try {
+            size_t used;
+            const int first = std::stoi(range, &used);
+            int last = first;
+            if (used < range.size() && range[used] == '-') {
+                last = std::stoi(range.substr(used + 1));
+            }
+            if (first < 0 || last < first) {
+                throw std::invalid_argument("bad range");
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::logic_error&) {
+            throw std::invalid_argument(
+                    "CpuTopology::parseCpuList: Invalid CPU list: \"" + list +
+                    "\"");
+        }
+    }
+    return cpus;
+}
+
+std::string cb::CpuTopology::formatCpuList(std::vector<int> cpus) {
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+    std::string list;
+    for (size_t ii = 0; ii < cpus.size();) {
+        size_t last = ii;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+            ++last;
+        }
+        if (!list.empty()) {
+            list += ',';
+        }
+        list += std::to_string(cpus[ii]);
+        if (last != ii) {
+            list += '-' + std::to_string(cpus[last]);
+        }
+        ii = last + 1;
+    }
+    return list;
+}
+
+bool cb::bindCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        errno = error;
+        return false;
+    }
+    return true;
+#else
+    errno = ENOTSUP;
+    return false;
+#endif
+}
+
+static std::mutex threadOrdinalMutex;
+static std::vector<bool> threadOrdinalsInUse;
+
+size_t cb::acquireThreadOrdinal() {
+    std::lock_guard<std::mutex> guard(threadOrdinalMutex);
+    auto it = std::find(
+            threadOrdinalsInUse.begin(), threadOrdinalsInUse.end(), false);
+    const size_t ordinal = it - threadOrdinalsInUse.begin();
+    if (it == threadOrdinalsInUse.end()) {
+        threadOrdinalsInUse.push_back(true);
+    } else {
+        *it = true;
+    }
+    return ordinal;
+}
+
+void cb::releaseThreadOrdinal(size_t ordinal) {
+    std::lock_guard<std::mutex> guard(threadOrdinalMutex);
+    if (ordinal >= threadOrdinalsInUse.size() ||
+        !threadOrdinalsInUse[ordinal]) {
+        throw std::invalid_argument(
+                "cb::releaseThreadOrdinal: ordinal not in use: " +
+                std::to_string(ordinal));
+    }
+    threadOrdinalsInUse[ordinal] = false;
+}
+
+bool cb::setLocalMemoryPolicy() {
+#ifdef __linux__
+    // The thread's default policy is to allocate from the local node. (Using
+    // the syscall directly avoids a dependency on libnuma.)
+    return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0;
+#else
+    errno = ENOTSUP;
+    return false;
+#endif
+}
+
+int cb::getCurrentCpu() {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
@@ -310,6 +310,34 @@ struct dcp_interface {
     ENGINE_ERROR_CODE (* step)(ENGINE_HANDLE* handle, const void* cookie,
                                struct dcp_message_producers* producers);
 
+    /**
+     * Batched version of step(). Called from the memcached core for a DCP
+     * connection to allow it to inject up to max_messages messages on the
+     * stream in a single call, which lets the core build larger writes
+     * per wakeup and saves the per-message call overhead.
+     *
+     * The engine should stop early when it runs out of ready messages, when
+     * the connection's flow control window is full, or when a message
+     * producer returns ENGINE_E2BIG (the core's write buffer is full - the
+     * rejected message must be sent on the next call).
+     *
+     * This is optional; if it is nullptr the core calls step() instead.
+     *
+     * @param handle reference to the engine itself
+     * @param cookie a unique handle the engine should pass on to the
+     *               message producers
+     * @param producers functions the client may use to add messages to
+     *                  the DCP stream
+     * @param max_messages the maximum number of messages to add
+     *
+     * @return as for step(); ENGINE_WANT_MORE if at least one message was
+     *         added
+     */
+    ENGINE_ERROR_CODE (* step_batch)(ENGINE_HANDLE* handle,
+                                     const void* cookie,
+                                     struct dcp_message_producers* producers,
+                                     size_t max_messages);
+
     ENGINE_ERROR_CODE (*open) (ENGINE_HANDLE* handle,
                                const void* cookie,
                                uint32_t opaque,
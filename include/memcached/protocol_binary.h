@@ -1289,7 +1289,8 @@ enum class Feature : uint16_t {
     SELECT_BUCKET = 0x08,
     COLLECTIONS = 0x09,
     SNAPPY = 0x0a,
-    JSON = 0x0b
+    JSON = 0x0b,
+    UNORDERED_EXECUTION = 0x0c // the server may reorder pipelined requests
 };
 }
 using protocol_binary_hello_features_t = mcbp::Feature;
@@ -2431,6 +2432,8 @@ inline std::string to_string(const Feature& feature) {
         return "COLLECTIONS";
     case Feature::SNAPPY:
         return "SNAPPY";
+    case Feature::UNORDERED_EXECUTION:
+        return "Unordered execution";
     case Feature::Invalid:
         return "Invalid";
     }
@@ -74,6 +74,17 @@ typedef struct {
     void (*evicting)(const void* cookie, const void* key, int nkey);
 } SERVER_STAT_API;
 
+namespace cb {
+/**
+ * A completed io operation for a connection (see
+ * SERVER_COOKIE_API::notify_io_complete_batch)
+ */
+struct IoCompletion {
+    const void* cookie;
+    ENGINE_ERROR_CODE status;
+};
+} // namespace cb
+
 /**
  * Commands to operate on a specific cookie.
  */
@@ -263,6 +274,19 @@ typedef struct {
      */
     void (*set_error_context)(void* cookie, cb::const_char_buffer message);
 
+    /**
+     * Let a number of connections know that IO has completed. This is
+     * the same as calling notify_io_complete for each of the completions,
+     * but the completions for connections served by the same worker
+     * thread are handed over to the thread in one go (and the thread is
+     * only woken up once).
+     *
+     * @param completions the cookies and the status of their io operation
+     * @param count the number of elements in completions
+     */
+    void (*notify_io_complete_batch)(const cb::IoCompletion* completions,
+                                     size_t count);
+
 } SERVER_COOKIE_API;
 
 struct SERVER_DOCUMENT_API {
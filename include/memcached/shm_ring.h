@@ -0,0 +1,256 @@
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+/*
+ * The layout of the shared memory used by local clients to talk to
+ * memcached without going through the network stack (see the "shm_listen"
+ * setting).
+ *
+ * The client connects to the unix domain socket memcached listens to, and
+ * receives a Hello message carrying three file descriptors:
+ *
+ *   1. The shared memory segment (to mmap, Segment::getSize() bytes)
+ *   2. The eventfd memcached waits on
+ *   3. The eventfd the client waits on
+ *
+ * The segment holds two single producer single consumer rings: the client
+ * writes the (unchanged) binary protocol requests to the request ring, and
+ * memcached writes the responses to the response ring. The rings carry a
+ * byte stream, just like a socket, so a frame may wrap around the end of
+ * the ring or be written in several chunks.
+ *
+ * The producer must signal the eventfd of the consumer when produce()
+ * tells it that the consumer may be waiting for data, and the consumer must
+ * signal the eventfd of the producer when consume() tells it the producer
+ * is waiting for room. Before waiting on its eventfd a side must drain it
+ * and check the ring once more (for room after calling waitForRoom()).
+ *
+ * Both sides stay connected to the unix domain socket, and treat the other
+ * side closing it as the end of the connection.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace cb {
+namespace shm {
+
+/** The magic of the Hello message and the segment ("MCSH") */
+const uint32_t Magic = 0x4d435348;
+
+/** The version of the layout described in this file */
+const uint32_t Version = 1;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "The rings require lock free 64 bit atomics");
+
+/**
+ * The message memcached sends over the unix domain socket (along with the
+ * file descriptors) when a client connects
+ */
+struct Hello {
+    uint32_t magic;
+    uint32_t version;
+    /** The size of each of the rings in the segment */
+    uint64_t ringSize;
+};
+
+/**
+ * The (shared) state of a ring. The indexes are never wrapped, the offset
+ * of an index in the data area is the index modulo the size of the ring. The
+ * ring is empty when head == tail, and full when tail - head is the size of
+ * the ring. The members live in separate cache lines as they're written by
+ * different sides.
+ */
+struct RingControl {
+    /** The number of bytes consumed (only written by the consumer) */
+    alignas(64) std::atomic<uint64_t> head;
+    /** The number of bytes produced (only written by the producer) */
+    alignas(64) std::atomic<uint64_t> tail;
+    /** Set by the producer while it waits for room in the ring */
+    alignas(64) std::atomic<uint32_t> producerWaiting;
+};
+
+/**
+ * The shared memory segment; followed by the data areas of the request
+ * ring and of the response ring. The header is informational: both sides
+ * are writing to the segment, so the sides must use the ring size they
+ * agreed on in the Hello message rather than the one in the segment.
+ */
+struct Segment {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ringSize;
+    RingControl requests;
+    RingControl responses;
+
+    uint8_t* getRequestData() {
+        return reinterpret_cast<uint8_t*>(this) + sizeof(Segment);
+    }
+
+    /** @param ringSize the (agreed on) size of the rings */
+    uint8_t* getResponseData(size_t ringSize) {
+        return getRequestData() + ringSize;
+    }
+
+    /** Get the size of the segment with the given ring size */
+    static size_t getSize(size_t ringSize) {
+        return sizeof(Segment) + 2 * ringSize;
+    }
+};
+
+/**
+ * A view of a ring in the segment for either of the sides. The producer
+ * may only call produce(), getFree() and waitForRoom(), and the consumer
+ * may only call consume() and empty().
+ *
+ * The wakeups rely on the sequentially consistent stores and loads of the
+ * indexes and of the producerWaiting flag: a side first publishes its
+ * progress and then looks at the other side, so at least one of them sees
+ * the progress of the other.
+ *
+ * The control lives in memory the other side may write to, so each index is
+ * loaded once per call and validated before it is used to address the data
+ * area. The size must be a trusted value (never read back from the segment).
+ */
+class Ring {
+public:
+    /**
+     * Returned by produce(), consume() and getFree() if the indexes are
+     * inconsistent (more bytes in the ring than it can hold): the other side
+     * is broken or hostile, and the connection must be closed.
+     */
+    static const size_t Corrupt = SIZE_MAX;
+
+    Ring(RingControl& control, uint8_t* data, size_t size)
+        : control(control), data(data), size(size) {
+    }
+
+    /**
+     * Copy (as much as there is room for of) the data into the ring
+     *
+     * @param src the data to add
+     * @param nbytes the number of bytes to add
+     * @param wakeConsumer set to true if the consumer must be signalled
+     *                     (it may be waiting for data)
+     * @return the number of bytes added (0 if the ring is full, Corrupt if
+     *         the indexes are inconsistent)
+     */
+    size_t produce(const void* src, size_t nbytes, bool& wakeConsumer) {
+        const auto tail = control.tail.load(std::memory_order_relaxed);
+        const auto head = control.head.load(std::memory_order_acquire);
+        if (tail - head > size) {
+            return Corrupt;
+        }
+        const size_t count = std::min(nbytes, size_t(size - (tail - head)));
+        if (count == 0) {
+            return 0;
+        }
+
+        const size_t offset = tail % size;
+        const size_t first = std::min(count, size - offset);
+        const auto* ptr = static_cast<const uint8_t*>(src);
+        std::memcpy(data + offset, ptr, first);
+        std::memcpy(data, ptr + first, count - first);
+        control.tail.store(tail + count);
+
+        // The consumer only waits once it consumed all of the data
+        if (control.head.load() == tail) {
+            wakeConsumer = true;
+        }
+        return count;
+    }
+
+    /**
+     * Copy (up to the requested number of bytes of) the data out of the
+     * ring
+     *
+     * @param dest where to store the data
+     * @param nbytes the maximum number of bytes to copy
+     * @param wakeProducer set to true if the producer must be signalled
+     *                     (it waits for room in the ring)
+     * @return the number of bytes copied (0 if the ring is empty, Corrupt
+     *         if the indexes are inconsistent)
+     */
+    size_t consume(void* dest, size_t nbytes, bool& wakeProducer) {
+        const auto head = control.head.load(std::memory_order_relaxed);
+        const auto tail = control.tail.load();
+        if (tail - head > size) {
+            return Corrupt;
+        }
+        const size_t count = std::min(nbytes, size_t(tail - head));
+        if (count == 0) {
+            return 0;
+        }
+
+        const size_t offset = head % size;
+        const size_t first = std::min(count, size - offset);
+        auto* ptr = static_cast<uint8_t*>(dest);
+        std::memcpy(ptr, data + offset, first);
+        std::memcpy(ptr + first, data, count - first);
+        control.head.store(head + count);
+
+        if (control.producerWaiting.load() != 0 &&
+            control.producerWaiting.exchange(0) != 0) {
+            wakeProducer = true;
+        }
+        return count;
+    }
+
+    /** Is the ring empty (as seen by the consumer)? */
+    bool empty() const {
+        return control.head.load(std::memory_order_relaxed) ==
+               control.tail.load();
+    }
+
+    /**
+     * Get the number of bytes the producer may add (Corrupt if the indexes
+     * are inconsistent)
+     */
+    size_t getFree() const {
+        const auto tail = control.tail.load(std::memory_order_relaxed);
+        const auto head = control.head.load();
+        if (tail - head > size) {
+            return Corrupt;
+        }
+        return size - size_t(tail - head);
+    }
+
+    /**
+     * Tell the consumer that the producer waits for room (and must be
+     * signalled once it consumed some data)
+     *
+     * @return the number of bytes the producer may add (if the consumer
+     *         made room in the mean time), or Corrupt
+     */
+    size_t waitForRoom() {
+        control.producerWaiting.store(1);
+        return getFree();
+    }
+
+private:
+    RingControl& control;
+    uint8_t* const data;
+    const size_t size;
+};
+
+} // namespace shm
+} // namespace cb
@@ -0,0 +1,143 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/engine_utilities_visibility.h>
+
+#include <string>
+#include <vector>
+
+namespace cb {
+
+/**
+ * How the threads of a pool (the front-end workers, or the ep-engine
+ * executor threads) are placed on the CPUs of the machine.
+ */
+enum class ThreadPlacement {
+    /// Leave it to the OS scheduler.
+    None,
+    /// Pin each thread to a single CPU. Consecutive threads are spread
+    /// round-robin across the NUMA nodes, and then across the CPUs of the
+    /// node.
+    Core,
+    /// Pin each thread to all of the CPUs of one NUMA node, with consecutive
+    /// threads spread round-robin across the nodes.
+    Numa
+};
+
+ENGINE_UTILITIES_PUBLIC_API
+std::string to_string(ThreadPlacement placement);
+
+/**
+ * Get the ThreadPlacement from its name ("none", "core" or "numa").
+ *
+ * @throws std::invalid_argument if the name is not known
+ */
+ENGINE_UTILITIES_PUBLIC_API
+ThreadPlacement to_thread_placement(const std::string& name);
+
+/**
+ * The CPUs which the process may run on, grouped by NUMA node.
+ */
+class ENGINE_UTILITIES_PUBLIC_API CpuTopology {
+public:
+    /**
+     * @param nodes the CPUs of each node; there must be at least one node,
+     *              and every node must have at least one CPU.
+     * @throws std::invalid_argument if nodes is empty (or has an empty node)
+     */
+    explicit CpuTopology(std::vector<std::vector<int>> nodes);
+
+    /**
+     * Get the topology of this machine. On Linux this is read from sysfs
+     * (and restricted to the process's CPU affinity); elsewhere, or if that
+     * fails, it is a single node of all the available CPUs.
+     */
+    static const CpuTopology& get();
+
+    size_t getNumNodes() const {
+        return nodes.size();
+    }
+
+    size_t getNumCpus() const;
+
+    const std::vector<int>& getCpus(size_t node) const {
+        return nodes.at(node);
+    }
+
+    /// @returns the node the given CPU belongs to, or -1 if not known.
+    int getNode(int cpu) const;
+
+    /**
+     * Get the CPUs the index'th thread should be bound to.
+     *
+     * @param placement the placement policy of the thread's pool
+     * @param index the thread's ordinal (see acquireThreadOrdinal)
+     * @returns the CPUs to bind to; empty if the thread should not be bound
+     */
+    std::vector<int> getPlacement(ThreadPlacement placement,
+                                  size_t index) const;
+
+    /// Parse a list of CPUs in the sysfs format; e.g. "0-3,8,10-11".
+    static std::vector<int> parseCpuList(const std::string& list);
+
+    /// Format a list of CPUs in the sysfs format.
+    static std::string formatCpuList(std::vector<int> cpus);
+
+private:
+    std::vector<std::vector<int>> nodes;
+};
+
+/**
+ * Reserve the lowest thread ordinal which no other thread of the process
+ * holds. Threads are placed by their ordinal (rather than their index within
+ * their own pool), so that memcached's worker threads and each type of
+ * executor thread are spread over the CPUs together, instead of every pool
+ * starting from the first CPU of the first node.
+ */
+ENGINE_UTILITIES_PUBLIC_API
+size_t acquireThreadOrdinal();
+
+/// Release an ordinal reserved by acquireThreadOrdinal(), for reuse.
+ENGINE_UTILITIES_PUBLIC_API
+void releaseThreadOrdinal(size_t ordinal);
+
+/**
+ * Bind the calling thread to the given CPUs.
+ *
+ * @returns false if binding threads is not supported on this platform, or
+ *          failed (errno holds the reason).
+ */
+ENGINE_UTILITIES_PUBLIC_API
+bool bindCurrentThread(const std::vector<int>& cpus);
+
+/**
+ * Make the calling thread allocate memory from the NUMA node it is running
+ * on, instead of following the process-wide policy (memcached interleaves
+ * allocations across all nodes by default).
+ *
+ * @returns false if not supported on this platform, or it failed (errno
+ *          holds the reason).
+ */
+ENGINE_UTILITIES_PUBLIC_API
+bool setLocalMemoryPolicy();
+
+/// @returns the CPU the calling thread is running on, or -1 if not known.
+ENGINE_UTILITIES_PUBLIC_API
+int getCurrentCpu();
+
+} // namespace cb
@@ -254,6 +254,13 @@ static void mock_notify_io_complete(const void *cookie, ENGINE_ERROR_CODE status
     }
 }
 
+static void mock_notify_io_complete_batch(const cb::IoCompletion* completions,
+                                          size_t count) {
+    for (size_t ii = 0; ii < count; ++ii) {
+        mock_notify_io_complete(completions[ii].cookie, completions[ii].status);
+    }
+}
+
 static time_t mock_abstime(const rel_time_t exptime)
 {
     return process_started + exptime;
@@ -438,6 +445,7 @@ SERVER_HANDLE_V1 *get_mock_server_api(void)
       server_cookie_api.engine_error2mcbp = mock_engine_error2mcbp;
       server_cookie_api.get_log_info = mock_get_log_info;
       server_cookie_api.set_error_context = mock_set_error_context;
+      server_cookie_api.notify_io_complete_batch = mock_notify_io_complete_batch;
       server_stat_api.evicting = mock_count_eviction;
 
       extension_api.register_extension = mock_register_extension;
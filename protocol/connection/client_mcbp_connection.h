@@ -174,6 +174,10 @@ public:
         setFeature(mcbp::Feature::XERROR, enable);
     }
 
+    void setUnorderedExecution(bool enable) {
+        setFeature(mcbp::Feature::UNORDERED_EXECUTION, enable);
+    }
+
     std::string ioctl_get(const std::string& key) override;
 
     void ioctl_set(const std::string& key,
@@ -814,6 +814,62 @@ TEST_F(SettingsTest, max_packet_size) {
     }
 }
 
+TEST_F(SettingsTest, ResponseCorkSize) {
+    nonNumericValuesShouldFail("response_cork_size");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "response_cork_size", 8192);
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(8192u, settings.getResponseCorkSize());
+        EXPECT_TRUE(settings.has.response_cork_size);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, ResponseCorkUsec) {
+    nonNumericValuesShouldFail("response_cork_usec");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "response_cork_usec", 100);
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(100u, settings.getResponseCorkUsec());
+        EXPECT_TRUE(settings.has.response_cork_usec);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, StreamValueThreshold) {
+    nonNumericValuesShouldFail("stream_value_threshold");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "stream_value_threshold", 65536);
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(65536u, settings.getStreamValueThreshold());
+        EXPECT_TRUE(settings.has.stream_value_threshold);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, StreamValueLimit) {
+    nonNumericValuesShouldFail("stream_value_limit");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "stream_value_limit", 65536);
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(65536u, settings.getStreamValueLimit());
+        EXPECT_TRUE(settings.has.stream_value_limit);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, StdinListen) {
     nonBooleanValuesShouldFail("stdin_listen");
 
@@ -838,6 +894,84 @@ TEST_F(SettingsTest, StdinListen) {
     }
 }
 
+TEST_F(SettingsTest, PerThreadListeners) {
+    nonBooleanValuesShouldFail("per_thread_listeners");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddTrueToObject(obj.get(), "per_thread_listeners");
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isPerThreadListeners());
+        EXPECT_TRUE(settings.has.per_thread_listeners);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj.reset(cJSON_CreateObject());
+    cJSON_AddFalseToObject(obj.get(), "per_thread_listeners");
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isPerThreadListeners());
+        EXPECT_TRUE(settings.has.per_thread_listeners);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, EventLoop) {
+    nonStringValuesShouldFail("event_loop");
+
+    for (const auto& name : {"libevent", "io_uring"}) {
+        unique_cJSON_ptr obj(cJSON_CreateObject());
+        cJSON_AddStringToObject(obj.get(), "event_loop", name);
+        try {
+            Settings settings(obj);
+            EXPECT_EQ(name, to_string(settings.getEventLoop()));
+            EXPECT_TRUE(settings.has.event_loop);
+        } catch (std::exception& exception) {
+            FAIL() << exception.what();
+        }
+    }
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddStringToObject(obj.get(), "event_loop", "epoll");
+    expectFail(obj);
+}
+
+TEST_F(SettingsTest, ShmListen) {
+    nonStringValuesShouldFail("shm_listen");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddStringToObject(obj.get(), "shm_listen", "/tmp/memcached.shm");
+    try {
+        Settings settings(obj);
+        EXPECT_EQ("/tmp/memcached.shm", settings.getShmListen());
+        EXPECT_TRUE(settings.has.shm_listen);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, ThreadPlacement) {
+    nonStringValuesShouldFail("thread_placement");
+
+    for (const auto& name : {"none", "core", "numa"}) {
+        unique_cJSON_ptr obj(cJSON_CreateObject());
+        cJSON_AddStringToObject(obj.get(), "thread_placement", name);
+        try {
+            Settings settings(obj);
+            EXPECT_EQ(name, cb::to_string(settings.getThreadPlacement()));
+            EXPECT_TRUE(settings.has.thread_placement);
+        } catch (std::exception& exception) {
+            FAIL() << exception.what();
+        }
+    }
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddStringToObject(obj.get(), "thread_placement", "socket");
+    expectFail(obj);
+}
+
 TEST_F(SettingsTest, ExitOnConnectionClose) {
     nonBooleanValuesShouldFail("exit_on_connection_close");
 
@@ -1016,6 +1150,20 @@ TEST(SettingsUpdateTest, ThreadsIsNotDynamic) {
                  std::invalid_argument);
 }
 
+TEST(SettingsUpdateTest, ThreadPlacementIsNotDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    settings.setThreadPlacement(cb::ThreadPlacement::Numa);
+    updated.setThreadPlacement(settings.getThreadPlacement());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should fail
+    updated.setThreadPlacement(cb::ThreadPlacement::Core);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
 TEST(SettingsUpdateTest, InterfaceIdenticalArraysShouldWork) {
     Settings updated;
     Settings settings;
@@ -1438,6 +1586,54 @@ TEST(SettingsUpdateTest, MaxPacketSizeIsDynamic) {
               settings.getMaxPacketSize());
 }
 
+TEST(SettingsUpdateTest, ResponseCorkIsDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    updated.setResponseCorkSize(settings.getResponseCorkSize());
+    updated.setResponseCorkUsec(settings.getResponseCorkUsec());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setResponseCorkSize(4096);
+    updated.setResponseCorkUsec(50);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(0u, settings.getResponseCorkSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(4096u, settings.getResponseCorkSize());
+    EXPECT_EQ(50u, settings.getResponseCorkUsec());
+}
+
+TEST(SettingsUpdateTest, StreamValueThresholdIsDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    updated.setStreamValueThreshold(settings.getStreamValueThreshold());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setStreamValueThreshold(65536);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(0u, settings.getStreamValueThreshold());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(65536u, settings.getStreamValueThreshold());
+}
+
+TEST(SettingsUpdateTest, StreamValueLimitIsDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    updated.setStreamValueLimit(settings.getStreamValueLimit());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setStreamValueLimit(65536);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(0u, settings.getStreamValueLimit());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(65536u, settings.getStreamValueLimit());
+}
+
 TEST(SettingsUpdateTest, StdinListenIsNotDynamic) {
     Settings settings;
     Settings updated;
@@ -1452,6 +1648,48 @@ TEST(SettingsUpdateTest, StdinListenIsNotDynamic) {
                  std::invalid_argument);
 }
 
+TEST(SettingsUpdateTest, PerThreadListenersIsNotDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    settings.setPerThreadListeners(true);
+    updated.setPerThreadListeners(settings.isPerThreadListeners());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should not work
+    updated.setPerThreadListeners(!settings.isPerThreadListeners());
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
+TEST(SettingsUpdateTest, EventLoopIsNotDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    settings.setEventLoop(EventLoop::IoUring);
+    updated.setEventLoop(settings.getEventLoop());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should not work
+    updated.setEventLoop(EventLoop::Libevent);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
+TEST(SettingsUpdateTest, ShmListenIsNotDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    settings.setShmListen("/tmp/memcached.shm");
+    updated.setShmListen(settings.getShmListen());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should not work
+    updated.setShmListen("/tmp/other.shm");
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
 TEST(SettingsUpdateTest, ExitOnConnectionCloseIsNotDynamic) {
     Settings settings;
     Settings updated;
@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Tests (and a simple throughput measurement) of the worker thread event
+ * loops selected by the "event_loop" setting. The same pipelined workload
+ * is run against a server using libevent and one using io_uring, so the
+ * *PerfTest results (the "OpsPerSec" property) may be compared. If the
+ * kernel doesn't support io_uring the server falls back to libevent (see
+ * "stats worker_thread_info io"); the io_uring tests then record a
+ * "skipped" property and test nothing. They run in their own ctest target
+ * (memcached-io-uring-tests) rather than in the bulk unit tests.
+ */
+
+#include "testapp_pipeline.h"
+
+class EventLoopTest : public PipelineTest {
+protected:
+    void perfTest(size_t value_size) {
+        const auto ops = perfPipeline(getBinprotConnection(), value_size);
+        RecordProperty("OpsPerSec", int(ops));
+    }
+};
+
+class LibeventLoopTest : public EventLoopTest {
+public:
+    static void SetUpTestCase() {
+        startServer("event_loop", "libevent");
+    }
+};
+
+class LibeventLoopPerfTest : public LibeventLoopTest {};
+
+class IoUringLoopTest : public EventLoopTest {
+public:
+    static void SetUpTestCase() {
+        startServer("event_loop", "io_uring");
+    }
+
+protected:
+    /**
+     * Check that the worker threads really use io_uring; if the kernel
+     * doesn't support it the server falls back to libevent, and the test
+     * records why it is skipped (rather than passing as if it tested
+     * io_uring).
+     */
+    bool usingIoUring() {
+        auto stats = getAdminConnection().stats("worker_thread_info io");
+        auto* loop = cJSON_GetObjectItem(stats.get(), "0:event_loop");
+        EXPECT_NE(nullptr, loop);
+        if (loop == nullptr) {
+            return false;
+        }
+        if (std::string(loop->valuestring) == "io_uring") {
+            return true;
+        }
+        RecordProperty("skipped",
+                       std::string("io_uring is not supported by the "
+                                   "kernel, the worker threads use ") +
+                               loop->valuestring);
+        return false;
+    }
+};
+
+class IoUringLoopPerfTest : public IoUringLoopTest {};
+
+TEST_F(LibeventLoopTest, Pipeline) {
+    pipeline(getBinprotConnection(), 10, 100, 100);
+}
+
+TEST_F(LibeventLoopTest, PipelineLargeValues) {
+    pipeline(getBinprotConnection(), 2, 10, 1024 * 1024);
+}
+
+TEST_F(LibeventLoopPerfTest, SmallValues) {
+    perfTest(64);
+}
+
+TEST_F(LibeventLoopPerfTest, LargeValues) {
+    perfTest(32 * 1024);
+}
+
+TEST_F(IoUringLoopTest, Settings) {
+    auto& conn = getAdminConnection();
+    auto stats = conn.stats("settings");
+    auto* loop = cJSON_GetObjectItem(stats.get(), "event_loop");
+    ASSERT_NE(nullptr, loop);
+    EXPECT_STREQ("io_uring", loop->valuestring);
+
+    // Each worker thread reports the event loop it actually uses (which is
+    // libevent if the kernel doesn't support io_uring)
+    usingIoUring();
+}
+
+TEST_F(IoUringLoopTest, Pipeline) {
+    if (!usingIoUring()) {
+        return;
+    }
+    pipeline(getBinprotConnection(), 10, 100, 100);
+}
+
+TEST_F(IoUringLoopTest, PipelineLargeValues) {
+    if (!usingIoUring()) {
+        return;
+    }
+    // Larger than the data the connection buffers before pausing the
+    // receive
+    pipeline(getBinprotConnection(), 2, 10, 1024 * 1024);
+}
+
+TEST_F(IoUringLoopPerfTest, SmallValues) {
+    if (!usingIoUring()) {
+        return;
+    }
+    perfTest(64);
+}
+
+TEST_F(IoUringLoopPerfTest, LargeValues) {
+    if (!usingIoUring()) {
+        return;
+    }
+    perfTest(32 * 1024);
+}
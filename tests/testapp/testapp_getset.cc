@@ -698,3 +698,93 @@ TEST_P(GetSetTest, TestGetMeta) {
     EXPECT_EQ(0, meta.deleted);
     EXPECT_EQ(PROTOCOL_BINARY_RAW_BYTES, meta.datatype);
 }
+
+/**
+ * The value of a SET bigger than stream_value_threshold (1MB by default)
+ * is received straight into the item; it must be stored and returned
+ * intact.
+ */
+TEST_P(GetSetTest, TestStreamedValue) {
+    auto& conn = getConnection();
+    auto getStreamedValues = [&conn]() -> uint64_t {
+        auto stats = conn.stats("");
+        auto* stat = cJSON_GetObjectItem(stats.get(), "streamed_values");
+        EXPECT_NE(nullptr, stat);
+        return stat == nullptr ? 0 : uint64_t(stat->valuedouble);
+    };
+    const auto streamed = getStreamedValues();
+
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value.resize(2 * 1024 * 1024);
+    for (size_t ii = 0; ii < document.value.size(); ++ii) {
+        document.value[ii] = static_cast<uint8_t>(ii % 251);
+    }
+    conn.mutate(document, 0, MutationType::Set);
+
+    const auto stored = conn.get(name, 0);
+    EXPECT_EQ(document.value.size(), stored.value.size());
+    EXPECT_TRUE(document.value == stored.value) << "Value corrupted";
+    EXPECT_LT(streamed, getStreamedValues());
+}
+
+/**
+ * A value which would take the values streamed at a time past
+ * stream_value_limit is buffered instead (and stored intact)
+ */
+TEST_P(GetSetTest, TestStreamedValueOverLimit) {
+    cJSON_DeleteItemFromObject(memcached_cfg.get(), "stream_value_limit");
+    cJSON_AddNumberToObject(memcached_cfg.get(), "stream_value_limit",
+                            1024 * 1024);
+    reconfigure(memcached_cfg);
+
+    auto& conn = getConnection();
+    auto getStreamedValues = [&conn]() -> uint64_t {
+        auto stats = conn.stats("");
+        auto* stat = cJSON_GetObjectItem(stats.get(), "streamed_values");
+        EXPECT_NE(nullptr, stat);
+        return stat == nullptr ? 0 : uint64_t(stat->valuedouble);
+    };
+    const auto streamed = getStreamedValues();
+
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value.resize(2 * 1024 * 1024);
+    for (size_t ii = 0; ii < document.value.size(); ++ii) {
+        document.value[ii] = static_cast<uint8_t>(ii % 251);
+    }
+    conn.mutate(document, 0, MutationType::Set);
+
+    const auto stored = conn.get(name, 0);
+    EXPECT_TRUE(document.value == stored.value) << "Value corrupted";
+    EXPECT_EQ(streamed, getStreamedValues());
+
+    cJSON_ReplaceItemInObject(memcached_cfg.get(), "stream_value_limit",
+                              cJSON_CreateNumber(100 * 1024 * 1024));
+    reconfigure(memcached_cfg);
+    cJSON_DeleteItemFromObject(memcached_cfg.get(), "stream_value_limit");
+}
+
+/**
+ * When the item allocation for a streamed value blocks, the command is
+ * buffered instead. It must then wait for the engine's notification of
+ * the allocation, rather than take it for the completion of the command.
+ */
+TEST_P(GetSetTest, TestStreamedValueAllocationBlocks) {
+    auto& conn = getConnection();
+
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value.resize(2 * 1024 * 1024);
+    for (size_t ii = 0; ii < document.value.size(); ++ii) {
+        document.value[ii] = static_cast<uint8_t>(ii % 251);
+    }
+
+    // Block the first call into the engine (the allocation when the
+    // header of the SET is received)
+    conn.configureEwouldBlockEngine(EWBEngineMode::Sequence,
+                                    ENGINE_EWOULDBLOCK,
+                                    0x1);
+    conn.mutate(document, 0, MutationType::Set);
+    conn.disableEwouldBlockEngine();
+
+    const auto stored = conn.get(name, 0);
+    EXPECT_TRUE(document.value == stored.value) << "Value corrupted";
+}
@@ -0,0 +1,109 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Tests of a server running with the "per_thread_listeners" setting, where
+ * each worker thread accepts the clients on its own listening socket. The
+ * server is shut down (and must exit cleanly) after the last test.
+ */
+
+#include "testapp.h"
+
+#include <memory>
+#include <vector>
+
+class PerThreadListenersTest : public TestappTest {
+public:
+    static void SetUpTestCase() {
+        memcached_cfg.reset(generate_config(0));
+        cJSON_AddTrueToObject(memcached_cfg.get(), "per_thread_listeners");
+
+        start_memcached_server(memcached_cfg.get());
+
+        if (HasFailure()) {
+            server_pid = reinterpret_cast<pid_t>(-1);
+        } else {
+            CreateTestBucket();
+        }
+
+        ASSERT_NE(reinterpret_cast<pid_t>(-1), server_pid);
+    }
+
+protected:
+    void store(MemcachedConnection& conn, const std::string& key) {
+        Document doc;
+        doc.info.cas = mcbp::cas::Wildcard;
+        doc.info.datatype = cb::mcbp::Datatype::Raw;
+        doc.info.flags = 0;
+        doc.info.id = key;
+        std::copy(key.begin(), key.end(), std::back_inserter(doc.value));
+        conn.mutate(doc, 0, MutationType::Set);
+    }
+
+    /**
+     * Get the sum over the worker threads of a connection count (see
+     * "stats worker_thread_info connections")
+     */
+    uint64_t getConnectionCount(const std::string& counter) {
+        auto stats = getAdminConnection().stats(
+                "worker_thread_info connections");
+        uint64_t total = 0;
+        for (int ii = 0; ii < cJSON_GetArraySize(stats.get()); ++ii) {
+            auto* stat = cJSON_GetArrayItem(stats.get(), ii);
+            const std::string key = stat->string;
+            if (key.substr(key.find(':') + 1) == counter) {
+                total += uint64_t(stat->valueint);
+            }
+        }
+        return total;
+    }
+};
+
+TEST_F(PerThreadListenersTest, Settings) {
+    auto stats = getAdminConnection().stats("settings");
+    auto* enabled = cJSON_GetObjectItem(stats.get(), "per_thread_listeners");
+    ASSERT_NE(nullptr, enabled);
+    EXPECT_EQ(cJSON_True, enabled->type);
+}
+
+/**
+ * All of the clients are accepted by the worker threads (rather than the
+ * dispatcher), and are served like any other client.
+ */
+TEST_F(PerThreadListenersTest, ClientsAcceptedByWorkers) {
+    const auto accepted = getConnectionCount("accepted_conns");
+    EXPECT_LE(1u, accepted);
+
+    auto& conn = getConnection();
+    std::vector<std::unique_ptr<MemcachedConnection>> clients;
+    for (int ii = 0; ii < 16; ++ii) {
+        clients.emplace_back(conn.clone());
+    }
+
+    for (size_t ii = 0; ii < clients.size(); ++ii) {
+        const auto key = name + std::to_string(ii);
+        store(*clients[ii], key);
+        const auto doc = clients[ii]->get(key, 0);
+        EXPECT_EQ(key, std::string(doc.value.begin(), doc.value.end()));
+    }
+
+    // getConnection() reconnected, and getConnectionCount() reconnects
+    // once more
+    EXPECT_LE(accepted + clients.size() + 2,
+              getConnectionCount("accepted_conns"));
+    EXPECT_LE(clients.size() + 1, getConnectionCount("curr_conns"));
+}
@@ -0,0 +1,38 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "testapp_pipeline.h"
+
+void PipelineTest::SetUp() {
+    TestappTest::SetUp();
+    // Pipelining / performance test - disable ewouldblock_engine.
+    ewouldblock_engine_configure(ENGINE_EWOULDBLOCK, EWBEngineMode::Next_N, 0);
+}
+
+void PipelineTest::startServer(const char* setting, const std::string& value) {
+    memcached_cfg.reset(generate_config(0));
+    cJSON_AddStringToObject(memcached_cfg.get(), setting, value.c_str());
+
+    start_memcached_server(memcached_cfg.get());
+
+    if (HasFailure()) {
+        server_pid = reinterpret_cast<pid_t>(-1);
+    } else {
+        CreateTestBucket();
+    }
+
+    ASSERT_NE(reinterpret_cast<pid_t>(-1), server_pid);
+}
@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+/*
+ * The pipelined workload shared by the tests (and simple throughput
+ * measurements) of the different ways clients may talk to the server: the
+ * worker thread event loops and the shared memory transport.
+ */
+
+#include "testapp.h"
+
+#include <chrono>
+#include <string>
+
+class PipelineTest : public TestappTest {
+public:
+    void SetUp() override;
+
+protected:
+    /**
+     * Start a server with the default configuration plus the given string
+     * setting, and create the test bucket.
+     */
+    static void startServer(const char* setting, const std::string& value);
+
+    MemcachedBinprotConnection& getBinprotConnection() {
+        return dynamic_cast<MemcachedBinprotConnection&>(getConnection());
+    }
+
+    /**
+     * Send batches of `pipeline` SETs followed by as many GETs of the same
+     * keys (without waiting for the responses in between), and verify the
+     * responses.
+     *
+     * @param conn a client connection (anything with sendCommand and
+     *             recvResponse)
+     * @param value_size the size of the documents stored
+     * @return the number of operations per second
+     */
+    template <typename T>
+    double pipeline(T& conn, size_t batches, size_t pipeline,
+                    size_t value_size) {
+        const std::string value(value_size, 'x');
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t batch = 0; batch < batches; ++batch) {
+            for (size_t ii = 0; ii < pipeline; ++ii) {
+                BinprotMutationCommand cmd;
+                cmd.setMutationType(MutationType::Set);
+                cmd.setKey(name + std::to_string(ii));
+                cmd.setValue(value);
+                conn.sendCommand(cmd);
+            }
+            for (size_t ii = 0; ii < pipeline; ++ii) {
+                BinprotGetCommand cmd;
+                cmd.setKey(name + std::to_string(ii));
+                conn.sendCommand(cmd);
+            }
+
+            for (size_t ii = 0; ii < pipeline; ++ii) {
+                BinprotMutationResponse resp;
+                conn.recvResponse(resp);
+                EXPECT_TRUE(resp.isSuccess())
+                        << memcached_status_2_text(resp.getStatus());
+            }
+            for (size_t ii = 0; ii < pipeline; ++ii) {
+                BinprotGetResponse resp;
+                conn.recvResponse(resp);
+                EXPECT_TRUE(resp.isSuccess())
+                        << memcached_status_2_text(resp.getStatus());
+                EXPECT_EQ(value, resp.getDataString());
+            }
+        }
+        const auto duration = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start);
+
+        return (batches * pipeline * 2) / duration.count();
+    }
+
+    /**
+     * Run the workload of the *PerfTest tests on the given connection.
+     * @return the number of operations per second
+     */
+    template <typename T>
+    double perfPipeline(T& conn, size_t value_size) {
+        return pipeline(conn, 2000 / ReductionFactor, 32, value_size);
+    }
+
+    /*
+     * Sanitizers and debug builds are considerably slower; reduce the
+     * iteration count of the performance tests.
+     */
+#if defined(THREAD_SANITIZER) || defined(ADDRESS_SANITIZER) || !defined(NDEBUG)
+    static const size_t ReductionFactor = 20;
+#else
+    static const size_t ReductionFactor = 1;
+#endif
+};
@@ -0,0 +1,390 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Tests (and a simple throughput measurement) of the shared memory
+ * transport for local clients selected by the "shm_listen" setting. The
+ * ShmTransportPerfTest tests run the same pipelined workload over the
+ * shared memory transport and over a TCP connection to the loopback
+ * interface, and record both rates ("ShmOpsPerSec" and "TcpOpsPerSec").
+ */
+
+#include "testapp_pipeline.h"
+
+#include <memcached/shm_ring.h>
+
+#include <array>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * A minimal client of the shared memory transport (the client connections
+ * of the test framework only talk to sockets)
+ */
+class ShmClient {
+public:
+    explicit ShmClient(const std::string& path) {
+        sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock == -1) {
+            throw std::system_error(errno, std::system_category(), "socket");
+        }
+
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::copy(path.begin(), path.end(), addr.sun_path);
+        if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr),
+                    sizeof(addr)) == -1) {
+            const auto error = errno;
+            close(sock);
+            throw std::system_error(error, std::system_category(), "connect");
+        }
+
+        cb::shm::Hello hello;
+        struct iovec iov = {&hello, sizeof(hello)};
+        int fds[3];
+        union {
+            char buffer[CMSG_SPACE(sizeof(fds))];
+            struct cmsghdr align;
+        } control;
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+        const auto nr = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        auto* cmsg = CMSG_FIRSTHDR(&msg);
+        if (nr != sizeof(hello) || cmsg == nullptr ||
+            cmsg->cmsg_type != SCM_RIGHTS ||
+            cmsg->cmsg_len != CMSG_LEN(sizeof(fds)) ||
+            hello.magic != cb::shm::Magic ||
+            hello.version != cb::shm::Version) {
+            close(sock);
+            throw std::runtime_error("ShmClient: Invalid hello message");
+        }
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        serverEventFd = fds[1];
+        clientEventFd = fds[2];
+        ringSize = hello.ringSize;
+
+        const auto size = cb::shm::Segment::getSize(ringSize);
+        auto* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fds[0], 0);
+        close(fds[0]);
+        if (ptr == MAP_FAILED) {
+            const auto error = errno;
+            close(sock);
+            close(serverEventFd);
+            close(clientEventFd);
+            throw std::system_error(error, std::system_category(), "mmap");
+        }
+        segment = static_cast<cb::shm::Segment*>(ptr);
+    }
+
+    ShmClient(const ShmClient&) = delete;
+
+    ~ShmClient() {
+        munmap(segment, cb::shm::Segment::getSize(ringSize));
+        close(serverEventFd);
+        close(clientEventFd);
+        close(sock);
+    }
+
+    void sendCommand(const BinprotCommand& command) {
+        const auto encoded = command.encode();
+        write(encoded.header.data(), encoded.header.size());
+        for (const auto& buf : encoded.bufs) {
+            write(buf.data(), buf.size());
+        }
+        flush();
+    }
+
+    void recvResponse(BinprotResponse& response) {
+        std::vector<uint8_t> frame(sizeof(protocol_binary_response_header));
+        read(frame.data(), frame.size());
+        const auto* header =
+                reinterpret_cast<const protocol_binary_response_header*>(
+                        frame.data());
+        const auto bodylen = ntohl(header->response.bodylen);
+        frame.resize(frame.size() + bodylen);
+        read(frame.data() + sizeof(protocol_binary_response_header), bodylen);
+        response.assign(std::move(frame));
+    }
+
+protected:
+    cb::shm::Ring getRequests() {
+        return {segment->requests, segment->getRequestData(), ringSize};
+    }
+
+    cb::shm::Ring getResponses() {
+        return {segment->responses, segment->getResponseData(ringSize),
+                ringSize};
+    }
+
+    void write(const uint8_t* data, size_t size) {
+        auto requests = getRequests();
+        while (size > 0) {
+            auto nw = requests.produce(data, size, wakeServer);
+            if (nw == cb::shm::Ring::Corrupt) {
+                throw std::runtime_error("ShmClient: Corrupt request ring");
+            }
+            if (nw == 0) {
+                flush();
+                drain();
+                if (requests.waitForRoom() == 0) {
+                    wait();
+                }
+                continue;
+            }
+            data += nw;
+            size -= nw;
+        }
+    }
+
+    void read(uint8_t* data, size_t size) {
+        auto responses = getResponses();
+        while (size > 0) {
+            bool wake = false;
+            auto nr = responses.consume(data, size, wake);
+            if (nr == 0) {
+                drain();
+                nr = responses.consume(data, size, wake);
+            }
+            if (nr == cb::shm::Ring::Corrupt) {
+                throw std::runtime_error("ShmClient: Corrupt response ring");
+            }
+            if (wake) {
+                signal(serverEventFd);
+            }
+            if (nr == 0) {
+                wait();
+                continue;
+            }
+            data += nr;
+            size -= nr;
+        }
+    }
+
+    /** Wake up the server if it may be waiting for the requests written */
+    void flush() {
+        if (wakeServer) {
+            wakeServer = false;
+            signal(serverEventFd);
+        }
+    }
+
+    static void signal(int fd) {
+        const uint64_t value = 1;
+        if (::write(fd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+            throw std::system_error(errno, std::system_category(), "write");
+        }
+    }
+
+    void drain() {
+        uint64_t value;
+        (void)::read(clientEventFd, &value, sizeof(value));
+    }
+
+    /** Wait for the server to signal our eventfd */
+    void wait() {
+        std::array<struct pollfd, 2> fds = {{{clientEventFd, POLLIN, 0},
+                                             {sock, POLLIN, 0}}};
+        const auto nr = poll(fds.data(), fds.size(), 60 * 1000);
+        if (nr == 0) {
+            throw std::runtime_error("ShmClient: Timed out");
+        }
+        if (nr == -1 && errno != EINTR) {
+            throw std::system_error(errno, std::system_category(), "poll");
+        }
+        if (fds[0].revents == 0 && fds[1].revents != 0) {
+            throw std::runtime_error("ShmClient: Server closed connection");
+        }
+    }
+
+    int sock;
+    int serverEventFd;
+    int clientEventFd;
+    cb::shm::Segment* segment;
+    size_t ringSize;
+    bool wakeServer = false;
+};
+
+/**
+ * A client writing garbage to the indexes of the rings, as a broken (or
+ * hostile) client could
+ */
+class CorruptingShmClient : public ShmClient {
+public:
+    using ShmClient::ShmClient;
+
+    /** Move the head of the response ring past its tail */
+    void corruptResponses() {
+        auto& control = segment->responses;
+        control.head.store(control.tail.load() + 4096);
+    }
+
+    /** Claim that there is more data in the request ring than it holds */
+    void corruptRequests() {
+        auto& control = segment->requests;
+        control.tail.store(control.head.load() + ringSize + 1);
+        signal(serverEventFd);
+    }
+
+    /**
+     * Wait for the server to close the connection
+     * @return true if it did (within a minute)
+     */
+    bool waitForClose() {
+        struct pollfd fds = {sock, POLLIN, 0};
+        if (poll(&fds, 1, 60 * 1000) != 1) {
+            return false;
+        }
+        char byte;
+        return ::recv(sock, &byte, sizeof(byte), 0) == 0;
+    }
+};
+
+class ShmTransportTest : public PipelineTest {
+public:
+    static void SetUpTestCase() {
+        socketPath = "/tmp/memcached_shm." + std::to_string(getpid());
+        startServer("shm_listen", socketPath);
+    }
+
+protected:
+    static std::string socketPath;
+};
+
+std::string ShmTransportTest::socketPath;
+
+class ShmTransportPerfTest : public ShmTransportTest {
+protected:
+    void perfTest(size_t value_size) {
+        ShmClient shm(socketPath);
+        const auto shmOps = perfPipeline(shm, value_size);
+        const auto tcpOps = perfPipeline(getBinprotConnection(), value_size);
+        RecordProperty("ShmOpsPerSec", int(shmOps));
+        RecordProperty("TcpOpsPerSec", int(tcpOps));
+    }
+};
+
+TEST_F(ShmTransportTest, Settings) {
+    auto& conn = getAdminConnection();
+    auto stats = conn.stats("settings");
+    auto* path = cJSON_GetObjectItem(stats.get(), "shm_listen");
+    ASSERT_NE(nullptr, path);
+    EXPECT_EQ(socketPath, path->valuestring);
+}
+
+TEST_F(ShmTransportTest, GetSet) {
+    ShmClient conn(socketPath);
+
+    BinprotGetCommand get;
+    get.setKey(name);
+    conn.sendCommand(get);
+    BinprotGetResponse miss;
+    conn.recvResponse(miss);
+    EXPECT_EQ(PROTOCOL_BINARY_RESPONSE_KEY_ENOENT, miss.getStatus());
+
+    BinprotMutationCommand set;
+    set.setMutationType(MutationType::Set);
+    set.setKey(name);
+    set.setValue(std::string("value"));
+    conn.sendCommand(set);
+    BinprotMutationResponse stored;
+    conn.recvResponse(stored);
+    ASSERT_TRUE(stored.isSuccess())
+            << memcached_status_2_text(stored.getStatus());
+
+    conn.sendCommand(get);
+    BinprotGetResponse hit;
+    conn.recvResponse(hit);
+    ASSERT_TRUE(hit.isSuccess()) << memcached_status_2_text(hit.getStatus());
+    EXPECT_EQ("value", hit.getDataString());
+
+    // The document is visible to the clients of other transports
+    const auto doc = getConnection().get(name, 0);
+    EXPECT_EQ("value", std::string(doc.value.begin(), doc.value.end()));
+}
+
+TEST_F(ShmTransportTest, Pipeline) {
+    ShmClient conn(socketPath);
+    pipeline(conn, 10, 100, 100);
+}
+
+TEST_F(ShmTransportTest, PipelineLargeValues) {
+    // Larger than the rings, so both sides have to wait for room
+    ShmClient conn(socketPath);
+    pipeline(conn, 2, 4, 2 * 1024 * 1024);
+}
+
+TEST_F(ShmTransportTest, Reconnect) {
+    // The server closes the connection as the client goes away, and keeps
+    // serving new clients
+    for (int ii = 0; ii < 10; ++ii) {
+        ShmClient conn(socketPath);
+        conn.sendCommand(BinprotGenericCommand(PROTOCOL_BINARY_CMD_NOOP));
+        BinprotResponse rsp;
+        conn.recvResponse(rsp);
+        EXPECT_TRUE(rsp.isSuccess());
+    }
+}
+
+TEST_F(ShmTransportTest, CorruptResponseRing) {
+    {
+        CorruptingShmClient conn(socketPath);
+        conn.corruptResponses();
+        conn.sendCommand(BinprotGenericCommand(PROTOCOL_BINARY_CMD_NOOP));
+        // The server must not write the response past the data area, and
+        // closes the connection instead
+        EXPECT_TRUE(conn.waitForClose());
+    }
+
+    // The server keeps serving the other clients
+    ShmClient conn(socketPath);
+    pipeline(conn, 1, 10, 100);
+    pipeline(getBinprotConnection(), 1, 10, 100);
+}
+
+TEST_F(ShmTransportTest, CorruptRequestRing) {
+    {
+        CorruptingShmClient conn(socketPath);
+        conn.corruptRequests();
+        // The server must not read the requests past the data area, and
+        // closes the connection instead
+        EXPECT_TRUE(conn.waitForClose());
+    }
+
+    ShmClient conn(socketPath);
+    pipeline(conn, 1, 10, 100);
+    pipeline(getBinprotConnection(), 1, 10, 100);
+}
+
+TEST_F(ShmTransportPerfTest, SmallValues) {
+    perfTest(64);
+}
+
+TEST_F(ShmTransportPerfTest, LargeValues) {
+    perfTest(32 * 1024);
+}
+
+#endif
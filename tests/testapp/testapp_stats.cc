@@ -16,6 +16,8 @@
  */
 #include "testapp_stats.h"
 
+#include <map>
+
 INSTANTIATE_TEST_CASE_P(TransportProtocols,
                         StatsTest,
                         ::testing::Values(TransportProtocols::McbpPlain,
@@ -136,6 +138,46 @@ TEST_P(StatsTest, Test_MB_17815) {
 }
 
 
+/**
+ * The responses to a batch of pipelined commands should be held back and
+ * sent with (a lot) fewer system calls than there are responses.
+ */
+TEST_P(StatsTest, TestResponseCorking) {
+    auto& conn = dynamic_cast<MemcachedBinprotConnection&>(getConnection());
+    auto getStat = [&conn](const char* name) -> uint64_t {
+        auto stats = conn.stats("");
+        auto* stat = cJSON_GetObjectItem(stats.get(), name);
+        EXPECT_NE(nullptr, stat);
+        return stat == nullptr ? 0 : uint64_t(stat->valuedouble);
+    };
+
+    const auto responses = getStat("responses_sent");
+    const auto calls = getStat("send_calls");
+
+    // Send all of the commands in one go
+    const size_t count = 16;
+    Frame frame;
+    for (size_t ii = 0; ii < count; ++ii) {
+        std::vector<uint8_t> buf;
+        BinprotGenericCommand(PROTOCOL_BINARY_CMD_NOOP).encode(buf);
+        std::copy(buf.begin(), buf.end(), std::back_inserter(frame.payload));
+    }
+    conn.sendFrame(frame);
+
+    for (size_t ii = 0; ii < count; ++ii) {
+        BinprotResponse rsp;
+        conn.recvResponse(rsp);
+        EXPECT_EQ(PROTOCOL_BINARY_CMD_NOOP, rsp.getOp());
+        EXPECT_TRUE(rsp.isSuccess());
+    }
+
+    // The stats calls add one response (and system call) each
+    const auto sent = getStat("responses_sent") - responses - 1;
+    const auto used = getStat("send_calls") - calls - 1;
+    EXPECT_LE(count, sent);
+    EXPECT_GT(count / 2, used) << "Responses not coalesced";
+}
+
 TEST_P(StatsTest, TestSettings) {
     MemcachedConnection& conn = getConnection();
     // @todo verify that I get all of the expected settings. for now
@@ -149,6 +191,9 @@ TEST_P(StatsTest, TestSettings) {
 
     ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "verbosity"));
     ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "num_threads"));
+    ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "thread_placement"));
+    ASSERT_NE(nullptr,
+              cJSON_GetObjectItem(stats.get(), "per_thread_listeners"));
     ASSERT_NE(nullptr,
               cJSON_GetObjectItem(stats.get(), "reqs_per_event_high_priority"));
     ASSERT_NE(nullptr,
@@ -157,6 +202,11 @@ TEST_P(StatsTest, TestSettings) {
               cJSON_GetObjectItem(stats.get(), "reqs_per_event_low_priority"));
     ASSERT_NE(nullptr,
               cJSON_GetObjectItem(stats.get(), "reqs_per_event_def_priority"));
+    ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "response_cork_size"));
+    ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "response_cork_usec"));
+    ASSERT_NE(nullptr,
+              cJSON_GetObjectItem(stats.get(), "stream_value_threshold"));
+    ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "stream_value_limit"));
     ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "auth_enabled_sasl"));
     ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "auth_sasl_engine"));
     ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "auth_required_sasl"));
@@ -256,6 +306,91 @@ TEST_P(StatsTest, TestSchedulerInfo_Aggregate) {
     EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "aggregate"));
 }
 
+TEST_P(StatsTest, TestSchedulerInfo_Placement) {
+    auto stats = getConnection().stats("worker_thread_info placement");
+    // The test server doesn't bind its threads, but we should know where
+    // they have been running.
+    auto* bound = cJSON_GetObjectItem(stats.get(), "0:bound_cpus");
+    ASSERT_NE(nullptr, bound);
+    EXPECT_STREQ("none", bound->valuestring);
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "0:cpu"));
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "0:node"));
+}
+
+TEST_P(StatsTest, TestSchedulerInfo_Connections) {
+    auto stats = getConnection().stats("worker_thread_info connections");
+    // The test server doesn't use per-thread listeners, so the dispatcher
+    // accepts all the clients; but this connection is served by a worker.
+    uint64_t total = 0;
+    uint64_t current = 0;
+    for (int ii = 0; ii < cJSON_GetArraySize(stats.get()); ++ii) {
+        auto* stat = cJSON_GetArrayItem(stats.get(), ii);
+        const std::string key = stat->string;
+        ASSERT_EQ(cJSON_Number, stat->type) << key;
+        const auto value = uint64_t(stat->valueint);
+        if (key.find(":accepted_conns") != std::string::npos) {
+            EXPECT_EQ(0u, value) << key;
+        } else if (key.find(":total_conns") != std::string::npos) {
+            total += value;
+        } else if (key.find(":curr_conns") != std::string::npos) {
+            current += value;
+        }
+    }
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "0:curr_conns"));
+    EXPECT_LE(1u, current);
+    EXPECT_LE(current, total);
+}
+
+TEST_P(StatsTest, TestSchedulerInfo_Buffers) {
+    auto stats = getConnection().stats("worker_thread_info buffers");
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "0:pooled_bytes"));
+
+    // Every buffer allocated (and not freed) by a thread is either kept in
+    // its pool or lent to a connection; and this connection is serving the
+    // command so it holds (at least) a read and a write buffer.
+    std::map<std::string, uint64_t> values;
+    for (int ii = 0; ii < cJSON_GetArraySize(stats.get()); ++ii) {
+        auto* stat = cJSON_GetArrayItem(stats.get(), ii);
+        ASSERT_EQ(cJSON_Number, stat->type) << stat->string;
+        const std::string key = stat->string;
+        values[key.substr(key.find(':') + 1)] += uint64_t(stat->valueint);
+    }
+    EXPECT_LE(2u, values["borrowed_buffers"]);
+    EXPECT_LE(values["borrowed_buffers"] * 2048, values["borrowed_bytes"]);
+    EXPECT_EQ(values["allocated_buffers"] - values["freed_buffers"],
+              values["pooled_buffers"] + values["borrowed_buffers"]);
+}
+
+TEST_P(StatsTest, TestSchedulerInfo_Notifications) {
+    auto stats = getConnection().stats("worker_thread_info notifications");
+    auto* channel = cJSON_GetObjectItem(stats.get(), "0:notify_channel");
+    ASSERT_NE(nullptr, channel);
+#ifdef __linux__
+    EXPECT_STREQ("eventfd", channel->valuestring);
+#else
+    EXPECT_STREQ("pipe", channel->valuestring);
+#endif
+
+    // Every connection dispatched to a worker notifies the thread, and a
+    // thread may drain several notifications in one go. The other threads
+    // are idle while this thread serves the command.
+    std::map<std::string, uint64_t> values;
+    for (int ii = 0; ii < cJSON_GetArraySize(stats.get()); ++ii) {
+        auto* stat = cJSON_GetArrayItem(stats.get(), ii);
+        const std::string key = stat->string;
+        if (key.find(":notify_channel") != std::string::npos) {
+            continue;
+        }
+        ASSERT_EQ(cJSON_Number, stat->type) << key;
+        values[key.substr(key.find(':') + 1)] += uint64_t(stat->valueint);
+    }
+    EXPECT_LE(1u, values["notify_signals"]);
+    EXPECT_LE(1u, values["notify_wakeups"]);
+    EXPECT_LE(values["notify_wakeups"], values["notify_signals"]);
+    EXPECT_LE(values["io_completion_signals"], values["io_completions"]);
+    EXPECT_LE(values["io_completion_signals"], values["notify_signals"]);
+}
+
 TEST_P(StatsTest, TestSchedulerInfo_InvalidSubcommand) {
     try {
         getConnection().stats("worker_thread_info foo");
@@ -0,0 +1,408 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "testapp.h"
+#include "testapp_client_test.h"
+#include <protocol/connection/client_mcbp_connection.h>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+
+/**
+ * Tests for the UnorderedExecution HELLO feature. The ewouldblock engine
+ * is used to make some of the GETs block (and be notified a bit later),
+ * which allows the server to execute the following commands first.
+ */
+class UnorderedExecutionTest : public TestappClientTest {
+protected:
+    MemcachedBinprotConnection& getMcbpConnection() {
+        auto& conn = dynamic_cast<MemcachedBinprotConnection&>(getConnection());
+        conn.setUnorderedExecution(true);
+        return conn;
+    }
+
+    void store(MemcachedConnection& conn,
+               const std::string& key,
+               const std::string& value) {
+        Document doc;
+        doc.info.cas = mcbp::cas::Wildcard;
+        doc.info.datatype = cb::mcbp::Datatype::Raw;
+        doc.info.flags = 0;
+        doc.info.id = key;
+        std::copy(value.begin(), value.end(), std::back_inserter(doc.value));
+        conn.mutate(doc, 0, MutationType::Set);
+    }
+
+    void sendGetK(MemcachedBinprotConnection& conn, const std::string& key) {
+        BinprotGetCommand cmd;
+        cmd.setOp(PROTOCOL_BINARY_CMD_GETK);
+        cmd.setKey(key);
+        conn.sendCommand(cmd);
+    }
+
+    void sendNoop(MemcachedBinprotConnection& conn) {
+        conn.sendCommand(BinprotGenericCommand(PROTOCOL_BINARY_CMD_NOOP));
+    }
+
+    /**
+     * Get a second connection to the bucket, used to resume the commands
+     * suspended by the ewouldblock engine (see
+     * EWBEngineMode::SuspendSequence) and to look at the state of the
+     * connection under test.
+     */
+    std::unique_ptr<MemcachedConnection> getControlConnection(
+            MemcachedConnection& conn) {
+        auto control = conn.clone();
+        control->authenticate("@admin", "password", "PLAIN");
+        control->selectBucket(bucketName);
+        return control;
+    }
+
+    /**
+     * Get the number of parked commands of the connection under test (the
+     * only one using unordered execution), and whether its current command
+     * waits for the engine.
+     */
+    std::pair<size_t, bool> getState(MemcachedConnection& control) {
+        auto stats = control.stats("connections");
+        for (int ii = 0; ii < cJSON_GetArraySize(stats.get()); ++ii) {
+            auto* stat = cJSON_GetArrayItem(stats.get(), ii);
+            unique_cJSON_ptr json{cJSON_Parse(stat->valuestring)};
+            auto* unordered = cJSON_GetObjectItem(json.get(),
+                                                  "unordered_execution");
+            if (unordered == nullptr || unordered->type != cJSON_True) {
+                continue;
+            }
+            auto* parked = cJSON_GetObjectItem(json.get(), "parked_commands");
+            auto* blocked = cJSON_GetObjectItem(json.get(), "ewouldblock");
+            if (parked == nullptr || blocked == nullptr) {
+                break;
+            }
+            return {size_t(parked->valueint), blocked->type == cJSON_True};
+        }
+        throw std::runtime_error("getState: connection not found");
+    }
+
+    /** Wait for the connection under test to reach the given state */
+    void waitForState(MemcachedConnection& control,
+                      size_t parked,
+                      bool blocked) {
+        const auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (getState(control) != std::make_pair(parked, blocked)) {
+            ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+                    << "Timed out waiting for " << parked
+                    << " parked commands (blocked: " << blocked << ")";
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    void resume(MemcachedConnection& control, uint32_t id) {
+        control.configureEwouldBlockEngine(EWBEngineMode::Resume,
+                                           ENGINE_SUCCESS, id);
+    }
+
+    /**
+     * Get the sum over the worker threads of a counter of "stats
+     * worker_thread_info notifications"
+     */
+    uint64_t getNotificationCount(MemcachedConnection& control,
+                                  const std::string& counter) {
+        auto stats = control.stats("worker_thread_info notifications");
+        uint64_t total = 0;
+        for (int ii = 0; ii < cJSON_GetArraySize(stats.get()); ++ii) {
+            auto* stat = cJSON_GetArrayItem(stats.get(), ii);
+            const std::string key = stat->string;
+            if (key.substr(key.find(':') + 1) == counter) {
+                total += uint64_t(stat->valueint);
+            }
+        }
+        return total;
+    }
+};
+
+INSTANTIATE_TEST_CASE_P(TransportProtocols,
+                        UnorderedExecutionTest,
+                        ::testing::Values(TransportProtocols::McbpPlain,
+                                          TransportProtocols::McbpSsl),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(UnorderedExecutionTest, HelloFeature) {
+    auto& conn = getMcbpConnection();
+    EXPECT_TRUE(conn.hasFeature(mcbp::Feature::UNORDERED_EXECUTION));
+
+    conn.setUnorderedExecution(false);
+    EXPECT_FALSE(conn.hasFeature(mcbp::Feature::UNORDERED_EXECUTION));
+}
+
+/**
+ * Pipeline GETKs of which every other call into the engine blocks. All of
+ * them must be answered (the responses are correlated by key), and the
+ * NOOP acts as a barrier so its response must be the last one.
+ */
+TEST_P(UnorderedExecutionTest, PipelinedGets) {
+    auto& conn = getMcbpConnection();
+    const int count = 16;
+    for (int ii = 0; ii < count; ++ii) {
+        store(conn, name + std::to_string(ii), "value" + std::to_string(ii));
+    }
+
+    conn.configureEwouldBlockEngine(EWBEngineMode::Sequence,
+                                    ENGINE_EWOULDBLOCK,
+                                    0x55555555);
+
+    for (int ii = 0; ii < count; ++ii) {
+        sendGetK(conn, name + std::to_string(ii));
+    }
+    sendNoop(conn);
+
+    std::map<std::string, std::string> values;
+    while (true) {
+        BinprotGetResponse resp;
+        conn.recvResponse(resp);
+        if (resp.getOp() == PROTOCOL_BINARY_CMD_NOOP) {
+            EXPECT_TRUE(resp.isSuccess());
+            break;
+        }
+        ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, resp.getOp());
+        ASSERT_TRUE(resp.isSuccess())
+                << memcached_status_2_text(resp.getStatus());
+        const auto key = to_string(resp.getKey());
+        EXPECT_EQ(0u, values.count(key)) << "Duplicate response for " << key;
+        values[key] = resp.getDataString();
+    }
+
+    ASSERT_EQ(size_t(count), values.size());
+    for (int ii = 0; ii < count; ++ii) {
+        EXPECT_EQ("value" + std::to_string(ii),
+                  values[name + std::to_string(ii)]);
+    }
+
+    conn.disableEwouldBlockEngine();
+}
+
+/**
+ * The GETs following a GET which waits for the engine are answered before
+ * it (the blocked GET is only resumed once they are).
+ */
+TEST_P(UnorderedExecutionTest, LaterGetsAnsweredFirst) {
+    auto& conn = getMcbpConnection();
+    const int count = 8;
+    for (int ii = 0; ii < count; ++ii) {
+        store(conn, name + std::to_string(ii), "value" + std::to_string(ii));
+    }
+    auto control = getControlConnection(conn);
+
+    // Suspend the first GET (with id 0)
+    conn.configureEwouldBlockEngine(EWBEngineMode::SuspendSequence,
+                                    ENGINE_EWOULDBLOCK,
+                                    0x1);
+
+    for (int ii = 0; ii < count; ++ii) {
+        sendGetK(conn, name + std::to_string(ii));
+    }
+    sendNoop(conn);
+
+    for (int ii = 1; ii < count; ++ii) {
+        BinprotGetResponse resp;
+        conn.recvResponse(resp);
+        ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, resp.getOp());
+        ASSERT_TRUE(resp.isSuccess())
+                << memcached_status_2_text(resp.getStatus());
+        EXPECT_EQ(name + std::to_string(ii), to_string(resp.getKey()));
+    }
+
+    resume(*control, 0);
+
+    BinprotGetResponse resp;
+    conn.recvResponse(resp);
+    ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, resp.getOp());
+    ASSERT_TRUE(resp.isSuccess());
+    EXPECT_EQ(name + "0", to_string(resp.getKey()));
+    EXPECT_EQ("value0", resp.getDataString());
+
+    BinprotResponse noop;
+    conn.recvResponse(noop);
+    EXPECT_EQ(PROTOCOL_BINARY_CMD_NOOP, noop.getOp());
+
+    conn.disableEwouldBlockEngine();
+}
+
+/**
+ * A command which can't be parked (a SET) waits for the engine while a GET
+ * is parked. The notification of the parked GET must not cause the SET to
+ * be executed again before the engine notified it.
+ */
+TEST_P(UnorderedExecutionTest, BlockedCommandWithParkedGets) {
+    auto& conn = getMcbpConnection();
+    const auto getKey = name + "_get";
+    const auto setKey = name + "_set";
+    store(conn, getKey, "value");
+    auto control = getControlConnection(conn);
+
+    // Suspend the GET (with id 0) and the first call into the engine for
+    // the SET (with id 1)
+    conn.configureEwouldBlockEngine(EWBEngineMode::SuspendSequence,
+                                    ENGINE_EWOULDBLOCK,
+                                    0x3);
+
+    sendGetK(conn, getKey);
+    {
+        BinprotMutationCommand cmd;
+        cmd.setMutationType(MutationType::Set);
+        cmd.setKey(setKey);
+        cmd.setValue(std::string("new"));
+        conn.sendCommand(cmd);
+    }
+    sendNoop(conn);
+    waitForState(*control, 1, true);
+
+    // Complete the GET, and give the server time to act on it. The SET
+    // still waits for the engine (and the GET's response is only sent
+    // once the SET completes)
+    resume(*control, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(std::make_pair(size_t(1), true), getState(*control));
+    try {
+        control->get(setKey, 0);
+        FAIL() << "The SET was executed before it was notified";
+    } catch (const ConnectionError& error) {
+        EXPECT_TRUE(error.isNotFound()) << error.what();
+    }
+
+    resume(*control, 1);
+
+    BinprotMutationResponse set;
+    conn.recvResponse(set);
+    ASSERT_EQ(PROTOCOL_BINARY_CMD_SET, set.getOp());
+    EXPECT_TRUE(set.isSuccess()) << memcached_status_2_text(set.getStatus());
+
+    BinprotGetResponse get;
+    conn.recvResponse(get);
+    ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, get.getOp());
+    ASSERT_TRUE(get.isSuccess());
+    EXPECT_EQ(getKey, to_string(get.getKey()));
+    EXPECT_EQ("value", get.getDataString());
+
+    BinprotResponse noop;
+    conn.recvResponse(noop);
+    EXPECT_EQ(PROTOCOL_BINARY_CMD_NOOP, noop.getOp());
+
+    // Exactly one SET was executed, and the connection is back to normal
+    conn.disableEwouldBlockEngine();
+    const auto doc = conn.get(setKey, 0);
+    EXPECT_EQ("new", std::string(doc.value.begin(), doc.value.end()));
+    EXPECT_EQ(std::make_pair(size_t(0), false), getState(*control));
+}
+
+/**
+ * Parked GETs completed by a single notify_io_complete_batch (like the
+ * GETs waiting for one batch of background fetches) are handed over to
+ * their worker thread together, which is only woken up once.
+ */
+TEST_P(UnorderedExecutionTest, ParkedGetsCompletedInOneBatch) {
+    auto& conn = getMcbpConnection();
+    const int count = 4;
+    for (int ii = 0; ii < count; ++ii) {
+        store(conn, name + std::to_string(ii), "value" + std::to_string(ii));
+    }
+    auto control = getControlConnection(conn);
+
+    // Suspend all of the GETs (with ids 0 to count - 1)
+    conn.configureEwouldBlockEngine(EWBEngineMode::SuspendSequence,
+                                    ENGINE_EWOULDBLOCK,
+                                    (1u << count) - 1);
+    for (int ii = 0; ii < count; ++ii) {
+        sendGetK(conn, name + std::to_string(ii));
+    }
+    waitForState(*control, count, false);
+
+    const auto completions = getNotificationCount(*control, "io_completions");
+    const auto signals =
+            getNotificationCount(*control, "io_completion_signals");
+
+    control->configureEwouldBlockEngine(EWBEngineMode::ResumeAll,
+                                        ENGINE_SUCCESS, 0);
+
+    std::set<std::string> keys;
+    for (int ii = 0; ii < count; ++ii) {
+        BinprotGetResponse resp;
+        conn.recvResponse(resp);
+        ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, resp.getOp());
+        ASSERT_TRUE(resp.isSuccess())
+                << memcached_status_2_text(resp.getStatus());
+        keys.insert(to_string(resp.getKey()));
+    }
+    EXPECT_EQ(size_t(count), keys.size());
+
+    EXPECT_EQ(completions + count,
+              getNotificationCount(*control, "io_completions"));
+    EXPECT_EQ(signals + 1,
+              getNotificationCount(*control, "io_completion_signals"));
+
+    conn.disableEwouldBlockEngine();
+}
+
+/**
+ * The commands on the same key as a parked GET must not be executed before
+ * it completes.
+ */
+TEST_P(UnorderedExecutionTest, SameKeyIsOrdered) {
+    auto& conn = getMcbpConnection();
+    store(conn, name, "old");
+
+    // Block the first GET
+    conn.configureEwouldBlockEngine(EWBEngineMode::Sequence,
+                                    ENGINE_EWOULDBLOCK,
+                                    0x1);
+
+    sendGetK(conn, name);
+    {
+        BinprotMutationCommand cmd;
+        cmd.setMutationType(MutationType::Set);
+        cmd.setKey(name);
+        cmd.setValue(std::string("new"));
+        conn.sendCommand(cmd);
+    }
+    sendGetK(conn, name);
+    sendNoop(conn);
+
+    BinprotGetResponse get;
+    conn.recvResponse(get);
+    ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, get.getOp());
+    ASSERT_TRUE(get.isSuccess());
+    EXPECT_EQ("old", get.getDataString());
+
+    BinprotMutationResponse set;
+    conn.recvResponse(set);
+    ASSERT_EQ(PROTOCOL_BINARY_CMD_SET, set.getOp());
+    ASSERT_TRUE(set.isSuccess());
+
+    get.clear();
+    conn.recvResponse(get);
+    ASSERT_EQ(PROTOCOL_BINARY_CMD_GETK, get.getOp());
+    ASSERT_TRUE(get.isSuccess());
+    EXPECT_EQ("new", get.getDataString());
+
+    BinprotResponse noop;
+    conn.recvResponse(noop);
+    EXPECT_EQ(PROTOCOL_BINARY_CMD_NOOP, noop.getOp());
+
+    conn.disableEwouldBlockEngine();
+}
@@ -24,11 +24,14 @@
 
 #include <memcached/util.h>
 #include <memcached/config_parser.h>
+#include <memcached/thread_placement.h>
 #include "string_utilities.h"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <thread>
+
 #define TMP_TEMPLATE "testapp_tmp_file.XXXXXXX"
 
 TEST(StringTest, safe_strtoul) {
@@ -475,3 +478,79 @@ TEST(ConfigParserTest, A) {
     EXPECT_EQ(0, fclose(error));
     remove(outfile);
 }
+
+TEST(ThreadPlacementTest, Names) {
+    for (auto placement : {cb::ThreadPlacement::None,
+                           cb::ThreadPlacement::Core,
+                           cb::ThreadPlacement::Numa}) {
+        EXPECT_EQ(placement, cb::to_thread_placement(cb::to_string(placement)));
+    }
+    EXPECT_THROW(cb::to_thread_placement("socket"), std::invalid_argument);
+}
+
+TEST(ThreadPlacementTest, CpuList) {
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}),
+              cb::CpuTopology::parseCpuList("0-3,8,10-11\n"));
+    EXPECT_TRUE(cb::CpuTopology::parseCpuList("").empty());
+    EXPECT_THROW(cb::CpuTopology::parseCpuList("a"), std::invalid_argument);
+    EXPECT_THROW(cb::CpuTopology::parseCpuList("3-1"), std::invalid_argument);
+
+    EXPECT_EQ("0-3,8,10-11",
+              cb::CpuTopology::formatCpuList({11, 10, 8, 3, 2, 1, 0}));
+    EXPECT_EQ("", cb::CpuTopology::formatCpuList({}));
+}
+
+TEST(ThreadPlacementTest, Placement) {
+    EXPECT_THROW(cb::CpuTopology({}), std::invalid_argument);
+    EXPECT_THROW(cb::CpuTopology({{0}, {}}), std::invalid_argument);
+
+    cb::CpuTopology topology({{0, 1, 2}, {3, 4, 5}});
+    EXPECT_EQ(6u, topology.getNumCpus());
+    EXPECT_EQ(1, topology.getNode(4));
+    EXPECT_EQ(-1, topology.getNode(6));
+
+    EXPECT_TRUE(topology.getPlacement(cb::ThreadPlacement::None, 0).empty());
+
+    // Consecutive threads alternate between the nodes, one core each.
+    const std::vector<std::vector<int>> cores = {{0}, {3}, {1}, {4}, {2}, {5},
+                                                 {0}};
+    for (size_t ii = 0; ii < cores.size(); ++ii) {
+        EXPECT_EQ(cores[ii],
+                  topology.getPlacement(cb::ThreadPlacement::Core, ii));
+    }
+
+    EXPECT_EQ(std::vector<int>({0, 1, 2}),
+              topology.getPlacement(cb::ThreadPlacement::Numa, 0));
+    EXPECT_EQ(std::vector<int>({3, 4, 5}),
+              topology.getPlacement(cb::ThreadPlacement::Numa, 1));
+    EXPECT_EQ(std::vector<int>({0, 1, 2}),
+              topology.getPlacement(cb::ThreadPlacement::Numa, 2));
+}
+
+TEST(ThreadPlacementTest, Ordinals) {
+    const auto first = cb::acquireThreadOrdinal();
+    const auto second = cb::acquireThreadOrdinal();
+    EXPECT_NE(first, second);
+
+    // The lowest free ordinal is reused.
+    cb::releaseThreadOrdinal(first);
+    EXPECT_EQ(first, cb::acquireThreadOrdinal());
+
+    cb::releaseThreadOrdinal(first);
+    cb::releaseThreadOrdinal(second);
+    EXPECT_THROW(cb::releaseThreadOrdinal(second), std::invalid_argument);
+}
+
+TEST(ThreadPlacementTest, BindCurrentThread) {
+    const auto& topology = cb::CpuTopology::get();
+    ASSERT_GE(topology.getNumNodes(), 1u);
+#ifdef __linux__
+    const auto cpus = topology.getPlacement(cb::ThreadPlacement::Core, 0);
+    // Bind a new thread, so this one isn't left bound.
+    std::thread thread([&cpus]() {
+        ASSERT_TRUE(cb::bindCurrentThread(cpus));
+        EXPECT_EQ(cpus.front(), cb::getCurrentCpu());
+    });
+    thread.join();
+#endif
+}